@@ -5,6 +5,10 @@
 #include "moments.h"
 #include "common.h"
 
+#if (DRAW_INSTANCE_DATA)
+#	include "drawinstances.h"
+#endif
+
 Texture2D<float4> opacity : DECLARE_TEXTURE;
 
 cbuffer ObjectVariables : DECL_OBJECT_BUFFER
@@ -23,9 +27,15 @@ struct VSOutput
 #endif
 };
 
-VSOutput vertexMain(VSInput vsIn)
+VSOutput vertexMain(VSInputEncoded vsInEncoded, uint instanceId : SV_InstanceID)
 {
-    float4 transformedPosition = mul(float4(vsIn.position, 1.0), worldTransform);
+    VSInput vsIn = decodeVertexInput(vsInEncoded);
+#if (DRAW_INSTANCE_DATA)
+    float4x4 instanceWorldTransform = drawInstances[instanceId].worldTransform;
+#else
+    float4x4 instanceWorldTransform = worldTransform;
+#endif
+    float4 transformedPosition = mul(float4(vsIn.position, 1.0), instanceWorldTransform);
 
 	VSOutput output;
     output.texCoord0 = vsIn.texCoord0;
@@ -0,0 +1,13 @@
+/*
+ * Per-instance transforms of the draw list (see DrawInstanceData),
+ * indexed by SV_InstanceID, which includes firstInstance of the draw command
+ */
+struct DrawInstance
+{
+	row_major float4x4 worldTransform;
+	row_major float4x4 worldRotationTransform;
+	row_major float4x4 previousWorldTransform;
+	row_major float4x4 previousWorldRotationTransform;
+};
+
+StructuredBuffer<DrawInstance> drawInstances : DECL_DRAW_INSTANCES_BUFFER;
@@ -4,6 +4,10 @@
 #include <options>
 #include "common.h"
 
+#if (DRAW_INSTANCE_DATA)
+#	include "drawinstances.h"
+#endif
+
 #define EnableClearCoat 0
 #define EnableIridescence 0
 
@@ -63,16 +67,27 @@ static const float ClearCoatEta = 1.76;
 static const float ClearCoatRoughness = 0.05;
 #endif
 
-VSOutput vertexMain(VSInput vsIn)
+VSOutput vertexMain(VSInputEncoded vsInEncoded, uint instanceId : SV_InstanceID)
 {
-    float4 transformedPosition = mul(float4(vsIn.position, 1.0), worldTransform);
-    float4 previousTransformedPosition = mul(float4(vsIn.position, 1.0), previousWorldTransform);
+    VSInput vsIn = decodeVertexInput(vsInEncoded);
+#if (DRAW_INSTANCE_DATA)
+    DrawInstance instance = drawInstances[instanceId];
+    float4x4 instanceWorldTransform = instance.worldTransform;
+    float4x4 instancePreviousWorldTransform = instance.previousWorldTransform;
+    float4x4 instanceWorldRotationTransform = instance.worldRotationTransform;
+#else
+    float4x4 instanceWorldTransform = worldTransform;
+    float4x4 instancePreviousWorldTransform = previousWorldTransform;
+    float4x4 instanceWorldRotationTransform = worldRotationTransform;
+#endif
+    float4 transformedPosition = mul(float4(vsIn.position, 1.0), instanceWorldTransform);
+    float4 previousTransformedPosition = mul(float4(vsIn.position, 1.0), instancePreviousWorldTransform);
 
     VSOutput vsOut;
     vsOut.texCoord0 = vsIn.texCoord0;
-    vsOut.normal = normalize(mul(float4(vsIn.normal, 0.0), worldRotationTransform).xyz);
+    vsOut.normal = normalize(mul(float4(vsIn.normal, 0.0), instanceWorldRotationTransform).xyz);
 
-    float3 tTangent = normalize(mul(float4(vsIn.tangent, 0.0), worldRotationTransform).xyz);
+    float3 tTangent = normalize(mul(float4(vsIn.tangent, 0.0), instanceWorldRotationTransform).xyz);
     float3 tBiTangent = cross(vsOut.normal, tTangent);
 
     vsOut.worldPosition =transformedPosition.xyz;
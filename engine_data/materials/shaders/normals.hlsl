@@ -15,8 +15,9 @@ struct VSOutput
 	float3 normal : NORMAL;
 };
 
-VSOutput vertexMain(VSInput vsIn)
+VSOutput vertexMain(VSInputEncoded vsInEncoded)
 {
+	VSInput vsIn = decodeVertexInput(vsInEncoded);
 	VSOutput vsOut;
 	vsOut.normal = mul(float4(vsIn.normal, 0.0), worldRotationTransform).xyz;
 	vsOut.position = mul(mul(float4(vsIn.position, 1.0), worldTransform), viewProjectionTransform);
@@ -8,6 +8,7 @@
 #include <et/app/application.h>
 #include <et/rendering/rendercontext.h>
 #include <et/rendering/base/indexarray.h>
+#include <et/rendering/base/meshoptimizer.h>
 #include <et/rendering/base/primitives.h>
 #include <et-ext/formats/fbxloader.h>
 
@@ -895,17 +896,38 @@ s3d::Mesh::Pointer FBXLoaderPrivate::loadMesh(s3d::Storage& storage, FbxMesh* me
 		result->setDeformer(deformer);
 	}
 
+	primitives::TriangleAdjacency adjacency;
+	if (!hasNormal || !hasTangents)
+		adjacency = primitives::buildTriangleAdjacency(ia, firstIndex, firstIndex + static_cast<uint32_t>(lPolygonCount), vs->capacity());
+
 	if (!hasNormal)
-		primitives::calculateNormals(vs, ia, firstIndex, firstIndex + static_cast<uint32_t>(lPolygonCount));
+		primitives::calculateNormals(vs, adjacency);
 	
 	if (!hasTangents)
-		primitives::calculateTangents(vs, ia, firstIndex, firstIndex + static_cast<uint32_t>(lPolygonCount));
+		primitives::calculateTangents(vs, adjacency);
 
 	return result;
 }
 
 void FBXLoaderPrivate::buildVertexBuffers(s3d::Storage& storage)
 {
+	/*
+	 * Skin clusters reference vertex indices, so only triangles order is optimized
+	 */
+	for (const VertexStorage::Pointer& i : storage.vertexStorages())
+	{
+		auto ci = constructionInfo.find(i.pointer());
+		if (ci == constructionInfo.end())
+			continue;
+
+		meshoptimizer::IndexRangeList ranges;
+		ranges.reserve(ci->second.size());
+		for (const RenderBatchConstructionInfo& mc : ci->second)
+			ranges.emplace_back(mc.startIndex, mc.numIndices);
+
+		meshoptimizer::optimize(i, storage.indexArray(), ranges, meshoptimizer::Option_IndicesOnly);
+	}
+
 	Buffer::Pointer primaryIndexBuffer;
 	for (const VertexStorage::Pointer& i : storage.vertexStorages())
 	{
@@ -14,6 +14,11 @@ namespace et
 {
 
 class RenderContext;
+
+/*
+ * FBX SDK importer keeps scene and GPU resources creation together, so loadAsync
+ * uses default ModelLoader::finalizeAsync and loads the whole model in one run loop iteration
+ */
 class FBXLoader : public ModelLoader
 {
 public:
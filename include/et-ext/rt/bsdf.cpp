@@ -6,6 +6,7 @@
  */
 
 #include <et-ext/rt/bsdf.h>
+#include <et-ext/rt/sampler.h>
 
 namespace et
 {
@@ -22,14 +23,14 @@ namespace rt
 #endif
 
 BSDFSample::BSDFSample(const float4& _wi, const float4& _n, const Material& mat,
-	const float4& uv, Direction _d) : Wi(_wi), n(_n), IdotN(_wi.dot(_n)), alpha(mat.roughness), dir(_d)
+	const float4& uv, PathSampler& sampler, Direction _d) : Wi(_wi), n(_n), IdotN(_wi.dot(_n)), alpha(mat.roughness), dir(_d)
 {
 	switch (mat.cls)
 	{
 	case Material::Class::Diffuse:
 	{
 		cls = BSDFSample::Class::Diffuse;
-		Wo = randomVectorOnHemisphere(float4(0.0f), n, ET_RT_DIFFUSE_DISTRIBUTION);
+		Wo = randomVectorOnHemisphere(sampler.next2D(), n, ET_RT_DIFFUSE_DISTRIBUTION);
 		color = mat.diffuse;
 		break;
 	}
@@ -37,7 +38,7 @@ BSDFSample::BSDFSample(const float4& _wi, const float4& _n, const Material& mat,
 	case Material::Class::Conductor:
 	{
 		cls = BSDFSample::Class::Reflection;
-		Wo = computeReflectionVector(Wi, n, alpha);
+		Wo = computeReflectionVector(Wi, n, alpha, sampler);
 		fresnel = fresnelShlickApproximation(1.0f, IdotN);
 		color = mat.specular;
 		break;
@@ -60,32 +61,32 @@ BSDFSample::BSDFSample(const float4& _wi, const float4& _n, const Material& mat,
 
 			float sinTheta = 1.0f - sqr(eta) * (1.0f - sqr(IdotN));
 			fresnel = (sinTheta > 0.0f) ? fresnelShlickApproximation(mat.metallness, IdotN) : 1.0f;
-			if (fastRandomFloat() <= fresnel)
+			if (sampler.next1D() <= fresnel)
 			{
 				cls = BSDFSample::Class::Reflection;
-				Wo = computeReflectionVector(Wi, n, alpha);
+				Wo = computeReflectionVector(Wi, n, alpha, sampler);
 				color = mat.specular;
 			}
 			else
 			{
 				cls = Class::Transmittance;
-				Wo = computeRefractionVector(Wi, n, eta, alpha, sinTheta, IdotN);
+				Wo = computeRefractionVector(Wi, n, eta, alpha, sinTheta, IdotN, sampler);
 				color = mat.diffuse;
 			}
 		}
 		else // non-refractive material
 		{
 			fresnel = fresnelShlickApproximation(mat.metallness, IdotN);
-			if (fastRandomFloat() <= fresnel)
+			if (sampler.next1D() <= fresnel)
 			{
 				cls = BSDFSample::Class::Reflection;
-				Wo = computeReflectionVector(Wi, n, alpha);
+				Wo = computeReflectionVector(Wi, n, alpha, sampler);
 				color = mat.specular;
 			}
 			else
 			{
 				cls = BSDFSample::Class::Diffuse;
-				Wo = randomVectorOnHemisphere(float4(0.0f), n, ET_RT_DIFFUSE_DISTRIBUTION);
+				Wo = randomVectorOnHemisphere(sampler.next2D(), n, ET_RT_DIFFUSE_DISTRIBUTION);
 				color = mat.diffuse;
 			}
 		}
@@ -101,7 +102,7 @@ BSDFSample::BSDFSample(const float4& _wi, const float4& _n, const Material& mat,
 }
 
 BSDFSample::BSDFSample(const float4& _wi, const float4& _wo, const float4& _n,
-	const Material& mat, const float4& uv, Direction _d)
+	const Material& mat, const float4& uv, PathSampler& sampler, Direction _d)
 	: Wi(_wi)
 	, Wo(_wo)
 	, n(_n)
@@ -151,7 +152,7 @@ BSDFSample::BSDFSample(const float4& _wi, const float4& _wo, const float4& _n,
 		else // non-refractive material
 		{
 			fresnel = fresnelShlickApproximation(mat.metallness, IdotN);
-			if (fastRandomFloat() <= fresnel)
+			if (sampler.next1D() <= fresnel)
 			{
 				cls = BSDFSample::Class::Reflection;
 				color = mat.specular;
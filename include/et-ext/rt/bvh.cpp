@@ -0,0 +1,513 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et-ext/rt/bvh.h>
+#include <et/core/tools.h>
+
+namespace et
+{
+namespace rt
+{
+
+namespace bvh_local
+{
+
+enum : uint32_t
+{
+	BinsCount = 16,
+	StackSize = 1024,
+	MaxLeafTriangles = TriangleBlock::Size,
+
+	/*
+	 * Child reference is either index of the node, or leaf flag and index of the triangle block
+	 */
+	LeafFlag = 0x80000000,
+	LeafIndexMask = LeafFlag - 1,
+};
+
+/*
+ * Far distance of the box is enlarged by 2 * gamma(3) (Ize 2013),
+ * so rounding errors could not make rays miss flat boxes or pass between adjacent boxes
+ */
+const float RobustFarScale = 1.0f + 2.0f * (3.0f * 0.5f * std::numeric_limits<float>::epsilon()) /
+	(1.0f - 3.0f * 0.5f * std::numeric_limits<float>::epsilon());
+
+struct Bounds
+{
+	vec3 minVertex = vec3(std::numeric_limits<float>::max());
+	vec3 maxVertex = vec3(-std::numeric_limits<float>::max());
+
+	void merge(const vec3& p)
+	{
+		minVertex = minv(minVertex, p);
+		maxVertex = maxv(maxVertex, p);
+	}
+
+	void merge(const Bounds& b)
+	{
+		minVertex = minv(minVertex, b.minVertex);
+		maxVertex = maxv(maxVertex, b.maxVertex);
+	}
+
+	float area() const
+	{
+		if (minVertex.x > maxVertex.x)
+			return 0.0f;
+
+		vec3 size = maxVertex - minVertex;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.x * size.z);
+	}
+};
+
+struct BinaryNode
+{
+	Bounds bounds;
+	uint32_t children[2]{ InvalidIndex, InvalidIndex };
+	uint32_t firstTriangle = 0;
+	uint32_t trianglesCount = 0;
+
+	bool leaf() const
+	{
+		return children[0] == InvalidIndex;
+	}
+};
+
+struct BinaryBuilder
+{
+	const Vector<Bounds>& triangleBounds;
+	const Vector<vec3>& centroids;
+	Vector<uint32_t>& indices;
+	Vector<BinaryNode> nodes;
+
+	BinaryBuilder(const Vector<Bounds>& tb, const Vector<vec3>& c, Vector<uint32_t>& i) :
+		triangleBounds(tb), centroids(c), indices(i) { }
+
+	uint32_t build(uint32_t begin, uint32_t end);
+};
+
+uint32_t BinaryBuilder::build(uint32_t begin, uint32_t end)
+{
+	uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back();
+
+	Bounds bounds;
+	Bounds centroidBounds;
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		bounds.merge(triangleBounds[indices[i]]);
+		centroidBounds.merge(centroids[indices[i]]);
+	}
+	nodes[nodeIndex].bounds = bounds;
+
+	uint32_t count = end - begin;
+	if (count <= MaxLeafTriangles)
+	{
+		nodes[nodeIndex].firstTriangle = begin;
+		nodes[nodeIndex].trianglesCount = count;
+		return nodeIndex;
+	}
+
+	vec3 extent = centroidBounds.maxVertex - centroidBounds.minVertex;
+	auto binIndex = [&centroidBounds, &extent](float value, uint32_t axis) -> uint32_t
+	{
+		float bin = static_cast<float>(BinsCount) * (value - centroidBounds.minVertex[axis]) / extent[axis];
+		return static_cast<uint32_t>(clamp(bin, 0.0f, static_cast<float>(BinsCount - 1)));
+	};
+
+	float bestCost = std::numeric_limits<float>::max();
+	uint32_t bestAxis = InvalidIndex;
+	uint32_t bestBoundary = 0;
+	for (uint32_t axis = 0; axis <= MaxAxisIndex; ++axis)
+	{
+		if (extent[axis] <= std::numeric_limits<float>::epsilon())
+			continue;
+
+		Bounds binBounds[BinsCount];
+		uint32_t binCounts[BinsCount] = { };
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			uint32_t bin = binIndex(centroids[indices[i]][axis], axis);
+			binBounds[bin].merge(triangleBounds[indices[i]]);
+			++binCounts[bin];
+		}
+
+		float rightArea[BinsCount] = { };
+		uint32_t rightCount[BinsCount] = { };
+		Bounds accumulated;
+		uint32_t accumulatedCount = 0;
+		for (uint32_t bin = BinsCount - 1; bin > 0; --bin)
+		{
+			accumulated.merge(binBounds[bin]);
+			accumulatedCount += binCounts[bin];
+			rightArea[bin] = accumulated.area();
+			rightCount[bin] = accumulatedCount;
+		}
+
+		accumulated = Bounds();
+		accumulatedCount = 0;
+		for (uint32_t boundary = 1; boundary < BinsCount; ++boundary)
+		{
+			accumulated.merge(binBounds[boundary - 1]);
+			accumulatedCount += binCounts[boundary - 1];
+			if ((accumulatedCount == 0) || (rightCount[boundary] == 0))
+				continue;
+
+			float cost = accumulated.area() * static_cast<float>(accumulatedCount) +
+				rightArea[boundary] * static_cast<float>(rightCount[boundary]);
+
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBoundary = boundary;
+			}
+		}
+	}
+
+	uint32_t middle = begin + count / 2;
+	if (bestAxis == InvalidIndex)
+	{
+		/*
+		 * All centroids are in the same point, split in the middle
+		 */
+		vec3 size = bounds.maxVertex - bounds.minVertex;
+		uint32_t axis = (size.x > size.y) ? ((size.x > size.z) ? 0 : 2) : ((size.y > size.z) ? 1 : 2);
+		std::nth_element(indices.begin() + begin, indices.begin() + middle, indices.begin() + end,
+			[this, axis](uint32_t l, uint32_t r) { return centroids[l][axis] < centroids[r][axis]; });
+	}
+	else
+	{
+		auto i = std::partition(indices.begin() + begin, indices.begin() + end, [&](uint32_t t)
+			{ return binIndex(centroids[t][bestAxis], bestAxis) < bestBoundary; });
+		middle = static_cast<uint32_t>(i - indices.begin());
+	}
+
+	uint32_t leftChild = build(begin, middle);
+	uint32_t rightChild = build(middle, end);
+	nodes[nodeIndex].children[0] = leftChild;
+	nodes[nodeIndex].children[1] = rightChild;
+	return nodeIndex;
+}
+
+/*
+ * Wide node is formed by opening the largest binary nodes until there are `Width` children
+ */
+template <uint32_t Width>
+uint32_t collapse(const Vector<BinaryNode>& binary, uint32_t binaryIndex, Vector<BVH::Node<Width>>& nodes,
+	uint32_t depth, BVH::Stats& stats)
+{
+	uint32_t children[Width] = { binaryIndex };
+	uint32_t childrenCount = 1;
+	while (childrenCount < Width)
+	{
+		uint32_t largest = InvalidIndex;
+		float largestArea = -1.0f;
+		for (uint32_t i = 0; i < childrenCount; ++i)
+		{
+			const BinaryNode& child = binary[children[i]];
+			if (!child.leaf() && (child.bounds.area() > largestArea))
+			{
+				largestArea = child.bounds.area();
+				largest = i;
+			}
+		}
+
+		if (largest == InvalidIndex)
+			break;
+
+		const BinaryNode& opened = binary[children[largest]];
+		children[largest] = opened.children[0];
+		children[childrenCount++] = opened.children[1];
+	}
+
+	uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back();
+	for (uint32_t i = 0; i < Width; ++i)
+	{
+		for (uint32_t axis = 0; axis <= MaxAxisIndex; ++axis)
+		{
+			nodes[nodeIndex].bounds[axis][i] = std::numeric_limits<float>::max();
+			nodes[nodeIndex].bounds[axis + 3][i] = -std::numeric_limits<float>::max();
+		}
+		nodes[nodeIndex].children[i] = InvalidIndex;
+	}
+
+	stats.maxDepth = std::max(stats.maxDepth, depth);
+	for (uint32_t i = 0; i < childrenCount; ++i)
+	{
+		const BinaryNode& child = binary[children[i]];
+		uint32_t reference = 0;
+		if (child.leaf())
+		{
+			ET_ASSERT(child.firstTriangle <= LeafIndexMask);
+			reference = LeafFlag | child.firstTriangle;
+			stats.minTrianglesPerLeaf = std::min(stats.minTrianglesPerLeaf, child.trianglesCount);
+			stats.maxTrianglesPerLeaf = std::max(stats.maxTrianglesPerLeaf, child.trianglesCount);
+			++stats.leafNodes;
+		}
+		else
+		{
+			reference = collapse<Width>(binary, children[i], nodes, depth + 1, stats);
+		}
+
+		BVH::Node<Width>& node = nodes[nodeIndex];
+		for (uint32_t axis = 0; axis <= MaxAxisIndex; ++axis)
+		{
+			node.bounds[axis][i] = child.bounds.minVertex[axis];
+			node.bounds[axis + 3][i] = child.bounds.maxVertex[axis];
+		}
+		node.children[i] = reference;
+	}
+	return nodeIndex;
+}
+
+struct ET_ALIGNED(16) RayData
+{
+	float4 origin[3];
+	float4 invDirection[3];
+	float originScalar[3];
+	float invDirectionScalar[3];
+
+	RayData(const Ray& ray)
+	{
+		ET_ALIGNED(16) float o[4];
+		ET_ALIGNED(16) float d[4];
+		ray.origin.loadToFloats(o);
+		ray.direction.loadToFloats(d);
+		for (uint32_t axis = 0; axis <= MaxAxisIndex; ++axis)
+		{
+			const float minComponent = 1.0e-20f;
+			float component = (std::abs(d[axis]) > minComponent) ? d[axis] : std::copysign(minComponent, d[axis]);
+			originScalar[axis] = o[axis];
+			invDirectionScalar[axis] = 1.0f / component;
+			origin[axis] = float4(originScalar[axis]);
+			invDirection[axis] = float4(invDirectionScalar[axis]);
+		}
+	}
+};
+
+template <uint32_t Width>
+inline uint32_t intersectFourChildren(const BVH::Node<Width>& node, uint32_t offset, const RayData& ray,
+	float tFar, float* distances)
+{
+	float4 tNear4(0.0f);
+	float4 tFar4(tFar);
+	for (uint32_t axis = 0; axis <= MaxAxisIndex; ++axis)
+	{
+		float4 t0 = (float4(_mm_loadu_ps(node.bounds[axis] + offset)) - ray.origin[axis]) * ray.invDirection[axis];
+		float4 t1 = (float4(_mm_loadu_ps(node.bounds[axis + 3] + offset)) - ray.origin[axis]) * ray.invDirection[axis];
+		tNear4 = tNear4.maxWith(t0.minWith(t1));
+		tFar4 = tFar4.minWith(t0.maxWith(t1) * RobustFarScale);
+	}
+	_mm_storeu_ps(distances + offset, tNear4.data());
+	return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(tNear4.data(), tFar4.data())));
+}
+
+inline uint32_t intersectChildren(const BVH::Node<4>& node, const RayData& ray, float tFar, float* distances)
+{
+	return intersectFourChildren(node, 0, ray, tFar, distances);
+}
+
+inline uint32_t intersectChildren(const BVH::Node<8>& node, const RayData& ray, float tFar, float* distances)
+{
+#if defined(__AVX__)
+	__m256 tNear8 = _mm256_setzero_ps();
+	__m256 tFar8 = _mm256_set1_ps(tFar);
+	for (uint32_t axis = 0; axis <= MaxAxisIndex; ++axis)
+	{
+		__m256 origin = _mm256_set1_ps(ray.originScalar[axis]);
+		__m256 invDirection = _mm256_set1_ps(ray.invDirectionScalar[axis]);
+		__m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.bounds[axis]), origin), invDirection);
+		__m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.bounds[axis + 3]), origin), invDirection);
+		tNear8 = _mm256_max_ps(tNear8, _mm256_min_ps(t0, t1));
+		tFar8 = _mm256_min_ps(tFar8, _mm256_mul_ps(_mm256_max_ps(t0, t1), _mm256_set1_ps(RobustFarScale)));
+	}
+	_mm256_storeu_ps(distances, tNear8);
+	return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(tNear8, tFar8, _CMP_LE_OQ)));
+#else
+	return intersectFourChildren(node, 0, ray, tFar, distances) |
+		(intersectFourChildren(node, 4, ray, tFar, distances) << 4);
+#endif
+}
+
+struct StackEntry
+{
+	uint32_t reference;
+	float distance;
+};
+
+}
+
+void BVH::build(const TriangleList& triangles, uint32_t width)
+{
+	using namespace bvh_local;
+
+	cleanUp();
+
+	uint64_t t0 = queryContinuousTimeInMilliSeconds();
+
+	Vector<Bounds> triangleBounds(triangles.size());
+	Vector<vec3> centroids(triangles.size());
+	Vector<uint32_t> indices(triangles.size());
+	for (uint32_t i = 0, e = static_cast<uint32_t>(triangles.size()); i < e; ++i)
+	{
+		const Triangle& t = triangles[i];
+		triangleBounds[i].minVertex = t.minVertex().xyz();
+		triangleBounds[i].maxVertex = t.maxVertex().xyz();
+		centroids[i] = 0.5f * (triangleBounds[i].minVertex + triangleBounds[i].maxVertex);
+		indices[i] = i;
+	}
+
+	if (triangles.empty())
+		return;
+
+	BinaryBuilder builder(triangleBounds, centroids, indices);
+	builder.nodes.reserve(2 * triangles.size() / MaxLeafTriangles + 1);
+	builder.build(0, static_cast<uint32_t>(indices.size()));
+
+	/*
+	 * Triangles of each leaf are packed into single block,
+	 * and leaf then references the block instead of the triangles range
+	 */
+	_blocks.reserve(triangles.size() / MaxLeafTriangles + 1);
+	for (BinaryNode& node : builder.nodes)
+	{
+		if (!node.leaf())
+			continue;
+
+		_blocks.emplace_back();
+		for (uint32_t lane = 0; lane < node.trianglesCount; ++lane)
+		{
+			uint32_t triangleIndex = indices[node.firstTriangle + lane];
+			_blocks.back().set(lane, triangles[triangleIndex], triangleIndex);
+		}
+		node.firstTriangle = static_cast<uint32_t>(_blocks.size() - 1);
+	}
+
+	if (width == 8)
+	{
+		collapse<8>(builder.nodes, 0, _nodes8, 0, _stats);
+		_stats.totalNodes = static_cast<uint32_t>(_nodes8.size());
+	}
+	else
+	{
+		ET_ASSERT(width == 4);
+		collapse<4>(builder.nodes, 0, _nodes4, 0, _stats);
+		_stats.totalNodes = static_cast<uint32_t>(_nodes4.size());
+	}
+
+	_width = width;
+	_stats.buildTime = queryContinuousTimeInMilliSeconds() - t0;
+}
+
+void BVH::cleanUp()
+{
+	_nodes4.clear();
+	_nodes8.clear();
+	_blocks.clear();
+	_stats = Stats();
+	_width = 0;
+}
+
+BVH::Hit BVH::intersect(const Ray& ray) const
+{
+	Hit result;
+
+	if (_width == 8)
+		intersect<8, false>(ray, _nodes8, result);
+	else if (_width == 4)
+		intersect<4, false>(ray, _nodes4, result);
+
+	return result;
+}
+
+bool BVH::occluded(const Ray& ray, float maxDistance) const
+{
+	Hit result;
+	result.distance = maxDistance;
+
+	if (_width == 8)
+		intersect<8, true>(ray, _nodes8, result);
+	else if (_width == 4)
+		intersect<4, true>(ray, _nodes4, result);
+
+	return result.triangleIndex != InvalidIndex;
+}
+
+template <uint32_t Width, bool AnyHit>
+void BVH::intersect(const Ray& ray, const Vector<Node<Width>>& nodes, Hit& result) const
+{
+	using namespace bvh_local;
+
+	RayData rayData(ray);
+	WatertightRay watertightRay(ray);
+
+	StackEntry stack[StackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, 0.0f };
+
+	while (stackSize > 0)
+	{
+		StackEntry entry = stack[--stackSize];
+		if (entry.distance > result.distance)
+			continue;
+
+		if (entry.reference & LeafFlag)
+		{
+			if (intersectLeaf(watertightRay, entry.reference, result) && AnyHit)
+				return;
+
+			continue;
+		}
+
+		const Node<Width>& node = nodes[entry.reference];
+
+		ET_ALIGNED(32) float distances[Width];
+		uint32_t mask = intersectChildren(node, rayData, result.distance, distances);
+
+		/*
+		 * Hit children are pushed from the farthest to the nearest one
+		 */
+		StackEntry hits[Width];
+		uint32_t hitsCount = 0;
+		for (uint32_t i = 0; (i < Width) && (mask != 0); ++i, mask >>= 1)
+		{
+			if (((mask & 1) == 0) || (node.children[i] == InvalidIndex))
+				continue;
+
+			uint32_t j = hitsCount++;
+			for (; (j > 0) && (hits[j - 1].distance < distances[i]); --j)
+				hits[j] = hits[j - 1];
+			hits[j] = { node.children[i], distances[i] };
+		}
+
+		ET_ASSERT(stackSize + hitsCount <= StackSize);
+		for (uint32_t i = 0; i < hitsCount; ++i)
+			stack[stackSize++] = hits[i];
+	}
+}
+
+bool BVH::intersectLeaf(const WatertightRay& ray, uint32_t reference, Hit& result) const
+{
+	using namespace bvh_local;
+
+	const TriangleBlock& block = _blocks[reference & LeafIndexMask];
+
+	float distance = 0.0f;
+	float4 barycentric;
+	uint32_t lane = intersectTriangleBlock(block, ray, Constants::epsilon, result.distance, distance, barycentric);
+	if (lane == InvalidIndex)
+		return false;
+
+	result.distance = distance;
+	result.triangleIndex = block.triangleIndex[lane];
+	result.barycentric = barycentric;
+	return true;
+}
+
+}
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et-ext/rt/triangleblock.h>
+
+namespace et {
+namespace rt {
+
+/*
+ * Wide bounding volume hierarchy: each node keeps bounds of up to 4 or 8 children
+ * in SoA layout, so all of them are tested against the ray at once (SSE, or AVX when available)
+ */
+class ET_ALIGNED(16) BVH
+{
+public:
+	enum : uint32_t
+	{
+		MaxWidth = 8
+	};
+
+	template <uint32_t Width>
+	struct ET_ALIGNED(16) Node
+	{
+		float bounds[6][Width]; /* min x, y, z and max x, y, z of the children */
+		uint32_t children[Width];
+	};
+
+	struct Stats
+	{
+		uint64_t buildTime = 0;
+		uint32_t totalNodes = 0;
+		uint32_t leafNodes = 0;
+		uint32_t maxDepth = 0;
+		uint32_t minTrianglesPerLeaf = std::numeric_limits<uint32_t>::max();
+		uint32_t maxTrianglesPerLeaf = 0;
+	};
+
+	struct ET_ALIGNED(16) Hit
+	{
+		float4 barycentric;
+		float distance = std::numeric_limits<float>::max();
+		uint32_t triangleIndex = InvalidIndex;
+	};
+
+public:
+	void build(const TriangleList&, uint32_t width);
+	void cleanUp();
+
+	Hit intersect(const Ray&) const;
+	bool occluded(const Ray&, float maxDistance) const;
+
+	Stats nodesStatistics() const {
+		return _stats;
+	}
+
+	uint32_t width() const {
+		return _width;
+	}
+
+	bool empty() const {
+		return _width == 0;
+	}
+
+private:
+	template <uint32_t Width, bool AnyHit>
+	void intersect(const Ray&, const Vector<Node<Width>>&, Hit&) const;
+
+	bool intersectLeaf(const WatertightRay&, uint32_t, Hit&) const;
+
+private:
+	Vector<Node<4>> _nodes4;
+	Vector<Node<8>> _nodes8;
+	Vector<TriangleBlock> _blocks;
+	Stats _stats;
+	uint32_t _width = 0;
+};
+
+}
+}
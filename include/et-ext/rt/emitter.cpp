@@ -6,6 +6,7 @@
  */
 
 #include <et-ext/rt/emitter.h>
+#include <et-ext/rt/sampler.h>
 
 namespace et
 {
@@ -17,9 +18,10 @@ UniformEmitter::UniformEmitter(const float4& color) :
 {
 }
 
-float4 UniformEmitter::samplePoint(const Scene& scene) const
+float4 UniformEmitter::samplePoint(const Scene& scene, PathSampler& sampler) const
 {
-	return randomVectorOnHemisphere(float4(0.0f), rand() % 2 ? float4(0.0f, 1.0f, 0.0f, 0.0f) : float4(0.0f, -1.0f, 0.0f, 0.0f), uniformDistribution);
+	float4 hemisphere = (sampler.next1D() < 0.5f) ? float4(0.0f, 1.0f, 0.0f, 0.0f) : float4(0.0f, -1.0f, 0.0f, 0.0f);
+	return randomVectorOnHemisphere(sampler.next2D(), hemisphere, uniformDistribution);
 }
 
 float UniformEmitter::pdf(const float4& position, const float4& direction, const float4& lightPosition, const float4& lightNormal) const
@@ -31,8 +33,7 @@ float4 UniformEmitter::evaluate(const Scene& scene, const float4& position, cons
 	float4& nrm, float4& pos, float& pdf) const
 {
 	float4 result(0.0f);
-	KDTree::TraverseResult hit = scene.kdTree.traverse(Ray(position, direction));
-	if (hit.triangleIndex == InvalidIndex)
+	if (!scene.kdTree.occluded(Ray(position, direction)))
 	{
 		pdf = 1.0f;
 		pos = position + direction * std::numeric_limits<float>::max();
@@ -47,6 +48,29 @@ EnvironmentEmitter::EnvironmentEmitter(const Image::Pointer& img) :
 {
 }
 
+float4 EnvironmentEmitter::samplePoint(const Scene& scene, PathSampler& sampler) const
+{
+	float4 hemisphere = (sampler.next1D() < 0.5f) ? float4(0.0f, 1.0f, 0.0f, 0.0f) : float4(0.0f, -1.0f, 0.0f, 0.0f);
+	return randomVectorOnHemisphere(sampler.next2D(), hemisphere, uniformDistribution);
+}
+
+float4 EnvironmentEmitter::evaluate(const Scene& scene, const float4& position, const float4& direction,
+	float4& nrm, float4& pos, float& pdf) const
+{
+	float4 result(0.0f);
+	if (!scene.kdTree.occluded(Ray(position, direction)))
+	{
+		pdf = 1.0f;
+		pos = position + direction * std::numeric_limits<float>::max();
+		nrm = direction * (-1.0f);
+
+		float phi = std::atan2(direction.cZ(), direction.cX());
+		float theta = std::asin(clamp(direction.cY(), -1.0f, 1.0f));
+		result = _image->quirectangularSample(phi, theta);
+	}
+	return result;
+}
+
 MeshEmitter::MeshEmitter(uint32_t firstTriangle, uint32_t numTriangles, uint32_t materialIndex)
 	: Emitter(Emitter::Type::Area), _firstTriangle(firstTriangle), _numTriangles(numTriangles), _materialIndex(materialIndex)
 {
@@ -61,10 +85,11 @@ void MeshEmitter::prepare(const Scene& scene)
 	}
 }
 
-float4 MeshEmitter::samplePoint(const Scene& scene) const
+float4 MeshEmitter::samplePoint(const Scene& scene, PathSampler& sampler) const
 {
-	const Triangle& emitterTriangle = scene.kdTree.triangleAtIndex(_firstTriangle + rand() % _numTriangles);
-	float4 bc = randomBarycentric();
+	uint32_t triangle = std::min(static_cast<uint32_t>(sampler.next1D() * static_cast<float>(_numTriangles)), _numTriangles - 1);
+	const Triangle& emitterTriangle = scene.kdTree.triangleAtIndex(_firstTriangle + triangle);
+	float4 bc = randomBarycentric(sampler.next2D());
 	return emitterTriangle.interpolatedPosition(bc) + float4(0.0f, 0.0f, 0.0f, 1.0f);
 }
 
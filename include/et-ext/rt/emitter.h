@@ -46,7 +46,7 @@ public:
 	virtual void prepare(const Scene&)
 		{ }
 
-	virtual float4 samplePoint(const Scene&) const
+	virtual float4 samplePoint(const Scene&, PathSampler&) const
 		{ return float4(0.0f); }
 
 	virtual float4 evaluate(const Scene&, const float4& position, const float4& direction, float4& nrm, float4& pos, float& pdf) const
@@ -73,7 +73,7 @@ public:
 
 public:
 	UniformEmitter(const float4& color);
-	float4 samplePoint(const Scene&) const override;
+	float4 samplePoint(const Scene&, PathSampler&) const override;
 	float4 evaluate(const Scene&, const float4& position, const float4& direction, float4& nrm, float4& pos, float& pdf) const override;
 	float pdf(const float4& position, const float4& direction, const float4& lightPosition, const float4& lightNormal) const override;
 
@@ -88,6 +88,8 @@ public:
 
 public:
 	EnvironmentEmitter(const Image::Pointer&);
+	float4 samplePoint(const Scene&, PathSampler&) const override;
+	float4 evaluate(const Scene&, const float4& position, const float4& direction, float4& nrm, float4& pos, float& pdf) const override;
 
 private:
 	Image::Pointer _image;
@@ -104,7 +106,7 @@ public:
 
 	uint32_t materialIndex() const override { return _materialIndex; }
 
-	float4 samplePoint(const Scene&) const override;
+	float4 samplePoint(const Scene&, PathSampler&) const override;
 	float4 evaluate(const Scene&, const float4& position, const float4& direction, float4& nrm, float4& pos, float& pdf) const override;
 	float pdf(const float4& position, const float4& direction, const float4& lightPosition, const float4& lightNormal) const override;
 
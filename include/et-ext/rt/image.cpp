@@ -12,14 +12,104 @@ namespace et
 namespace rt
 {
 
+namespace img_local
+{
+
+enum : uint32_t
+{
+	TileSizeShift = 3,
+	TileSize = 1 << TileSizeShift,
+	TileMask = TileSize - 1,
+	TexelsPerTile = TileSize * TileSize,
+};
+
+struct Level
+{
+	vec2i size;
+	int tilesPerRow = 0;
+	Vector<float4> texels;
+};
+
+inline uint32_t tileMortonCode(uint32_t x, uint32_t y)
+{
+	auto spread = [](uint32_t v) { return (v & 1u) | ((v & 2u) << 1) | ((v & 4u) << 2); };
+	return spread(x) | (spread(y) << 1);
+}
+
+inline int wrap(int value, int size)
+{
+	value %= size;
+	return (value < 0) ? value + size : value;
+}
+
+float halfToFloat(uint16_t value)
+{
+	uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+	uint32_t exponent = (value >> 10) & 0x1fu;
+	uint32_t mantissa = value & 0x03ffu;
+
+	uint32_t bits = 0;
+	if (exponent == 0x1fu)
+	{
+		bits = sign | 0x7f800000u | (mantissa << 13);
+	}
+	else if (exponent > 0)
+	{
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	else if (mantissa > 0)
+	{
+		float denormal = static_cast<float>(mantissa) / static_cast<float>(1 << 24);
+		return sign ? -denormal : denormal;
+	}
+	else
+	{
+		bits = sign;
+	}
+
+	float result = 0.0f;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+}
+
 class ImagePrivate
 {
 public:
+	void build(const TextureDescription&);
+	void setLevelSize(img_local::Level&, const vec2i&);
+	void buildMipLevel(const img_local::Level& source, img_local::Level& target);
+	bool convertTexels(const TextureDescription&, Vector<float4>&);
+
+	float4& texel(img_local::Level&, int x, int y);
+	const float4& texel(const img_local::Level&, int x, int y) const;
+
+	template <bool ClampVertical>
+	float4 bilinearSample(const img_local::Level&, float u, float v) const;
+
+public:
+	Vector<img_local::Level> levels;
 };
 
-Image::Image(const TextureDescription::Pointer) 
+Image::Image(const TextureDescription::Pointer desc)
 {
 	ET_PIMPL_INIT(Image);
+
+	if (desc.valid())
+	{
+		_private->build(desc.reference());
+	}
+	else
+	{
+		log::error("Image: texture description is not valid");
+	}
+
+	if (_private->levels.empty())
+	{
+		_private->levels.emplace_back();
+		_private->setLevelSize(_private->levels.back(), vec2i(1));
+	}
 }
 
 Image::~Image() 
@@ -27,19 +117,242 @@ Image::~Image()
 	ET_PIMPL_FINALIZE(Image);
 }
 
-float4 Image::pointSample(uint32_t x, uint32_t y) 
+const vec2i& Image::size() const
+{
+	return _private->levels.front().size;
+}
+
+uint32_t Image::levelCount() const
+{
+	return static_cast<uint32_t>(_private->levels.size());
+}
+
+float4 Image::pointSample(uint32_t x, uint32_t y, uint32_t level) const
 {
-	return float4(0.5);
+	const img_local::Level& lvl = _private->levels[std::min(level, levelCount() - 1)];
+	return _private->texel(lvl, img_local::wrap(static_cast<int>(x), lvl.size.x), img_local::wrap(static_cast<int>(y), lvl.size.y));
 }
 
-rt::float4 Image::sample(float u, float v)
+float4 Image::sample(float u, float v) const
 {
-	return float4(0.333333f);
+	return _private->bilinearSample<false>(_private->levels.front(), u, v);
 }
 
-float4 Image::quirectangularSample(float phi, float theta)
+float4 Image::sample(const vec2& uv, const vec2& dUVdx, const vec2& dUVdy) const
 {
-	return float4(0.25);
+	/*
+	 * Isotropic footprint: the longest of the differentials, measured in texels of the first level
+	 */
+	const vec2i& baseSize = size();
+	vec2 texelScale(static_cast<float>(baseSize.x), static_cast<float>(baseSize.y));
+	float width = std::max((dUVdx * texelScale).length(), (dUVdy * texelScale).length());
+
+	float maxLevel = static_cast<float>(levelCount() - 1);
+	float level = (width > 1.0f) ? std::min(std::log2(width), maxLevel) : 0.0f;
+
+	uint32_t baseLevel = static_cast<uint32_t>(level);
+	float t = level - static_cast<float>(baseLevel);
+
+	float4 result = _private->bilinearSample<false>(_private->levels[baseLevel], uv.x, uv.y);
+	if ((t > 0.0f) && (baseLevel + 1 < levelCount()))
+	{
+		float4 next = _private->bilinearSample<false>(_private->levels[baseLevel + 1], uv.x, uv.y);
+		result += (next - result) * t;
+	}
+	return result;
+}
+
+float4 Image::quirectangularSample(float phi, float theta) const
+{
+	float u = 0.5f + phi / DOUBLE_PI;
+	float v = 0.5f + theta / PI;
+	return _private->bilinearSample<true>(_private->levels.front(), u, v);
+}
+
+/*
+ * Image private
+ */
+void ImagePrivate::build(const TextureDescription& desc)
+{
+	Vector<float4> linear;
+	if (!convertTexels(desc, linear))
+		return;
+
+	levels.emplace_back();
+	setLevelSize(levels.back(), desc.size);
+
+	const float4* source = linear.data();
+	for (int y = 0; y < desc.size.y; ++y)
+	{
+		for (int x = 0; x < desc.size.x; ++x, ++source)
+			texel(levels.back(), x, y) = *source;
+	}
+
+	while ((levels.back().size.x > 1) || (levels.back().size.y > 1))
+	{
+		levels.emplace_back();
+		buildMipLevel(levels[levels.size() - 2], levels.back());
+	}
+}
+
+void ImagePrivate::setLevelSize(img_local::Level& level, const vec2i& size)
+{
+	level.size = size;
+	level.tilesPerRow = (size.x + img_local::TileMask) >> img_local::TileSizeShift;
+
+	int tileRows = (size.y + img_local::TileMask) >> img_local::TileSizeShift;
+	level.texels.resize(level.tilesPerRow * tileRows * img_local::TexelsPerTile, float4(0.0f));
+}
+
+void ImagePrivate::buildMipLevel(const img_local::Level& source, img_local::Level& target)
+{
+	/*
+	 * Size is rounded up, so the last row / column of odd-sized levels is not dropped,
+	 * edge texels of such levels average the remaining source texel with itself
+	 */
+	setLevelSize(target, vec2i(std::max(1, (source.size.x + 1) / 2), std::max(1, (source.size.y + 1) / 2)));
+
+	for (int y = 0; y < target.size.y; ++y)
+	{
+		int y0 = std::min(2 * y, source.size.y - 1);
+		int y1 = std::min(2 * y + 1, source.size.y - 1);
+		for (int x = 0; x < target.size.x; ++x)
+		{
+			int x0 = std::min(2 * x, source.size.x - 1);
+			int x1 = std::min(2 * x + 1, source.size.x - 1);
+			texel(target, x, y) = (texel(source, x0, y0) + texel(source, x1, y0) +
+				texel(source, x0, y1) + texel(source, x1, y1)) * 0.25f;
+		}
+	}
+}
+
+bool ImagePrivate::convertTexels(const TextureDescription& desc, Vector<float4>& output)
+{
+	if ((desc.size.x <= 0) || (desc.size.y <= 0) || desc.data.empty())
+	{
+		log::error("Image: texture description does not contain any data");
+		return false;
+	}
+
+	uint32_t bitsPerComponent = 0;
+	bool floatComponents = false;
+	switch (desc.format)
+	{
+	case TextureFormat::R8:
+	case TextureFormat::RG8:
+	case TextureFormat::RGBA8:
+	case TextureFormat::BGRA8:
+		bitsPerComponent = 8;
+		break;
+
+	case TextureFormat::R16:
+	case TextureFormat::RG16:
+	case TextureFormat::RGBA16:
+		bitsPerComponent = 16;
+		break;
+
+	case TextureFormat::R16F:
+	case TextureFormat::RG16F:
+	case TextureFormat::RGBA16F:
+		bitsPerComponent = 16;
+		floatComponents = true;
+		break;
+
+	case TextureFormat::R32F:
+	case TextureFormat::RG32F:
+	case TextureFormat::RGBA32F:
+		bitsPerComponent = 32;
+		floatComponents = true;
+		break;
+
+	default:
+		log::error("Image: texture format %u is not supported", static_cast<uint32_t>(desc.format));
+		return false;
+	}
+	uint32_t components = bitsPerPixelForTextureFormat(desc.format) / bitsPerComponent;
+
+	uint64_t texelCount = static_cast<uint64_t>(desc.size.square());
+	if (desc.data.size() < texelCount * components * bitsPerComponent / 8)
+	{
+		log::error("Image: texture data is smaller than expected");
+		return false;
+	}
+
+	auto readComponent = [&desc, bitsPerComponent, floatComponents](uint64_t index) -> float
+	{
+		if (bitsPerComponent == 8)
+			return static_cast<float>(desc.data[index]) / 255.0f;
+
+		if (bitsPerComponent == 32)
+			return reinterpret_cast<const float*>(desc.data.data())[index];
+
+		uint16_t value = reinterpret_cast<const uint16_t*>(desc.data.data())[index];
+		return floatComponents ? img_local::halfToFloat(value) : static_cast<float>(value) / 65535.0f;
+	};
+
+	output.resize(texelCount);
+	for (uint64_t i = 0; i < texelCount; ++i)
+	{
+		float c[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		for (uint32_t j = 0; j < components; ++j)
+			c[j] = readComponent(i * components + j);
+
+		if (components == 1)
+			c[1] = c[2] = c[0];
+
+		if (desc.format == TextureFormat::BGRA8)
+			std::swap(c[0], c[2]);
+
+		output[i] = float4(c[0], c[1], c[2], c[3]);
+	}
+	return true;
+}
+
+float4& ImagePrivate::texel(img_local::Level& level, int x, int y)
+{
+	uint32_t tile = static_cast<uint32_t>((y >> img_local::TileSizeShift) * level.tilesPerRow + (x >> img_local::TileSizeShift));
+	return level.texels[tile * img_local::TexelsPerTile + img_local::tileMortonCode(x & img_local::TileMask, y & img_local::TileMask)];
+}
+
+const float4& ImagePrivate::texel(const img_local::Level& level, int x, int y) const
+{
+	uint32_t tile = static_cast<uint32_t>((y >> img_local::TileSizeShift) * level.tilesPerRow + (x >> img_local::TileSizeShift));
+	return level.texels[tile * img_local::TexelsPerTile + img_local::tileMortonCode(x & img_local::TileMask, y & img_local::TileMask)];
+}
+
+/*
+ * Horizontal coordinate is always repeated, vertical one is clamped for environment maps,
+ * so poles do not blend with the opposite side of the image
+ */
+template <bool ClampVertical>
+float4 ImagePrivate::bilinearSample(const img_local::Level& level, float u, float v) const
+{
+	float tx = u * static_cast<float>(level.size.x) - 0.5f;
+	float ty = v * static_cast<float>(level.size.y) - 0.5f;
+	float fx = std::floor(tx);
+	float fy = std::floor(ty);
+	float dx = tx - fx;
+	float dy = ty - fy;
+
+	int x0 = img_local::wrap(static_cast<int>(fx), level.size.x);
+	int x1 = (x0 + 1 < level.size.x) ? x0 + 1 : 0;
+
+	int y0 = static_cast<int>(fy);
+	int y1 = y0 + 1;
+	if (ClampVertical)
+	{
+		y0 = clamp(y0, 0, level.size.y - 1);
+		y1 = clamp(y1, 0, level.size.y - 1);
+	}
+	else
+	{
+		y0 = img_local::wrap(y0, level.size.y);
+		y1 = (y0 + 1 < level.size.y) ? y0 + 1 : 0;
+	}
+
+	float4 c0 = texel(level, x0, y0) + (texel(level, x1, y0) - texel(level, x0, y0)) * dx;
+	float4 c1 = texel(level, x0, y1) + (texel(level, x1, y1) - texel(level, x0, y1)) * dx;
+	return c0 + (c1 - c0) * dy;
 }
 
 }
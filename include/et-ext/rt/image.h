@@ -15,6 +15,10 @@ namespace et
 namespace rt
 {
 
+/*
+ * Texels are converted to float RGBA and stored in 8x8 tiles with Morton order inside,
+ * each mip level uses the same layout, so filtering footprints stay within few cache lines
+ */
 class ImagePrivate;
 class Image : public Object
 {
@@ -25,10 +29,26 @@ public:
 	Image(const TextureDescription::Pointer);
 	~Image() override;
 
-	float4 pointSample(uint32_t x, uint32_t y);
-	float4 sample(float u, float v);
+	const vec2i& size() const;
+	uint32_t levelCount() const;
+
+	float4 pointSample(uint32_t x, uint32_t y, uint32_t level = 0) const;
+
+	/*
+	 * Bilinear sample of the first level, texture coordinates are repeated
+	 */
+	float4 sample(float u, float v) const;
+
+	/*
+	 * Trilinear sample, level is selected from texture coordinate differentials
+	 * along screen x and y (ray differentials)
+	 */
+	float4 sample(const vec2& uv, const vec2& dUVdx, const vec2& dUVdy) const;
 
-	float4 quirectangularSample(float phi, float theta);
+	/*
+	 * phi - azimuth in [-pi, pi] (atan2(z, x)), theta - elevation in [-pi / 2, pi / 2] (asin(y))
+	 */
+	float4 quirectangularSample(float phi, float theta) const;
 
 private:
 	ET_DECLARE_PIMPL(Image, 256);
@@ -29,16 +29,13 @@ float4 evaluateAmbientOcclusion(Scene& scene, const Ray& inRay, Evaluate& eval)
 	{
 		++eval.pathLength;
 
-		vec4simd randomSample(fastRandomFloat(), fastRandomFloat(), 0.0f, 0.0f);
+		float4 randomSample = eval.sampler.next2D();
 
 		const Triangle& tri = scene.kdTree.triangleAtIndex(hit.triangleIndex);
 		float4 surfaceNormal = tri.interpolatedNormal(hit.intersectionPointBarycentric);
 		float4 nextDirection = randomVectorOnHemisphere(randomSample, surfaceNormal, uniformDistribution);
 
-		float4 origin = hit.intersectionPoint;
-		hit = scene.kdTree.traverse(Ray(origin, nextDirection));
-
-		if (hit.triangleIndex != InvalidIndex)
+		if (scene.kdTree.occluded(Ray(hit.intersectionPoint, nextDirection)))
 			result = float4(0.0f);
 	}
 
@@ -60,7 +57,7 @@ float4 evaluateGlobalIllumination(Scene& scene, const Ray& inRay, Evaluate& eval
 		{
 			for (const Emitter::Pointer& em : scene.emitters)
 			{
-				if (em->type() == Emitter::Type::Uniform)
+				if ((em->type() == Emitter::Type::Uniform) || (em->type() == Emitter::Type::Environment))
 				{
 					float pdf;
 					float4 nrm;
@@ -77,7 +74,7 @@ float4 evaluateGlobalIllumination(Scene& scene, const Ray& inRay, Evaluate& eval
 		float4 nrm = tri.interpolatedNormal(intersection.intersectionPointBarycentric);
 		float4 uv0 = tri.interpolatedTexCoord0(intersection.intersectionPointBarycentric);
 
-		BSDFSample bsdfSample(currentRay.direction, nrm, mtl, uv0);
+		BSDFSample bsdfSample(currentRay.direction, nrm, mtl, uv0, eval.sampler);
 
 		result += throughput * mtl.emissive;
 		throughput *= bsdfSample.evaluate();
@@ -92,7 +89,7 @@ float4 evaluateGlobalIllumination(Scene& scene, const Ray& inRay, Evaluate& eval
 			throughput.loadToFloats(local);
 			float maxComponent = std::max(local[0], std::max(local[1], local[2]));
 			float q = std::min(maxComponent, 0.95f);
-			if (rt::fastRandomFloat() >= q)
+			if (eval.sampler.next1D() >= q)
 				break;
 			throughput /= q;
 		}
@@ -20,6 +20,7 @@ struct Evaluate
 	uint32_t totalRayCount = 0;
 	uint32_t maxPathLength = 0;
 	uint32_t pathLength = 0;
+	PathSampler sampler;
 };
 
 using EvaluateFunction = float4(*)(Scene&, const Ray&, Evaluate&);
@@ -7,6 +7,8 @@
 
 #include <et-ext/rt/kdtree.h>
 #include <et/core/tools.h>
+#include <atomic>
+#include <thread>
 
 namespace et
 {
@@ -16,282 +18,378 @@ namespace rt
 const size_t DepthLimit = 128;
 const size_t MinTrianglesToSubdivide = 12;
 
+namespace kd_local
+{
+
+enum : uint32_t
+{
+	BinsCount = 32,
+	ParallelSubtreeThreshold = 4096,
+	SubtreesPerThread = 4,
+};
+
+const float TraversalCost = 1.0f;
+const float IntersectionCost = 1.5f;
+
+struct TriangleBounds
+{
+	vec3 minVertex;
+	vec3 maxVertex;
+};
+
 struct Split
 {
-	float3 cost = float3(0.0f);
-	int index = 0;
-	int axis = 0;
+	float cost = std::numeric_limits<float>::max();
+	float position = 0.0f;
+	uint32_t axis = InvalidIndex;
 };
 
-KDTree::~KDTree()
+/*
+ * Subtree, built by single thread into its own storage,
+ * local node 0 corresponds to the node `nodeIndex` of the parent task
+ */
+struct BuildTask
 {
-	cleanUp();
+	Vector<KDTree::Node> nodes;
+	Vector<BoundingBox> boundingBoxes;
+	Vector<uint32_t> indices;
+	Vector<uint32_t> triangles;
+	BoundingBox boundingBox;
+	size_t depth = 0;
+	size_t maxBuildDepth = 0;
+	uint32_t nodeIndex = 0;
+};
+
+struct BuildContext
+{
+	const Vector<TriangleBounds>& bounds;
+	size_t maxDepth = 0;
+	size_t parallelDepth = 0;
+	Vector<BuildTask>* deferredTasks = nullptr;
+
+	BuildContext(const Vector<TriangleBounds>& b, size_t md) :
+		bounds(b), maxDepth(md) { }
+};
+
+inline float surfaceArea(const vec3& size)
+{
+	return 2.0f * (size.x * size.y + size.y * size.z + size.x * size.z);
 }
 
-rt::KDTree::Node KDTree::buildRootNode()
+Split findSplit(const BuildContext& context, const Vector<uint32_t>& triangles, const BoundingBox& box)
 {
-	_intersectionData.reserve(_triangles.size());
-	_boundingBoxes.reserve(32 + _triangles.size() / 32);
-	
-	float4 minVertex = float4(+std::numeric_limits<float>::max());
-	float4 maxVertex = float4(-std::numeric_limits<float>::max());;
-	
-	for (const auto& t : _triangles)
+	Split result;
+
+	vec3 lower = box.minVertex().xyz();
+	vec3 size = box.halfSize.xyz() * 2.0f;
+	float totalArea = surfaceArea(size);
+	if (totalArea <= std::numeric_limits<float>::epsilon())
+		return result;
+
+	/*
+	 * Triangle starting in bin `i` goes to the left of every boundary above `i`,
+	 * triangle ending in bin `i` goes to the right of every boundary below or at `i`
+	 */
+	uint32_t starts[3][BinsCount] = { };
+	uint32_t ends[3][BinsCount] = { };
+
+	vec3 binScale;
+	for (uint32_t axis = 0; axis <= MaxAxisIndex; ++axis)
+		binScale[axis] = (size[axis] > Constants::epsilon) ? static_cast<float>(BinsCount) / size[axis] : 0.0f;
+
+	auto binIndex = [&binScale, &lower](float value, uint32_t axis) -> uint32_t
 	{
-		minVertex = minVertex.minWith(t.v[0]);
-		minVertex = minVertex.minWith(t.v[1]);
-		minVertex = minVertex.minWith(t.v[2]);
-		maxVertex = maxVertex.maxWith(t.v[0]);
-		maxVertex = maxVertex.maxWith(t.v[1]);
-		maxVertex = maxVertex.maxWith(t.v[2]);
-		_intersectionData.emplace_back(t.v[0], t.edge1to0, t.edge2to0);
-	}
-	
-	float4 center = (minVertex + maxVertex) * float4(0.5f);
-	float4 halfSize = (maxVertex - minVertex) * float4(0.5f);
-	_indices.reserve(16 * _triangles.size());
-	
-	_boundingBoxes.clear();
-    _boundingBoxes.emplace_back(center, halfSize);
-	_sceneBoundingBox = _boundingBoxes.back();
+		float bin = (value - lower[axis]) * binScale[axis];
+		return static_cast<uint32_t>(clamp(bin, 0.0f, static_cast<float>(BinsCount - 1)));
+	};
 
-	KDTree::Node result;
-	result.endIndex = static_cast<uint32_t>(_triangles.size());
-	for (uint32_t i = 0; i < result.endIndex; ++i)
+	for (uint32_t triangleIndex : triangles)
 	{
-		_indices.emplace_back(i);
+		const TriangleBounds& tb = context.bounds[triangleIndex];
+		for (uint32_t axis = 0; axis <= MaxAxisIndex; ++axis)
+		{
+			++starts[axis][binIndex(tb.minVertex[axis], axis)];
+			++ends[axis][binIndex(tb.maxVertex[axis], axis)];
+		}
 	}
-	return result;
-}
 
-void KDTree::build(const TriangleList& triangles, size_t maxDepth)
-{
-	cleanUp();
-	
-	_maxBuildDepth = 0;
-	_triangles = triangles;
-	
-	_maxDepth = std::min(DepthLimit, maxDepth);
-	_nodes.reserve(maxDepth * maxDepth);
-	_nodes.emplace_back(buildRootNode());
+	float trianglesCount = static_cast<float>(triangles.size());
+	for (uint32_t axis = 0; axis <= MaxAxisIndex; ++axis)
+	{
+		if (binScale[axis] == 0.0f)
+			continue;
+
+		float binSize = size[axis] / static_cast<float>(BinsCount);
+		vec3 leftSize = size;
+		vec3 rightSize = size;
+		uint32_t leftCount = 0;
+		uint32_t rightCount = static_cast<uint32_t>(triangles.size());
+		for (uint32_t boundary = 1; boundary < BinsCount; ++boundary)
+		{
+			leftCount += starts[axis][boundary - 1];
+			rightCount -= ends[axis][boundary - 1];
 
-	uint64_t t0 = queryContinuousTimeInMilliSeconds();
-	splitNodeUsingSortedArray(0, 0);
-	uint64_t t1 = queryContinuousTimeInMilliSeconds();
-	log::info("kD-tree building time: %llu", t1 - t0);
+			leftSize[axis] = static_cast<float>(boundary) * binSize;
+			rightSize[axis] = size[axis] - leftSize[axis];
+
+			float cost = TraversalCost + IntersectionCost *
+				(surfaceArea(leftSize) * static_cast<float>(leftCount) +
+				surfaceArea(rightSize) * static_cast<float>(rightCount)) / totalArea;
+
+			if ((cost < result.cost) && (cost < IntersectionCost * trianglesCount))
+			{
+				result.cost = cost;
+				result.axis = axis;
+				result.position = lower[axis] + leftSize[axis];
+			}
+		}
+	}
+
+	return result;
 }
 
-void KDTree::buildSplitBoxesUsingAxisAndPosition(size_t nodeIndex, int axis, float position)
+void splitBoundingBox(const BoundingBox& box, const Split& split, BoundingBox& left, BoundingBox& right)
 {
-	auto bbox = _boundingBoxes[nodeIndex];
-	
-	float4 lowerCorner = bbox.minVertex();
-	float4 upperCorner = bbox.maxVertex();
-	
-	vec4 axisScale4(1.0f);
-	axisScale4[axis] = 0.0f;
-	
-	vec4 posScale4(0.0f);
-	posScale4[axis] = 1.0f;
-	
-	float4 axisScale(axisScale4);
-	float4 posScale(posScale4);
-	
-	float4 middlePoint = lowerCorner * axisScale + posScale * position;
-	float4 leftSize = (middlePoint - lowerCorner) * posScale * 0.5f;
-	float4 rightSize = (upperCorner - middlePoint) * posScale * 0.5f;
-	
-	_nodes[nodeIndex].axis = axis;
-	_nodes[nodeIndex].distance = position;
-	_nodes[nodeIndex].children[0] = static_cast<uint32_t>(_nodes.size());
-	_nodes.emplace_back();
-	_nodes.back().children[0] = InvalidIndex;
-	_nodes.back().children[1] = InvalidIndex;
-	_nodes.back().axis = InvalidIndex;
-	_nodes.back().distance = 0.0f;
-
-	_boundingBoxes.emplace_back(bbox.center * axisScale + posScale * (middlePoint - leftSize),
-		bbox.halfSize * axisScale + posScale * leftSize);
-
-	_nodes[nodeIndex].children[1] = static_cast<uint32_t>(_nodes.size());
-	_nodes.emplace_back();
-	_nodes.back().children[0] = InvalidIndex;
-	_nodes.back().children[1] = InvalidIndex;
-	_nodes.back().axis = InvalidIndex;
-	_nodes.back().distance = 0.0f;
-
-	_boundingBoxes.emplace_back(bbox.center * axisScale + posScale * (middlePoint + rightSize),
-		bbox.halfSize * axisScale + posScale * rightSize);
+	vec4 lower = box.minVertex().toVec4();
+	vec4 upper = box.maxVertex().toVec4();
+	vec4 middleUpper = upper;
+	vec4 middleLower = lower;
+	middleUpper[split.axis] = split.position;
+	middleLower[split.axis] = split.position;
+	left = BoundingBox(float4(lower), float4(middleUpper), 0);
+	right = BoundingBox(float4(middleLower), float4(upper), 0);
 }
 
-void KDTree::distributeTrianglesToChildren(size_t nodeIndex)
+void distributeTriangles(const BuildContext& context, const Vector<uint32_t>& triangles, const Split& split,
+	Vector<uint32_t>& left, Vector<uint32_t>& right)
 {
-	ET_ALIGNED(16) vec4 minVertex;
-	ET_ALIGNED(16) vec4 maxVertex;
-	
-	auto& node = _nodes[nodeIndex];
-
-	static Vector<uint32_t> rightIndexes;
-	rightIndexes.reserve(32 * 1024);
-	rightIndexes.clear();
-	
-	static Vector<uint32_t> leftIndexes;
-	leftIndexes.reserve(32 * 1024);
-	leftIndexes.clear();
-
-	for (uint32_t i = node.startIndex, e = node.startIndex + node.numIndexes(); i < e; ++i)
+	left.reserve(triangles.size());
+	right.reserve(triangles.size());
+	for (uint32_t triangleIndex : triangles)
 	{
-		uint32_t triIndex = _indices[i];
-		const auto& tri = _triangles[triIndex];
-		tri.minVertex().loadToFloats(minVertex.data());
-		tri.maxVertex().loadToFloats(maxVertex.data());
-		
-		if (minVertex[node.axis] > node.distance)
+		const TriangleBounds& tb = context.bounds[triangleIndex];
+		if (tb.minVertex[split.axis] > split.position)
 		{
-			rightIndexes.emplace_back(triIndex);
+			right.emplace_back(triangleIndex);
 		}
-		else if (maxVertex[node.axis] < node.distance)
+		else if (tb.maxVertex[split.axis] < split.position)
 		{
-			leftIndexes.emplace_back(triIndex);
+			left.emplace_back(triangleIndex);
 		}
 		else
 		{
-			rightIndexes.emplace_back(triIndex);
-			leftIndexes.emplace_back(triIndex);
+			left.emplace_back(triangleIndex);
+			right.emplace_back(triangleIndex);
 		}
 	}
+}
 
-	auto& left = _nodes[node.children[0]];
-	left.startIndex = static_cast<uint32_t>(_indices.size());
-	left.endIndex = left.startIndex + static_cast<uint32_t>(leftIndexes.size());
-	_indices.insert(_indices.end(), leftIndexes.begin(), leftIndexes.end());
+uint32_t buildNode(const BuildContext& context, BuildTask& task, Vector<uint32_t>& triangles,
+	const BoundingBox& box, size_t depth)
+{
+	uint32_t nodeIndex = static_cast<uint32_t>(task.nodes.size());
+	task.nodes.emplace_back();
+	task.boundingBoxes.emplace_back(box);
+	task.maxBuildDepth = std::max(task.maxBuildDepth, depth);
+
+	bool canSplit = (depth < context.maxDepth) && (triangles.size() >= MinTrianglesToSubdivide);
+
+	if (canSplit && (context.deferredTasks != nullptr) &&
+		((depth >= context.parallelDepth) || (triangles.size() < ParallelSubtreeThreshold)))
+	{
+		context.deferredTasks->emplace_back();
+		BuildTask& deferred = context.deferredTasks->back();
+		deferred.triangles.swap(triangles);
+		deferred.boundingBox = box;
+		deferred.depth = depth;
+		deferred.nodeIndex = nodeIndex;
+		return nodeIndex;
+	}
+
+	Split split;
+	if (canSplit)
+		split = findSplit(context, triangles, box);
+
+	if (split.axis == InvalidIndex)
+	{
+		KDTree::Node& leaf = task.nodes[nodeIndex];
+		leaf.startIndex = static_cast<uint32_t>(task.indices.size());
+		leaf.endIndex = leaf.startIndex + static_cast<uint32_t>(triangles.size());
+		task.indices.insert(task.indices.end(), triangles.begin(), triangles.end());
+		return nodeIndex;
+	}
+
+	Vector<uint32_t> leftTriangles;
+	Vector<uint32_t> rightTriangles;
+	distributeTriangles(context, triangles, split, leftTriangles, rightTriangles);
+	Vector<uint32_t>().swap(triangles);
+
+	BoundingBox leftBox;
+	BoundingBox rightBox;
+	splitBoundingBox(box, split, leftBox, rightBox);
 
-	auto& right = _nodes[node.children[1]];
-	right.startIndex = static_cast<uint32_t>(_indices.size());
-	right.endIndex = right.startIndex + static_cast<uint32_t>(rightIndexes.size());
-	_indices.insert(_indices.end(), rightIndexes.begin(), rightIndexes.end());
+	uint32_t leftChild = buildNode(context, task, leftTriangles, leftBox, depth + 1);
+	uint32_t rightChild = buildNode(context, task, rightTriangles, rightBox, depth + 1);
+
+	KDTree::Node& node = task.nodes[nodeIndex];
+	node.axis = split.axis;
+	node.distance = split.position;
+	node.children[0] = leftChild;
+	node.children[1] = rightChild;
+	return nodeIndex;
 }
 
-void KDTree::cleanUp()
+void mergeTask(BuildTask& target, const BuildTask& task)
 {
-	_nodes.clear();
-	_triangles.clear();
+	uint32_t nodesOffset = static_cast<uint32_t>(target.nodes.size()) - 1;
+	uint32_t indicesOffset = static_cast<uint32_t>(target.indices.size());
+
+	auto remap = [&task, nodesOffset](uint32_t index) -> uint32_t
+	{
+		if (index == InvalidIndex)
+			return InvalidIndex;
+
+		return (index == 0) ? task.nodeIndex : nodesOffset + index;
+	};
+
+	for (size_t i = 0, e = task.nodes.size(); i < e; ++i)
+	{
+		KDTree::Node node = task.nodes[i];
+		node.children[0] = remap(node.children[0]);
+		node.children[1] = remap(node.children[1]);
+		node.startIndex += indicesOffset;
+		node.endIndex += indicesOffset;
+
+		if (i == 0)
+			target.nodes[task.nodeIndex] = node;
+		else
+			target.nodes.emplace_back(node);
+	}
+
+	target.boundingBoxes.insert(target.boundingBoxes.end(), task.boundingBoxes.begin() + 1, task.boundingBoxes.end());
+	target.indices.insert(target.indices.end(), task.indices.begin(), task.indices.end());
+	target.maxBuildDepth = std::max(target.maxBuildDepth, task.maxBuildDepth);
+}
+
+}
+
+KDTree::~KDTree()
+{
+	cleanUp();
 }
 
-void KDTree::splitNodeUsingSortedArray(size_t nodeIndex, size_t depth)
+void KDTree::build(const TriangleList& triangles, size_t maxDepth, AccelerationStructure structure)
 {
-	auto numTriangles = _nodes[nodeIndex].numIndexes();
-	if ((depth > _maxDepth) || (numTriangles < MinTrianglesToSubdivide))
+	using namespace kd_local;
+
+	cleanUp();
+
+	uint64_t t0 = queryContinuousTimeInMilliSeconds();
+
+	_triangles = triangles;
+	_maxDepth = std::min(DepthLimit, maxDepth);
+
+	if (structure != AccelerationStructure::KDTree)
 	{
+		_bvh.build(_triangles, (structure == AccelerationStructure::BVH8) ? 8 : 4);
+		_maxBuildDepth = _bvh.nodesStatistics().maxDepth;
+		_buildTime = queryContinuousTimeInMilliSeconds() - t0;
 		return;
 	}
-		
-	_maxBuildDepth = std::max(_maxBuildDepth, depth);
-	const auto& bbox = _boundingBoxes[nodeIndex];
-	
-	auto estimateCostAtSplit = [bbox, nodeIndex, this](float splitPlane, size_t leftTriangles,
-		size_t rightTriangles, int axis) -> float
-	{
-		ET_ASSERT((leftTriangles + rightTriangles) == _nodes[nodeIndex].numIndexes());
-		
-		const vec4& minVertex = bbox.minVertex().toVec4();
-		if (splitPlane <= minVertex[axis] + Constants::epsilon)
-			return std::numeric_limits<float>::max();
-
-		const vec4& maxVertex = bbox.maxVertex().toVec4();
-		if (splitPlane >= maxVertex[axis] - Constants::epsilon)
-			return std::numeric_limits<float>::max();
-
-		vec4 axisScale(1.0f);
-		vec4 axisOffset(0.0f);
-		axisScale[axis] = 0.0f;
-		axisOffset[axis] = splitPlane;
-		BoundingBox leftBox(bbox.minVertex(), bbox.maxVertex() * float4(axisScale) + float4(axisOffset), 0);
-		BoundingBox rightBox(bbox.minVertex() * float4(axisScale) + float4(axisOffset), bbox.maxVertex(), 0);
-		
-		float totalSquare = bbox.square();
-		float leftSquare = leftBox.square() / totalSquare;
-		float rightSquare = rightBox.square() / totalSquare;
-		float costLeft = leftSquare * float(leftTriangles);
-		float costRight = rightSquare * float(rightTriangles);
-		return costLeft + costRight;
-	};
 	
-	auto compareAndAssignMinimum = [](float& minCost, float cost) -> bool
-	{
-		bool result = (cost < minCost);
-		if (result)
-			minCost = cost;
-		return result;
-	};
+	float4 minVertex = float4(+std::numeric_limits<float>::max());
+	float4 maxVertex = float4(-std::numeric_limits<float>::max());
 	
-	const auto& localNode = _nodes[nodeIndex];
-
-	static Vector<float3> minPoints;
-	static Vector<float3> maxPoints;
-	minPoints.reserve(32 * 1024);
-	maxPoints.reserve(32 * 1024);
-
-	minPoints.clear();
-	maxPoints.clear();
-	for (uint32_t i = localNode.startIndex, e = localNode.endIndex; i < e; ++i)
+	Vector<TriangleBounds> bounds;
+	bounds.reserve(_triangles.size());
+	for (const auto& t : _triangles)
 	{
-		const auto& tri = _triangles[_indices[i]];
-		minPoints.emplace_back(tri.minVertex().xyz());
-		maxPoints.emplace_back(tri.maxVertex().xyz());
+		float4 triangleMin = t.minVertex();
+		float4 triangleMax = t.maxVertex();
+		minVertex = minVertex.minWith(triangleMin);
+		maxVertex = maxVertex.maxWith(triangleMax);
+		bounds.push_back({ triangleMin.xyz(), triangleMax.xyz() });
 	}
+	_sceneBoundingBox = BoundingBox(minVertex, maxVertex, 0);
 	
-	float3 splitPosition = minPoints[minPoints.size() / 2];
-	float3 splitCost(Constants::initialSplitValue);
+	BuildTask root;
+	root.triangles.reserve(_triangles.size());
+	for (uint32_t i = 0, e = static_cast<uint32_t>(_triangles.size()); i < e; ++i)
+		root.triangles.emplace_back(i);
 	
-	bool splitFound = false;
-	int numElements = static_cast<int>(minPoints.size());
-
-	for (int currentAxis = 0; currentAxis < 3; ++currentAxis)
+	size_t threadsCount = std::max(size_t(1), threading::maxConcurrentThreads());
+
+	/*
+	 * Top levels are built on the calling thread,
+	 * deeper subtrees are deferred and distributed across threads
+	 */
+	Vector<BuildTask> tasks;
+	BuildContext context(bounds, _maxDepth);
+	if (threadsCount > 1)
 	{
-		std::sort(minPoints.begin(), minPoints.end(), [currentAxis](const vec3& l, const vec3& r)
-			{ return l[currentAxis] < r[currentAxis]; });
-		
-		std::sort(maxPoints.begin(), maxPoints.end(), [currentAxis](const vec3& l, const vec3& r)
-			{ return l[currentAxis] < r[currentAxis]; });
+		context.deferredTasks = &tasks;
+		while ((size_t(1) << context.parallelDepth) < threadsCount * SubtreesPerThread)
+			++context.parallelDepth;
+	}
+	buildNode(context, root, root.triangles, _sceneBoundingBox, 0);
+	context.deferredTasks = nullptr;
 
-		for (int i = 1; i + 1 < numElements; ++i)
-		{
-			float costMin = estimateCostAtSplit(minPoints[i][currentAxis], i, numElements - i, currentAxis);
-			if (compareAndAssignMinimum(splitCost[currentAxis], costMin))
-			{
-				splitPosition[currentAxis] = minPoints[i][currentAxis];
-				splitFound = true;
-			}
-		}
-		
-		for (int i = numElements - 2; i > 0; --i)
+	threading::parallelFor(static_cast<uint32_t>(tasks.size()), 1, [&context, &tasks](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
 		{
-			float costMax = estimateCostAtSplit(maxPoints[i][currentAxis], i, numElements - i, currentAxis);
-			if (compareAndAssignMinimum(splitCost[currentAxis], costMax))
-			{
-				splitPosition[currentAxis] = maxPoints[i][currentAxis];
-				splitFound = true;
-			}
+			BuildTask& task = tasks[i];
+			buildNode(context, task, task.triangles, task.boundingBox, task.depth);
 		}
-	}
+	});
+	
+	for (const BuildTask& task : tasks)
+		mergeTask(root, task);
 	
-	float targetValue = std::min(splitCost.x, std::min(splitCost.y, splitCost.z));
-	for (int currentAxis = 0; splitFound && (currentAxis < 3); ++currentAxis)
+	_nodes.swap(root.nodes);
+	_boundingBoxes.swap(root.boundingBoxes);
+	_indices.swap(root.indices);
+
+	/*
+	 * Triangles of each leaf are packed into contiguous blocks
+	 */
+	for (Node& node : _nodes)
 	{
-		if (splitCost[currentAxis] == targetValue)
+		if (node.axis != InvalidIndex)
+			continue;
+
+		node.firstBlock = static_cast<uint32_t>(_leafBlocks.size());
+		for (uint32_t i = node.startIndex; i < node.endIndex; ++i)
 		{
-			buildSplitBoxesUsingAxisAndPosition(nodeIndex, currentAxis, splitPosition[currentAxis]);
-			distributeTrianglesToChildren(nodeIndex);
-			splitNodeUsingSortedArray(_nodes[nodeIndex].children[0], depth + 1);
-			splitNodeUsingSortedArray(_nodes[nodeIndex].children[1], depth + 1);
-			break;
+			uint32_t lane = (i - node.startIndex) % TriangleBlock::Size;
+			if (lane == 0)
+				_leafBlocks.emplace_back();
+			_leafBlocks.back().set(lane, _triangles[_indices[i]], _indices[i]);
 		}
 	}
+	_maxBuildDepth = root.maxBuildDepth;
+	_buildTasks = static_cast<uint32_t>(tasks.size());
+	_buildTime = queryContinuousTimeInMilliSeconds() - t0;
+}
+
+void KDTree::cleanUp()
+{
+	_nodes.clear();
+	_indices.clear();
+	_leafBlocks.clear();
+	_boundingBoxes.clear();
+	_triangles.clear();
+	_bvh.cleanUp();
+	_maxBuildDepth = 0;
+	_buildTime = 0;
+	_buildTasks = 0;
 }
 
 void KDTree::printStructure()
 {
+	if (_nodes.empty())
+		return;
+
 	printStructure(_nodes.front(), std::string());
 }
 
@@ -325,6 +423,34 @@ struct KDTreeSearchNode
 };
 
 KDTree::TraverseResult KDTree::traverse(const Ray& ray) const
+{
+	KDTree::TraverseResult result;
+	
+	if (!_bvh.empty())
+	{
+		BVH::Hit hit = _bvh.intersect(ray);
+		if (hit.triangleIndex != InvalidIndex)
+		{
+			result.triangleIndex = hit.triangleIndex;
+			result.intersectionPoint = ray.origin + ray.direction * hit.distance;
+			result.intersectionPointBarycentric = hit.barycentric;
+		}
+		return result;
+	}
+
+	return traverseTree<false>(ray, std::numeric_limits<float>::max());
+}
+
+bool KDTree::occluded(const Ray& ray, float maxDistance) const
+{
+	if (!_bvh.empty())
+		return _bvh.occluded(ray, maxDistance);
+
+	return traverseTree<true>(ray, maxDistance).triangleIndex != InvalidIndex;
+}
+
+template <bool AnyHit>
+KDTree::TraverseResult KDTree::traverseTree(const Ray& ray, float maxDistance) const
 {
 	KDTree::TraverseResult result;
 	
@@ -340,13 +466,16 @@ KDTree::TraverseResult KDTree::traverse(const Ray& ray) const
 		tNear = 0.0f;
 
 	ET_ALIGNED(16) float direction[4];
-	ray.direction.reciprocal().loadToFloats(direction);
+	/*
+	 * Exact division, approximate reciprocal is not precise enough for split distances
+	 */
+	(float4(1.0f) / ray.direction).loadToFloats(direction);
 
-	ET_ALIGNED(16) float originDivDirection[4];
-	(ray.origin / (ray.direction + rt::float4(std::numeric_limits<float>::epsilon()))).loadToFloats(originDivDirection);
+	ET_ALIGNED(16) float origin[4];
+	ray.origin.loadToFloats(origin);
     
-	const IntersectionData* intersectionDataPtr = _intersectionData.data();
-	const uint32_t* indicesPtr = _indices.data();
+	const TriangleBlock* blocksPtr = _leafBlocks.data();
+	WatertightRay watertightRay(ray);
 
 	Node localNode = _nodes.front();
 	FastStack<DepthLimit + 1, KDTreeSearchNode> traverseStack;
@@ -356,7 +485,7 @@ KDTree::TraverseResult KDTree::traverse(const Ray& ray) const
 		{
             union { float f; int i; } side = { direction[localNode.axis] };
             side.i = (side.i & 0x80000000) >> 31;
-			float tSplit = localNode.distance * direction[localNode.axis] - originDivDirection[localNode.axis];
+			float tSplit = (localNode.distance - origin[localNode.axis]) * direction[localNode.axis];
             
 			if (tSplit < tNear)
 			{
@@ -378,41 +507,24 @@ KDTree::TraverseResult KDTree::traverse(const Ray& ray) const
 		{
 			result.triangleIndex = InvalidIndex;
 
-			ET_ALIGNED(16) float minDistance = std::numeric_limits<float>::max();
-			for (uint32_t i = localNode.startIndex, e = localNode.endIndex; i < e; ++i)
+			/*
+			 * Any hit closer than max distance occludes the ray, even outside of the current node;
+			 * closest hit is accepted slightly beyond the node, since distance to the split plane
+			 * is not exact
+			 */
+			float minDistance = AnyHit ? maxDistance : std::min(maxDistance, tFar + eps);
+			for (uint32_t i = localNode.firstBlock, e = localNode.firstBlock + localNode.numBlocks(); i < e; ++i)
 			{
-				uint32_t triangleIndex = indicesPtr[i];
-				IntersectionData data = intersectionDataPtr[triangleIndex];
-				
-				float4 pvec = ray.direction.crossXYZ(data.edge2to0);
-				union
+				float t = 0.0f;
+				float4 barycentric;
+				uint32_t lane = intersectTriangleBlock(blocksPtr[i], watertightRay, Constants::epsilon, minDistance, t, barycentric);
+				if (lane != InvalidIndex)
 				{
-					float f;
-					uint32_t i;
-				} det = { data.edge1to0.dot(pvec) };
-
-				if (!(det.i & 0x7fffffff))
-					continue;
-
-				float inv_dev = 1.0f / det.f;
-
-				float4 tvec = ray.origin - data.v0;
-				float u = tvec.dot(pvec) * inv_dev;
-				if ((u < 0.0f) || (u > 1.0f))
-					continue;
-
-				float4 qvec = tvec.crossXYZ(data.edge1to0);
-				float t = data.edge2to0.dot(qvec) * inv_dev;
-				if ((t < minDistance) && (t <= tFar) && (t > Constants::epsilon))
-				{
-					float v = ray.direction.dot(qvec) * inv_dev;
-					float uv = u + v;
-					if ((v >= 0.0f) && (uv <= 1.0f))
-					{
-						minDistance = t;
-						result.triangleIndex = triangleIndex;
-						result.intersectionPointBarycentric = float4(1.0f - uv, u, v, 0.0f);
-					}
+					minDistance = t;
+					result.triangleIndex = blocksPtr[i].triangleIndex[lane];
+					result.intersectionPointBarycentric = barycentric;
+					if (AnyHit)
+						break;
 				}
 			}
 
@@ -434,6 +546,12 @@ KDTree::TraverseResult KDTree::traverse(const Ray& ray) const
 		tFar = traverseStack.top().time + eps;
 
 		traverseStack.pop();
+
+		if (tNear > maxDistance)
+		{
+			result.triangleIndex = InvalidIndex;
+			return result;
+		}
 	}
 	
 	return result;
@@ -445,6 +563,23 @@ KDTree::Stats KDTree::nodesStatistics() const
 	result.totalNodes = _nodes.size();
 	result.maxDepth = _maxBuildDepth;
 	result.totalTriangles = _triangles.size();
+	result.buildTime = _buildTime;
+	result.buildTasks = _buildTasks;
+
+	if (!_bvh.empty())
+	{
+		BVH::Stats bvhStats = _bvh.nodesStatistics();
+		result.totalNodes = bvhStats.totalNodes + bvhStats.leafNodes;
+		result.innerNodes = bvhStats.totalNodes;
+		result.leafNodes = bvhStats.leafNodes;
+		result.minTrianglesPerNode = bvhStats.minTrianglesPerLeaf;
+		result.maxTrianglesPerNode = bvhStats.maxTrianglesPerLeaf;
+		result.distributedTriangles = static_cast<uint32_t>(_triangles.size());
+		if (result.leafNodes > 0)
+			result.averageTrianglesPerLeaf = static_cast<float>(result.distributedTriangles) / static_cast<float>(result.leafNodes);
+		return result;
+	}
+
 	for (const auto& node : _nodes)
 	{
 		if (node.axis == InvalidIndex)
@@ -454,6 +589,10 @@ KDTree::Stats KDTree::nodesStatistics() const
 			if (node.empty())
 				++result.emptyLeafNodes;
 		}
+		else
+		{
+			++result.innerNodes;
+		}
 		
 		if ((node.children[0] == InvalidIndex) && (node.children[1] == InvalidIndex) && (node.numIndexes() > 0))
 		{
@@ -463,6 +602,10 @@ KDTree::Stats KDTree::nodesStatistics() const
 		
 		result.distributedTriangles += node.numIndexes();
 	}
+
+	if (result.leafNodes > 0)
+		result.averageTrianglesPerLeaf = static_cast<float>(result.distributedTriangles) / static_cast<float>(result.leafNodes);
+
 	return result;
 }
 
@@ -9,6 +9,8 @@
 
 #include <stack>
 #include <et-ext/rt/raytraceobjects.h>
+#include <et-ext/rt/bvh.h>
+#include <et-ext/rt/triangleblock.h>
 
 namespace et {
 namespace rt {
@@ -21,11 +23,16 @@ public:
 		uint32_t axis = InvalidIndex;
 		uint32_t startIndex = 0;
 		uint32_t endIndex = 0;
+		uint32_t firstBlock = 0;
 
 		uint32_t numIndexes() const {
 			return endIndex - startIndex;
 		}
 
+		uint32_t numBlocks() const {
+			return (numIndexes() + TriangleBlock::Size - 1) / TriangleBlock::Size;
+		}
+
 		bool empty() const {
 			return startIndex == endIndex;
 		}
@@ -40,11 +47,15 @@ public:
 		size_t totalTriangles = 0;
 		size_t totalNodes = 0;
 		size_t maxDepth = 0;
+		uint64_t buildTime = 0;
+		uint32_t buildTasks = 0;
 		uint32_t distributedTriangles = 0;
+		uint32_t innerNodes = 0;
 		uint32_t leafNodes = 0;
 		uint32_t emptyLeafNodes = 0;
 		uint32_t maxTrianglesPerNode = 0;
 		uint32_t minTrianglesPerNode = std::numeric_limits<uint32_t>::max();
+		float averageTrianglesPerLeaf = 0.0f;
 	};
 
 	struct ET_ALIGNED(16) TraverseResult {
@@ -56,10 +67,19 @@ public:
 public:
 	~KDTree();
 
-	void build(const TriangleList&, size_t maxDepth);
+	/*
+	 * Builds tree using binned SAH, subtrees below top levels are built in parallel;
+	 * build is reentrant, so several trees could be built at the same time.
+	 * When wide BVH is requested, kd-tree nodes are not built and traversal is performed using BVH
+	 */
+	void build(const TriangleList&, size_t maxDepth, AccelerationStructure = AccelerationStructure::KDTree);
 	Stats nodesStatistics() const;
 	void cleanUp();
 
+	size_t nodesCount() const {
+		return _nodes.size();
+	}
+
 	const Node& nodeAt(size_t i) const {
 		return _nodes[i];
 	}
@@ -69,6 +89,11 @@ public:
 
 	TraverseResult traverse(const Ray& r) const;
 
+	/*
+	 * Terminates on the first hit closer than maxDistance
+	 */
+	bool occluded(const Ray&, float maxDistance = std::numeric_limits<float>::max()) const;
+
 	void printStructure();
 
 	const Triangle& triangleAtIndex(size_t) const;
@@ -76,22 +101,23 @@ public:
 private:
 	void printStructure(const Node&, const std::string&);
 
-	Node buildRootNode();
-	void splitNodeUsingSortedArray(size_t, size_t);
-	void buildSplitBoxesUsingAxisAndPosition(size_t nodeIndex, int axis, float position);
-	void distributeTrianglesToChildren(size_t nodeIndex);
+	template <bool AnyHit>
+	TraverseResult traverseTree(const Ray&, float maxDistance) const;
 
 private:
 	BoundingBox _sceneBoundingBox;
 
 	Vector<Node> _nodes;
 	Vector<uint32_t> _indices;
-	Vector<IntersectionData> _intersectionData;
+	Vector<TriangleBlock> _leafBlocks;
 	Vector<BoundingBox> _boundingBoxes;
 
 	TriangleList _triangles;
+	BVH _bvh;
 	size_t _maxDepth = 0;
 	size_t _maxBuildDepth = 0;
+	uint64_t _buildTime = 0;
+	uint32_t _buildTasks = 0;
 };
 
 template <size_t MaxElements, class T>
@@ -7,20 +7,75 @@
 
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <et-ext/rt/raytrace.h>
 #include <et-ext/rt/raytraceobjects.h>
 #include <et-ext/rt/reconstruction.h>
 #include <et-ext/rt/sampler.h>
 #include <et/app/application.h>
 #include <et/camera/camera.h>
-
-#include <et/pbr/pbr.h>
+#include <et/imaging/imagewriter.h>
 
 namespace et
 {
 namespace rt
 {
 
+namespace rtr_local
+{
+
+/*
+ * Variance estimate is not reliable for fewer samples, and relative error is not meaningful
+ * for almost black pixels, so their error is compared against this luminance
+ */
+const uint32_t MinAdaptiveSamples = 16;
+const float MinAdaptiveLuminance = 0.01f;
+
+const float4 luminanceWeights(0.2126f, 0.7152f, 0.0722f, 0.0f);
+
+/*
+ * Tiles are not split below this size
+ */
+const int MinTileSize = 4;
+
+/*
+ * Part of the region, rendered within one pass
+ */
+struct Tile
+{
+	vec2i origin = vec2i(0);
+	vec2i size = vec2i(0);
+	uint32_t firstSample = 0;
+	uint32_t samples = 0;
+};
+
+/*
+ * Written only by owning worker thread, aligned to avoid false sharing
+ */
+struct ET_ALIGNED(64) ThreadStatistics
+{
+	std::atomic<uint64_t> minTileTime{std::numeric_limits<uint64_t>::max()};
+	std::atomic<uint64_t> maxTileTime{0};
+	std::atomic<uint32_t> processedTiles{0};
+};
+
+inline uint32_t spreadBits(uint32_t x)
+{
+	x &= 0x0000ffffu;
+	x = (x | (x << 8)) & 0x00ff00ffu;
+	x = (x | (x << 4)) & 0x0f0f0f0fu;
+	x = (x | (x << 2)) & 0x33333333u;
+	x = (x | (x << 1)) & 0x55555555u;
+	return x;
+}
+
+inline uint32_t mortonCode(uint32_t x, uint32_t y)
+{
+	return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+}
+
 class ET_ALIGNED(16) RaytracePrivate
 {
 public:
@@ -39,11 +94,18 @@ public:
 	void buildScene(const s3d::Scene::Pointer&);	
 
 	void buildRegions(const vec2i& size);
-	void estimateRegionsOrder();
 
 	vec4 raytracePixel(const vec2i&, uint32_t samples, uint32_t& bounces);
+	uint32_t samplePixel(const vec2i&, uint32_t firstSample, uint32_t samples, PixelAccumulator&);
+	bool pixelConverged(const PixelAccumulator&) const;
+	void outputTile(const rtr_local::Tile&, Vector<vec4>& colors);
 
-	Region getNextRegion();
+	bool getNextTile(uint32_t& tileIndex);
+	bool beginNextPass();
+	void buildPass();
+	void splitTailTiles();
+	uint32_t samplesForPass(const Region&) const;
+	bool regionConverged(const Region&) const;
 
 	void renderSpacePartitioning();
 	void renderKDTreeRecursive(uint32_t nodeIndex, uint32_t index);
@@ -69,19 +131,29 @@ public:
 	Map<uint32_t, uint32_t> lightTriangleToIndex;
 	Vector<Region> regions;
 	Vector<float4> forwardTraceBuffer;
+	Vector<PixelAccumulator> accumulationBuffer;
+	Vector<vec4> framebuffer;
 	TriangleList lightTriangles;
 
-	std::mutex regionsLock;
+	/*
+	 * Tiles of the current pass are taken by atomic index,
+	 * lock is only used to build next pass, when all threads finished current one
+	 */
+	Vector<rtr_local::Tile> passTiles;
+	std::atomic<uint32_t> nextPassTile{0};
+	std::mutex passLock;
+	std::condition_variable passCondition;
+	uint32_t passIndex = 0;
+	uint32_t threadsAtBarrier = 0;
+
+	std::unique_ptr<rtr_local::ThreadStatistics[]> threadStatistics;
+
 	std::mutex forwardTraceBufferMutex;
 	std::atomic<bool> running{false};
 	std::atomic<uint32_t> threadCounter{0};
-	std::atomic<uint32_t> processedRegions{0};
 	std::atomic<uint64_t> startTime{0};
-	std::atomic<uint64_t> minTimePerRegion{0};
-	std::atomic<uint64_t> maxTimePerRegion{0};
-	std::atomic<uint64_t> totalTimePerRegions{0};
+	std::atomic<uint32_t> totalTiles{0};
 
-	uint32_t totalRegions = 0;
 	uint32_t flushCounter = 0;
 	vec2i viewportSize;
 	vec2i regionSize;
@@ -90,7 +162,6 @@ public:
 Raytrace::Raytrace()
 {
 	ET_PIMPL_INIT(Raytrace, this);
-	setOutputMethod([](const vec2i&, const vec4&) {});
 }
 
 Raytrace::~Raytrace()
@@ -126,7 +197,7 @@ vec4 Raytrace::performAtPoint(const vec2i& pixel)
 		color.x, color.y, color.z, std::pow(color.x, 2.2f), std::pow(color.y, 2.2f), std::pow(color.z, 2.2f),
 		bounces);
 	
-	_outputMethod(pixel, color);
+	output(pixel, color);
 
 	return color;
 }
@@ -148,7 +219,40 @@ void Raytrace::renderSpacePartitioning()
 
 void Raytrace::output(const vec2i& pos, const vec4& color)
 {
-	_outputMethod(pos, color);
+	if (_outputMethod)
+		_outputMethod(pos, color);
+}
+
+void Raytrace::outputTile(const vec2i& origin, const vec2i& size, const vec4* colors)
+{
+	if (_tileOutputMethod)
+	{
+		_tileOutputMethod(origin, size, colors);
+	}
+	else if (_outputMethod)
+	{
+		vec2i pixel;
+		for (pixel.y = 0; pixel.y < size.y; ++pixel.y)
+		{
+			for (pixel.x = 0; pixel.x < size.x; ++pixel.x, ++colors)
+				_outputMethod(origin + pixel, *colors);
+		}
+	}
+}
+
+const Vector<vec4>& Raytrace::framebuffer() const
+{
+	return _private->framebuffer;
+}
+
+bool Raytrace::saveFramebuffer(const std::string& fileName) const
+{
+	if (_private->framebuffer.empty())
+		return false;
+
+	BinaryDataStorage data(_private->framebuffer.size() * sizeof(vec4), 0);
+	etCopyMemory(data.data(), _private->framebuffer.data(), data.size());
+	return writeImageToFile(fileName, data, _private->viewportSize, 4, 32, ImageFormat_HDR, true);
 }
 
 void Raytrace::setIntegrator(EvaluateFunction eval)
@@ -163,19 +267,31 @@ bool Raytrace::running() const
 
 void Raytrace::reportProgress()
 {
-	uint32_t processedRegions = _private->processedRegions.load();
-	if (processedRegions == 0)
+	if (!_private->threadStatistics)
 		return;
 
+	uint32_t processedTiles = 0;
+	uint64_t minTime = std::numeric_limits<uint64_t>::max();
+	uint64_t maxTime = 0;
+	for (uint32_t i = 0; i < _private->scene.options.threads; ++i)
+	{
+		const rtr_local::ThreadStatistics& stats = _private->threadStatistics[i];
+		processedTiles += stats.processedTiles.load(std::memory_order_relaxed);
+		minTime = std::min(minTime, stats.minTileTime.load(std::memory_order_relaxed));
+		maxTime = std::max(maxTime, stats.maxTileTime.load(std::memory_order_relaxed));
+	}
+
+	if (processedTiles == 0)
+		return;
+
+	uint32_t totalTiles = std::max(processedTiles, _private->totalTiles.load());
 	uint64_t elapsedTime = queryContinuousTimeInMilliSeconds() - _private->startTime;
-	uint64_t minTime = _private->minTimePerRegion.load();
-	uint64_t maxTime = _private->maxTimePerRegion.load();
-	uint64_t avgTime = elapsedTime / processedRegions;
-	uint64_t remTime = (_private->totalRegions - processedRegions) * avgTime;
+	uint64_t avgTime = elapsedTime / processedTiles;
+	uint64_t remTime = (totalTiles - processedTiles) * avgTime;
 
-	log::info("[%s] region %3u / %3u, min: %llu.%03llu, max: %llu.%03llu, avg: %llu.%03llu, remaining: %llu.%03llu",
+	log::info("[%s] tile %3u / %3u, min: %llu.%03llu, max: %llu.%03llu, avg: %llu.%03llu, remaining: %llu.%03llu",
 		floatToTimeStr(static_cast<float>(elapsedTime) / 1000.0f, false).c_str(),
-		processedRegions, _private->totalRegions,
+		processedTiles, totalTiles,
 		minTime / 1000, minTime % 1000, maxTime / 1000, maxTime % 1000,
 		avgTime / 1000, avgTime % 1000, remTime / 1000, remTime % 1000);
 }
@@ -196,15 +312,18 @@ RaytracePrivate::~RaytracePrivate()
 
 void RaytracePrivate::emitWorkerThreads()
 {
-	srand(static_cast<unsigned int>(time(nullptr)));
 	startTime = queryContinuousTimeInMilliSeconds();
-	minTimePerRegion.store(std::numeric_limits<uint64_t>::max());
-	maxTimePerRegion.store(0);
 
 	forwardTraceBuffer.clear();
 	forwardTraceBuffer.resize(viewportSize.square());
 	std::fill(forwardTraceBuffer.begin(), forwardTraceBuffer.end(), float4(0.0f, 0.0f, 0.0f, 0.0f));
 
+	accumulationBuffer.clear();
+	accumulationBuffer.resize(viewportSize.square());
+
+	framebuffer.clear();
+	framebuffer.resize(viewportSize.square(), vec4(0.0f));
+
 	uint64_t totalRays = static_cast<uint64_t>(viewportSize.square()) * scene.options.raysPerPixel;
 	log::info("Rendering started: %d x %d, %llu rpp, %llu total rays",
 		viewportSize.x, viewportSize.y, static_cast<uint64_t>(scene.options.raysPerPixel), totalRays);
@@ -216,6 +335,13 @@ void RaytracePrivate::emitWorkerThreads()
 		scene.options.threads = std::thread::hardware_concurrency();
 	}
 
+	threadStatistics.reset(new rtr_local::ThreadStatistics[scene.options.threads]);
+
+	passIndex = 0;
+	threadsAtBarrier = 0;
+	totalTiles = 0;
+	buildPass();
+
 	threadCounter.store(scene.options.threads);
 	for (uint32_t i = 0; i < scene.options.threads; ++i)
 	{
@@ -246,6 +372,10 @@ void RaytracePrivate::waitForCompletion()
 void RaytracePrivate::stopWorkerThreads()
 {
 	running = false;
+	{
+		std::unique_lock<std::mutex> lock(passLock);
+	}
+	passCondition.notify_all();
 	waitForCompletion();
 }
 
@@ -274,7 +404,7 @@ void RaytracePrivate::buildScene(const s3d::Scene::Pointer& input)
 
 void RaytracePrivate::buildRegions(const vec2i& aSize)
 {
-	std::unique_lock<std::mutex> lock(regionsLock);
+	std::unique_lock<std::mutex> lock(passLock);
 	regions.clear();
 
 	regionSize = aSize;
@@ -327,22 +457,141 @@ void RaytracePrivate::buildRegions(const vec2i& aSize)
 		}
 	}
 
-	totalRegions = static_cast<uint32_t>(regions.size());
-	processedRegions.store(0);
+	/*
+	 * Morton order keeps consecutive regions close to each other on screen
+	 */
+	std::sort(regions.begin(), regions.end(), [this](const Region& l, const Region& r)
+	{
+		uint32_t lc = rtr_local::mortonCode(l.origin.x / regionSize.x, l.origin.y / regionSize.y);
+		uint32_t rc = rtr_local::mortonCode(r.origin.x / regionSize.x, r.origin.y / regionSize.y);
+		return lc < rc;
+	});
+}
+
+bool RaytracePrivate::getNextTile(uint32_t& tileIndex)
+{
+	while (running)
+	{
+		tileIndex = nextPassTile.fetch_add(1);
+		if (tileIndex < passTiles.size())
+			return true;
+
+		if (!beginNextPass())
+			break;
+	}
+	return false;
+}
+
+/*
+ * Barrier between passes: last thread, which finished current pass, builds the next one
+ */
+bool RaytracePrivate::beginNextPass()
+{
+	std::unique_lock<std::mutex> lock(passLock);
+	if (!running)
+		return false;
+
+	uint32_t currentPass = passIndex;
+	if (++threadsAtBarrier == scene.options.threads)
+	{
+		threadsAtBarrier = 0;
+		buildPass();
+		passCondition.notify_all();
+	}
+	else
+	{
+		passCondition.wait(lock, [this, currentPass]() { return (passIndex != currentPass) || !running; });
+	}
+
+	return running && !passTiles.empty();
+}
+
+void RaytracePrivate::buildPass()
+{
+	uint64_t timeBudget = static_cast<uint64_t>(1000.0f * scene.options.timeBudget);
+	bool budgetExceeded = (timeBudget > 0) && (queryContinuousTimeInMilliSeconds() - startTime > timeBudget);
+
+	passTiles.clear();
+	for (Region& rgn : regions)
+	{
+		rgn.finished = rgn.finished || (rgn.samples >= scene.options.raysPerPixel) ||
+			((rgn.samples > 0) && regionConverged(rgn));
+
+		if (rgn.finished || (budgetExceeded && (rgn.samples > 0)))
+			continue;
+
+		passTiles.emplace_back();
+		rtr_local::Tile& tile = passTiles.back();
+		tile.origin = rgn.origin;
+		tile.size = rgn.size;
+		tile.firstSample = rgn.samples;
+		tile.samples = samplesForPass(rgn);
+		rgn.samples += tile.samples;
+	}
+
+	if (scene.options.splitTailRegions)
+		splitTailTiles();
+
+	totalTiles += static_cast<uint32_t>(passTiles.size());
+	nextPassTile = 0;
+	++passIndex;
+}
+
+/*
+ * Last tiles of the pass are split into quarters,
+ * so threads run out of work at about the same time
+ */
+void RaytracePrivate::splitTailTiles()
+{
+	size_t tailSize = std::min(passTiles.size(), static_cast<size_t>(scene.options.threads));
+	Vector<rtr_local::Tile> tail(passTiles.end() - tailSize, passTiles.end());
+	passTiles.erase(passTiles.end() - tailSize, passTiles.end());
+
+	for (const rtr_local::Tile& tile : tail)
+	{
+		if ((tile.size.x < 2 * rtr_local::MinTileSize) || (tile.size.y < 2 * rtr_local::MinTileSize))
+		{
+			passTiles.emplace_back(tile);
+			continue;
+		}
+
+		vec2i half = tile.size / 2;
+		for (int y = 0; y < 2; ++y)
+		{
+			for (int x = 0; x < 2; ++x)
+			{
+				passTiles.emplace_back(tile);
+				passTiles.back().origin = tile.origin + vec2i(x, y) * half;
+				passTiles.back().size = vec2i(x ? tile.size.x - half.x : half.x, y ? tile.size.y - half.y : half.y);
+			}
+		}
+	}
+}
+
+uint32_t RaytracePrivate::samplesForPass(const Region& region) const
+{
+	uint32_t totalSamples = scene.options.raysPerPixel;
+	bool progressive = scene.options.progressive || (scene.options.noiseThreshold > 0.0f);
+	if (!progressive)
+		return totalSamples;
+
+	if (region.samples == 0)
+		return std::max(1u, std::min(scene.options.initialRaysPerPixel, totalSamples));
+
+	return std::min(region.samples, totalSamples - region.samples);
 }
 
-Region RaytracePrivate::getNextRegion()
+bool RaytracePrivate::regionConverged(const Region& region) const
 {
-	std::unique_lock<std::mutex> lock(regionsLock);
-	for (auto& rgn : regions)
+	for (int y = region.origin.y; y < region.origin.y + region.size.y; ++y)
 	{
-		if (rgn.sampled == false)
+		for (int x = region.origin.x; x < region.origin.x + region.size.x; ++x)
 		{
-			rgn.sampled = true;
-			return rgn;
+			if (!accumulationBuffer[x + y * viewportSize.x].converged)
+				return false;
 		}
 	}
-	return Region();
+	return true;
 }
 
 /*
@@ -364,11 +613,12 @@ void RaytracePrivate::visualizeSamplerThreadFunction(uint32_t index)
 		occurences.resize(randomBufferSize + 1);
 
 		log::info("Calculating random sampler distribution...");
+		RandomGenerator rng(scene.options.randomSeed, index);
 		float upper = 0.0f;
 		float lower = std::numeric_limits<float>::max();
 		for (uint32_t i = 0; i < randomBufferSamples; ++i)
 		{
-			float Xi = fastRandomFloat();
+			float Xi = rng.nextFloat();
 			uint32_t bin = static_cast<uint32_t>(static_cast<float>(randomBufferSize) * Xi);
 			occurences[bin] += 1.0f;
 			lower = std::min(lower, Xi);
@@ -454,7 +704,11 @@ void RaytracePrivate::visualizeDistributionThreadFunction(uint32_t index)
 
 	if (index == 0)
 	{
-		testDirection = float4(2.0f * fastRandomFloat() - 1.0f, 2.0f * fastRandomFloat() - 1.0f, 2.0f * fastRandomFloat() - 1.0f, 0.0f);
+		RandomGenerator rng(scene.options.randomSeed, index);
+		float x = rng.nextFloat();
+		float y = rng.nextFloat();
+		float z = rng.nextFloat();
+		testDirection = float4(2.0f * x - 1.0f, 2.0f * y - 1.0f, 2.0f * z - 1.0f, 0.0f);
 		testDirection.normalize();
 	}
 
@@ -532,6 +786,8 @@ void RaytracePrivate::forwardPathTraceThreadFunction(uint32_t threadId)
 	float imagePlaneDistanceSq = 2.0f * sqr(static_cast<float>(viewportSize.x) / std::tan(camera.fieldOfView()));
 
 	Vector<float4> localBuffer(viewportSize.square(), float4(0.0f));
+	PathSampler sampler(scene.options.pathSampler, scene.options.randomSeed);
+	uint32_t lightPathIndex = 0;
 
 	float4 cameraPos(camera.position(), 0.0f);
 	float4 cameraDir(-camera.direction(), 0.0f);
@@ -546,7 +802,7 @@ void RaytracePrivate::forwardPathTraceThreadFunction(uint32_t threadId)
 		const auto& tri = scene.kdTree.triangleAtIndex(hit.triangleIndex);
 		const auto& mat = scene.materials[tri.materialIndex];
 		float4 uv0 = tri.interpolatedTexCoord0(hit.intersectionPointBarycentric);
-		BSDFSample sample(inRay.direction, toCamera, nrm, mat, uv0, BSDFSample::Direction::Forward);
+		BSDFSample sample(inRay.direction, toCamera, nrm, mat, uv0, sampler, BSDFSample::Direction::Forward);
 
 		if (sample.OdotN <= 0.0f)
 			return;
@@ -583,17 +839,20 @@ void RaytracePrivate::forwardPathTraceThreadFunction(uint32_t threadId)
 	{
 		for (uint32_t ir = 0; running && (ir < raysPerIteration); ++ir)
 		{
-			uint32_t emitterIndex = rand() % lightTriangles.size();
+			sampler.startSample(threadId, lightPathIndex++);
+
+			uint32_t lightTrianglesCount = static_cast<uint32_t>(lightTriangles.size());
+			uint32_t emitterIndex = std::min(static_cast<uint32_t>(sampler.next1D() * static_cast<float>(lightTrianglesCount)),
+				lightTrianglesCount - 1);
 			const auto& emitterTriangle = lightTriangles[emitterIndex];
 
 			KDTree::TraverseResult source;
-			source.intersectionPointBarycentric = randomBarycentric();
+			source.intersectionPointBarycentric = randomBarycentric(sampler.next2D());
 			source.intersectionPoint = emitterTriangle.interpolatedPosition(source.intersectionPointBarycentric);
 			source.triangleIndex = lightTriangleToIndex[emitterIndex];
 
 			float4 triangleNormal = emitterTriangle.interpolatedNormal(source.intersectionPointBarycentric);
-			float4 rnd = scene.sampler.sample(ir, raysPerIteration);
-			float4 sourceDir = randomVectorOnHemisphere(rnd, triangleNormal, cosineDistribution);
+			float4 sourceDir = randomVectorOnHemisphere(sampler.next2D(), triangleNormal, cosineDistribution);
 
 			float pickProb = 1.0f / static_cast<float>(lightTriangles.size());
 			float area = emitterTriangle.area();
@@ -621,7 +880,7 @@ void RaytracePrivate::forwardPathTraceThreadFunction(uint32_t threadId)
 
 				float4 nrm = tri.interpolatedNormal(hit.intersectionPointBarycentric);
 				float4 uv0 = tri.interpolatedTexCoord0(hit.intersectionPointBarycentric);
-				BSDFSample sample(currentRay.direction, nrm, mat, uv0, BSDFSample::Direction::Forward);
+				BSDFSample sample(currentRay.direction, nrm, mat, uv0, sampler, BSDFSample::Direction::Forward);
 
 #			if (ET_RT_VISUALIZE_BRDF)
 				projectToCamera(currentRay, hit, float4(sample.bsdf()), nrm);
@@ -645,73 +904,50 @@ void RaytracePrivate::forwardPathTraceThreadFunction(uint32_t threadId)
 
 void RaytracePrivate::backwardPathTraceThreadFunction(uint32_t threadId)
 {
-	DataStorage<vec4> localData(sqr(scene.options.renderRegionSize), 0);
+	rtr_local::ThreadStatistics& stats = threadStatistics[threadId];
+	Vector<vec4> tileColors;
 
-	while (running)
+	uint32_t tileIndex = 0;
+	while (getNextTile(tileIndex))
 	{
-		auto region = getNextRegion();
-		if (region.sampled == false)
-			break;
+		const rtr_local::Tile& tile = passTiles[tileIndex];
 
 		uint64_t runTime = queryContinuousTimeInMilliSeconds();
 
 		vec2i pixel;
-		for (pixel.y = region.origin.y; pixel.y < region.origin.y + region.size.y; ++pixel.y)
+		if (owner->_outputMethod && !owner->_tileOutputMethod)
 		{
-			owner->_outputMethod(vec2i(region.origin.x, pixel.y), vec4(1.0f, 0.0f, 0.0f, 1.0f));
-			owner->_outputMethod(vec2i(region.origin.x + region.size.x - 1, pixel.y), vec4(1.0f, 0.0f, 0.0f, 1.0f));
-		}
-		for (pixel.x = region.origin.x; pixel.x < region.origin.x + region.size.x; ++pixel.x)
-		{
-			owner->_outputMethod(vec2i(pixel.x, region.origin.y), vec4(1.0f, 0.0f, 0.0f, 1.0f));
-			owner->_outputMethod(vec2i(pixel.x, region.origin.y + region.size.y - 1), vec4(1.0f, 0.0f, 0.0f, 1.0f));
+			for (pixel.y = tile.origin.y; pixel.y < tile.origin.y + tile.size.y; ++pixel.y)
+			{
+				owner->_outputMethod(vec2i(tile.origin.x, pixel.y), vec4(1.0f, 0.0f, 0.0f, 1.0f));
+				owner->_outputMethod(vec2i(tile.origin.x + tile.size.x - 1, pixel.y), vec4(1.0f, 0.0f, 0.0f, 1.0f));
+			}
+			for (pixel.x = tile.origin.x; pixel.x < tile.origin.x + tile.size.x; ++pixel.x)
+			{
+				owner->_outputMethod(vec2i(pixel.x, tile.origin.y), vec4(1.0f, 0.0f, 0.0f, 1.0f));
+				owner->_outputMethod(vec2i(pixel.x, tile.origin.y + tile.size.y - 1), vec4(1.0f, 0.0f, 0.0f, 1.0f));
+			}
 		}
 
-		uint32_t k = 0;
-		for (pixel.y = region.origin.y; running && (pixel.y < region.origin.y + region.size.y); ++pixel.y)
+		for (pixel.y = tile.origin.y; running && (pixel.y < tile.origin.y + tile.size.y); ++pixel.y)
 		{
-			for (pixel.x = region.origin.x; running && (pixel.x < region.origin.x + region.size.x); ++pixel.x)
+			for (pixel.x = tile.origin.x; running && (pixel.x < tile.origin.x + tile.size.x); ++pixel.x)
 			{
-				float s = static_cast<float>(pixel.x) / static_cast<float>(viewportSize.x);
-
-				float temperature = 750.0f + s * 12000.0f;
-				pbr::DefaultSpectrumSamples smp;
-				float* samples = smp.mutableSamples();
-
-				pbr::Spectrum::blackBodyRadiation(pbr::Spectrum::defaultWavelengths, samples, 
-					pbr::Spectrum::WavelengthSamples, temperature);
-
-				smp.toRGB(localData[k].xyz().data());
-				localData[k] /= std::max(localData[k].x, std::max(localData[k].y, localData[k].z));
-
-				const float keyPoints[] = { 2700.0f, 4000.0f, 6500.0f };
-
-				for (const float p : keyPoints)
+				PixelAccumulator& acc = accumulationBuffer[pixel.x + pixel.y * viewportSize.x];
+				if (!acc.converged)
 				{
-					if (std::abs(temperature - p) < 5.0f)
-						localData[k] = vec4(0.0f);
+					samplePixel(pixel, tile.firstSample, tile.samples, acc);
+					acc.converged = pixelConverged(acc);
 				}
-
-				uint32_t bounces = 0;
-				localData[k] = raytracePixel(pixel, scene.options.raysPerPixel, bounces);
-				++k;
 			}
 		}
 
-		k = 0;
-		for (pixel.y = region.origin.y; running && (pixel.y < region.origin.y + region.size.y); ++pixel.y)
-		{
-			for (pixel.x = region.origin.x; running && (pixel.x < region.origin.x + region.size.x); ++pixel.x)
-			{
-				owner->_outputMethod(pixel, localData[k++]);
-			}
-		}
+		outputTile(tile, tileColors);
 
-		uint64_t regionTime = queryContinuousTimeInMilliSeconds() - runTime;
-		minTimePerRegion = std::min(minTimePerRegion.load(), regionTime);
-		maxTimePerRegion = std::max(maxTimePerRegion.load(), regionTime);
-		totalTimePerRegions += regionTime;
-		++processedRegions;
+		uint64_t tileTime = queryContinuousTimeInMilliSeconds() - runTime;
+		stats.minTileTime.store(std::min(stats.minTileTime.load(std::memory_order_relaxed), tileTime), std::memory_order_relaxed);
+		stats.maxTileTime.store(std::max(stats.maxTileTime.load(std::memory_order_relaxed), tileTime), std::memory_order_relaxed);
+		stats.processedTiles.fetch_add(1, std::memory_order_relaxed);
 	}
 
 	--threadCounter;
@@ -720,7 +956,7 @@ void RaytracePrivate::backwardPathTraceThreadFunction(uint32_t threadId)
 	{
 		running = false;
 
-		if (scene.options.renderKDTree)
+		if (scene.options.renderKDTree && (scene.kdTree.nodesCount() > 0))
 			renderSpacePartitioning();
 
 		owner->reportProgress();
@@ -729,31 +965,46 @@ void RaytracePrivate::backwardPathTraceThreadFunction(uint32_t threadId)
 }
 
 vec4 RaytracePrivate::raytracePixel(const vec2i& intCoord, uint32_t samples, uint32_t& bounces)
+{
+	PixelAccumulator acc;
+	bounces = samplePixel(intCoord, 0, samples, acc);
+	return vec4((acc.color / static_cast<float>(std::max(1u, acc.samples))).xyz(), 1.0f);
+}
+
+uint32_t RaytracePrivate::samplePixel(const vec2i& intCoord, uint32_t firstSample, uint32_t samples, PixelAccumulator& acc)
 {
 	if (evaluateFunction == nullptr)
 	{
 		ET_FAIL("Integrator is not set");
-		return vec4(0.0f);
+		return 0;
 	}
 
-	float4 result(0.0f);
-	float weight = 0.0f;
 	vec2 pixelSize = vec2(1.0f) / vector2ToFloat(viewportSize);
 	vec2 baseCoordinate = vector2ToFloat(intCoord);
 
 	uint32_t rndOffset = static_cast<uint32_t>(intCoord.x + intCoord.x * intCoord.y);
 
+	/*
+	 * Samples depend only on pixel and sample index, so image does not depend on threads count and regions order
+	 */
+	uint32_t pixelIndex = static_cast<uint32_t>(intCoord.x + intCoord.y * viewportSize.x);
+	uint32_t bounces = 0;
+
 	Evaluate eval;
-	eval.totalRayCount = samples;
-	for (eval.rayIndex = 0; eval.rayIndex < eval.totalRayCount; ++eval.rayIndex)
+	eval.sampler = PathSampler(scene.options.pathSampler, scene.options.randomSeed);
+	eval.totalRayCount = firstSample + samples;
+	for (eval.rayIndex = firstSample; eval.rayIndex < eval.totalRayCount; ++eval.rayIndex)
 	{
+		eval.sampler.startSample(pixelIndex, eval.rayIndex);
+
 		vec2 normalizedCoordinate = 2.0f * (baseCoordinate) * pixelSize - vec2(1.0f);
 		ray3d baseRay = camera.castRay(normalizedCoordinate);
 		float distanceToFocalPlane = scene.focalDistance / baseRay.direction.dot(scene.centerRay.direction);
 		vec3 focalPoint = camera.position() + distanceToFocalPlane * baseRay.direction;
 
-		float phi = fastRandomFloat() * DOUBLE_PI;
-		float r = std::sqrt(fastRandomFloat());
+		float4 lensSample = eval.sampler.next2D();
+		float phi = lensSample.component<1>() * DOUBLE_PI;
+		float r = std::sqrt(lensSample.component<0>());
 		float uScale = std::sin(phi) * scene.options.apertureSize * r;
 		float vScale = std::cos(phi) * scene.options.apertureSize * r;
 		vec3 uOffset = perpendicularVector(baseRay.direction);
@@ -762,49 +1013,53 @@ vec4 RaytracePrivate::raytracePixel(const vec2i& intCoord, uint32_t samples, uin
 		vec3 shiftedOrigin = camera.position() + uOffset * uScale + vOffset * vScale;
 		vec3 shiftedDirection = (focalPoint - shiftedOrigin).normalize();
 
-		float w = 1.0f;
 		eval.rayIndex += rndOffset;
-		result += evaluateFunction(scene, ray3d(shiftedOrigin, shiftedDirection), eval) * w;
+		float4 color = evaluateFunction(scene, ray3d(shiftedOrigin, shiftedDirection), eval);
 		eval.rayIndex -= rndOffset;
-		weight += w;
+		bounces += eval.pathLength;
+
+		float luminance = color.dot(rtr_local::luminanceWeights);
+		acc.color += color;
+		acc.luminance += luminance;
+		acc.luminanceSquared += luminance * luminance;
+		++acc.samples;
 	}
-	return vec4(result.xyz() / weight, 1.0f);
+	return bounces;
 }
 
-void RaytracePrivate::estimateRegionsOrder()
+/*
+ * Tiles of the pass do not overlap and passes are separated by barrier,
+ * so framebuffer is updated without locking
+ */
+void RaytracePrivate::outputTile(const rtr_local::Tile& tile, Vector<vec4>& colors)
 {
-	const uint32_t maxSamples = 5;
-
-	const vec2i sx[maxSamples] =
-	{
-		vec2i(1, 3), vec2i(2, 3), vec2i(1, 2), vec2i(1, 3), vec2i(2, 3),
-	};
-
-	const vec2i sy[maxSamples] =
-	{
-		vec2i(1, 3), vec2i(1, 3), vec2i(1, 2), vec2i(2, 3), vec2i(2, 3),
-	};
+	colors.resize(tile.size.square());
 
-	std::random_shuffle(regions.begin(), regions.end());
-	for (auto& r : regions)
+	auto color = colors.begin();
+	for (int y = tile.origin.y; y < tile.origin.y + tile.size.y; ++y)
 	{
-		r.estimatedBounces = 0;
-		vec4 estimatedColor(0.0);
-		for (uint32_t i = 0; i < maxSamples; ++i)
+		uint32_t rowStart = static_cast<uint32_t>(tile.origin.x + y * viewportSize.x);
+		for (uint32_t i = rowStart, e = rowStart + tile.size.x; i < e; ++i, ++color)
 		{
-			uint32_t bounces = 0;
-			vec2i px = r.origin + vec2i(sx[i].x * r.size.x / sx[i].y, sy[i].x * r.size.y / sy[i].y);
-			estimatedColor += raytracePixel(px, 1, bounces);
-			r.estimatedBounces += bounces;
+			const PixelAccumulator& acc = accumulationBuffer[i];
+			*color = vec4((acc.color / static_cast<float>(std::max(1u, acc.samples))).xyz(), 1.0f);
 		}
+		std::copy(color - tile.size.x, color, framebuffer.begin() + rowStart);
 	}
 
-	std::sort(regions.begin(), regions.end(), [](const Region& l, const Region& r)
-	{
-		return l.estimatedBounces > r.estimatedBounces;
-	});
+	owner->outputTile(tile.origin, tile.size, colors.data());
+}
 
-	emitWorkerThreads();
+bool RaytracePrivate::pixelConverged(const PixelAccumulator& acc) const
+{
+	if ((scene.options.noiseThreshold <= 0.0f) || (acc.samples < rtr_local::MinAdaptiveSamples))
+		return false;
+
+	float n = static_cast<float>(acc.samples);
+	float mean = acc.luminance / n;
+	float variance = std::max(0.0f, (acc.luminanceSquared - n * mean * mean) / (n - 1.0f));
+	float standardError = std::sqrt(variance / n);
+	return standardError <= scene.options.noiseThreshold * std::max(mean, rtr_local::MinAdaptiveLuminance);
 }
 
 void RaytracePrivate::renderSpacePartitioning()
@@ -879,7 +1134,7 @@ void RaytracePrivate::renderPixel(const vec2& pixel, const vec4& color)
 	{
 		float d = length(nearPixels[i] - pixel);
 		vec2i px(static_cast<int>(nearPixels[i].x), static_cast<int>(nearPixels[i].y));
-		owner->_outputMethod(px, color * vec4(1.0f, 1.0f, 1.0f, 1.0f - d));
+		owner->output(px, color * vec4(1.0f, 1.0f, 1.0f, 1.0f - d));
 	}
 }
 
@@ -900,7 +1155,7 @@ void RaytracePrivate::fillRegionWithColor(const Region& region, const vec4& colo
 	for (pixel.y = region.origin.y; pixel.y < region.origin.y + region.size.y; ++pixel.y)
 	{
 		for (pixel.x = region.origin.x; pixel.x < region.origin.x + region.size.x; ++pixel.x)
-			owner->_outputMethod(pixel, color);
+			owner->output(pixel, color);
 	}
 }
 
@@ -929,13 +1184,10 @@ void RaytracePrivate::flushToForwardTraceBuffer(const Vector<float4>& localBuffe
 	for (uint32_t i = 0; i < forwardTraceBuffer.size(); ++i, ++dst, ++src)
 	{
 		*dst += *src;
-
-		vec4 output = dst->toVec4() * rsScale;
-		output.w = 1.0f;
-
-		vec2i px(static_cast<int>(i % viewportSize.x), static_cast<int>(i / viewportSize.x));
-		owner->output(px, output);
+		framebuffer[i] = vec4((*dst * rsScale).xyz(), 1.0f);
 	}
+
+	owner->outputTile(vec2i(0), viewportSize, framebuffer.data());
 }
 
 }
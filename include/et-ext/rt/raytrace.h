@@ -22,6 +22,12 @@ class ET_ALIGNED(16) Raytrace {
 public:
 	using OutputMethod = std::function<void(const vec2i& /* location */, const vec4& /* color */ )>;
 
+	/*
+	 * Receives completed tile at once, colors are stored row by row, size.x colors per row.
+	 * When set, it is used instead of per-pixel output method for rendered tiles
+	 */
+	using TileOutputMethod = std::function<void(const vec2i& /* origin */, const vec2i& /* size */, const vec4* /* colors */)>;
+
 public:
 	Raytrace();
 	~Raytrace();
@@ -31,9 +37,22 @@ public:
 		_outputMethod = func;
 	}
 
+	template <typename F>
+	void setTileOutputMethod(F func) {
+		_tileOutputMethod = func;
+	}
+
 	void setIntegrator(EvaluateFunction);
 
 	void output(const vec2i&, const vec4&);
+	void outputTile(const vec2i& origin, const vec2i& size, const vec4* colors);
+
+	/*
+	 * HDR image with averaged samples, updated when tiles are completed.
+	 * Tiles being rendered could be partially updated while reading it during rendering
+	 */
+	const Vector<vec4>& framebuffer() const;
+	bool saveFramebuffer(const std::string& fileName) const;
 
 	void perform(s3d::Scene::Pointer, const vec2i&);
 	vec4 performAtPoint(const vec2i&);
@@ -52,6 +71,7 @@ public:
 private:
 	friend class RaytracePrivate;
 	OutputMethod _outputMethod;
+	TileOutputMethod _tileOutputMethod;
 };
 
 }
@@ -7,6 +7,7 @@
 
 #include <et-ext/rt/raytrace.h>
 #include <et-ext/rt/raytraceobjects.h>
+#include <et-ext/rt/sampler.h>
 
 namespace et {
 namespace rt {
@@ -26,7 +27,7 @@ const float4& defaultLightDirection()
 	return d;
 }
 
-float4 computeReflectionVector(const float4& incidence, const float4& normal, float roughness)
+float4 computeReflectionVector(const float4& incidence, const float4& normal, float roughness, PathSampler& sampler)
 {
 #if (ET_RT_VISUALIZE_BRDF)
     return defaultLightDirection();
@@ -36,10 +37,10 @@ float4 computeReflectionVector(const float4& incidence, const float4& normal, fl
 #	define MAX_REFLECTION_ATTEMPTS 16
 
 	uint32_t attempts = 0;
-	auto result = randomVectorOnHemisphere(float4(0.0f), idealReflection, ggxDistribution, roughness);
+	auto result = randomVectorOnHemisphere(sampler.next2D(), idealReflection, ggxDistribution, roughness);
 	while ((result.dot(normal) <= 0.0f) && (attempts < MAX_REFLECTION_ATTEMPTS))
 	{
-		result = randomVectorOnHemisphere(float4(0.0f), idealReflection, ggxDistribution, roughness);
+		result = randomVectorOnHemisphere(sampler.next2D(), idealReflection, ggxDistribution, roughness);
 		++attempts;
 	}
 
@@ -47,22 +48,23 @@ float4 computeReflectionVector(const float4& incidence, const float4& normal, fl
 #endif
 }
 
-float4 computeRefractionVector(const float4& Wi, const float4& n, float eta, float roughness, float sinTheta, float IdotN)
+float4 computeRefractionVector(const float4& Wi, const float4& n, float eta, float roughness, float sinTheta, float IdotN,
+	PathSampler& sampler)
 {
 #	define MAX_REFRACTION_ATTEMPTS 16
 
 	ET_ASSERT(sinTheta > 0);
 
 	float4 idealRefraction = Wi * eta - n * (eta * IdotN + std::sqrt(sinTheta));
-	float4 result = randomVectorOnHemisphere(float4(0.0f), idealRefraction, ggxDistribution, roughness);
+	float4 result = randomVectorOnHemisphere(sampler.next2D(), idealRefraction, ggxDistribution, roughness);
 
 	uint32_t attempts = 0;
 	while ((result.dot(n) >= 0.0f) && (attempts < MAX_REFRACTION_ATTEMPTS))
 	{
-		result = randomVectorOnHemisphere(float4(0.0f), idealRefraction, ggxDistribution, roughness);
+		result = randomVectorOnHemisphere(sampler.next2D(), idealRefraction, ggxDistribution, roughness);
 		++attempts;
 	}
-	return randomVectorOnHemisphere(float4(0.0f), idealRefraction, ggxDistribution, roughness);
+	return result;
 }
 
 #define SIGN_MASK 0x80000000
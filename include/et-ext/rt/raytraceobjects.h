@@ -9,7 +9,6 @@
 
 #include <et/geometry/vector4-simd.h>
 #include <et/scene3d/scene3d.h>
-#include <random>
 
 namespace et
 {
@@ -18,7 +17,6 @@ namespace rt
 #define ET_RT_EVALUATE_DISTRIBUTION				0
 #define ET_RT_EVALUATE_SAMPLER					0
 #define ET_RT_VISUALIZE_BRDF					0
-#define ET_RT_USE_MT_GENERATOR					1
 
 using float3 = vector3<float>;
 using float4 = vec4simd;
@@ -48,6 +46,20 @@ enum class RaytraceMethod : uint32_t
 	ForwardLightTracing
 };
 
+enum class PathSamplerType : uint32_t
+{
+	Random,
+	Sobol,
+	Lattice
+};
+
+enum class AccelerationStructure : uint32_t
+{
+	KDTree,
+	BVH4,
+	BVH8
+};
+
 struct Options
 {
 	uint32_t threads = 0;
@@ -59,7 +71,21 @@ struct Options
 	uint32_t bsdfSamples = 1;
 	float apertureSize = 0.0f;
 	float focalDistanceCorrection = 0.0f;
+	uint32_t randomSeed = 0;
+	/*
+	 * Progressive rendering: regions are refined in passes, each pass doubles samples of the region,
+	 * starting from initialRaysPerPixel up to raysPerPixel. Adaptive sampling (enabled by non-zero
+	 * noise threshold) stops sampling pixels with relative standard error of luminance below threshold.
+	 * After time budget (in seconds) is exceeded, regions are not refined anymore
+	 */
+	bool progressive = false;
+	uint32_t initialRaysPerPixel = 4;
+	float noiseThreshold = 0.0f;
+	float timeBudget = 0.0f;
+	bool splitTailRegions = true;
 	RaytraceMethod method = RaytraceMethod::BackwardPathTracing;
+	AccelerationStructure accelerationStructure = AccelerationStructure::KDTree;
+	PathSamplerType pathSampler = PathSamplerType::Sobol;
 	bool renderKDTree = false;
 };
 
@@ -235,26 +261,66 @@ struct Region
 	vec2i origin = vec2i(0);
 	vec2i size = vec2i(0);
 	size_t estimatedBounces = 0;
-	bool sampled = false;
+	uint32_t samples = 0;
+	bool finished = false;
 };
 
-inline float fastRandomFloat()
+struct ET_ALIGNED(16) PixelAccumulator
 {
-#if (ET_RT_USE_MT_GENERATOR)
-	static std::random_device rd;
-	static std::mt19937 gen(rd());
-	static std::uniform_real_distribution<float> dis(0.0f, 1.0f);
-	return dis(gen);
-#else
-	static uint32_t seed = static_cast<uint32_t>(time(nullptr));
-	union
+	float4 color = float4(0.0f);
+	float luminance = 0.0f;
+	float luminanceSquared = 0.0f;
+	uint32_t samples = 0;
+	bool converged = false;
+};
+
+/*
+ * PCG32 generator (O'Neill, 2014): 16 bytes of state and independent streams,
+ * each pixel or worker thread owns its instance, so sequences do not depend on scheduling
+ */
+class RandomGenerator
+{
+public:
+	RandomGenerator() = default;
+
+	RandomGenerator(uint64_t seed, uint64_t stream)
+		{ reset(seed, stream); }
+
+	void reset(uint64_t seed, uint64_t stream)
 	{
-		uint32_t u;
-		float f;
-	} wrap = { ((seed *= 16807) >> 9) | 0x3f800000 };
-	return wrap.f - 1.0f;
-#endif
-}
+		_state = 0;
+		_increment = (stream << 1u) | 1u;
+		nextUInt();
+		_state += seed;
+		nextUInt();
+	}
+
+	uint32_t nextUInt()
+	{
+		uint64_t oldState = _state;
+		_state = oldState * 6364136223846793005ull + _increment;
+		uint32_t xorShifted = static_cast<uint32_t>(((oldState >> 18u) ^ oldState) >> 27u);
+		uint32_t rotation = static_cast<uint32_t>(oldState >> 59u);
+		return (xorShifted >> rotation) | (xorShifted << ((32u - rotation) & 31u));
+	}
+
+	/*
+	 * Uniformly distributed in [0, 1), upper 24 bits are used to fit float mantissa
+	 */
+	float nextFloat()
+		{ return static_cast<float>(nextUInt() >> 8) * (1.0f / 16777216.0f); }
+
+	float4 nextSample()
+	{
+		float x = nextFloat();
+		float y = nextFloat();
+		return float4(x, y, 0.0f, 0.0f);
+	}
+
+private:
+	uint64_t _state = 0x853c49e6748fea9bull;
+	uint64_t _increment = 0xda3e39cb94b95bdbull;
+};
 
 inline float4 normalize(float4 n)
 {
@@ -320,17 +386,19 @@ inline float fresnelShlickApproximation(float f0, float cosTheta)
 	return f0 + (1.0f - f0) * std::pow(1.0f - std::abs(cosTheta), 5.0f);
 }
 
-inline float4 randomBarycentric()
+inline float4 randomBarycentric(const float4& rnd)
 {
-	float r1 = std::sqrt(fastRandomFloat());
-	float r2 = fastRandomFloat();
+	float r1 = std::sqrt(rnd.component<0>());
+	float r2 = rnd.component<1>();
 	return float4(1.0f - r1, r1 * (1.0f - r2), r1 * r2, 0.0f);
 }
 
+class PathSampler;
+
 const float4& defaultLightDirection();
 
 float4 computeDiffuseVector(const float4& i, const float4& n, float r);
-float4 computeReflectionVector(const float4& i, const float4& n, float r);
-float4 computeRefractionVector(const float4& i, const float4& n, float eta, float r, float sinTheta, float IdotN);
+float4 computeReflectionVector(const float4& i, const float4& n, float r, PathSampler&);
+float4 computeRefractionVector(const float4& i, const float4& n, float eta, float r, float sinTheta, float IdotN, PathSampler&);
 }
 }
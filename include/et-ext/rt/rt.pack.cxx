@@ -1,6 +1,7 @@
 #include "raytraceobjects.h"
 
 #include "bsdf.cpp"
+#include "bvh.cpp"
 #include "integrator.cpp"
 #include "image.cpp"
 #include "kdtree.cpp"
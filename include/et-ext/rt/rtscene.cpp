@@ -146,7 +146,7 @@ void Scene::build(const Vector<SceneEntry>& geometry, const Camera::Pointer& cam
 		}
 	}
 
-	kdTree.build(triangles, options.maxKDTreeDepth);
+	kdTree.build(triangles, options.maxKDTreeDepth, options.accelerationStructure);
 
 	for (Emitter::Pointer& em : emitters)
 		em->prepare(*this);
@@ -158,13 +158,17 @@ void Scene::build(const Vector<SceneEntry>& geometry, const Camera::Pointer& cam
 	focalDistance += options.focalDistanceCorrection;
 
 	auto stats = kdTree.nodesStatistics();
-	log::info("KD-Tree statistics:\n\t%llu nodes\n\t%llu leaf nodes\n\t%llu empty leaf nodes"
+	log::info("KD-Tree statistics:\n\t%llu ms build time (%llu tasks)"
+		"\n\t%llu nodes\n\t%llu inner nodes\n\t%llu leaf nodes\n\t%llu empty leaf nodes"
 		"\n\t%llu max depth\n\t%llu min triangles per node\n\t%llu max triangles per node"
+		"\n\t%.2f average triangles per leaf"
 		"\n\t%llu total triangles\n\t%llu distributed triangles"
 		"\n\t%.2f focal distance"
 		"\n\t%.2f aperture size",
-		uint64_t(stats.totalNodes), uint64_t(stats.leafNodes), uint64_t(stats.emptyLeafNodes),
+		uint64_t(stats.buildTime), uint64_t(stats.buildTasks),
+		uint64_t(stats.totalNodes), uint64_t(stats.innerNodes), uint64_t(stats.leafNodes), uint64_t(stats.emptyLeafNodes),
 		uint64_t(stats.maxDepth), uint64_t(stats.minTrianglesPerNode), uint64_t(stats.maxTrianglesPerNode),
+		stats.averageTrianglesPerLeaf,
 		uint64_t(stats.totalTriangles), uint64_t(stats.distributedTriangles),
 		focalDistance, options.apertureSize);
 
@@ -12,6 +12,139 @@ namespace et
 namespace rt
 {
 
+namespace smp_local
+{
+
+/*
+ * Low-bias 32-bit integer hash (C. Wellons)
+ */
+inline uint32_t hash(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+inline uint32_t hashCombine(uint32_t seed, uint32_t value)
+{
+	return hash(seed ^ (value + 0x9e3779b9u + (seed << 6) + (seed >> 2)));
+}
+
+inline uint32_t reverseBits(uint32_t bits)
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return bits;
+}
+
+/*
+ * Hash-based Owen scrambling (Laine-Karras permutation over reversed bits)
+ */
+inline uint32_t nestedUniformScramble(uint32_t x, uint32_t seed)
+{
+	x = reverseBits(x);
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return reverseBits(x);
+}
+
+/*
+ * First two Sobol dimensions: van der Corput sequence and (1, 1) primitive polynomial
+ */
+inline uint32_t sobolDimension1(uint32_t index)
+{
+	uint32_t result = 0;
+	for (uint32_t v = 0x80000000u; index != 0; index >>= 1, v ^= v >> 1)
+	{
+		if (index & 1)
+			result ^= v;
+	}
+	return result;
+}
+
+inline float toUnitFloat(uint32_t x)
+{
+	return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+}
+
+/*
+ * Generators of the rank-1 lattice (plastic number based R2 sequence) and of the pixel rotations
+ * (golden ratio and square root of two), in 0.32 fixed point
+ */
+const uint32_t latticeGenerator[2] = { 0xc13fa9a9u, 0x91e10da5u };
+const uint32_t rotationGenerator[2] = { 0x9e3779b9u, 0x6a09e667u };
+
+}
+
+void PathSampler::startSample(uint32_t pixelIndex, uint32_t sampleIndex)
+{
+	_pixelIndex = pixelIndex;
+	_pixelSeed = smp_local::hashCombine(_seed, pixelIndex);
+	_sampleIndex = sampleIndex;
+	_dimension = 0;
+
+	if (_type == PathSamplerType::Random)
+		_rng.reset(smp_local::hashCombine(_seed, sampleIndex), pixelIndex);
+}
+
+uint32_t PathSampler::nextDimensionSeed()
+{
+	return smp_local::hashCombine(_pixelSeed, _dimension++);
+}
+
+float PathSampler::next1D()
+{
+	if (_type == PathSamplerType::Random)
+		return _rng.nextFloat();
+
+	return next2D().component<0>();
+}
+
+float4 PathSampler::next2D()
+{
+	using namespace smp_local;
+
+	uint32_t x = 0;
+	uint32_t y = 0;
+	switch (_type)
+	{
+	case PathSamplerType::Sobol:
+	{
+		uint32_t dimensionSeed = nextDimensionSeed();
+		uint32_t index = nestedUniformScramble(_sampleIndex, dimensionSeed);
+		x = nestedUniformScramble(reverseBits(index), hashCombine(dimensionSeed, 0));
+		y = nestedUniformScramble(sobolDimension1(index), hashCombine(dimensionSeed, 1));
+		break;
+	}
+
+	case PathSamplerType::Lattice:
+	{
+		/*
+		 * Rotation consists of the per-pixel part, so neighbour pixels get well separated offsets,
+		 * and of the random per-dimension part, shared by all pixels
+		 */
+		uint32_t dimensionSeed = hashCombine(_seed, _dimension++);
+		x = _sampleIndex * latticeGenerator[0] + _pixelIndex * rotationGenerator[0] + dimensionSeed;
+		y = _sampleIndex * latticeGenerator[1] + _pixelIndex * rotationGenerator[1] + hash(dimensionSeed);
+		break;
+	}
+
+	default:
+		return _rng.nextSample();
+	}
+
+	return float4(toUnitFloat(x), toUnitFloat(y), 0.0f, 0.0f);
+}
+
 RandomSampler::RandomSampler(uint32_t maxSamples) :
 	_maxSamples(maxSamples), _samples(0)
 {
@@ -21,14 +154,14 @@ RandomSampler::RandomSampler(uint32_t maxSamples) :
 bool RandomSampler::next(vec2& sample)
 {
 	++_samples;
-	sample.x = fastRandomFloat();
-	sample.y = fastRandomFloat();
+	sample.x = _rng.nextFloat();
+	sample.y = _rng.nextFloat();
 	return _samples <= _maxSamples;
 }
 
 float4 RandomSampler::sample(uint32_t, uint32_t)
 {
-	return float4(0.0f, 0.0f, 0.0f, 0.0f);
+	return _rng.nextSample();
 }
 
 UniformSampler::UniformSampler(uint32_t maxSamples)
@@ -66,8 +199,8 @@ bool StratifiedSampler::next(vec2 & sample)
 	{
 		float row = static_cast<float>((_samples - 1) / _gridSubdivisions);
 		float col = static_cast<float>((_samples - 1) % _gridSubdivisions);
-		sample.x = (col + _a + _b * fastRandomFloat()) * _cellSize;
-		sample.y = (row + _a + _b * fastRandomFloat()) * _cellSize;
+		sample.x = (col + _a + _b * _rng.nextFloat()) * _cellSize;
+		sample.y = (row + _a + _b * _rng.nextFloat()) * _cellSize;
 	}
 	return _samples <= _maxSamples;
 }
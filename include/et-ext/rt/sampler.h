@@ -40,6 +40,7 @@ public:
 	float4 sample(uint32_t, uint32_t);
 
 private:
+	RandomGenerator _rng;
 	uint32_t _maxSamples = 1;
 	uint32_t _samples = 0;
 };
@@ -70,10 +71,47 @@ public:
 	bool next(vec2& sample) override;
 
 private:
+	RandomGenerator _rng;
 	float _a = 0.0f;
 	float _b = 1.0f;
 };
 
+/*
+ * Per-dimension sampler of the path: each call of next1D / next2D takes the next dimension
+ * of the current sample, so the same decision along the path (lens, bsdf, roulette, ...)
+ * receives well-distributed values across samples of the pixel.
+ * Sobol points are Owen-scrambled and shuffled per dimension (Burley, 2020),
+ * lattice is an extensible rank-1 lattice, rotated per pixel along another rank-1 sequence
+ */
+class PathSampler
+{
+public:
+	PathSampler() = default;
+
+	PathSampler(PathSamplerType type, uint32_t seed) :
+		_type(type), _seed(seed) { }
+
+	void startSample(uint32_t pixelIndex, uint32_t sampleIndex);
+
+	float next1D();
+	float4 next2D();
+
+	PathSamplerType type() const
+		{ return _type; }
+
+private:
+	uint32_t nextDimensionSeed();
+
+private:
+	RandomGenerator _rng;
+	PathSamplerType _type = PathSamplerType::Random;
+	uint32_t _seed = 0;
+	uint32_t _pixelIndex = 0;
+	uint32_t _pixelSeed = 0;
+	uint32_t _sampleIndex = 0;
+	uint32_t _dimension = 0;
+};
+
 struct HammersleyQMCSampler
 {
 	void setSamplesCount(uint32_t s) 
@@ -0,0 +1,172 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et-ext/rt/raytraceobjects.h>
+
+namespace et {
+namespace rt {
+
+/*
+ * Four triangles of the leaf in SoA layout, intersected at once.
+ * Vertices are stored instead of edges, so shared edges are evaluated
+ * exactly the same way for adjacent triangles, which keeps intersection watertight
+ */
+struct ET_ALIGNED(16) TriangleBlock
+{
+	enum : uint32_t
+	{
+		Size = 4
+	};
+
+	float v0[3][Size];
+	float v1[3][Size];
+	float v2[3][Size];
+	uint32_t triangleIndex[Size];
+
+	TriangleBlock()
+	{
+		std::fill(&v0[0][0], &v2[0][0] + 3 * Size, 0.0f);
+		std::fill(triangleIndex, triangleIndex + Size, static_cast<uint32_t>(InvalidIndex));
+	}
+
+	void set(uint32_t lane, const Triangle& t, uint32_t index)
+	{
+		ET_ASSERT(lane < Size);
+
+		ET_ALIGNED(16) float values[3][4];
+		t.v[0].loadToFloats(values[0]);
+		t.v[1].loadToFloats(values[1]);
+		t.v[2].loadToFloats(values[2]);
+		for (uint32_t axis = 0; axis <= MaxAxisIndex; ++axis)
+		{
+			v0[axis][lane] = values[0][axis];
+			v1[axis][lane] = values[1][axis];
+			v2[axis][lane] = values[2][axis];
+		}
+		triangleIndex[lane] = index;
+	}
+};
+
+/*
+ * Ray transformed for watertight intersection (Woop, Benthin, Wald 2013):
+ * dominant direction axis becomes z, and ray is sheared to (0, 0, 1)
+ */
+struct ET_ALIGNED(16) WatertightRay
+{
+	float4 origin[3];
+	float4 shear[3];
+	uint32_t kx = 0;
+	uint32_t ky = 1;
+	uint32_t kz = 2;
+
+	WatertightRay(const Ray& ray)
+	{
+		ET_ALIGNED(16) float o[4];
+		ET_ALIGNED(16) float d[4];
+		ray.origin.loadToFloats(o);
+		ray.direction.loadToFloats(d);
+
+		kz = (std::abs(d[0]) > std::abs(d[1])) ? ((std::abs(d[0]) > std::abs(d[2])) ? 0 : 2) :
+			((std::abs(d[1]) > std::abs(d[2])) ? 1 : 2);
+		kx = (kz + 1) % 3;
+		ky = (kx + 1) % 3;
+		if (d[kz] < 0.0f)
+			std::swap(kx, ky);
+
+		origin[0] = float4(o[kx]);
+		origin[1] = float4(o[ky]);
+		origin[2] = float4(o[kz]);
+		shear[0] = float4(d[kx] / d[kz]);
+		shear[1] = float4(d[ky] / d[kz]);
+		shear[2] = float4(1.0f / d[kz]);
+	}
+};
+
+/*
+ * Returns lane of the closest triangle hit within (minDistance, maxDistance), or InvalidIndex.
+ * Edge functions exactly equal to zero are treated as inside, so rays hitting shared edges
+ * could not pass between triangles
+ */
+inline uint32_t intersectTriangleBlock(const TriangleBlock& block, const WatertightRay& ray,
+	float minDistance, float maxDistance, float& distance, float4& barycentric)
+{
+	auto transform = [&ray](const float (&v)[3][TriangleBlock::Size], float4& x, float4& y, float4& z)
+	{
+		z = float4(_mm_loadu_ps(v[ray.kz])) - ray.origin[2];
+		x = float4(_mm_loadu_ps(v[ray.kx])) - ray.origin[0] - ray.shear[0] * z;
+		y = float4(_mm_loadu_ps(v[ray.ky])) - ray.origin[1] - ray.shear[1] * z;
+		z *= ray.shear[2];
+	};
+
+	float4 ax, ay, az;
+	float4 bx, by, bz;
+	float4 cx, cy, cz;
+	transform(block.v0, ax, ay, az);
+	transform(block.v1, bx, by, bz);
+	transform(block.v2, cx, cy, cz);
+
+	float4 u = cx * by - cy * bx;
+	float4 v = ax * cy - ay * cx;
+	float4 w = bx * ay - by * ax;
+
+	const __m128 zero = _mm_setzero_ps();
+	__m128 negative = _mm_or_ps(_mm_cmplt_ps(u.data(), zero), _mm_or_ps(_mm_cmplt_ps(v.data(), zero), _mm_cmplt_ps(w.data(), zero)));
+	__m128 positive = _mm_or_ps(_mm_cmpgt_ps(u.data(), zero), _mm_or_ps(_mm_cmpgt_ps(v.data(), zero), _mm_cmpgt_ps(w.data(), zero)));
+
+	float4 det = u + v + w;
+	float4 t = u * az + v * bz + w * cz;
+
+	/*
+	 * Distance is compared as t * |det| to avoid division for rejected triangles
+	 */
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 detSign = _mm_and_ps(det.data(), signMask);
+	__m128 absDet = _mm_xor_ps(det.data(), detSign);
+	__m128 signedT = _mm_xor_ps(t.data(), detSign);
+
+	__m128 valid = _mm_andnot_ps(_mm_and_ps(negative, positive), _mm_cmpneq_ps(det.data(), zero));
+	valid = _mm_and_ps(valid, _mm_cmpgt_ps(signedT, _mm_mul_ps(absDet, _mm_set1_ps(minDistance))));
+	valid = _mm_and_ps(valid, _mm_cmplt_ps(signedT, _mm_mul_ps(absDet, _mm_set1_ps(maxDistance))));
+
+	uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(valid));
+	if (mask == 0)
+		return InvalidIndex;
+
+	ET_ALIGNED(16) float distances[TriangleBlock::Size];
+	_mm_store_ps(distances, _mm_div_ps(signedT, absDet));
+
+	uint32_t result = InvalidIndex;
+	distance = maxDistance;
+	for (uint32_t lane = 0; lane < TriangleBlock::Size; ++lane)
+	{
+		if ((mask & (1u << lane)) && (distances[lane] < distance))
+		{
+			distance = distances[lane];
+			result = lane;
+		}
+	}
+
+	if (result != InvalidIndex)
+	{
+		ET_ALIGNED(16) float uf[4];
+		ET_ALIGNED(16) float vf[4];
+		ET_ALIGNED(16) float wf[4];
+		ET_ALIGNED(16) float df[4];
+		u.loadToFloats(uf);
+		v.loadToFloats(vf);
+		w.loadToFloats(wf);
+		det.loadToFloats(df);
+		float invDet = 1.0f / df[result];
+		barycentric = float4(uf[result] * invDet, vf[result] * invDet, wf[result] * invDet, 0.0f);
+	}
+	return result;
+}
+
+}
+}
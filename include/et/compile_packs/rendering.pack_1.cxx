@@ -3,8 +3,13 @@
 #include "../rendering/renderoptions.cpp"
 
 #include "../rendering/base/constantbuffer.cpp"
+#include "../rendering/base/drawlist.cpp"
+#include "../rendering/base/geometrybuffer.cpp"
 #include "../rendering/base/helpers.cpp"
 #include "../rendering/base/indexarray.cpp"
+#include "../rendering/base/meshoptimizer.cpp"
+#include "../rendering/base/meshsimplifier.cpp"
+#include "../rendering/base/skinning.cpp"
 #include "../rendering/base/material.cpp"
 #include "../rendering/base/materiallibrary.cpp"
 #include "../rendering/base/pipelinestate.cpp"
@@ -1,17 +1,22 @@
 #include <et/core/et.h>
 
 #include "../scene3d/animation.cpp"
+#include "../scene3d/compressedanimation.cpp"
+#include "../scene3d/animationsystem.cpp"
+#include "../scene3d/scenecache.cpp"
 #include "../scene3d/baseelement.cpp"
 #include "../scene3d/lightelement.cpp"
 #include "../scene3d/lineelement.cpp"
 #include "../scene3d/mesh.cpp"
 #include "../scene3d/meshdeformer.cpp"
+#include "../scene3d/modelloader.cpp"
 #include "../scene3d/objloader.cpp"
 #include "../scene3d/gltfloader.cpp"
 #include "../scene3d/particlesystem.cpp"
 #include "../scene3d/renderableelement.cpp"
 #include "../scene3d/scene3d.cpp"
 #include "../scene3d/skeletonelement.cpp"
+#include "../scene3d/transformhierarchy.cpp"
 #include "../scene3d/storage.cpp"
 
 #include "../scene3d/drawer/common.cpp"
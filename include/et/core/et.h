@@ -186,7 +186,9 @@ inline INT_T alignUpTo(INT_T sz, INT_T al) {
 	return sz + m & (~m);
 }
 
-inline uint32_t alignDownTo(uint32_t sz, uint32_t al) {
+template <class INT_T>
+inline INT_T alignDownTo(INT_T sz, INT_T al) {
+	static_assert(std::is_integral<INT_T>::value, "alignDownTo can only be used with integral types");
 	ET_ASSERT(al > 0);
 	return sz & (~(al - 1));
 }
@@ -5,6 +5,11 @@
  *
  */
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
 static et::threading::ThreadIdentifier mainThreadId = 0;
 static et::threading::ThreadIdentifier renderThreadId = 0;
 
@@ -52,3 +57,152 @@ void et::threading::sleep(float seconds) {
 void et::threading::sleepMSec(uint64_t msec) {
 	std::this_thread::sleep_for(std::chrono::milliseconds(msec));
 }
+
+namespace et {
+namespace threading {
+namespace th_local {
+
+enum : uint32_t
+{
+	RangesPerThread = 4
+};
+
+struct ParallelJob
+{
+	const RangeFunction* function = nullptr;
+	uint32_t count = 0;
+	uint32_t rangeSize = 0;
+	uint32_t rangesCount = 0;
+	std::atomic<uint32_t> nextRange{ 0 };
+	std::atomic<uint32_t> completedRanges{ 0 };
+};
+using ParallelJobPointer = std::shared_ptr<ParallelJob>;
+
+/*
+ * Workers are started once and sleep while there are no jobs. Job is shared between
+ * the caller and workers, each range is claimed by exactly one thread, so nested parallelFor
+ * calls do not block: caller can always process all unclaimed ranges by itself
+ */
+class WorkerPool
+{
+public:
+	WorkerPool()
+	{
+		size_t workersCount = std::max(size_t(1), maxConcurrentThreads()) - 1;
+		_threads.reserve(workersCount);
+		for (size_t i = 0; i < workersCount; ++i)
+			_threads.emplace_back(&WorkerPool::workerMain, this);
+	}
+
+	~WorkerPool()
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_running = false;
+		}
+		_jobAdded.notify_all();
+
+		for (std::thread& thread : _threads)
+			thread.join();
+	}
+
+	uint32_t workersCount() const
+		{ return static_cast<uint32_t>(_threads.size()); }
+
+	void run(const ParallelJobPointer& job)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_jobs.push_back(job);
+		}
+		_jobAdded.notify_all();
+
+		processRanges(*job);
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_jobCompleted.wait(lock, [&job]() { return job->completedRanges == job->rangesCount; });
+		removeJob(job);
+	}
+
+private:
+	void workerMain()
+	{
+		for (;;)
+		{
+			ParallelJobPointer job;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_jobAdded.wait(lock, [this]() { return !_running || !_jobs.empty(); });
+				if (!_running)
+					return;
+
+				job = _jobs.front();
+			}
+
+			processRanges(*job);
+
+			std::unique_lock<std::mutex> lock(_mutex);
+			removeJob(job);
+		}
+	}
+
+	void processRanges(ParallelJob& job)
+	{
+		for (uint32_t range = job.nextRange++; range < job.rangesCount; range = job.nextRange++)
+		{
+			uint32_t begin = range * job.rangeSize;
+			(*job.function)(begin, std::min(job.count, begin + job.rangeSize));
+
+			if (++job.completedRanges == job.rangesCount)
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_jobCompleted.notify_all();
+			}
+		}
+	}
+
+	void removeJob(const ParallelJobPointer& job)
+	{
+		auto i = std::find(_jobs.begin(), _jobs.end(), job);
+		if (i != _jobs.end())
+			_jobs.erase(i);
+	}
+
+private:
+	std::mutex _mutex;
+	std::condition_variable _jobAdded;
+	std::condition_variable _jobCompleted;
+	std::deque<ParallelJobPointer> _jobs;
+	std::vector<std::thread> _threads;
+	bool _running = true;
+};
+
+WorkerPool& sharedWorkerPool()
+{
+	static WorkerPool pool;
+	return pool;
+}
+
+}
+}
+}
+
+void et::threading::parallelFor(uint32_t count, uint32_t minRangeSize, const et::threading::RangeFunction& function) {
+	th_local::WorkerPool& pool = th_local::sharedWorkerPool();
+
+	minRangeSize = std::max(1u, minRangeSize);
+	if ((count <= minRangeSize) || (pool.workersCount() == 0))
+	{
+		if (count > 0)
+			function(0, count);
+		return;
+	}
+
+	uint32_t threadsCount = pool.workersCount() + 1;
+	th_local::ParallelJobPointer job = std::make_shared<th_local::ParallelJob>();
+	job->function = &function;
+	job->count = count;
+	job->rangeSize = std::max(minRangeSize, (count + threadsCount * th_local::RangesPerThread - 1) / (threadsCount * th_local::RangesPerThread));
+	job->rangesCount = (count + job->rangeSize - 1) / job->rangeSize;
+	pool.run(job);
+}
@@ -27,6 +27,14 @@ bool inRenderThread();
 
 size_t maxConcurrentThreads();
 
+/*
+ * Calls function(begin, end) for contiguous ranges covering [0, count), ranges are processed
+ * by the calling thread and by the shared pool of worker threads. Returns when all ranges are done,
+ * ranges are not smaller than minRangeSize (except the last one)
+ */
+using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+void parallelFor(uint32_t count, uint32_t minRangeSize, const RangeFunction& function);
+
 ThreadIdentifier currentThread();
 
 void sleep(float seconds);
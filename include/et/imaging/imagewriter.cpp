@@ -19,7 +19,16 @@ bool internal_writePNGtoBuffer(BinaryDataStorage& buffer, const BinaryDataStorag
 void internal_func_writePNGtoBuffer(png_structp png_ptr, png_bytep data, png_size_t length);
 void internal_func_PNGflush(png_structp png_ptr);
 
-static float compressionLevels[ImageFormat_max] = { 0.5f };
+bool internal_encodeHDR(BinaryDataStorage& encoded, const BinaryDataStorage& data,
+	const vec2i& size, int components, int bitsPerComponent, bool flip);
+
+bool internal_writeHDRtoFile(const std::string& fileName, const BinaryDataStorage& data,
+	const vec2i& size, int components, int bitsPerComponent, bool flip);
+
+bool internal_writeHDRtoBuffer(BinaryDataStorage& buffer, const BinaryDataStorage& data,
+	const vec2i& size, int components, int bitsPerComponent, bool flip);
+
+static float compressionLevels[ImageFormat_max] = { 0.5f, 0.0f };
 
 void et::setCompressionLevelForImageFormat(ImageFormat fmt, float value)
 {
@@ -35,6 +44,9 @@ bool et::writeImageToFile(const std::string& fileName, const BinaryDataStorage&
 	case ImageFormat_PNG:
 		return internal_writePNGtoFile(fileName, data, size, components, bitsPerComponent, flip);
 
+	case ImageFormat_HDR:
+		return internal_writeHDRtoFile(fileName, data, size, components, bitsPerComponent, flip);
+
 	default:
 		return false;
 	}
@@ -47,6 +59,9 @@ bool et::writeImageToBuffer(BinaryDataStorage& buffer, const BinaryDataStorage&
 	{
 		case ImageFormat_PNG:
 			return internal_writePNGtoBuffer(buffer, data, size, components, bitsPerComponent, flip);
+
+		case ImageFormat_HDR:
+			return internal_writeHDRtoBuffer(buffer, data, size, components, bitsPerComponent, flip);
 			
 		default:
 			return false;
@@ -63,6 +78,9 @@ std::string et::extensionForImageFormat(ImageFormat fmt)
 	case ImageFormat_PNG:
 		return ".png";
 
+	case ImageFormat_HDR:
+		return ".hdr";
+
 	default:
 		return ".image";
 	}
@@ -217,3 +235,154 @@ bool internal_writePNGtoFile(const std::string& fileName, const BinaryDataStorag
 	
 	return true;
 }
+
+/*
+ * Radiance HDR
+ */
+void internal_appendBytes(BinaryDataStorage& encoded, const uint8_t* values, uint64_t count)
+{
+	etCopyMemory(encoded.current_ptr(), values, count);
+	encoded.applyOffset(count);
+}
+
+void internal_encodeRGBE(const float* rgb, uint8_t* rgbe)
+{
+	float value = std::max(rgb[0], std::max(rgb[1], rgb[2]));
+	if (value < 1.0e-32f)
+	{
+		rgbe[0] = rgbe[1] = rgbe[2] = rgbe[3] = 0;
+		return;
+	}
+
+	int exponent = 0;
+	float scale = std::frexp(value, &exponent) * 256.0f / value;
+	rgbe[0] = static_cast<uint8_t>(std::max(0.0f, rgb[0]) * scale);
+	rgbe[1] = static_cast<uint8_t>(std::max(0.0f, rgb[1]) * scale);
+	rgbe[2] = static_cast<uint8_t>(std::max(0.0f, rgb[2]) * scale);
+	rgbe[3] = static_cast<uint8_t>(exponent + 128);
+}
+
+/*
+ * Runs of at least 4 equal values are encoded as (128 + count, value),
+ * everything else as (count, values...), count is limited to 127 and 128 respectively
+ */
+void internal_encodeRLEChannel(BinaryDataStorage& encoded, const uint8_t* values, int count)
+{
+	const int minRunLength = 4;
+
+	int current = 0;
+	while (current < count)
+	{
+		int runStart = current;
+		int runLength = 0;
+		while ((runLength < minRunLength) && (runStart < count))
+		{
+			runStart += runLength;
+			runLength = 1;
+			while ((runStart + runLength < count) && (runLength < 127) && (values[runStart] == values[runStart + runLength]))
+				++runLength;
+		}
+
+		if (runLength < minRunLength)
+			runStart = count;
+
+		while (current < runStart)
+		{
+			int literalLength = std::min(128, runStart - current);
+			encoded.push_back(static_cast<uint8_t>(literalLength));
+			internal_appendBytes(encoded, values + current, literalLength);
+			current += literalLength;
+		}
+
+		if (runLength >= minRunLength)
+		{
+			encoded.push_back(static_cast<uint8_t>(128 + runLength));
+			encoded.push_back(values[runStart]);
+			current += runLength;
+		}
+	}
+}
+
+bool internal_encodeHDR(BinaryDataStorage& encoded, const BinaryDataStorage& data,
+	const vec2i& size, int components, int bitsPerComponent, bool flip)
+{
+	if ((bitsPerComponent != 32) || ((components != 3) && (components != 4)) || (size.x <= 0) || (size.y <= 0))
+	{
+		log::error("HDR images could only be written from 3 or 4 float components");
+		return false;
+	}
+
+	char header[128] = { };
+	int headerSize = snprintf(header, sizeof(header),
+		"#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %d +X %d\n", size.y, size.x);
+
+	uint64_t maxScanlineSize = 4 + 4 * (size.x + size.x / 128 + 1);
+	encoded.resize(headerSize + size.y * maxScanlineSize);
+	encoded.setOffset(0);
+	internal_appendBytes(encoded, reinterpret_cast<const uint8_t*>(header), headerSize);
+
+	/*
+	 * Run-length encoding is only defined for scanlines of 8 to 32767 pixels
+	 */
+	bool useRLE = (size.x >= 8) && (size.x <= 0x7fff);
+
+	DataStorage<uint8_t> rgbe(4 * size.x, 0);
+	DataStorage<uint8_t> channel(size.x, 0);
+	const float* floatData = reinterpret_cast<const float*>(data.data());
+	for (int y = 0; y < size.y; ++y)
+	{
+		const float* row = floatData + size.x * components * (flip ? size.y - 1 - y : y);
+		for (int x = 0; x < size.x; ++x)
+			internal_encodeRGBE(row + x * components, rgbe.element_ptr(4 * x));
+
+		if (useRLE)
+		{
+			encoded.push_back(2);
+			encoded.push_back(2);
+			encoded.push_back(static_cast<uint8_t>(size.x >> 8));
+			encoded.push_back(static_cast<uint8_t>(size.x & 0xff));
+			for (int c = 0; c < 4; ++c)
+			{
+				for (int x = 0; x < size.x; ++x)
+					channel[x] = rgbe[4 * x + c];
+				internal_encodeRLEChannel(encoded, channel.data(), size.x);
+			}
+		}
+		else
+		{
+			internal_appendBytes(encoded, rgbe.data(), rgbe.size());
+		}
+	}
+
+	return true;
+}
+
+bool internal_writeHDRtoBuffer(BinaryDataStorage& buffer, const BinaryDataStorage& data,
+	const vec2i& size, int components, int bitsPerComponent, bool flip)
+{
+	BinaryDataStorage encoded;
+	if (!internal_encodeHDR(encoded, data, size, components, bitsPerComponent, flip))
+		return false;
+
+	buffer.fitToSize(encoded.lastElementIndex());
+	etCopyMemory(buffer.current_ptr(), encoded.data(), encoded.lastElementIndex());
+	buffer.applyOffset(encoded.lastElementIndex());
+	return true;
+}
+
+bool internal_writeHDRtoFile(const std::string& fileName, const BinaryDataStorage& data,
+	const vec2i& size, int components, int bitsPerComponent, bool flip)
+{
+	BinaryDataStorage encoded;
+	if (!internal_encodeHDR(encoded, data, size, components, bitsPerComponent, flip))
+		return false;
+
+	FILE* fp = fopen(fileName.c_str(), "wb");
+	if (!fp)
+		return false;
+
+	size_t written = fwrite(encoded.data(), 1, static_cast<size_t>(encoded.lastElementIndex()), fp);
+	fclose(fp);
+
+	return written == encoded.lastElementIndex();
+}
@@ -14,12 +14,17 @@ namespace et
 enum ImageFormat 
 {
 	ImageFormat_PNG,
+	ImageFormat_HDR,
 	ImageFormat_max
 };
 
 std::string extensionForImageFormat(ImageFormat);
 void setCompressionLevelForImageFormat(ImageFormat, float);
 
+/*
+ * ImageFormat_HDR expects 3 or 4 float components (32 bits per component),
+ * writes Radiance RGBE with run-length encoded scanlines
+ */
 bool writeImageToFile(const std::string& fileName, const BinaryDataStorage& data,
 	const vec2i& size, int components, int bitsPerComponent, ImageFormat fmt, bool flip);
 	
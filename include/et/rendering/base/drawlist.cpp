@@ -0,0 +1,188 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/rendering/base/drawlist.h>
+
+namespace et {
+
+void DrawList::clear() {
+	_materials.clear();
+	_vertexStreams.clear();
+	_entries.clear();
+	_instances.clear();
+	_commands.clear();
+	_groups.clear();
+}
+
+void DrawList::reserve(uint32_t entries, uint32_t instances) {
+	_materials.reserve(entries);
+	_vertexStreams.reserve(entries);
+	_entries.reserve(entries);
+	_commands.reserve(entries);
+	_groups.reserve(entries);
+	_instances.reserve(instances);
+}
+
+uint32_t DrawList::addInstance(const DrawInstanceData& data) {
+	_instances.emplace_back(data);
+	return static_cast<uint32_t>(_instances.size() - 1);
+}
+
+void DrawList::push(const MaterialInstance::Pointer& material, const VertexStream::Pointer& vertexStream,
+	uint32_t firstIndex, uint32_t indexCount, int32_t vertexOffset, uint32_t instanceIndex) {
+	ET_ASSERT(material.valid());
+	ET_ASSERT(instanceIndex < _instances.size());
+
+	if (indexCount == 0)
+		return;
+
+	/*
+	 * Entries are referencing objects by raw pointers (to keep them trivially sortable),
+	 * ownership is held by the list until the next clear()
+	 */
+	if (_materials.empty() || (_materials.back() != material))
+		_materials.emplace_back(material);
+
+	if (_vertexStreams.empty() || (_vertexStreams.back() != vertexStream))
+		_vertexStreams.emplace_back(vertexStream);
+
+	_entries.emplace_back();
+	Entry& entry = _entries.back();
+	entry.material = _materials.back().pointer();
+	entry.vertexStream = _vertexStreams.back().pointer();
+	entry.firstIndex = firstIndex;
+	entry.indexCount = indexCount;
+	entry.vertexOffset = vertexOffset;
+	if (vertexStream.valid())
+	{
+		entry.firstIndex += vertexStream->firstIndex();
+		entry.vertexOffset += static_cast<int32_t>(vertexStream->baseVertex());
+	}
+	entry.instanceIndex = instanceIndex;
+}
+
+void DrawList::push(const RenderBatch::Pointer& batch, uint32_t instanceIndex) {
+	push(batch->material(), batch->vertexStream(), batch->firstIndex(), batch->numIndexes(), 0, instanceIndex);
+}
+
+void DrawList::build() {
+	drawlist::sortEntries(_entries);
+	drawlist::compactEntries(_entries);
+	drawlist::packEntries(_entries, _commands, _groups);
+}
+
+namespace drawlist {
+
+inline const Buffer* vertexBufferKey(const VertexStream* vs) {
+	return (vs == nullptr) ? nullptr : vs->vertexBuffer().pointer();
+}
+
+inline const Buffer* indexBufferKey(const VertexStream* vs) {
+	return (vs == nullptr) ? nullptr : vs->indexBuffer().pointer();
+}
+
+inline bool streamsCompatible(const VertexStream* l, const VertexStream* r) {
+	return (l == r) || ((l != nullptr) && (r != nullptr) && l->sharesBuffersWith(*r));
+}
+
+inline bool entriesShareState(const DrawList::Entry& l, const DrawList::Entry& r) {
+	return (l.material == r.material) && streamsCompatible(l.vertexStream, r.vertexStream);
+}
+
+void sortEntries(Vector<DrawList::Entry>& entries) {
+	/*
+	 * Streams are ordered by buffers, so streams suballocated from
+	 * the same shared buffers (see GeometryBuffer) end up adjacent
+	 */
+	std::sort(entries.begin(), entries.end(), [](const DrawList::Entry& l, const DrawList::Entry& r) {
+		if (l.material != r.material)
+			return l.material < r.material;
+
+		if (vertexBufferKey(l.vertexStream) != vertexBufferKey(r.vertexStream))
+			return vertexBufferKey(l.vertexStream) < vertexBufferKey(r.vertexStream);
+
+		if (indexBufferKey(l.vertexStream) != indexBufferKey(r.vertexStream))
+			return indexBufferKey(l.vertexStream) < indexBufferKey(r.vertexStream);
+
+		if (l.instanceIndex != r.instanceIndex)
+			return l.instanceIndex < r.instanceIndex;
+
+		if (l.vertexOffset != r.vertexOffset)
+			return l.vertexOffset < r.vertexOffset;
+
+		return l.firstIndex < r.firstIndex;
+	});
+}
+
+void compactEntries(Vector<DrawList::Entry>& entries) {
+	if (entries.empty())
+		return;
+
+	/*
+	 * Expects sorted entries: removes empty draws and merges adjacent draws
+	 * of the same instance and contiguous index ranges into a single one
+	 */
+	size_t writeIndex = 0;
+	for (size_t readIndex = 0, e = entries.size(); readIndex < e; ++readIndex)
+	{
+		const DrawList::Entry& current = entries[readIndex];
+		if (current.indexCount == 0)
+			continue;
+
+		if (writeIndex > 0)
+		{
+			DrawList::Entry& previous = entries[writeIndex - 1];
+			bool canMerge = entriesShareState(previous, current) && (previous.instanceIndex == current.instanceIndex) &&
+				(previous.vertexOffset == current.vertexOffset) && (previous.firstIndex + previous.indexCount >= current.firstIndex);
+
+			if (canMerge)
+			{
+				uint32_t lastIndex = std::max(previous.firstIndex + previous.indexCount, current.firstIndex + current.indexCount);
+				previous.indexCount = lastIndex - previous.firstIndex;
+				continue;
+			}
+		}
+
+		entries[writeIndex++] = current;
+	}
+	entries.resize(writeIndex);
+}
+
+void packEntries(const Vector<DrawList::Entry>& entries, Vector<DrawIndexedIndirectCommand>& commands, Vector<DrawList::Group>& groups) {
+	commands.clear();
+	groups.clear();
+	commands.reserve(entries.size());
+
+	for (const DrawList::Entry& entry : entries)
+	{
+		bool startNewGroup = groups.empty() ||
+			(groups.back().material.pointer() != entry.material) ||
+			!streamsCompatible(groups.back().vertexStream.pointer(), entry.vertexStream);
+
+		if (startNewGroup)
+		{
+			groups.emplace_back();
+			DrawList::Group& group = groups.back();
+			group.material = MaterialInstance::Pointer(entry.material);
+			group.vertexStream = VertexStream::Pointer(entry.vertexStream);
+			group.firstCommand = static_cast<uint32_t>(commands.size());
+		}
+
+		commands.emplace_back();
+		DrawIndexedIndirectCommand& command = commands.back();
+		command.indexCount = entry.indexCount;
+		command.instanceCount = 1;
+		command.firstIndex = entry.firstIndex;
+		command.vertexOffset = entry.vertexOffset;
+		command.firstInstance = entry.instanceIndex;
+		++groups.back().commandCount;
+	}
+}
+
+}
+
+}
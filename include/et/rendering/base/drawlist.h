@@ -0,0 +1,116 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/rendering/base/renderbatch.h>
+
+namespace et {
+
+/*
+ * Layout matches VkDrawIndexedIndirectCommand / D3D12_DRAW_INDEXED_ARGUMENTS,
+ * so packed commands could be copied directly into an indirect argument buffer
+ */
+struct DrawIndexedIndirectCommand
+{
+	uint32_t indexCount = 0;
+	uint32_t instanceCount = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t firstInstance = 0;
+};
+static_assert(sizeof(DrawIndexedIndirectCommand) == 5 * sizeof(uint32_t), "Invalid DrawIndexedIndirectCommand layout");
+
+/*
+ * Per-instance data, referenced by DrawList::Entry::instanceIndex,
+ * shaders read it from the storage buffer indexed by instance id
+ * (firstInstance of the indirect command), see drawinstances.h
+ */
+struct DrawInstanceData
+{
+	mat4 worldTransform = identityMatrix;
+	mat4 worldRotationTransform = identityMatrix;
+	mat4 previousWorldTransform = identityMatrix;
+	mat4 previousWorldRotationTransform = identityMatrix;
+};
+
+class DrawList : public Object
+{
+public:
+	ET_DECLARE_POINTER(DrawList);
+
+	/*
+	 * Entry stores absolute first index and vertex offset
+	 * (with vertex stream's firstIndex and baseVertex applied)
+	 */
+	struct Entry
+	{
+		MaterialInstance* material = nullptr;
+		VertexStream* vertexStream = nullptr;
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		int32_t vertexOffset = 0;
+		uint32_t instanceIndex = 0;
+	};
+
+	/*
+	 * Range of commands sharing material and vertex/index buffers (pipeline state),
+	 * could be issued with a single multi-draw-indirect call; commands are ordered by instance index
+	 */
+	struct Group
+	{
+		MaterialInstance::Pointer material;
+		VertexStream::Pointer vertexStream;
+		uint32_t firstCommand = 0;
+		uint32_t commandCount = 0;
+	};
+
+public:
+	DrawList() = default;
+
+	void clear();
+	void reserve(uint32_t entries, uint32_t instances);
+
+	uint32_t addInstance(const DrawInstanceData&);
+	void push(const MaterialInstance::Pointer&, const VertexStream::Pointer&, uint32_t firstIndex, uint32_t indexCount, int32_t vertexOffset, uint32_t instanceIndex);
+	void push(const RenderBatch::Pointer&, uint32_t instanceIndex);
+
+	void build();
+
+	bool empty() const
+		{ return _commands.empty(); }
+
+	const Vector<Entry>& entries() const
+		{ return _entries; }
+	const Vector<DrawInstanceData>& instances() const
+		{ return _instances; }
+	const Vector<DrawIndexedIndirectCommand>& commands() const
+		{ return _commands; }
+	const Vector<Group>& groups() const
+		{ return _groups; }
+
+private:
+	Vector<MaterialInstance::Pointer> _materials;
+	Vector<VertexStream::Pointer> _vertexStreams;
+	Vector<Entry> _entries;
+	Vector<DrawInstanceData> _instances;
+	Vector<DrawIndexedIndirectCommand> _commands;
+	Vector<Group> _groups;
+};
+
+namespace drawlist {
+
+/*
+ * Stages of the DrawList::build, exposed separately to be used (and tested) without DrawList
+ */
+void sortEntries(Vector<DrawList::Entry>&);
+void compactEntries(Vector<DrawList::Entry>&);
+void packEntries(const Vector<DrawList::Entry>&, Vector<DrawIndexedIndirectCommand>&, Vector<DrawList::Group>&);
+
+}
+
+}
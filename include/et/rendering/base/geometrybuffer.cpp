@@ -0,0 +1,289 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/rendering/interface/renderer.h>
+#include <et/rendering/base/geometrybuffer.h>
+
+namespace et
+{
+
+struct GeometryBufferPage
+{
+	Buffer::Pointer buffer;
+	RemoteHeap heap;
+	BinaryDataStorage heapInfo;
+	IndexArrayFormat format = IndexArrayFormat::Count;
+};
+using GeometryBufferPageList = Vector<UniquePtr<GeometryBufferPage>>;
+
+class GeometryBufferAllocation : public Object
+{
+public:
+	ET_DECLARE_POINTER(GeometryBufferAllocation);
+
+public:
+	GeometryBufferPage* vertexPage = nullptr;
+	GeometryBufferPage* indexPage = nullptr;
+	uint64_t vertexAllocationOffset = 0;
+	uint64_t vertexDataSize = 0;
+	uint64_t indexAllocationOffset = 0;
+	uint64_t indexDataSize = 0;
+	uint64_t releaseFrame = InvalidFlushFrame;
+};
+
+class GeometryBufferPrivate
+{
+public:
+	RenderInterface* renderer = nullptr;
+	GeometryBufferPageList vertexPages;
+	GeometryBufferPageList indexPages;
+	Vector<GeometryBufferAllocation::Pointer> allocations;
+	uint64_t allocatedVertexData = 0;
+	uint64_t allocatedIndexData = 0;
+
+	GeometryBufferPage* allocateInPages(GeometryBufferPageList& pages, Buffer::Usage usage, IndexArrayFormat format,
+		uint64_t size, uint64_t& offset);
+
+	void release(const GeometryBufferAllocation::Pointer&);
+};
+
+GeometryBuffer::GeometryBuffer()
+{
+	ET_PIMPL_INIT(GeometryBuffer);
+}
+
+GeometryBuffer::~GeometryBuffer()
+{
+	ET_PIMPL_FINALIZE(GeometryBuffer);
+}
+
+void GeometryBuffer::init(RenderInterface* renderer)
+{
+	_private->renderer = renderer;
+}
+
+void GeometryBuffer::shutdown()
+{
+	_private->allocations.clear();
+	_private->vertexPages.clear();
+	_private->indexPages.clear();
+	_private->allocatedVertexData = 0;
+	_private->allocatedIndexData = 0;
+	_private->renderer = nullptr;
+}
+
+VertexStream::Pointer GeometryBuffer::allocate(const VertexStorage::Pointer& vs, const IndexArray::Pointer& ia)
+{
+	ET_ASSERT(vs.valid());
+
+	const VertexDeclaration& declaration = vs->declaration();
+	ET_ASSERT(declaration.sizeInBytes() > 0);
+
+	uint32_t vertexCount = static_cast<uint32_t>(vs->data().size() / declaration.sizeInBytes());
+	uint32_t indexCount = ia.valid() ? ia->capacity() : 0;
+	IndexArrayFormat format = ia.valid() ? ia->format() : IndexArrayFormat::Count;
+	PrimitiveType primitiveType = ia.valid() ? ia->primitiveType() : PrimitiveType::Triangles;
+
+	VertexStream::Pointer result = allocate(declaration, vertexCount, format, indexCount, primitiveType);
+	if (result.invalid())
+		return result;
+
+	result->setPositionDequantization(vs->positionScale(), vs->positionOffset());
+	uploadVertices(result, vs, 0, vertexCount);
+
+	if (indexCount > 0)
+		uploadIndices(result, ia, 0, indexCount);
+
+	return result;
+}
+
+VertexStream::Pointer GeometryBuffer::allocate(const VertexDeclaration& declaration, uint32_t vertexCount,
+	IndexArrayFormat format, uint32_t indexCount, PrimitiveType primitiveType)
+{
+	ET_ASSERT(_private->renderer != nullptr);
+
+	uint64_t stride = declaration.sizeInBytes();
+	uint64_t vertexDataSize = stride * vertexCount;
+	ET_ASSERT(stride > 0);
+
+	GeometryBufferAllocation::Pointer allocation = GeometryBufferAllocation::Pointer::create();
+	VertexStream::Pointer result = VertexStream::Pointer::create();
+
+	/*
+	 * Vertex data offset should be a multiple of the stride to be addressed with base vertex,
+	 * so allocation is extended to fit aligned data
+	 */
+	uint64_t alignmentReserve = (Granularity % stride == 0) ? 0 : stride;
+	allocation->vertexPage = _private->allocateInPages(_private->vertexPages, Buffer::Usage::Vertex, IndexArrayFormat::Count,
+		vertexDataSize + alignmentReserve, allocation->vertexAllocationOffset);
+
+	if (allocation->vertexPage == nullptr)
+	{
+		log::error("Failed to allocate %llu bytes of vertex data in geometry buffer", static_cast<unsigned long long>(vertexDataSize));
+		return VertexStream::Pointer();
+	}
+
+	uint64_t vertexOffset = stride * ((allocation->vertexAllocationOffset + stride - 1) / stride);
+	allocation->vertexDataSize = vertexDataSize + alignmentReserve;
+
+	result->setVertexBuffer(allocation->vertexPage->buffer, declaration);
+	result->setBaseVertex(static_cast<uint32_t>(vertexOffset / stride));
+	result->setVertexCount(vertexCount);
+	_private->allocatedVertexData += allocation->vertexDataSize;
+
+	if (indexCount > 0)
+	{
+		/*
+		 * 8-bit indices are not supported by all APIs, so they are stored as 16-bit
+		 */
+		if (format == IndexArrayFormat::Format_8bit)
+			format = IndexArrayFormat::Format_16bit;
+
+		uint64_t indexSize = static_cast<uint64_t>(format);
+		uint64_t indexDataSize = indexSize * indexCount;
+		allocation->indexPage = _private->allocateInPages(_private->indexPages, Buffer::Usage::Index, format,
+			indexDataSize, allocation->indexAllocationOffset);
+
+		if (allocation->indexPage == nullptr)
+		{
+			log::error("Failed to allocate %llu bytes of index data in geometry buffer", static_cast<unsigned long long>(indexDataSize));
+			_private->release(allocation);
+			return VertexStream::Pointer();
+		}
+
+		allocation->indexDataSize = indexDataSize;
+
+		result->setIndexBuffer(allocation->indexPage->buffer, format);
+		result->setFirstIndex(static_cast<uint32_t>(allocation->indexAllocationOffset / indexSize));
+		result->setPrimitiveType(primitiveType);
+		_private->allocatedIndexData += allocation->indexDataSize;
+	}
+
+	result->setAllocation(allocation);
+	_private->allocations.emplace_back(allocation);
+	return result;
+}
+
+void GeometryBuffer::uploadVertices(const VertexStream::Pointer& stream, const VertexStorage::Pointer& vs,
+	uint32_t firstVertex, uint32_t count)
+{
+	uint64_t stride = stream->vertexDeclaration().sizeInBytes();
+	ET_ASSERT(vs->declaration().sizeInBytes() == stride);
+	ET_ASSERT(firstVertex + count <= stream->vertexCount());
+	ET_ASSERT(stride * (firstVertex + count) <= vs->data().size());
+
+	uint64_t offset = stride * (stream->baseVertex() + firstVertex);
+	stream->vertexBuffer()->updateData(offset, BinaryDataStorage(vs->data().data() + stride * firstVertex, stride * count));
+}
+
+void GeometryBuffer::uploadIndices(const VertexStream::Pointer& stream, const IndexArray::Pointer& ia,
+	uint32_t firstIndex, uint32_t count)
+{
+	ET_ASSERT(stream->indexBuffer().valid());
+	ET_ASSERT(firstIndex + count <= ia->capacity());
+
+	IndexArrayFormat format = stream->indexArrayFormat();
+	uint64_t indexSize = static_cast<uint64_t>(format);
+	uint64_t offset = indexSize * (stream->firstIndex() + firstIndex);
+
+	if (format == ia->format())
+	{
+		stream->indexBuffer()->updateData(offset, BinaryDataStorage(ia->data() + indexSize * firstIndex, indexSize * count));
+		return;
+	}
+
+	ET_ASSERT(format == IndexArrayFormat::Format_16bit);
+	BinaryDataStorage convertedData(indexSize * count);
+	uint16_t* indices = reinterpret_cast<uint16_t*>(convertedData.data());
+	for (uint32_t i = 0; i < count; ++i)
+		indices[i] = static_cast<uint16_t>(ia->getIndex(firstIndex + i));
+
+	stream->indexBuffer()->updateData(offset, convertedData);
+}
+
+void GeometryBuffer::flush(uint64_t frameNumber)
+{
+	auto i = std::remove_if(_private->allocations.begin(), _private->allocations.end(), [this, frameNumber](GeometryBufferAllocation::Pointer& a)
+	{
+		if (a->retainCount() > 1)
+		{
+			a->releaseFrame = InvalidFlushFrame;
+			return false;
+		}
+
+		/*
+		 * Allocation could still be referenced by frames in flight
+		 */
+		if (a->releaseFrame == InvalidFlushFrame)
+			a->releaseFrame = frameNumber + RendererFrameCount;
+
+		bool shouldRelease = frameNumber >= a->releaseFrame;
+		if (shouldRelease)
+			_private->release(a);
+
+		return shouldRelease;
+	});
+
+	if (i != _private->allocations.end())
+		_private->allocations.erase(i, _private->allocations.end());
+}
+
+GeometryBuffer::Statistics GeometryBuffer::statistics() const
+{
+	Statistics result;
+	result.vertexPages = static_cast<uint32_t>(_private->vertexPages.size());
+	result.indexPages = static_cast<uint32_t>(_private->indexPages.size());
+	result.allocations = static_cast<uint32_t>(_private->allocations.size());
+	result.allocatedVertexData = _private->allocatedVertexData;
+	result.allocatedIndexData = _private->allocatedIndexData;
+	return result;
+}
+
+GeometryBufferPage* GeometryBufferPrivate::allocateInPages(GeometryBufferPageList& pages, Buffer::Usage usage,
+	IndexArrayFormat format, uint64_t size, uint64_t& offset)
+{
+	for (UniquePtr<GeometryBufferPage>& page : pages)
+	{
+		if ((page->format == format) && page->heap.allocate(size, offset))
+			return page.get();
+	}
+
+	uint64_t defaultCapacity = (usage == Buffer::Usage::Vertex) ? GeometryBuffer::VertexPageCapacity : GeometryBuffer::IndexPageCapacity;
+
+	pages.emplace_back(makeUnique<GeometryBufferPage>());
+	GeometryBufferPage* page = pages.back().get();
+	page->format = format;
+	page->heap.init(std::max(defaultCapacity, alignUpTo(size, static_cast<uint64_t>(GeometryBuffer::Granularity))), GeometryBuffer::Granularity);
+	page->heapInfo.resize(page->heap.requiredInfoSize());
+	page->heap.setInfoStorage(page->heapInfo.begin());
+
+	Buffer::Description desc;
+	desc.size = page->heap.capacity();
+	desc.usage = usage;
+	desc.location = Buffer::Location::Device;
+	page->buffer = renderer->createBuffer((usage == Buffer::Usage::Vertex ? "shared-vertex-buffer-" : "shared-index-buffer-") +
+		intToStr(pages.size()), desc);
+
+	return page->heap.allocate(size, offset) ? page : nullptr;
+}
+
+void GeometryBufferPrivate::release(const GeometryBufferAllocation::Pointer& allocation)
+{
+	if (allocation->vertexPage != nullptr)
+	{
+		allocation->vertexPage->heap.release(allocation->vertexAllocationOffset);
+		allocatedVertexData -= allocation->vertexDataSize;
+	}
+
+	if (allocation->indexPage != nullptr)
+	{
+		allocation->indexPage->heap.release(allocation->indexAllocationOffset);
+		allocatedIndexData -= allocation->indexDataSize;
+	}
+}
+
+}
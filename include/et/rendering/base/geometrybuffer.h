@@ -0,0 +1,68 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/rendering/base/vertexstream.h>
+#include <et/rendering/base/vertexstorage.h>
+#include <et/rendering/base/indexarray.h>
+
+namespace et
+{
+
+class RenderInterface;
+class GeometryBufferPrivate;
+class GeometryBuffer
+{
+public:
+	enum : uint64_t
+	{
+		VertexPageCapacity = 64 * 1024 * 1024,
+		IndexPageCapacity = 32 * 1024 * 1024,
+		Granularity = 256,
+	};
+
+	struct Statistics
+	{
+		uint32_t vertexPages = 0;
+		uint32_t indexPages = 0;
+		uint32_t allocations = 0;
+		uint64_t allocatedVertexData = 0;
+		uint64_t allocatedIndexData = 0;
+	};
+
+public:
+	GeometryBuffer();
+	~GeometryBuffer();
+
+	void init(RenderInterface*);
+	void shutdown();
+
+	/*
+	 * Uploads vertices and indices into shared buffers and returns vertex stream
+	 * referencing them with baseVertex / firstIndex offsets.
+	 * Allocation is released (after RendererFrameCount frames) when vertex stream is no longer used
+	 */
+	VertexStream::Pointer allocate(const VertexStorage::Pointer&, const IndexArray::Pointer&);
+
+	/*
+	 * Reserves space without uploading data, so large geometry could be uploaded in parts
+	 * with uploadVertices / uploadIndices. Indices are not allocated when indexCount is zero
+	 */
+	VertexStream::Pointer allocate(const VertexDeclaration&, uint32_t vertexCount, IndexArrayFormat, uint32_t indexCount, PrimitiveType);
+	void uploadVertices(const VertexStream::Pointer&, const VertexStorage::Pointer&, uint32_t firstVertex, uint32_t count);
+	void uploadIndices(const VertexStream::Pointer&, const IndexArray::Pointer&, uint32_t firstIndex, uint32_t count);
+
+	void flush(uint64_t frameNumber);
+
+	Statistics statistics() const;
+
+private:
+	ET_DECLARE_PIMPL(GeometryBuffer, 256);
+};
+
+}
@@ -47,7 +47,7 @@ uint32_t IndexArray::getIndex(uint32_t pos) const
 {
 	auto maskValue = indexTypeMask[static_cast<uint32_t>(_format) / 2];
 
-	ET_ASSERT(pos <= maskValue);
+	ET_ASSERT(pos < capacity());
 
 	return *reinterpret_cast<const uint32_t*>(_data.element_ptr(pos * static_cast<uint32_t>(_format))) & maskValue;
 }
@@ -266,14 +266,28 @@ bool IndexArray::PrimitiveIterator::operator != (const IndexArray::PrimitiveIter
 	return _primitive != p._primitive;
 }
 
-void IndexArray::serialize(std::ostream&)
+void IndexArray::serialize(std::ostream& fOut)
 {
-
+	serializeUInt32(fOut, 0);
+	serializeUInt32(fOut, static_cast<uint32_t>(_format));
+	serializeUInt32(fOut, static_cast<uint32_t>(_primitiveType));
+	serializeUInt32(fOut, _actualSize);
+	serializeUInt64(fOut, _data.size());
+	if (_data.size() > 0)
+		fOut.write(_data.binary(), _data.size());
 }
 
-void IndexArray::deserialize(std::istream&)
+void IndexArray::deserialize(std::istream& fIn)
 {
-
+	deserializeUInt32(fIn);
+	_format = static_cast<IndexArrayFormat>(deserializeUInt32(fIn));
+	_primitiveType = static_cast<PrimitiveType>(deserializeUInt32(fIn));
+	_actualSize = deserializeUInt32(fIn);
+
+	uint64_t dataSize = deserializeUInt64(fIn);
+	_data.resize(dataSize);
+	if (dataSize > 0)
+		fIn.read(_data.binary(), dataSize);
 }
 
 
@@ -185,6 +185,43 @@ const Material::Configuration& Material::configuration(const std::string& cls) c
 	return (i == _configurations.end()) ? emptyConfiguration : i->second;
 }
 
+inline uint32_t shaderDecodedUsages(const VertexDeclaration& layout, const VertexDeclaration& streamLayout) {
+	uint32_t result = 0;
+	for (const VertexElement& element : layout.elements())
+	{
+		const VertexElement& provided = streamLayout.elementForUsage(element.usage());
+		if (streamLayout.has(element.usage()) && (provided.encoding() == VertexAttributeEncoding::OctahedralSnorm16))
+			result |= vertexAttributeUsageMask(element.usage());
+	}
+	return result;
+}
+
+const Program::Pointer& Material::program(const std::string& cls, const VertexDeclaration& streamLayout) {
+	auto i = _configurations.find(cls);
+	if (i == _configurations.end())
+	{
+		i = _configurations.find(kDefault);
+		ET_ASSERT(i != _configurations.end());
+	}
+
+	/*
+	 * Hardware decodes half / normalized formats to the same float types, so the
+	 * common program is used unless stream provides octahedral encoded attributes
+	 */
+	Configuration& config = i->second;
+	uint32_t decodedUsages = shaderDecodedUsages(config.inputLayout, streamLayout);
+	if (decodedUsages == 0)
+		return config.program;
+
+	Program::Pointer& result = config.decodingPrograms[decodedUsages];
+	if (result.invalid())
+	{
+		StringList usedFiles;
+		result = loadCode(config.code, config.baseFolder, config.options, config.inputLayout, decodedUsages, usedFiles);
+	}
+	return result;
+}
+
 void Material::loadRenderPass(const std::string& cls, const Dictionary& obj, const std::string& baseFolder) {
 	bool isGraphicsPipeline = (obj.stringForKey(kClass)->content != kCompute);
 	_pipelineClass = isGraphicsPipeline ? PipelineClass::Graphics : PipelineClass::Compute;
@@ -201,8 +238,12 @@ void Material::loadRenderPass(const std::string& cls, const Dictionary& obj, con
 		setCullMode(cullMode, cls);
 	}
 
-	_configurations[cls].program = loadCode(obj.stringForKey(kCode)->content, baseFolder, obj.dictionaryForKey(kOptions),
-		_configurations[cls].inputLayout, _configurations[cls].usedFiles);
+	Configuration& config = _configurations[cls];
+	config.code = obj.stringForKey(kCode)->content;
+	config.baseFolder = baseFolder;
+	config.options = obj.dictionaryForKey(kOptions);
+	config.decodingPrograms.clear();
+	config.program = loadCode(config.code, config.baseFolder, config.options, config.inputLayout, 0, config.usedFiles);
 }
 
 VertexDeclaration Material::loadInputLayout(Dictionary layout) {
@@ -228,29 +269,85 @@ VertexDeclaration Material::loadInputLayout(Dictionary layout) {
 	return decl;
 }
 
-std::string Material::generateInputLayout(const VertexDeclaration& decl) {
+std::string Material::generateInputLayout(const VertexDeclaration& decl, uint32_t decodedUsages) {
 	std::string layout;
-	layout.reserve(1024);
+	layout.reserve(2048);
 
-	layout.append("struct VSInput {\n");
+	/*
+	 * Shaders are expected to take VSInputEncoded and to get VSInput by calling decodeVertexInput,
+	 * without decoded usages VSInputEncoded is the same structure as VSInput
+	 */
+	if (decodedUsages == 0)
+	{
+		layout.append("struct VSInput {\n");
+		for (const auto& element : decl.elements())
+		{
+			char buffer[256] = {};
+			sprintf(buffer, "%s %s : %s;\n",
+				dataTypeToString(element.type(), _renderer->api()).c_str(),
+				vertexAttributeUsageToString(element.usage()).c_str(),
+				vertexAttributeUsageSemantics(element.usage()).c_str()
+			);
+
+			layout.append(buffer);
+		}
+		layout.append("};\n");
+		layout.append("typedef VSInput VSInputEncoded;\n");
+		layout.append("VSInput decodeVertexInput(VSInputEncoded vsIn) { return vsIn; }\n");
+		return layout;
+	}
+
+	layout.append("struct VSInputEncoded {\n");
 	for (const auto& element : decl.elements())
 	{
+		bool decoded = (decodedUsages & vertexAttributeUsageMask(element.usage())) != 0;
 		char buffer[256] = {};
 		sprintf(buffer, "%s %s : %s;\n",
-			dataTypeToString(element.type(), _renderer->api()).c_str(),
+			dataTypeToString(decoded ? DataType::Vec2 : element.type(), _renderer->api()).c_str(),
 			vertexAttributeUsageToString(element.usage()).c_str(),
 			vertexAttributeUsageSemantics(element.usage()).c_str()
 		);
+		layout.append(buffer);
+	}
+	layout.append("};\n");
 
+	layout.append("struct VSInput {\n");
+	for (const auto& element : decl.elements())
+	{
+		char buffer[256] = {};
+		sprintf(buffer, "%s %s;\n",
+			dataTypeToString(element.type(), _renderer->api()).c_str(),
+			vertexAttributeUsageToString(element.usage()).c_str()
+		);
 		layout.append(buffer);
 	}
 	layout.append("};\n");
 
+	layout.append(
+		"float3 decodeOctahedral(float2 e) {\n"
+		"float3 n = float3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));\n"
+		"float t = saturate(-n.z);\n"
+		"n.x += (n.x >= 0.0) ? -t : t;\n"
+		"n.y += (n.y >= 0.0) ? -t : t;\n"
+		"return normalize(n);\n"
+		"}\n");
+
+	layout.append("VSInput decodeVertexInput(VSInputEncoded vsIn) {\n");
+	layout.append("VSInput result;\n");
+	for (const auto& element : decl.elements())
+	{
+		bool decoded = (decodedUsages & vertexAttributeUsageMask(element.usage())) != 0;
+		const std::string& name = vertexAttributeUsageToString(element.usage());
+		layout.append("result." + name + (decoded ? " = decodeOctahedral(vsIn." + name + ");\n" : " = vsIn." + name + ";\n"));
+	}
+	layout.append("return result;\n");
+	layout.append("}\n");
+
 	return layout;
 }
 
 Program::Pointer Material::loadCode(const std::string& codeString, const std::string& baseFolder,
-	const Dictionary& defines, const VertexDeclaration& decl, StringList& fileNames) {
+	const Dictionary& defines, const VertexDeclaration& decl, uint32_t decodedUsages, StringList& fileNames) {
 	application().pushSearchPath(baseFolder);
 	std::string codeFileName = application().resolveFileName(codeString + ".hlsl");
 	application().popSearchPaths();
@@ -282,10 +379,10 @@ Program::Pointer Material::loadCode(const std::string& codeString, const std::st
 
 	std::string programSource = loadTextFile(codeFileName);
 	fileNames = parseShaderSource(programSource, getFilePath(codeFileName), allDefines,
-		[this, &decl](ParseDirective what, std::string& code, uint32_t positionInCode) {
+		[this, &decl, decodedUsages](ParseDirective what, std::string& code, uint32_t positionInCode) {
 		if (what == ParseDirective::InputLayout)
 		{
-			code.insert(positionInCode, generateInputLayout(decl));
+			code.insert(positionInCode, generateInputLayout(decl, decodedUsages));
 		}
 		else if (what == ParseDirective::DefaultHeader)
 		{
@@ -569,6 +666,7 @@ void Material::initDefaultHeader() {
 
 #define DECL_OBJECT_BUFFER		register(c0, space0)
 #define DECL_MATERIAL_BUFFER	register(c1, space0)
+#define DECL_DRAW_INSTANCES_BUFFER	register(t2, space0)
 
 #define DECLARE_BUFFER		DECL_REGISTER(c, space0)
 #define DECLARE_TEXTURE		DECL_REGISTER(t, space1) 
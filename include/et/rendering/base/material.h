@@ -31,6 +31,15 @@ public:
 		BlendState blendState;
 		CullMode cullMode = CullMode::Disabled;
 		StringList usedFiles;
+
+		/*
+		 * Source of the program, kept to build variants decoding
+		 * vertex attributes which are not decoded by hardware
+		 */
+		std::string code;
+		std::string baseFolder;
+		Dictionary options;
+		Map<uint32_t, Program::Pointer> decodingPrograms;
 	};
 	using ConfigurationMap = UnorderedMap<std::string, Configuration>;
 
@@ -60,6 +69,7 @@ public:
 	uint64_t sortingKey() const;
 
 	const Configuration& configuration(const std::string&) const;
+	const Program::Pointer& program(const std::string&, const VertexDeclaration& streamLayout);
 	const ConfigurationMap& configurations() const { return _configurations; }
 
 	void loadFromJson(const std::string& json, const std::string& baseFolder);
@@ -76,8 +86,8 @@ private:
 
 	VertexDeclaration loadInputLayout(Dictionary);
 	Program::Pointer loadCode(const std::string&, const std::string& baseFolder, 
-		const Dictionary& defines, const VertexDeclaration&, StringList& fileNames);
-	std::string generateInputLayout(const VertexDeclaration& decl);
+		const Dictionary& defines, const VertexDeclaration&, uint32_t decodedUsages, StringList& fileNames);
+	std::string generateInputLayout(const VertexDeclaration& decl, uint32_t decodedUsages);
 
 	void setProgram(const Program::Pointer&, const std::string&);
 	void setDepthState(const DepthState&, const std::string&);
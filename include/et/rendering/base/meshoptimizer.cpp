@@ -0,0 +1,512 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/rendering/base/meshoptimizer.h>
+
+namespace et
+{
+
+namespace mo_local
+{
+
+enum : uint32_t
+{
+	ForsythCacheSize = 32,
+	ForsythMaxValence = 32,
+};
+
+const float ForsythCacheDecayPower = 1.5f;
+const float ForsythLastTriangleScore = 0.75f;
+const float ForsythValenceBoostScale = 2.0f;
+const float ForsythValenceBoostPower = 0.5f;
+
+void readIndices(const IndexArray::Pointer& ia, const meshoptimizer::IndexRange& range, Vector<uint32_t>& indices)
+{
+	ET_ASSERT(range.first + range.count <= ia->capacity());
+
+	indices.resize(range.count);
+	for (uint32_t i = 0; i < range.count; ++i)
+		indices[i] = ia->getIndex(range.first + i);
+}
+
+void writeIndices(const IndexArray::Pointer& ia, const meshoptimizer::IndexRange& range, const Vector<uint32_t>& indices)
+{
+	ET_ASSERT(indices.size() == range.count);
+
+	for (uint32_t i = 0; i < range.count; ++i)
+		ia->setIndex(indices[i], range.first + i);
+}
+
+/*
+ * FIFO cache simulation, vertex is in cache if it was inserted less than cacheSize insertions ago
+ */
+class FIFOCache
+{
+public:
+	FIFOCache(uint32_t vertexCount, uint32_t cacheSize) :
+		_timestamps(vertexCount, 0), _cacheSize(cacheSize), _time(cacheSize + 1) { }
+
+	bool access(uint32_t v)
+	{
+		if (_time - _timestamps[v] <= _cacheSize)
+			return true;
+
+		_timestamps[v] = _time++;
+		return false;
+	}
+
+	void flush()
+	{
+		_time += _cacheSize + 1;
+	}
+
+private:
+	Vector<uint32_t> _timestamps;
+	uint32_t _cacheSize = 0;
+	uint32_t _time = 0;
+};
+
+uint32_t triangleCacheMisses(FIFOCache& cache, const uint32_t* triangle)
+{
+	uint32_t misses = 0;
+	for (uint32_t k = 0; k < 3; ++k)
+		misses += cache.access(triangle[k]) ? 0 : 1;
+	return misses;
+}
+
+float forsythVertexScore(int32_t cachePosition, uint32_t liveTriangles)
+{
+	if (liveTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+		{
+			score = ForsythLastTriangleScore;
+		}
+		else
+		{
+			float scaler = 1.0f / static_cast<float>(ForsythCacheSize - 3);
+			score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scaler, ForsythCacheDecayPower);
+		}
+	}
+
+	return score + ForsythValenceBoostScale * std::pow(static_cast<float>(liveTriangles), -ForsythValenceBoostPower);
+}
+
+}
+
+meshoptimizer::CacheStatistics meshoptimizer::analyzeVertexCache(const IndexArray::Pointer& ia, const IndexRange& range, uint32_t cacheSize)
+{
+	return analyzeVertexCache(ia, IndexRangeList(1, range), cacheSize);
+}
+
+meshoptimizer::CacheStatistics meshoptimizer::analyzeVertexCache(const IndexArray::Pointer& ia, const IndexRangeList& ranges, uint32_t cacheSize)
+{
+	ET_ASSERT(ia->primitiveType() == PrimitiveType::Triangles);
+
+	uint32_t vertexCount = 0;
+	for (const IndexRange& range : ranges)
+	{
+		for (uint32_t i = range.first, e = range.first + range.count; i < e; ++i)
+			vertexCount = std::max(vertexCount, ia->getIndex(i) + 1);
+	}
+
+	CacheStatistics result;
+	Vector<bool> referenced(vertexCount, false);
+	mo_local::FIFOCache cache(vertexCount, cacheSize);
+	for (const IndexRange& range : ranges)
+	{
+		/*
+		 * Each range is a separate draw, so cache is not shared between them
+		 */
+		cache.flush();
+		for (uint32_t i = range.first, e = range.first + range.count - range.count % 3; i < e; i += 3)
+		{
+			uint32_t triangle[3] = { ia->getIndex(i), ia->getIndex(i + 1), ia->getIndex(i + 2) };
+			result.transformedVertices += mo_local::triangleCacheMisses(cache, triangle);
+			for (uint32_t v : triangle)
+			{
+				result.uniqueVertices += referenced[v] ? 0 : 1;
+				referenced[v] = true;
+			}
+			++result.triangles;
+		}
+	}
+
+	if (result.triangles > 0)
+		result.acmr = static_cast<float>(result.transformedVertices) / static_cast<float>(result.triangles);
+
+	if (result.uniqueVertices > 0)
+		result.atvr = static_cast<float>(result.transformedVertices) / static_cast<float>(result.uniqueVertices);
+
+	return result;
+}
+
+void meshoptimizer::optimizeVertexCache(const IndexArray::Pointer& ia, const IndexRange& range)
+{
+	ET_ASSERT(ia->primitiveType() == PrimitiveType::Triangles);
+
+	uint32_t triangleCount = range.count / 3;
+	if (triangleCount < 2)
+		return;
+
+	Vector<uint32_t> indices;
+	mo_local::readIndices(ia, range, indices);
+
+	/*
+	 * Vertices are addressed relatively to the smallest index in range
+	 */
+	uint32_t minIndex = *std::min_element(indices.begin(), indices.begin() + 3 * triangleCount);
+	uint32_t maxIndex = *std::max_element(indices.begin(), indices.begin() + 3 * triangleCount);
+	uint32_t vertexCount = maxIndex - minIndex + 1;
+	for (uint32_t i = 0; i < 3 * triangleCount; ++i)
+		indices[i] -= minIndex;
+
+	Vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (uint32_t i = 0; i < 3 * triangleCount; ++i)
+		++liveTriangles[indices[i]];
+
+	Vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+	Vector<uint32_t> adjacency(3 * triangleCount);
+	{
+		Vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
+				adjacency[fill[indices[3 * t + k]]++] = t;
+		}
+	}
+
+	Vector<int32_t> cachePosition(vertexCount, -1);
+	Vector<float> vertexScore(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		vertexScore[v] = mo_local::forsythVertexScore(-1, liveTriangles[v]);
+
+	Vector<float> triangleScore(triangleCount);
+	Vector<bool> emitted(triangleCount, false);
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		const uint32_t* tri = indices.data() + 3 * t;
+		triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+	}
+
+	uint32_t cache[mo_local::ForsythCacheSize + 3] = { };
+	uint32_t cacheEntries = 0;
+
+	Vector<uint32_t> result;
+	result.reserve(range.count);
+
+	uint32_t bestTriangle = static_cast<uint32_t>(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+	uint32_t inputCursor = 0;
+	for (uint32_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		/*
+		 * Nothing to continue with from cache, next triangle in input order is used
+		 */
+		if (bestTriangle == InvalidIndex)
+		{
+			while (emitted[inputCursor])
+				++inputCursor;
+			bestTriangle = inputCursor;
+		}
+
+		const uint32_t* tri = indices.data() + 3 * bestTriangle;
+		emitted[bestTriangle] = true;
+
+		uint32_t newCache[mo_local::ForsythCacheSize + 3] = { };
+		uint32_t newCacheEntries = 0;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t v = tri[k];
+			result.push_back(v + minIndex);
+			newCache[newCacheEntries++] = v;
+
+			uint32_t* adjacencyBegin = adjacency.data() + adjacencyOffsets[v];
+			uint32_t* adjacencyEnd = adjacencyBegin + liveTriangles[v];
+			uint32_t* removed = std::find(adjacencyBegin, adjacencyEnd, bestTriangle);
+			ET_ASSERT(removed != adjacencyEnd);
+			std::swap(*removed, *(adjacencyEnd - 1));
+			--liveTriangles[v];
+		}
+
+		for (uint32_t i = 0; i < cacheEntries; ++i)
+		{
+			uint32_t v = cache[i];
+			if ((v != tri[0]) && (v != tri[1]) && (v != tri[2]))
+				newCache[newCacheEntries++] = v;
+		}
+
+		/*
+		 * Vertices pushed out of cache are updated with the ones remaining in cache
+		 */
+		for (uint32_t i = 0; i < newCacheEntries; ++i)
+		{
+			uint32_t v = newCache[i];
+			cachePosition[v] = (i < mo_local::ForsythCacheSize) ? static_cast<int32_t>(i) : -1;
+			vertexScore[v] = mo_local::forsythVertexScore(cachePosition[v], liveTriangles[v]);
+		}
+
+		bestTriangle = InvalidIndex;
+		float bestScore = -1.0f;
+		for (uint32_t i = 0; i < newCacheEntries; ++i)
+		{
+			uint32_t v = newCache[i];
+			for (uint32_t a = adjacencyOffsets[v], ae = adjacencyOffsets[v] + liveTriangles[v]; a < ae; ++a)
+			{
+				uint32_t t = adjacency[a];
+				const uint32_t* adjacentTriangle = indices.data() + 3 * t;
+				triangleScore[t] = vertexScore[adjacentTriangle[0]] + vertexScore[adjacentTriangle[1]] + vertexScore[adjacentTriangle[2]];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		cacheEntries = std::min(newCacheEntries, static_cast<uint32_t>(mo_local::ForsythCacheSize));
+		std::copy(newCache, newCache + cacheEntries, cache);
+	}
+
+	for (uint32_t i = 3 * triangleCount; i < range.count; ++i)
+		result.push_back(indices[i] + minIndex);
+
+	mo_local::writeIndices(ia, range, result);
+}
+
+void meshoptimizer::optimizeOverdraw(const IndexArray::Pointer& ia, const VertexStorage::Pointer& vs, const IndexRange& range, float threshold)
+{
+	ET_ASSERT(ia->primitiveType() == PrimitiveType::Triangles);
+	ET_ASSERT(vs->hasAttributeWithType(VertexAttributeUsage::Position, DataType::Vec3));
+
+	uint32_t triangleCount = range.count / 3;
+	if (triangleCount < 2)
+		return;
+
+	Vector<uint32_t> indices;
+	mo_local::readIndices(ia, range, indices);
+
+	/*
+	 * Hard boundaries - triangles which are not sharing any vertex with cache
+	 */
+	Vector<uint32_t> clusters;
+	mo_local::FIFOCache cache(vs->capacity(), DefaultCacheSize);
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		if (mo_local::triangleCacheMisses(cache, indices.data() + 3 * t) == 3)
+			clusters.push_back(t);
+	}
+	clusters.push_back(triangleCount);
+
+	float rangeACMR = analyzeVertexCache(ia, range).acmr;
+
+	/*
+	 * Soft boundaries - cluster is split when its ACMR is close enough to ACMR of the whole range
+	 */
+	Vector<uint32_t> softClusters;
+	for (size_t c = 0; c + 1 < clusters.size(); ++c)
+	{
+		cache.flush();
+		uint32_t clusterStart = clusters[c];
+		uint32_t clusterMisses = 0;
+		for (uint32_t t = clusterStart, te = clusters[c + 1]; t < te; ++t)
+		{
+			if (t == clusterStart)
+				softClusters.push_back(t);
+
+			clusterMisses += mo_local::triangleCacheMisses(cache, indices.data() + 3 * t);
+			float clusterACMR = static_cast<float>(clusterMisses) / static_cast<float>(t - clusterStart + 1);
+			if ((t + 1 < te) && (clusterACMR <= threshold * rangeACMR))
+			{
+				cache.flush();
+				clusterStart = t + 1;
+				clusterMisses = 0;
+			}
+		}
+	}
+	softClusters.push_back(triangleCount);
+
+	const auto pos = vs->accessData<DataType::Vec3>(VertexAttributeUsage::Position, 0);
+
+	vec3 meshCenter(0.0f);
+	float meshArea = 0.0f;
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		const uint32_t* tri = indices.data() + 3 * t;
+		float area = cross(pos[tri[1]] - pos[tri[0]], pos[tri[2]] - pos[tri[0]]).length();
+		meshCenter += area * (pos[tri[0]] + pos[tri[1]] + pos[tri[2]]) / 3.0f;
+		meshArea += area;
+	}
+	meshCenter /= std::max(meshArea, std::numeric_limits<float>::epsilon());
+
+	/*
+	 * Clusters facing outside of the mesh are more likely to occlude others,
+	 * so they are drawn first
+	 */
+	using SortKey = std::pair<float, uint32_t>;
+	Vector<SortKey> sortKeys;
+	sortKeys.reserve(softClusters.size() - 1);
+	for (uint32_t c = 0; c + 1 < softClusters.size(); ++c)
+	{
+		vec3 clusterCenter(0.0f);
+		vec3 clusterNormal(0.0f);
+		float clusterArea = 0.0f;
+		for (uint32_t t = softClusters[c]; t < softClusters[c + 1]; ++t)
+		{
+			const uint32_t* tri = indices.data() + 3 * t;
+			vec3 normal = cross(pos[tri[1]] - pos[tri[0]], pos[tri[2]] - pos[tri[0]]);
+			float area = normal.length();
+			clusterCenter += area * (pos[tri[0]] + pos[tri[1]] + pos[tri[2]]) / 3.0f;
+			clusterNormal += normal;
+			clusterArea += area;
+		}
+		clusterCenter /= std::max(clusterArea, std::numeric_limits<float>::epsilon());
+		float normalLength = clusterNormal.length();
+		if (normalLength > 0.0f)
+			clusterNormal /= normalLength;
+
+		sortKeys.emplace_back(dot(clusterCenter - meshCenter, clusterNormal), c);
+	}
+
+	std::stable_sort(sortKeys.begin(), sortKeys.end(), [](const SortKey& l, const SortKey& r) {
+		return l.first > r.first;
+	});
+
+	Vector<uint32_t> result;
+	result.reserve(range.count);
+	for (const SortKey& key : sortKeys)
+	{
+		uint32_t first = 3 * softClusters[key.second];
+		uint32_t last = 3 * softClusters[key.second + 1];
+		result.insert(result.end(), indices.begin() + first, indices.begin() + last);
+	}
+	result.insert(result.end(), indices.begin() + 3 * triangleCount, indices.end());
+
+	mo_local::writeIndices(ia, range, result);
+}
+
+uint32_t meshoptimizer::removeDuplicateVertices(const VertexStorage::Pointer& vs, const IndexArray::Pointer& ia, const IndexRangeList& ranges)
+{
+	uint32_t vertexCount = vs->capacity();
+	uint32_t stride = vs->stride();
+	const char* vertexData = vs->data().binary();
+
+	auto vertexHash = [vertexData, stride](uint32_t v) {
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(vertexData + v * stride);
+		uint64_t hash = 14695981039346656037ull;
+		for (uint32_t i = 0; i < stride; ++i)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	};
+
+	auto vertexEqual = [vertexData, stride](uint32_t l, uint32_t r) {
+		return memcmp(vertexData + l * stride, vertexData + r * stride, stride) == 0;
+	};
+
+	/*
+	 * Maps hash to the first vertex with it, different vertices with colliding hashes
+	 * are placed at the following keys
+	 */
+	UnorderedMap<uint64_t, uint32_t> uniqueVertices;
+	uniqueVertices.reserve(vertexCount);
+
+	Vector<uint32_t> remap(vertexCount);
+	uint32_t newVertexCount = 0;
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		uint64_t key = vertexHash(v);
+		auto inserted = uniqueVertices.emplace(key, v);
+		while (!inserted.second && !vertexEqual(inserted.first->second, v))
+			inserted = uniqueVertices.emplace(++key, v);
+
+		remap[v] = inserted.second ? newVertexCount++ : remap[inserted.first->second];
+	}
+
+	if (newVertexCount == vertexCount)
+		return vertexCount;
+
+	BinaryDataStorage newData(newVertexCount * stride, 0);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		memcpy(newData.binary() + remap[v] * stride, vertexData + v * stride, stride);
+
+	for (const IndexRange& range : ranges)
+	{
+		for (uint32_t i = range.first, e = range.first + range.count; i < e; ++i)
+			ia->setIndex(remap[ia->getIndex(i)], i);
+	}
+
+	vs->resize(newVertexCount);
+	memcpy(vs->data().binary(), newData.binary(), newData.dataSize());
+	return newVertexCount;
+}
+
+void meshoptimizer::optimizeVertexFetch(const VertexStorage::Pointer& vs, const IndexArray::Pointer& ia, const IndexRangeList& ranges)
+{
+	uint32_t vertexCount = vs->capacity();
+	uint32_t stride = vs->stride();
+
+	Vector<uint32_t> remap(vertexCount, InvalidIndex);
+	uint32_t nextVertex = 0;
+	for (const IndexRange& range : ranges)
+	{
+		for (uint32_t i = range.first, e = range.first + range.count; i < e; ++i)
+		{
+			uint32_t v = ia->getIndex(i);
+			if (remap[v] == InvalidIndex)
+				remap[v] = nextVertex++;
+			ia->setIndex(remap[v], i);
+		}
+	}
+
+	for (uint32_t& r : remap)
+	{
+		if (r == InvalidIndex)
+			r = nextVertex++;
+	}
+
+	BinaryDataStorage newData(vs->data().dataSize(), 0);
+	const char* vertexData = vs->data().binary();
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		memcpy(newData.binary() + remap[v] * stride, vertexData + v * stride, stride);
+
+	memcpy(vs->data().binary(), newData.binary(), newData.dataSize());
+}
+
+meshoptimizer::CacheStatistics meshoptimizer::optimize(const VertexStorage::Pointer& vs, const IndexArray::Pointer& ia,
+	const IndexRangeList& ranges, uint32_t options)
+{
+	CacheStatistics before = analyzeVertexCache(ia, ranges);
+
+	if (options & Option_RemoveDuplicateVertices)
+		removeDuplicateVertices(vs, ia, ranges);
+
+	for (const IndexRange& range : ranges)
+	{
+		if (options & Option_VertexCache)
+			optimizeVertexCache(ia, range);
+
+		if (options & Option_Overdraw)
+			optimizeOverdraw(ia, vs, range);
+	}
+
+	if (options & Option_VertexFetch)
+		optimizeVertexFetch(vs, ia, ranges);
+
+	CacheStatistics after = analyzeVertexCache(ia, ranges);
+	log::info("Mesh optimization: %u triangles, ACMR: %.3f -> %.3f, ATVR: %.3f -> %.3f",
+		after.triangles, before.acmr, after.acmr, before.atvr, after.atvr);
+
+	return after;
+}
+
+}
@@ -0,0 +1,91 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/rendering/base/indexarray.h>
+#include <et/rendering/base/vertexstorage.h>
+
+namespace et
+{
+	namespace meshoptimizer
+	{
+		enum : uint32_t
+		{
+			/*
+			 * Size of the FIFO cache used to estimate post-transform cache efficiency
+			 */
+			DefaultCacheSize = 16,
+		};
+
+		enum Options : uint32_t
+		{
+			Option_RemoveDuplicateVertices = 1 << 0,
+			Option_VertexCache = 1 << 1,
+			Option_Overdraw = 1 << 2,
+			Option_VertexFetch = 1 << 3,
+
+			Option_IndicesOnly = Option_VertexCache | Option_Overdraw,
+			Option_All = Option_RemoveDuplicateVertices | Option_VertexCache | Option_Overdraw | Option_VertexFetch,
+		};
+
+		struct IndexRange
+		{
+			uint32_t first = 0;
+			uint32_t count = 0;
+
+			IndexRange() = default;
+			IndexRange(uint32_t f, uint32_t c) :
+				first(f), count(c) { }
+		};
+		using IndexRangeList = Vector<IndexRange>;
+
+		struct CacheStatistics
+		{
+			/*
+			 * acmr - average cache miss ratio, transformed vertices per triangle (0.5 ... 3.0)
+			 * atvr - average transform to vertex ratio, transformed vertices per unique vertex (1.0 ... 6.0)
+			 */
+			float acmr = 0.0f;
+			float atvr = 0.0f;
+			uint32_t triangles = 0;
+			uint32_t uniqueVertices = 0;
+			uint32_t transformedVertices = 0;
+		};
+
+		CacheStatistics analyzeVertexCache(const IndexArray::Pointer&, const IndexRange&, uint32_t cacheSize = DefaultCacheSize);
+		CacheStatistics analyzeVertexCache(const IndexArray::Pointer&, const IndexRangeList&, uint32_t cacheSize = DefaultCacheSize);
+
+		/*
+		 * Reorders triangles within the range for post-transform cache (Forsyth's linear-speed algorithm)
+		 */
+		void optimizeVertexCache(const IndexArray::Pointer&, const IndexRange&);
+
+		/*
+		 * Splits cache-optimized triangles into clusters (at cache flushes and where cluster ACMR
+		 * is within threshold of the whole range) and orders clusters outside-in to reduce overdraw
+		 */
+		void optimizeOverdraw(const IndexArray::Pointer&, const VertexStorage::Pointer&, const IndexRange&, float threshold = 1.05f);
+
+		/*
+		 * Merges binary identical vertices, returns new vertex count
+		 */
+		uint32_t removeDuplicateVertices(const VertexStorage::Pointer&, const IndexArray::Pointer&, const IndexRangeList&);
+
+		/*
+		 * Reorders vertices in order of the first use by ranges, unreferenced vertices are moved to the end
+		 */
+		void optimizeVertexFetch(const VertexStorage::Pointer&, const IndexArray::Pointer&, const IndexRangeList&);
+
+		/*
+		 * Runs enabled stages in order: duplicates removal, vertex cache, overdraw, vertex fetch,
+		 * reports cache statistics before and after optimization
+		 */
+		CacheStatistics optimize(const VertexStorage::Pointer&, const IndexArray::Pointer&, const IndexRangeList&,
+			uint32_t options = Option_All);
+	}
+}
@@ -0,0 +1,602 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/rendering/base/meshsimplifier.h>
+
+namespace et
+{
+
+namespace ms_local
+{
+
+enum : uint32_t
+{
+	MaxAttributes = 5,
+
+	VertexKind_Manifold = 0,
+	VertexKind_Border = 1 << 0,
+	VertexKind_Locked = 1 << 1,
+};
+
+const float BorderWeight = 10.0f;
+const float MinNormalCosine = 0.25f;
+
+/*
+ * Symmetric quadric of squared distances to planes, weighted by triangle areas
+ */
+struct Quadric
+{
+	float a00 = 0.0f;
+	float a11 = 0.0f;
+	float a22 = 0.0f;
+	float a10 = 0.0f;
+	float a20 = 0.0f;
+	float a21 = 0.0f;
+	float b0 = 0.0f;
+	float b1 = 0.0f;
+	float b2 = 0.0f;
+	float c = 0.0f;
+	float w = 0.0f;
+
+	Quadric() = default;
+
+	Quadric(const vec3& n, float d, float weight) :
+		a00(weight * n.x * n.x), a11(weight * n.y * n.y), a22(weight * n.z * n.z),
+		a10(weight * n.y * n.x), a20(weight * n.z * n.x), a21(weight * n.z * n.y),
+		b0(weight * n.x * d), b1(weight * n.y * d), b2(weight * n.z * d), c(weight * d * d), w(weight) { }
+
+	Quadric& operator += (const Quadric& q)
+	{
+		a00 += q.a00; a11 += q.a11; a22 += q.a22;
+		a10 += q.a10; a20 += q.a20; a21 += q.a21;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+		w += q.w;
+		return *this;
+	}
+
+	float evaluate(const vec3& p) const
+	{
+		float rx = a00 * p.x + a10 * p.y + a20 * p.z;
+		float ry = a10 * p.x + a11 * p.y + a21 * p.z;
+		float rz = a20 * p.x + a21 * p.y + a22 * p.z;
+		float value = p.x * rx + p.y * ry + p.z * rz + 2.0f * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+		return (w > 0.0f) ? std::abs(value) / w : 0.0f;
+	}
+};
+
+/*
+ * Quadric of squared distances to attribute samples: sum of w * |x - a|^2
+ */
+struct AttributeQuadric
+{
+	float b[MaxAttributes] = { };
+	float c = 0.0f;
+	float w = 0.0f;
+
+	void add(const float* a, float weight)
+	{
+		for (uint32_t i = 0; i < MaxAttributes; ++i)
+		{
+			b[i] += weight * a[i];
+			c += weight * a[i] * a[i];
+		}
+		w += weight;
+	}
+
+	AttributeQuadric& operator += (const AttributeQuadric& q)
+	{
+		for (uint32_t i = 0; i < MaxAttributes; ++i)
+			b[i] += q.b[i];
+		c += q.c;
+		w += q.w;
+		return *this;
+	}
+
+	float evaluate(const float* x) const
+	{
+		float value = c;
+		for (uint32_t i = 0; i < MaxAttributes; ++i)
+			value += w * x[i] * x[i] - 2.0f * b[i] * x[i];
+		return (w > 0.0f) ? std::abs(value) / w : 0.0f;
+	}
+};
+
+inline uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+	return (a < b) ? ((static_cast<uint64_t>(a) << 32) | b) : ((static_cast<uint64_t>(b) << 32) | a);
+}
+
+/*
+ * Vertices with equal positions (wedges of attribute seams) share the canonical vertex,
+ * topology is evaluated on canonical vertices, attributes - on wedges.
+ * State is preserved between runs, so levels of detail are produced by the continuous simplification.
+ * Only vertices referenced by the indices are processed: indices are remapped to the compact set
+ * on construction and should be restored with restoreIndices
+ */
+class Simplifier
+{
+public:
+	Simplifier(const VertexStorage::Pointer& vs, Vector<uint32_t>& indices, const meshsimplifier::Options& options);
+
+	void run(Vector<uint32_t>& indices, uint32_t targetIndexCount);
+
+	float error() const
+		{ return std::sqrt(_error) * _extent; }
+
+	uint32_t sourceVertex(uint32_t v) const
+		{ return _vertices[v]; }
+
+	void restoreIndices(Vector<uint32_t>& indices) const
+	{
+		for (uint32_t& i : indices)
+			i = _vertices[i];
+	}
+
+private:
+	struct Collapse
+	{
+		uint32_t source = 0;
+		uint32_t target = 0;
+		float cost = 0.0f;
+	};
+
+	void classifyVertices(const Vector<uint32_t>& indices);
+	void buildAdjacency(const Vector<uint32_t>& indices);
+	bool evaluateCollapse(const Vector<uint32_t>& indices, uint32_t v, uint32_t t, float& cost);
+
+	const float* attributes(uint32_t v) const
+		{ return _attributes.data() + v * MaxAttributes; }
+
+	uint32_t edgeTriangles(uint32_t a, uint32_t b) const
+	{
+		auto i = _edges.find(edgeKey(a, b));
+		return (i == _edges.end()) ? 0 : i->second;
+	}
+
+private:
+	Vector<uint32_t> _vertices;
+	Vector<vec3> _positions;
+	Vector<float> _attributes;
+	Vector<uint32_t> _canonical;
+	Vector<Quadric> _quadrics;
+	Vector<AttributeQuadric> _attributeQuadrics;
+	Vector<uint32_t> _wedgeRemap;
+	Vector<uint32_t> _vertexKind;
+	Vector<uint32_t> _adjacencyOffsets;
+	Vector<uint32_t> _adjacency;
+	Vector<std::pair<uint32_t, uint32_t>> _wedgeMapping;
+	UnorderedMap<uint64_t, uint32_t> _edges;
+	float _maxErrorSquared = 0.0f;
+	float _extent = 1.0f;
+	float _error = 0.0f;
+};
+
+Simplifier::Simplifier(const VertexStorage::Pointer& vs, Vector<uint32_t>& indices, const meshsimplifier::Options& options)
+{
+	ET_ASSERT(vs->hasAttributeWithType(VertexAttributeUsage::Position, DataType::Vec3));
+
+	_vertices.assign(indices.begin(), indices.end());
+	std::sort(_vertices.begin(), _vertices.end());
+	_vertices.erase(std::unique(_vertices.begin(), _vertices.end()), _vertices.end());
+	for (uint32_t& i : indices)
+		i = static_cast<uint32_t>(std::lower_bound(_vertices.begin(), _vertices.end(), i) - _vertices.begin());
+
+	uint32_t vertexCount = static_cast<uint32_t>(_vertices.size());
+	const auto pos = vs->accessData<DataType::Vec3>(VertexAttributeUsage::Position, 0);
+
+	vec3 minVertex(std::numeric_limits<float>::max());
+	vec3 maxVertex(-std::numeric_limits<float>::max());
+	for (uint32_t v : _vertices)
+	{
+		minVertex = minv(minVertex, pos[v]);
+		maxVertex = maxv(maxVertex, pos[v]);
+	}
+	vec3 dimensions = maxVertex - minVertex;
+	_extent = std::max(std::max(dimensions.x, dimensions.y), dimensions.z);
+	if (_extent <= std::numeric_limits<float>::epsilon())
+		_extent = 1.0f;
+	_maxErrorSquared = sqr(options.maxError);
+
+	/*
+	 * Positions are normalized, so errors and weights do not depend on the mesh scale
+	 */
+	_positions.resize(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		_positions[v] = (pos[_vertices[v]] - minVertex) / _extent;
+
+	const VertexDeclaration& decl = vs->declaration();
+	_attributes.resize(vertexCount * MaxAttributes, 0.0f);
+	if (decl.has(VertexAttributeUsage::Normal) && !decl.elementForUsage(VertexAttributeUsage::Normal).encoded() &&
+		vs->hasAttributeWithType(VertexAttributeUsage::Normal, DataType::Vec3))
+	{
+		const auto nrm = vs->accessData<DataType::Vec3>(VertexAttributeUsage::Normal, 0);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			const vec3& n = nrm[_vertices[v]];
+			_attributes[v * MaxAttributes + 0] = options.normalWeight * n.x;
+			_attributes[v * MaxAttributes + 1] = options.normalWeight * n.y;
+			_attributes[v * MaxAttributes + 2] = options.normalWeight * n.z;
+		}
+	}
+	if (decl.has(VertexAttributeUsage::TexCoord0) && !decl.elementForUsage(VertexAttributeUsage::TexCoord0).encoded() &&
+		vs->hasAttributeWithType(VertexAttributeUsage::TexCoord0, DataType::Vec2))
+	{
+		const auto uv = vs->accessData<DataType::Vec2>(VertexAttributeUsage::TexCoord0, 0);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			const vec2& t = uv[_vertices[v]];
+			_attributes[v * MaxAttributes + 3] = options.texCoordWeight * t.x;
+			_attributes[v * MaxAttributes + 4] = options.texCoordWeight * t.y;
+		}
+	}
+
+	const vec3* positions = _positions.data();
+	auto positionHash = [positions](uint32_t v) {
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(positions + v);
+		uint64_t hash = 14695981039346656037ull;
+		for (uint32_t i = 0; i < sizeof(vec3); ++i)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	};
+	auto positionEqual = [positions](uint32_t l, uint32_t r) {
+		return memcmp(positions + l, positions + r, sizeof(vec3)) == 0;
+	};
+
+	/*
+	 * Colliding hashes of different positions are placed at the following keys
+	 */
+	UnorderedMap<uint64_t, uint32_t> uniquePositions;
+	uniquePositions.reserve(vertexCount);
+
+	_canonical.resize(vertexCount);
+	_wedgeRemap.resize(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		uint64_t key = positionHash(v);
+		auto inserted = uniquePositions.emplace(key, v);
+		while (!inserted.second && !positionEqual(inserted.first->second, v))
+			inserted = uniquePositions.emplace(++key, v);
+
+		_canonical[v] = inserted.first->second;
+		_wedgeRemap[v] = v;
+	}
+
+	_quadrics.resize(vertexCount);
+	_attributeQuadrics.resize(vertexCount);
+	for (uint32_t i = 0, e = static_cast<uint32_t>(indices.size()); i < e; i += 3)
+	{
+		const uint32_t* tri = indices.data() + i;
+		const vec3& p0 = _positions[tri[0]];
+		vec3 n = cross(_positions[tri[1]] - p0, _positions[tri[2]] - p0);
+		float length = n.length();
+		if (length <= 0.0f)
+			continue;
+
+		n /= length;
+		float area = 0.5f * length;
+		Quadric q(n, -dot(n, p0), area);
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			_quadrics[_canonical[tri[k]]] += q;
+			_attributeQuadrics[tri[k]].add(attributes(tri[k]), area / 3.0f);
+		}
+	}
+
+	/*
+	 * Planes perpendicular to open borders keep them from shrinking
+	 */
+	classifyVertices(indices);
+	for (uint32_t i = 0, e = static_cast<uint32_t>(indices.size()); i < e; i += 3)
+	{
+		const uint32_t* tri = indices.data() + i;
+		const vec3& p0 = _positions[tri[0]];
+		vec3 n = cross(_positions[tri[1]] - p0, _positions[tri[2]] - p0);
+		if (n.dotSelf() <= 0.0f)
+			continue;
+
+		n.normalize();
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t a = _canonical[tri[k]];
+			uint32_t b = _canonical[tri[(k + 1) % 3]];
+			if (edgeTriangles(a, b) != 1)
+				continue;
+
+			vec3 edge = _positions[b] - _positions[a];
+			vec3 borderNormal = cross(edge, n);
+			if (borderNormal.dotSelf() <= 0.0f)
+				continue;
+
+			borderNormal.normalize();
+			Quadric q(borderNormal, -dot(borderNormal, _positions[a]), BorderWeight * edge.dotSelf());
+			_quadrics[a] += q;
+			_quadrics[b] += q;
+		}
+	}
+}
+
+void Simplifier::classifyVertices(const Vector<uint32_t>& indices)
+{
+	_edges.clear();
+	_edges.reserve(indices.size());
+	for (uint32_t i = 0, e = static_cast<uint32_t>(indices.size()); i < e; i += 3)
+	{
+		for (uint32_t k = 0; k < 3; ++k)
+			++_edges[edgeKey(_canonical[indices[i + k]], _canonical[indices[i + (k + 1) % 3]])];
+	}
+
+	_vertexKind.assign(_canonical.size(), VertexKind_Manifold);
+	for (const auto& edge : _edges)
+	{
+		uint32_t a = static_cast<uint32_t>(edge.first >> 32);
+		uint32_t b = static_cast<uint32_t>(edge.first & 0xffffffff);
+		uint32_t kind = (edge.second == 1) ? VertexKind_Border : ((edge.second > 2) ? VertexKind_Locked : VertexKind_Manifold);
+		_vertexKind[a] |= kind;
+		_vertexKind[b] |= kind;
+	}
+}
+
+void Simplifier::buildAdjacency(const Vector<uint32_t>& indices)
+{
+	uint32_t vertexCount = static_cast<uint32_t>(_canonical.size());
+	_adjacencyOffsets.assign(vertexCount + 1, 0);
+	for (uint32_t i : indices)
+		++_adjacencyOffsets[_canonical[i] + 1];
+
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		_adjacencyOffsets[v + 1] += _adjacencyOffsets[v];
+
+	Vector<uint32_t> fill(_adjacencyOffsets.begin(), _adjacencyOffsets.end() - 1);
+	_adjacency.resize(indices.size());
+	for (uint32_t i = 0, e = static_cast<uint32_t>(indices.size()); i < e; ++i)
+		_adjacency[fill[_canonical[indices[i]]]++] = i / 3;
+}
+
+bool Simplifier::evaluateCollapse(const Vector<uint32_t>& indices, uint32_t v, uint32_t t, float& cost)
+{
+	if ((_vertexKind[v] & VertexKind_Border) && (edgeTriangles(v, t) != 1))
+		return false;
+
+	const vec3& target = _positions[t];
+	_wedgeMapping.clear();
+	for (uint32_t a = _adjacencyOffsets[v], ae = _adjacencyOffsets[v + 1]; a < ae; ++a)
+	{
+		const uint32_t* tri = indices.data() + 3 * _adjacency[a];
+
+		uint32_t corner = (_canonical[tri[0]] == v) ? 0 : ((_canonical[tri[1]] == v) ? 1 : 2);
+		uint32_t next = tri[(corner + 1) % 3];
+		uint32_t prev = tri[(corner + 2) % 3];
+
+		auto mapping = std::find_if(_wedgeMapping.begin(), _wedgeMapping.end(),
+			[&tri, corner](const std::pair<uint32_t, uint32_t>& m) { return m.first == tri[corner]; });
+		if (mapping == _wedgeMapping.end())
+			mapping = _wedgeMapping.emplace(_wedgeMapping.end(), tri[corner], InvalidIndex);
+
+		if ((_canonical[next] == t) || (_canonical[prev] == t))
+		{
+			if (mapping->second == InvalidIndex)
+				mapping->second = (_canonical[next] == t) ? next : prev;
+			continue;
+		}
+
+		/*
+		 * Triangles which are not removed by the collapse should not flip
+		 */
+		const vec3& p0 = _positions[next];
+		const vec3& p1 = _positions[prev];
+		vec3 oldNormal = cross(p0 - _positions[v], p1 - _positions[v]);
+		vec3 newNormal = cross(p0 - target, p1 - target);
+		if (dot(oldNormal, newNormal) <= MinNormalCosine * oldNormal.length() * newNormal.length())
+			return false;
+	}
+
+	Quadric q = _quadrics[v];
+	q += _quadrics[t];
+	cost = q.evaluate(target);
+
+	for (const auto& mapping : _wedgeMapping)
+	{
+		/*
+		 * Each wedge should be moved along the edge to the wedge with the same attributes side
+		 */
+		if (mapping.second == InvalidIndex)
+			return false;
+
+		AttributeQuadric aq = _attributeQuadrics[mapping.first];
+		aq += _attributeQuadrics[mapping.second];
+		cost += aq.evaluate(attributes(mapping.second));
+	}
+	return true;
+}
+
+void Simplifier::run(Vector<uint32_t>& indices, uint32_t targetIndexCount)
+{
+	uint32_t vertexCount = static_cast<uint32_t>(_canonical.size());
+	uint32_t targetTriangles = targetIndexCount / 3;
+
+	Vector<Collapse> collapses;
+	Vector<bool> touched(vertexCount, false);
+	while (indices.size() / 3 > targetTriangles)
+	{
+		uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+		classifyVertices(indices);
+		buildAdjacency(indices);
+
+		collapses.clear();
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			if ((_canonical[v] != v) || (_vertexKind[v] & VertexKind_Locked) || (_adjacencyOffsets[v] == _adjacencyOffsets[v + 1]))
+				continue;
+
+			Collapse best;
+			best.target = InvalidIndex;
+			best.cost = std::numeric_limits<float>::max();
+			for (uint32_t a = _adjacencyOffsets[v], ae = _adjacencyOffsets[v + 1]; a < ae; ++a)
+			{
+				const uint32_t* tri = indices.data() + 3 * _adjacency[a];
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					uint32_t t = _canonical[tri[k]];
+					float cost = 0.0f;
+					if ((t != v) && (t != best.target) && evaluateCollapse(indices, v, t, cost) && (cost < best.cost))
+					{
+						best.source = v;
+						best.target = t;
+						best.cost = cost;
+					}
+				}
+			}
+
+			if (best.cost <= _maxErrorSquared)
+				collapses.emplace_back(best);
+		}
+
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.cost < r.cost; });
+
+		/*
+		 * Each collapse removes about two triangles, so pass is limited by the cost of the collapse
+		 * that would reach the target if there were no conflicts between collapses
+		 */
+		size_t limitIndex = std::min(collapses.size() - 1, static_cast<size_t>((triangleCount - targetTriangles) / 2));
+		float passCostLimit = collapses[limitIndex].cost;
+
+		uint32_t removedTriangles = 0;
+		uint32_t appliedCollapses = 0;
+		std::fill(touched.begin(), touched.end(), false);
+		for (const Collapse& collapse : collapses)
+		{
+			if ((collapse.cost > passCostLimit) || (triangleCount - removedTriangles <= targetTriangles))
+				break;
+
+			uint32_t v = collapse.source;
+			uint32_t t = collapse.target;
+			if (touched[v] || touched[t])
+				continue;
+
+			float cost = 0.0f;
+			if (!evaluateCollapse(indices, v, t, cost))
+				continue;
+
+			for (const auto& mapping : _wedgeMapping)
+			{
+				_wedgeRemap[mapping.first] = mapping.second;
+				_attributeQuadrics[mapping.second] += _attributeQuadrics[mapping.first];
+			}
+			_quadrics[t] += _quadrics[v];
+
+			for (uint32_t a = _adjacencyOffsets[v], ae = _adjacencyOffsets[v + 1]; a < ae; ++a)
+			{
+				const uint32_t* tri = indices.data() + 3 * _adjacency[a];
+				bool removed = false;
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					touched[_canonical[tri[k]]] = true;
+					removed |= (_canonical[tri[k]] == t);
+				}
+				removedTriangles += removed ? 1 : 0;
+			}
+
+			_error = std::max(_error, cost);
+			++appliedCollapses;
+		}
+
+		if (appliedCollapses == 0)
+			break;
+
+		size_t writePosition = 0;
+		for (size_t i = 0, e = indices.size(); i < e; i += 3)
+		{
+			uint32_t i0 = _wedgeRemap[indices[i + 0]];
+			uint32_t i1 = _wedgeRemap[indices[i + 1]];
+			uint32_t i2 = _wedgeRemap[indices[i + 2]];
+			uint32_t c0 = _canonical[i0];
+			uint32_t c1 = _canonical[i1];
+			uint32_t c2 = _canonical[i2];
+			if ((c0 != c1) && (c0 != c2) && (c1 != c2))
+			{
+				indices[writePosition++] = i0;
+				indices[writePosition++] = i1;
+				indices[writePosition++] = i2;
+			}
+		}
+		indices.resize(writePosition);
+	}
+}
+
+}
+
+float meshsimplifier::simplify(const VertexStorage::Pointer& vs, Vector<uint32_t>& indices, uint32_t targetIndexCount,
+	const Options& options)
+{
+	indices.resize(indices.size() - indices.size() % 3);
+
+	ms_local::Simplifier simplifier(vs, indices, options);
+	simplifier.run(indices, targetIndexCount);
+	simplifier.restoreIndices(indices);
+	return simplifier.error();
+}
+
+Vector<meshsimplifier::LevelOfDetailList> meshsimplifier::generateLevelsOfDetail(const VertexStorage::Pointer& vs,
+	const IndexArray::Pointer& ia, const meshoptimizer::IndexRangeList& ranges, const Options& options)
+{
+	ET_ASSERT(ia->primitiveType() == PrimitiveType::Triangles);
+
+	uint32_t indexCount = 0;
+	for (const meshoptimizer::IndexRange& range : ranges)
+		indexCount = std::max(indexCount, range.first + range.count);
+
+	uint32_t generatedLevels = 0;
+	Vector<LevelOfDetailList> result(ranges.size());
+	for (size_t r = 0, re = ranges.size(); r < re; ++r)
+	{
+		const meshoptimizer::IndexRange& range = ranges[r];
+
+		Vector<uint32_t> indices(range.count - range.count % 3);
+		for (uint32_t i = 0, e = static_cast<uint32_t>(indices.size()); i < e; ++i)
+			indices[i] = ia->getIndex(range.first + i);
+
+		ms_local::Simplifier simplifier(vs, indices, options);
+		for (uint32_t level = 0; level < options.maxLevels; ++level)
+		{
+			uint32_t sourceIndexCount = static_cast<uint32_t>(indices.size());
+			uint32_t targetIndexCount = 3 * static_cast<uint32_t>(options.reductionRatio * static_cast<float>(sourceIndexCount / 3));
+			if (targetIndexCount < 3 * options.minTriangles)
+				break;
+
+			simplifier.run(indices, targetIndexCount);
+
+			/*
+			 * Level is discarded if error limit does not allow to reduce triangle count noticeably
+			 */
+			uint32_t levelIndexCount = static_cast<uint32_t>(indices.size());
+			if (levelIndexCount + levelIndexCount / 8 > sourceIndexCount)
+				break;
+
+			if (ia->capacity() < indexCount + levelIndexCount)
+				ia->resize(indexCount + levelIndexCount);
+
+			meshoptimizer::IndexRange levelRange(indexCount, levelIndexCount);
+			for (uint32_t i = 0; i < levelIndexCount; ++i)
+				ia->setIndex(simplifier.sourceVertex(indices[i]), indexCount + i);
+			meshoptimizer::optimizeVertexCache(ia, levelRange);
+
+			result[r].emplace_back(levelRange, simplifier.error());
+			indexCount += levelIndexCount;
+			++generatedLevels;
+		}
+	}
+
+	log::info("Generated %u levels of detail for %u ranges", generatedLevels, static_cast<uint32_t>(ranges.size()));
+	return result;
+}
+
+}
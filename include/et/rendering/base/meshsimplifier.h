@@ -0,0 +1,57 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/rendering/base/meshoptimizer.h>
+
+namespace et
+{
+	namespace meshsimplifier
+	{
+		struct Options
+		{
+			/*
+			 * reductionRatio - triangle count of each level relative to the previous one
+			 * maxError - max allowed geometric error, relative to the mesh extent
+			 * normalWeight, texCoordWeight - weights of the attribute error, relative to the geometric one
+			 */
+			float reductionRatio = 0.5f;
+			float maxError = 0.05f;
+			float normalWeight = 0.25f;
+			float texCoordWeight = 0.25f;
+			uint32_t maxLevels = 4;
+			uint32_t minTriangles = 64;
+		};
+
+		struct LevelOfDetail
+		{
+			meshoptimizer::IndexRange range;
+			float error = 0.0f;
+
+			LevelOfDetail() = default;
+			LevelOfDetail(const meshoptimizer::IndexRange& r, float e) :
+				range(r), error(e) { }
+		};
+		using LevelOfDetailList = Vector<LevelOfDetail>;
+
+		/*
+		 * Collapses edges to existing vertices (vertex storage is not modified) using quadric error metrics
+		 * with normals and texture coordinates preservation. Attribute seams and open borders are kept.
+		 * Returns achieved error in object space units
+		 */
+		float simplify(const VertexStorage::Pointer&, Vector<uint32_t>& indices, uint32_t targetIndexCount,
+			const Options& = Options());
+
+		/*
+		 * Generates chain of levels of detail for each range, indices of levels are appended
+		 * to the end of the index array. Result contains levels list for each input range
+		 */
+		Vector<LevelOfDetailList> generateLevelsOfDetail(const VertexStorage::Pointer&, const IndexArray::Pointer&,
+			const meshoptimizer::IndexRangeList&, const Options& = Options());
+	}
+}
@@ -6,11 +6,44 @@
  */
 
 #include <et/core/containers.h>
+#include <et/core/threading.h>
 #include <et/geometry/geometry.h>
 #include <et/rendering/base/primitives.h>
 
 using namespace et;
 
+namespace et
+{
+namespace pr_local
+{
+enum : uint32_t
+{
+	ParallelThreshold = 4096
+};
+
+inline float angleBetween(const vec3& a, const vec3& b)
+{
+	float l = a.length() * b.length();
+	return (l > 0.0f) ? std::acos(clamp(dot(a, b) / l, -1.0f, 1.0f)) : 0.0f;
+}
+
+inline vec3 orthogonalVector(const vec3& n)
+{
+	vec3 axis = (std::abs(n.x) < 0.9f) ? vec3(1.0f, 0.0f, 0.0f) : vec3(0.0f, 1.0f, 0.0f);
+	return normalize(cross(n, axis));
+}
+
+/*
+ * 21 bits per coordinate, wrapped cells only produce extra candidates
+ */
+inline uint64_t cellKey(const vec3i& c)
+{
+	const uint64_t mask = (1ull << 21) - 1;
+	return (static_cast<uint64_t>(c.x) & mask) | ((static_cast<uint64_t>(c.y) & mask) << 21) | ((static_cast<uint64_t>(c.z) & mask) << 42);
+}
+}
+}
+
 inline int getIndex(int u, int v, int u_sz, int v_sz)
 {
 	return clamp<int32_t>(u, 0, u_sz - 1) + clamp<int32_t>(v, 0, v_sz - 1) * u_sz;
@@ -460,7 +493,41 @@ uint32_t primitives::buildTriangleStripIndexes(IndexArray::Pointer buffer, const
 void primitives::calculateNormals(VertexStorage::Pointer data, const IndexArray::Pointer& buffer, uint32_t first, uint32_t last)
 {
 	ET_ASSERT(first < last);
+	calculateNormals(data, buildTriangleAdjacency(buffer, first, last, data->capacity()));
+}
+
+primitives::TriangleAdjacency primitives::buildTriangleAdjacency(const IndexArray::Pointer& buffer,
+	uint32_t first, uint32_t last, uint32_t vertexCount)
+{
+	TriangleAdjacency result;
+	result.triangleVertices.reserve(3 * (last - first));
+	for (IndexArray::PrimitiveIterator i = buffer->primitive(first), e = buffer->primitive(last); i != e; ++i)
+	{
+		const IndexArray::Primitive& p = (*i);
+		if ((p[0] < vertexCount) && (p[1] < vertexCount) && (p[2] < vertexCount))
+			result.triangleVertices.insert(result.triangleVertices.end(), { p[0], p[1], p[2] });
+	}
+
+	/*
+	 * Counting sort of triangles by vertex, keeps triangles of each vertex in ascending order
+	 */
+	result.vertexOffsets.assign(vertexCount + 1, 0);
+	for (uint32_t v : result.triangleVertices)
+		++result.vertexOffsets[v + 1];
+
+	for (uint32_t v = 0; v < vertexCount; ++v)
+		result.vertexOffsets[v + 1] += result.vertexOffsets[v];
+
+	Vector<uint32_t> cursors(result.vertexOffsets.begin(), result.vertexOffsets.end() - 1);
+	result.vertexTriangles.resize(result.triangleVertices.size());
+	for (uint32_t i = 0, e = static_cast<uint32_t>(result.triangleVertices.size()); i < e; ++i)
+		result.vertexTriangles[cursors[result.triangleVertices[i]]++] = i / 3;
 
+	return result;
+}
+
+void primitives::calculateNormals(VertexStorage::Pointer data, const TriangleAdjacency& adjacency)
+{
 	if (!data->hasAttributeWithType(VertexAttributeUsage::Position, DataType::Vec3))
 	{
 		log::error("primitives::calculateNormals - vertex storage does not contain positions of type vec3.");
@@ -472,36 +539,43 @@ void primitives::calculateNormals(VertexStorage::Pointer data, const IndexArray:
 		return;
 	}
 
+	ET_ASSERT(adjacency.verticesCount() <= data->capacity());
+
 	RawDataAcessor<vec3> pos = data->accessData<DataType::Vec3>(VertexAttributeUsage::Position, 0);
 	RawDataAcessor<vec3> nrm = data->accessData<DataType::Vec3>(VertexAttributeUsage::Normal, 0);
+	const Vector<uint32_t>& tv = adjacency.triangleVertices;
 
-	const auto& e = buffer->primitive(last);
-
-	for (auto i = buffer->primitive(first); i != e; ++i)
-	{
-		const auto& p = (*i);
-		nrm[p[0]] = vec3(0.0f);
-		nrm[p[1]] = vec3(0.0f);
-		nrm[p[2]] = vec3(0.0f);
-	}
-
-	for (auto i = buffer->primitive(first); i != e; ++i)
+	/*
+	 * Area weighted face normals
+	 */
+	Vector<vec3> faceNormals(adjacency.trianglesCount());
+	threading::parallelFor(adjacency.trianglesCount(), pr_local::ParallelThreshold, [&](uint32_t begin, uint32_t end)
 	{
-		const auto& p = (*i);
-		triangle t(pos[p[0]], pos[p[1]], pos[p[2]]);
-		vec3 n = t.normalizedNormal() * t.square();
-		nrm[p[0]] += n;
-		nrm[p[1]] += n;
-		nrm[p[2]] += n;
-	}
+		for (uint32_t t = begin; t < end; ++t)
+		{
+			const vec3& p0 = pos[tv[3 * t + 0]];
+			faceNormals[t] = 0.5f * cross(pos[tv[3 * t + 1]] - p0, pos[tv[3 * t + 2]] - p0);
+		}
+	});
 
-	for (auto i = buffer->primitive(first); i != e; ++i)
+	/*
+	 * Vertices not referenced by triangles keep their normals
+	 */
+	threading::parallelFor(adjacency.verticesCount(), pr_local::ParallelThreshold, [&](uint32_t begin, uint32_t end)
 	{
-		const auto& p = (*i);
-		nrm[p[0]].normalize();
-		nrm[p[1]].normalize();
-		nrm[p[2]].normalize();
-	}
+		for (uint32_t v = begin; v < end; ++v)
+		{
+			uint32_t t = adjacency.vertexOffsets[v];
+			uint32_t te = adjacency.vertexOffsets[v + 1];
+			if (t == te)
+				continue;
+
+			vec3 n(0.0f);
+			for (; t < te; ++t)
+				n += faceNormals[adjacency.vertexTriangles[t]];
+			nrm[v] = normalize(n);
+		}
+	});
 }
 
 void primitives::calculateNormals(VertexArray::Pointer data, const IndexArray::Pointer& buffer, uint32_t first, uint32_t last)
@@ -627,7 +701,11 @@ void primitives::calculateTangents(VertexStorage::Pointer data, const IndexArray
 	uint32_t first, uint32_t last)
 {
 	ET_ASSERT(first < last);
+	calculateTangents(data, buildTriangleAdjacency(buffer, first, last, data->capacity()));
+}
 
+void primitives::calculateTangents(VertexStorage::Pointer data, const TriangleAdjacency& adjacency)
+{
 	if (!data->hasAttributeWithType(VertexAttributeUsage::Position, DataType::Vec3))
 	{
 		log::error("primitives::calculateTangents - vertex storage does not contain positions of type vec3.");
@@ -643,95 +721,180 @@ void primitives::calculateTangents(VertexStorage::Pointer data, const IndexArray
 		log::error("primitives::calculateTangents - vertex storage does not contain TexCoord0 of type vec2.");
 		return;
 	}
-	if (!data->hasAttributeWithType(VertexAttributeUsage::Tangent, DataType::Vec3))
+	if (!data->hasAttributeWithType(VertexAttributeUsage::Tangent, DataType::Vec3) &&
+		!data->hasAttributeWithType(VertexAttributeUsage::Tangent, DataType::Vec4))
 	{
-		log::error("primitives::calculateTangents - vertex storage does not contain tangents of type vec3.");
+		log::error("primitives::calculateTangents - vertex storage does not contain tangents of type vec3 or vec4.");
 		return;
 	}
 
+	ET_ASSERT(adjacency.verticesCount() <= data->capacity());
+
+	bool tangentsWithHandedness = data->hasAttributeWithType(VertexAttributeUsage::Tangent, DataType::Vec4);
+	bool hasBinormals = data->hasAttributeWithType(VertexAttributeUsage::Binormal, DataType::Vec3);
+
 	RawDataAcessor<vec3> pos = data->accessData<DataType::Vec3>(VertexAttributeUsage::Position, 0);
 	RawDataAcessor<vec3> nrm = data->accessData<DataType::Vec3>(VertexAttributeUsage::Normal, 0);
-	RawDataAcessor<vec3> tan = data->accessData<DataType::Vec3>(VertexAttributeUsage::Tangent, 0);
 	RawDataAcessor<vec2> uv = data->accessData<DataType::Vec2>(VertexAttributeUsage::TexCoord0, 0);
+	RawDataAcessor<vec3> tan3;
+	RawDataAcessor<vec4> tan4;
+	RawDataAcessor<vec3> bin;
 
-	DataStorage<vec3> tan1(data->capacity(), 0);
-	DataStorage<vec3> tan2(data->capacity(), 0);
+	if (tangentsWithHandedness)
+		tan4 = data->accessData<DataType::Vec4>(VertexAttributeUsage::Tangent, 0);
+	else
+		tan3 = data->accessData<DataType::Vec3>(VertexAttributeUsage::Tangent, 0);
 
-	for (IndexArray::PrimitiveIterator i = buffer->primitive(first), e = buffer->primitive(last); i != e; ++i)
-	{
-		IndexArray::Primitive& p = (*i);
+	if (hasBinormals)
+		bin = data->accessData<DataType::Vec3>(VertexAttributeUsage::Binormal, 0);
 
-		const vec3& v1 = pos[p[0]];
-		const vec3& v2 = pos[p[1]];
-		const vec3& v3 = pos[p[2]];
-		const vec2& w1 = uv[p[0]];
-		const vec2& w2 = uv[p[1]];
-		const vec2& w3 = uv[p[2]];
+	const Vector<uint32_t>& tv = adjacency.triangleVertices;
 
-		float x1 = v2.x - v1.x;
-		float x2 = v3.x - v1.x;
-		float y1 = v2.y - v1.y;
-		float y2 = v3.y - v1.y;
-		float z1 = v2.z - v1.z;
-		float z2 = v3.z - v1.z;
-		float s1 = w2.x - w1.x;
-		float s2 = w3.x - w1.x;
-		float t1 = w2.y - w1.y;
-		float t2 = w3.y - w1.y;
-		float r = 1.0f / (s1 * t2 - s2 * t1);
+	/*
+	 * Unnormalized texture space directions and corner angles of each triangle,
+	 * triangles with degenerate texture coordinates do not contribute
+	 */
+	struct FaceFrame
+	{
+		vec3 s;
+		vec3 t;
+		vec3 angles;
+	};
+	Vector<FaceFrame> faces(adjacency.trianglesCount());
+	threading::parallelFor(adjacency.trianglesCount(), pr_local::ParallelThreshold, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t f = begin; f < end; ++f)
+		{
+			const vec3& v1 = pos[tv[3 * f + 0]];
+			const vec3& v2 = pos[tv[3 * f + 1]];
+			const vec3& v3 = pos[tv[3 * f + 2]];
+			const vec2& w1 = uv[tv[3 * f + 0]];
+			const vec2& w2 = uv[tv[3 * f + 1]];
+			const vec2& w3 = uv[tv[3 * f + 2]];
+
+			vec3 e1 = v2 - v1;
+			vec3 e2 = v3 - v1;
+			float s1 = w2.x - w1.x;
+			float s2 = w3.x - w1.x;
+			float t1 = w2.y - w1.y;
+			float t2 = w3.y - w1.y;
+			float det = s1 * t2 - s2 * t1;
+
+			FaceFrame& face = faces[f];
+			if (std::abs(det) > std::numeric_limits<float>::min())
+			{
+				float r = 1.0f / det;
+				face.s = (e1 * t2 - e2 * t1) * r;
+				face.t = (e2 * s1 - e1 * s2) * r;
+			}
 
-		vec3 sdir((t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r, (t2 * z1 - t1 * z2) * r);
-		vec3 tdir((s1 * x2 - s2 * x1) * r, (s1 * y2 - s2 * y1) * r, (s1 * z2 - s2 * z1) * r);
+			vec3 e3 = v3 - v2;
+			face.angles.x = pr_local::angleBetween(e1, e2);
+			face.angles.y = pr_local::angleBetween(-e1, e3);
+			face.angles.z = PI - face.angles.x - face.angles.y;
+		}
+	});
 
-		tan1[p[0]] += sdir;
-		tan1[p[1]] += sdir;
-		tan1[p[2]] += sdir;
+	threading::parallelFor(adjacency.verticesCount(), pr_local::ParallelThreshold, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t v = begin; v < end; ++v)
+		{
+			uint32_t i = adjacency.vertexOffsets[v];
+			uint32_t ie = adjacency.vertexOffsets[v + 1];
+			if (i == ie)
+				continue;
+
+			const vec3& n = nrm[v];
+			vec3 s(0.0f);
+			vec3 t(0.0f);
+			for (; i < ie; ++i)
+			{
+				uint32_t f = adjacency.vertexTriangles[i];
+				const FaceFrame& face = faces[f];
+				uint32_t corner = (tv[3 * f] == v) ? 0 : ((tv[3 * f + 1] == v) ? 1 : 2);
+
+				vec3 fs = face.s - n * dot(n, face.s);
+				vec3 ft = face.t - n * dot(n, face.t);
+				float fsl = fs.length();
+				float ftl = ft.length();
+				if (fsl > 0.0f)
+					s += fs * (face.angles[corner] / fsl);
+				if (ftl > 0.0f)
+					t += ft * (face.angles[corner] / ftl);
+			}
 
-		tan2[p[0]] += tdir;
-		tan2[p[1]] += tdir;
-		tan2[p[2]] += tdir;
-	}
+			s -= n * dot(n, s);
+			float sl = s.length();
+			s = (sl > 0.0f) ? s / sl : pr_local::orthogonalVector(n);
 
-	for (auto& t : tan1)
-		t.normalize();
+			float handedness = (dot(cross(n, s), t) < 0.0f) ? -1.0f : 1.0f;
 
-	for (IndexArray::PrimitiveIterator i = buffer->primitive(first), e = buffer->primitive(last); i != e; ++i)
-	{
-		const IndexArray::Primitive& p = (*i);
-		for (uint32_t k = 0; k < 3; ++k)
-		{
-			// const vec3& n = nrm[p[k]];
-			const vec3& t = tan1[p[k]];
-			// float value = dot(cross(n, t), tan2[p[k]]);
-			// tan[p[k]] = normalize(t - n * dot(n, t)) * signOrZero(value);
-			tan[p[k]] = t;
+			if (tangentsWithHandedness)
+				tan4[v] = vec4(s, handedness);
+			else
+				tan3[v] = s;
+
+			if (hasBinormals)
+				bin[v] = cross(n, s) * handedness;
 		}
-	}
+	});
 }
 
+/*
+ * Tangents of the vertices closer than threshold are averaged,
+ * candidates are found in neighbouring cells of the uniform grid
+ */
 void primitives::smoothTangents(VertexStorage::Pointer data, const IndexArray::Pointer&, uint32_t first, uint32_t last)
 {
 	ET_ASSERT(first < last);
 
-	if (!data->hasAttribute(VertexAttributeUsage::Position) || !data->hasAttribute(VertexAttributeUsage::Tangent))
+	if (!data->hasAttributeWithType(VertexAttributeUsage::Position, DataType::Vec3) ||
+		!data->hasAttributeWithType(VertexAttributeUsage::Tangent, DataType::Vec3))
 	{
 		log::error("primitives::smoothTangents - supplied data is invalid.");
 		return;
 	}
 
+	const float distanceThreshold = 1.0e-3f;
+	const float cellSize = std::sqrt(distanceThreshold);
+
 	uint32_t len = last - first;
-	DataStorage<vec3> tanSmooth(data->capacity());
 	RawDataAcessor<vec3> pos = data->accessData<DataType::Vec3>(VertexAttributeUsage::Position, first);
 	RawDataAcessor<vec3> tan = data->accessData<DataType::Vec3>(VertexAttributeUsage::Tangent, first);
-	for (uint32_t p = 0; p < len; ++p)
+
+	Vector<vec3i> cells(len);
+	Vector<std::pair<uint64_t, uint32_t>> sortedCells(len);
+	for (uint32_t i = 0; i < len; ++i)
 	{
-		tanSmooth[p] = tan[p];
-		for (uint32_t i = p + 1; i < len; ++i)
+		cells[i] = vec3i(static_cast<int>(std::floor(pos[i].x / cellSize)),
+			static_cast<int>(std::floor(pos[i].y / cellSize)), static_cast<int>(std::floor(pos[i].z / cellSize)));
+		sortedCells[i] = std::make_pair(pr_local::cellKey(cells[i]), i);
+	}
+	std::sort(sortedCells.begin(), sortedCells.end());
+
+	DataStorage<vec3> tanSmooth(len, 0);
+	threading::parallelFor(len, pr_local::ParallelThreshold, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t p = begin; p < end; ++p)
 		{
-			if ((pos[p] - pos[i]).dotSelf() <= 1.0e-3f)
-				tanSmooth[p] += tan[i];
+			for (int z = -1; z <= 1; ++z)
+			{
+				for (int y = -1; y <= 1; ++y)
+				{
+					for (int x = -1; x <= 1; ++x)
+					{
+						uint64_t key = pr_local::cellKey(cells[p] + vec3i(x, y, z));
+						auto i = std::lower_bound(sortedCells.begin(), sortedCells.end(), std::make_pair(key, 0u));
+						for (; (i != sortedCells.end()) && (i->first == key); ++i)
+						{
+							if ((pos[p] - pos[i->second]).dotSelf() <= distanceThreshold)
+								tanSmooth[p] += tan[i->second];
+						}
+					}
+				}
+			}
 		}
-	}
+	});
 
 	for (uint32_t i = 0; i < len; ++i)
 		tan[i] = normalize(tanSmooth[i]);
@@ -1244,3 +1407,264 @@ VertexArray::Pointer primitives::linearizeTrianglesIndexArray(VertexArray::Point
 	}
 	return result;
 }
+
+/*
+ * Vertex attribute encoding
+ */
+inline int32_t quantizeSnorm(float value, int32_t maxValue)
+{
+	return static_cast<int32_t>(std::floor(clamp(value, -1.0f, 1.0f) * static_cast<float>(maxValue) + 0.5f));
+}
+
+inline float dequantizeSnorm(int32_t value, int32_t maxValue)
+{
+	return std::max(-1.0f, static_cast<float>(value) / static_cast<float>(maxValue));
+}
+
+inline int32_t signExtend(uint32_t value, uint32_t bits)
+{
+	uint32_t shift = 32 - bits;
+	return static_cast<int32_t>(value << shift) >> shift;
+}
+
+uint32_t primitives::encodeOctahedralSnorm16(const vec3& n)
+{
+	float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	vec2 e = (l1 > 0.0f) ? vec2(n.x, n.y) / l1 : vec2(0.0f);
+	if (n.z < 0.0f)
+	{
+		e = vec2((1.0f - std::abs(e.y)) * ((e.x >= 0.0f) ? 1.0f : -1.0f),
+			(1.0f - std::abs(e.x)) * ((e.y >= 0.0f) ? 1.0f : -1.0f));
+	}
+
+	uint32_t x = static_cast<uint32_t>(quantizeSnorm(e.x, 32767)) & 0xffff;
+	uint32_t y = static_cast<uint32_t>(quantizeSnorm(e.y, 32767)) & 0xffff;
+	return x | (y << 16);
+}
+
+vec3 primitives::decodeOctahedralSnorm16(uint32_t value)
+{
+	float ex = dequantizeSnorm(signExtend(value & 0xffff, 16), 32767);
+	float ey = dequantizeSnorm(signExtend(value >> 16, 16), 32767);
+	vec3 n(ex, ey, 1.0f - std::abs(ex) - std::abs(ey));
+	float t = clamp(-n.z, 0.0f, 1.0f);
+	n.x += (n.x >= 0.0f) ? -t : t;
+	n.y += (n.y >= 0.0f) ? -t : t;
+	return normalize(n);
+}
+
+uint32_t primitives::encodeSnorm10_10_10_2(const vec4& v)
+{
+	uint32_t x = static_cast<uint32_t>(quantizeSnorm(v.x, 511)) & 0x3ff;
+	uint32_t y = static_cast<uint32_t>(quantizeSnorm(v.y, 511)) & 0x3ff;
+	uint32_t z = static_cast<uint32_t>(quantizeSnorm(v.z, 511)) & 0x3ff;
+	uint32_t w = static_cast<uint32_t>(quantizeSnorm(v.w, 1)) & 0x3;
+	return x | (y << 10) | (z << 20) | (w << 30);
+}
+
+vec4 primitives::decodeSnorm10_10_10_2(uint32_t value)
+{
+	return vec4(dequantizeSnorm(signExtend(value & 0x3ff, 10), 511), dequantizeSnorm(signExtend((value >> 10) & 0x3ff, 10), 511),
+		dequantizeSnorm(signExtend((value >> 20) & 0x3ff, 10), 511), dequantizeSnorm(signExtend(value >> 30, 2), 1));
+}
+
+uint16_t primitives::encodeHalf(float value)
+{
+	uint32_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t floatExponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x007fffff;
+	int32_t exponent = static_cast<int32_t>(floatExponent) - 127 + 15;
+
+	if (floatExponent == 0xff)
+		return static_cast<uint16_t>(sign | 0x7c00 | ((mantissa != 0) ? 0x0200 : 0));
+
+	if (exponent >= 31)
+		return static_cast<uint16_t>(sign | 0x7c00);
+
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+			return static_cast<uint16_t>(sign);
+
+		mantissa |= 0x00800000;
+		uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint32_t result = mantissa >> shift;
+		uint32_t roundBit = 1u << (shift - 1);
+		if ((mantissa & roundBit) && ((mantissa & (roundBit - 1)) || (result & 1)))
+			++result;
+		return static_cast<uint16_t>(sign | result);
+	}
+
+	/*
+	 * Rounding to nearest even, overflow of the mantissa correctly increments exponent
+	 */
+	uint32_t result = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	if ((mantissa & 0x1000) && ((mantissa & 0x0fff) || (result & 1)))
+		++result;
+	return static_cast<uint16_t>(result);
+}
+
+float primitives::decodeHalf(uint16_t value)
+{
+	uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x03ff;
+
+	if (exponent == 0)
+	{
+		float result = std::ldexp(static_cast<float>(mantissa), -24);
+		return (sign != 0) ? -result : result;
+	}
+
+	uint32_t bits = sign | (mantissa << 13) | ((exponent == 31) ? 0x7f800000 : ((exponent + 112) << 23));
+	float result = 0.0f;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+uint16_t primitives::encodeUnorm16(float value)
+{
+	return static_cast<uint16_t>(std::floor(clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f));
+}
+
+float primitives::decodeUnorm16(uint16_t value)
+{
+	return static_cast<float>(value) / 65535.0f;
+}
+
+VertexDeclaration primitives::compressedVertexDeclaration(const VertexDeclaration& decl)
+{
+	VertexDeclaration result(decl.interleaved());
+	for (const VertexElement& e : decl.elements())
+	{
+		VertexAttributeEncoding encoding = VertexAttributeEncoding::None;
+		switch (e.usage())
+		{
+		case VertexAttributeUsage::Position:
+			encoding = VertexAttributeEncoding::Unorm16;
+			break;
+
+		case VertexAttributeUsage::Normal:
+		case VertexAttributeUsage::Tangent:
+		case VertexAttributeUsage::Binormal:
+			encoding = (e.type() == DataType::Vec4) ? VertexAttributeEncoding::Snorm10_10_10_2 : VertexAttributeEncoding::OctahedralSnorm16;
+			break;
+
+		case VertexAttributeUsage::TexCoord0:
+		case VertexAttributeUsage::TexCoord1:
+		case VertexAttributeUsage::TexCoord2:
+		case VertexAttributeUsage::TexCoord3:
+			encoding = VertexAttributeEncoding::Half;
+			break;
+
+		default:
+			break;
+		}
+
+		if (!vertexAttributeEncodingSupported(e.type(), encoding))
+			encoding = VertexAttributeEncoding::None;
+
+		result.push_back(e.usage(), e.type(), encoding);
+	}
+	return result;
+}
+
+VertexStorage::Pointer primitives::encodeVertexStorage(const VertexStorage::Pointer& source, const VertexDeclaration& encoded)
+{
+	ET_ASSERT(source.valid());
+	ET_ASSERT(!source->declaration().hasEncodedElements());
+
+	uint32_t vertexCount = source->capacity();
+	VertexStorage::Pointer result = VertexStorage::Pointer::create(encoded, vertexCount);
+
+	const char* sourceData = source->data().binary();
+	char* resultData = result->data().binary();
+	uint32_t sourceStride = source->stride();
+	uint32_t resultStride = result->stride();
+
+	vec3 positionScale(1.0f);
+	vec3 positionOffset(0.0f);
+	if (encoded.has(VertexAttributeUsage::Position) && (encoded.elementForUsage(VertexAttributeUsage::Position).encoding() == VertexAttributeEncoding::Unorm16))
+	{
+		ET_ASSERT(source->hasAttributeWithType(VertexAttributeUsage::Position, DataType::Vec3));
+
+		vec3 minPosition(std::numeric_limits<float>::max());
+		vec3 maxPosition(-std::numeric_limits<float>::max());
+		auto pos = source->accessData<DataType::Vec3>(VertexAttributeUsage::Position, 0);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			minPosition = minv(minPosition, pos[i]);
+			maxPosition = maxv(maxPosition, pos[i]);
+		}
+
+		if (vertexCount > 0)
+		{
+			vec3 extent = maxPosition - minPosition;
+			positionScale = vec3(extent.x > 0.0f ? extent.x : 1.0f, extent.y > 0.0f ? extent.y : 1.0f, extent.z > 0.0f ? extent.z : 1.0f);
+			positionOffset = minPosition;
+		}
+	}
+
+	for (const VertexElement& e : encoded.elements())
+	{
+		ET_ASSERT(source->hasAttributeWithType(e.usage(), e.type()));
+
+		bool isPosition = (e.usage() == VertexAttributeUsage::Position);
+		uint32_t components = dataTypeComponents(e.type());
+		uint32_t sourceOffset = source->offsetOfAttribute(e.usage());
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			const float* src = reinterpret_cast<const float*>(sourceData + i * sourceStride + sourceOffset);
+			char* dst = resultData + i * resultStride + e.offset();
+
+			vec4 value(0.0f, 0.0f, 0.0f, 1.0f);
+			for (uint32_t c = 0; (c < components) && (c < 4); ++c)
+				value[c] = src[c];
+
+			switch (e.encoding())
+			{
+			case VertexAttributeEncoding::OctahedralSnorm16:
+			{
+				uint32_t packed = encodeOctahedralSnorm16(value.xyz());
+				memcpy(dst, &packed, sizeof(packed));
+				break;
+			}
+
+			case VertexAttributeEncoding::Snorm10_10_10_2:
+			{
+				uint32_t packed = encodeSnorm10_10_10_2(value);
+				memcpy(dst, &packed, sizeof(packed));
+				break;
+			}
+
+			case VertexAttributeEncoding::Half:
+			{
+				uint16_t* packed = reinterpret_cast<uint16_t*>(dst);
+				for (uint32_t c = 0, ce = e.sizeInBytes() / 2; c < ce; ++c)
+					packed[c] = encodeHalf(value[c]);
+				break;
+			}
+
+			case VertexAttributeEncoding::Unorm16:
+			{
+				if (isPosition)
+					value.xyz() = (value.xyz() - positionOffset) / positionScale;
+
+				uint16_t* packed = reinterpret_cast<uint16_t*>(dst);
+				for (uint32_t c = 0, ce = e.sizeInBytes() / 2; c < ce; ++c)
+					packed[c] = encodeUnorm16(value[c]);
+				break;
+			}
+
+			default:
+				memcpy(dst, src, e.sizeInBytes());
+			}
+		}
+	}
+
+	result->setPositionDequantization(positionScale, positionOffset);
+	return result;
+}
@@ -63,6 +63,34 @@ namespace et
 		void smoothTangents(VertexStorage::Pointer data, const IndexArray::Pointer& buffer,
 			uint32_t first, uint32_t last);
 		
+		/*
+		 * Triangles of the index range with vertex to triangle adjacency in compressed sparse row layout:
+		 * triangles of vertex v are vertexTriangles[vertexOffsets[v]..vertexOffsets[v + 1]), in ascending order.
+		 * Built once, it could be reused for the several operations over the same index range
+		 */
+		struct TriangleAdjacency
+		{
+			Vector<uint32_t> triangleVertices;
+			Vector<uint32_t> vertexOffsets;
+			Vector<uint32_t> vertexTriangles;
+
+			uint32_t trianglesCount() const
+				{ return static_cast<uint32_t>(triangleVertices.size() / 3); }
+
+			uint32_t verticesCount() const
+				{ return vertexOffsets.empty() ? 0 : static_cast<uint32_t>(vertexOffsets.size() - 1); }
+		};
+		TriangleAdjacency buildTriangleAdjacency(const IndexArray::Pointer& buffer, uint32_t first, uint32_t last,
+			uint32_t vertexCount);
+
+		/*
+		 * Computed per triangle, then gathered per vertex in parallel, result does not depend on threads count.
+		 * Tangents are built as in MikkTSpace: angle weighted, orthogonalized to the normal,
+		 * handedness is written to w of Vec4 tangents and used for binormals (if present)
+		 */
+		void calculateNormals(VertexStorage::Pointer data, const TriangleAdjacency&);
+		void calculateTangents(VertexStorage::Pointer data, const TriangleAdjacency&);
+		
 		void createBox(VertexArray::Pointer data, const vec3& size, const vec3& center = vec3(0.0f));
 		void createOctahedron(VertexArray::Pointer data, float radius);
 		void createDodecahedron(VertexArray::Pointer data, float radius);
@@ -77,5 +105,33 @@ namespace et
 		VertexArray::Pointer linearizeTrianglesIndexArray(VertexArray::Pointer data, IndexArray::Pointer indexArray);
 		
 		uint64_t vector3Hash(const vec3&);
+
+		/*
+		 * Vertex attribute encoding (see VertexAttributeEncoding),
+		 * packed values are stored in the layout of the corresponding vertex formats
+		 */
+		uint32_t encodeOctahedralSnorm16(const vec3& unitVector);
+		vec3 decodeOctahedralSnorm16(uint32_t);
+
+		uint32_t encodeSnorm10_10_10_2(const vec4&);
+		vec4 decodeSnorm10_10_10_2(uint32_t);
+
+		uint16_t encodeHalf(float);
+		float decodeHalf(uint16_t);
+
+		uint16_t encodeUnorm16(float);
+		float decodeUnorm16(uint16_t);
+
+		/*
+		 * Returns declaration with compact encodings for the attributes of the given one:
+		 * Unorm16 positions, octahedral normals, tangents and binormals, half texture coordinates
+		 */
+		VertexDeclaration compressedVertexDeclaration(const VertexDeclaration&);
+
+		/*
+		 * Builds storage with attributes encoded as specified in declaration (usages and types should match source),
+		 * Unorm16 positions are quantized within bounds of the source data with dequantization set to the result
+		 */
+		VertexStorage::Pointer encodeVertexStorage(const VertexStorage::Pointer& source, const VertexDeclaration& encoded);
 	}
 }
@@ -86,15 +86,21 @@ Dictionary RenderBatch::serialize() const
 }
 
 RayIntersection RenderBatch::intersectsLocalSpaceRay(const ray3d& ray) const
+{
+	return intersectsLocalSpaceRay(ray, _vertexStorage);
+}
+
+RayIntersection RenderBatch::intersectsLocalSpaceRay(const ray3d& ray, const VertexStorage::Pointer& positions) const
 {
 	RayIntersection result;
 
-	if (_vertexStorage->hasAttributeWithType(VertexAttributeUsage::Position, DataType::Vec3) == false)
+	if (positions->hasAttributeWithType(VertexAttributeUsage::Position, DataType::Vec3) == false)
 	{
 		log::error("Unable to calculate intersection - missing position attribute.");
+		return result;
 	}
 
-	const auto pos = _vertexStorage->accessData<DataType::Vec3>(VertexAttributeUsage::Position, 0);
+	const auto pos = positions->accessData<DataType::Vec3>(VertexAttributeUsage::Position, 0);
 	uint32_t numTriangles = _numIndexes / 3;
 	for (uint32_t t = 0; t < numTriangles; ++t)
 	{
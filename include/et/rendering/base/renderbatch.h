@@ -65,6 +65,7 @@ public:
 		{ return _boundingBox; }
 
 	RayIntersection intersectsLocalSpaceRay(const ray3d&) const;
+	RayIntersection intersectsLocalSpaceRay(const ray3d&, const VertexStorage::Pointer& positions) const;
 	Dictionary serialize() const;
 
 	RenderBatch* duplicate() const;
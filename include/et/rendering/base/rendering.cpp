@@ -54,6 +54,11 @@ const std::string dataFormatNames[DataFormat_max] =
 	"unsigned short <565>",
 };
 
+const std::string vertexAttributeEncodingNames[VertexAttributeEncoding_max] =
+{
+	"none", "octahedral-snorm16", "half", "snorm-10-10-10-2", "unorm16"
+};
+
 const std::map<IndexArrayFormat, std::pair<std::string, DataFormat>> indexArrayFormats =
 {
 	{ IndexArrayFormat::Format_8bit, { "8 bit", DataFormat::UnsignedChar } },
@@ -234,6 +239,79 @@ uint32_t dataTypeSize(DataType t) {
 	return dataTypeComponents(t) * ((t == DataType::Int) ? sizeof(int) : sizeof(float));
 }
 
+std::string vertexAttributeEncodingToString(VertexAttributeEncoding enc) {
+	return (enc < VertexAttributeEncoding::max) ? vertexAttributeEncodingNames[static_cast<uint32_t>(enc)] :
+		intToStr(static_cast<uint32_t>(enc));
+}
+
+VertexAttributeEncoding stringToVertexAttributeEncoding(const std::string& s) {
+	for (uint32_t i = 0, e = VertexAttributeEncoding_max; i < e; ++i)
+	{
+		if (s == vertexAttributeEncodingNames[i])
+			return static_cast<VertexAttributeEncoding>(i);
+	}
+	return VertexAttributeEncoding::None;
+}
+
+bool vertexAttributeEncodingSupported(DataType t, VertexAttributeEncoding enc) {
+	switch (enc)
+	{
+	case VertexAttributeEncoding::None:
+		return true;
+
+	case VertexAttributeEncoding::OctahedralSnorm16:
+		return (t == DataType::Vec3);
+
+	case VertexAttributeEncoding::Half:
+	case VertexAttributeEncoding::Unorm16:
+		return (t == DataType::Vec2) || (t == DataType::Vec3) || (t == DataType::Vec4);
+
+	case VertexAttributeEncoding::Snorm10_10_10_2:
+		return (t == DataType::Vec3) || (t == DataType::Vec4);
+
+	default:
+		return false;
+	}
+}
+
+DataFormat vertexAttributeEncodingDataFormat(DataType t, VertexAttributeEncoding enc) {
+	ET_ASSERT(vertexAttributeEncodingSupported(t, enc));
+	switch (enc)
+	{
+	case VertexAttributeEncoding::OctahedralSnorm16:
+		return DataFormat::Short;
+	case VertexAttributeEncoding::Half:
+		return DataFormat::Half;
+	case VertexAttributeEncoding::Snorm10_10_10_2:
+		return DataFormat::UnsignedInt;
+	case VertexAttributeEncoding::Unorm16:
+		return DataFormat::UnsignedShort;
+	default:
+		return dataTypeDataFormat(t);
+	}
+}
+
+uint32_t vertexAttributeEncodingSize(DataType t, VertexAttributeEncoding enc) {
+	ET_ASSERT(vertexAttributeEncodingSupported(t, enc));
+	switch (enc)
+	{
+	case VertexAttributeEncoding::OctahedralSnorm16:
+	case VertexAttributeEncoding::Snorm10_10_10_2:
+		return 4;
+
+	/*
+	 * Three-component 16-bit formats are padded to four components,
+	 * since they are not supported as vertex formats by most of the hardware
+	 */
+	case VertexAttributeEncoding::Half:
+	case VertexAttributeEncoding::Unorm16:
+		return (t == DataType::Vec2) ? 4 : 8;
+
+	default:
+		return dataTypeSize(t);
+	}
+}
+
 uint32_t vertexAttributeUsageMask(VertexAttributeUsage u) {
 	ET_ASSERT(u < VertexAttributeUsage::max);
 	return vertexAttributeUsageMasks[static_cast<uint32_t>(u)];
@@ -118,6 +118,21 @@ enum class DataType : uint32_t
 	max
 };
 
+/*
+ * Storage format of the vertex attribute, attribute is always seen as DataType in shaders:
+ * hardware decodes Half / Snorm / Unorm formats, octahedral values are decoded in the generated input layout
+ */
+enum class VertexAttributeEncoding : uint32_t
+{
+	None,
+	OctahedralSnorm16,
+	Half,
+	Snorm10_10_10_2,
+	Unorm16,
+	
+	max
+};
+
 enum class BlendConfiguration : uint32_t
 {
 	Disabled,
@@ -317,6 +332,7 @@ enum : uint32_t
 	FillMode_max = static_cast<uint32_t>(FillMode::max),
 	VertexAttributeUsage_max = static_cast<uint32_t>(VertexAttributeUsage::max),
 	DataType_max = static_cast<uint32_t>(DataType::max),
+	VertexAttributeEncoding_max = static_cast<uint32_t>(VertexAttributeEncoding::max),
 	PrimitiveType_max = static_cast<uint32_t>(PrimitiveType::max),
 	BlendConfiguration_max = static_cast<uint32_t>(BlendConfiguration::max),
 	DataFormat_max = static_cast<uint32_t>(DataFormat::max),
@@ -338,6 +354,7 @@ enum : uint32_t
 
 	ObjectVariablesBufferIndex = 0,
 	MaterialVariablesBufferIndex = 1,
+	DrawInstancesBufferIndex = 2,
 
 	MaxRenderTargets = 8,
 	MaxTextureUnits = 8,
@@ -599,6 +616,12 @@ uint32_t vertexAttributeUsageMask(VertexAttributeUsage u);
 uint32_t dataTypeSize(DataType t);
 uint32_t dataTypeComponents(DataType t);
 
+std::string vertexAttributeEncodingToString(VertexAttributeEncoding);
+VertexAttributeEncoding stringToVertexAttributeEncoding(const std::string&);
+bool vertexAttributeEncodingSupported(DataType, VertexAttributeEncoding);
+DataFormat vertexAttributeEncodingDataFormat(DataType, VertexAttributeEncoding);
+uint32_t vertexAttributeEncodingSize(DataType, VertexAttributeEncoding);
+
 uint32_t bitsPerPixelForDataFormat(DataFormat type);
 uint32_t bitsPerPixelForTextureFormat(TextureFormat internalFormat);
 uint32_t channelsForTextureFormat(TextureFormat internalFormat);
@@ -82,4 +82,39 @@ void RenderPass::loadSharedVariablesFromLight(const Light::Pointer& l) {
 	setSharedVariable(ObjectVariable::LightProjectionTransform, l->projectionMatrix());
 }
 
+void RenderPass::loadSharedVariablesFromDrawInstance(const DrawInstanceData& data) {
+	setSharedVariable(ObjectVariable::WorldTransform, data.worldTransform);
+	setSharedVariable(ObjectVariable::WorldRotationTransform, data.worldRotationTransform);
+	setSharedVariable(ObjectVariable::PreviousWorldTransform, data.previousWorldTransform);
+	setSharedVariable(ObjectVariable::PreviousWorldRotationTransform, data.previousWorldRotationTransform);
+}
+
+void RenderPass::pushDrawList(const DrawList::Pointer& drawList) {
+	/*
+	 * Built draw list contains one entry per command, entries are used here
+	 * to restore stream-relative ranges, since pushRenderBatch applies stream offsets itself,
+	 * instance data is passed through shared variables whenever it changes
+	 */
+	const Vector<DrawList::Entry>& entries = drawList->entries();
+	ET_ASSERT(entries.size() == drawList->commands().size());
+
+	uint32_t loadedInstance = InvalidIndex;
+	for (const DrawList::Group& group : drawList->groups())
+	{
+		for (uint32_t i = group.firstCommand, e = group.firstCommand + group.commandCount; i < e; ++i)
+		{
+			if (entries[i].instanceIndex != loadedInstance)
+			{
+				loadedInstance = entries[i].instanceIndex;
+				loadSharedVariablesFromDrawInstance(drawList->instances().at(loadedInstance));
+			}
+
+			VertexStream::Pointer vertexStream(entries[i].vertexStream);
+			uint32_t streamFirstIndex = vertexStream.valid() ? vertexStream->firstIndex() : 0;
+			ET_ASSERT(entries[i].vertexOffset == (vertexStream.valid() ? static_cast<int32_t>(vertexStream->baseVertex()) : 0));
+			pushRenderBatch(group.material, vertexStream, entries[i].firstIndex - streamFirstIndex, entries[i].indexCount);
+		}
+	}
+}
+
 }
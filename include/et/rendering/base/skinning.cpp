@@ -0,0 +1,262 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/core/threading.h>
+#include <et/geometry/geometry.h>
+#include <et/geometry/vector4-simd.h>
+#include <et/rendering/base/skinning.h>
+
+namespace et
+{
+namespace sk_local
+{
+enum : uint32_t
+{
+	InfluencesPerVertex = 4,
+};
+
+const VertexAttributeUsage directionAttributes[] =
+{
+	VertexAttributeUsage::Normal,
+	VertexAttributeUsage::Tangent,
+	VertexAttributeUsage::Binormal
+};
+
+/*
+ * Direction attributes are either Vec3, or Vec4 with w component kept (tangent handedness)
+ */
+struct DirectionStream
+{
+	VertexDataAccessor<DataType::Vec3> source3;
+	VertexDataAccessor<DataType::Vec3> destination3;
+	VertexDataAccessor<DataType::Vec4> source4;
+	VertexDataAccessor<DataType::Vec4> destination4;
+	bool vector4 = false;
+
+	vec4 source(uint32_t v) const
+		{ return vector4 ? source4[v] : vec4(source3[v], 0.0f); }
+
+	void setDestination(uint32_t v, const vec3& value, float w)
+	{
+		if (vector4)
+			destination4[v] = vec4(value, w);
+		else
+			destination3[v] = value;
+	}
+};
+
+/*
+ * Dual quaternions are stored as (scalar, x, y, z) for both real and dual parts
+ */
+struct BoneDualQuaternion
+{
+	vec4 real;
+	vec4 dual;
+};
+
+inline quaternion toQuaternion(const vec4& v)
+{
+	return quaternion(v.x, v.y, v.z, v.w);
+}
+
+inline vec4 fromQuaternion(const quaternion& q)
+{
+	return vec4(q.scalar, q.vector.x, q.vector.y, q.vector.z);
+}
+
+void buildDualQuaternions(const Vector<mat4>& transforms, Vector<BoneDualQuaternion>& result)
+{
+	result.resize(transforms.size());
+	for (size_t i = 0, e = transforms.size(); i < e; ++i)
+	{
+		vec3 translation;
+		vec3 scale;
+		quaternion rotation;
+		decomposeMatrix(transforms[i], translation, rotation, scale);
+		rotation.normalize();
+
+		result[i].real = fromQuaternion(rotation);
+		result[i].dual = fromQuaternion(quaternion(translation) * rotation * 0.5f);
+	}
+}
+
+/*
+ * Rotates vector by quaternion the same way mat4 built from quaternion does
+ */
+inline vec3 rotate(const quaternion& q, const vec3& v)
+{
+	vec3 t = 2.0f * cross(v, q.vector);
+	return v + q.scalar * t + cross(t, q.vector);
+}
+
+void skinRange(const VertexStorage::Pointer& source, VertexStorage::Pointer destination,
+	const Vector<mat4>& transforms, const Vector<BoneDualQuaternion>& dualQuaternions, skinning::Method method,
+	uint32_t begin, uint32_t end)
+{
+	const auto blendIndices = source->accessData<DataType::IntVec4>(VertexAttributeUsage::BlendIndices, 0);
+	const auto blendWeights = source->accessData<DataType::Vec4>(VertexAttributeUsage::BlendWeights, 0);
+
+	bool hasPositions = source->hasAttributeWithType(VertexAttributeUsage::Position, DataType::Vec3);
+	const VertexDataAccessor<DataType::Vec3> sourcePositions = hasPositions ?
+		source->accessData<DataType::Vec3>(VertexAttributeUsage::Position, 0) : VertexDataAccessor<DataType::Vec3>();
+	VertexDataAccessor<DataType::Vec3> destinationPositions = hasPositions ?
+		destination->accessData<DataType::Vec3>(VertexAttributeUsage::Position, 0) : VertexDataAccessor<DataType::Vec3>();
+
+	DirectionStream directions[sizeof(directionAttributes) / sizeof(directionAttributes[0])];
+	uint32_t directionsCount = 0;
+	for (VertexAttributeUsage usage : directionAttributes)
+	{
+		DirectionStream& stream = directions[directionsCount];
+		if (source->hasAttributeWithType(usage, DataType::Vec3))
+		{
+			stream.source3 = source->accessData<DataType::Vec3>(usage, 0);
+			stream.destination3 = destination->accessData<DataType::Vec3>(usage, 0);
+			++directionsCount;
+		}
+		else if (source->hasAttributeWithType(usage, DataType::Vec4))
+		{
+			stream.source4 = source->accessData<DataType::Vec4>(usage, 0);
+			stream.destination4 = destination->accessData<DataType::Vec4>(usage, 0);
+			stream.vector4 = true;
+			++directionsCount;
+		}
+	}
+
+	uint32_t bonesCount = static_cast<uint32_t>(transforms.size());
+	for (uint32_t v = begin; v < end; ++v)
+	{
+		const vec4i& indices = blendIndices[v];
+		const vec4& weights = blendWeights[v];
+
+		if (method == skinning::Method::LinearBlend)
+		{
+			/*
+			 * Rows of the weighted sum of bone matrices, applied once to all attributes
+			 */
+			vec4simd r0(0.0f);
+			vec4simd r1(0.0f);
+			vec4simd r2(0.0f);
+			vec4simd r3(0.0f);
+			for (uint32_t i = 0; i < InfluencesPerVertex; ++i)
+			{
+				uint32_t bone = static_cast<uint32_t>(indices[i]);
+				if ((weights[i] == 0.0f) || (bone >= bonesCount))
+					continue;
+
+				const mat4& m = transforms[bone];
+				r0.addMultiplied(vec4simd(m[0]), weights[i]);
+				r1.addMultiplied(vec4simd(m[1]), weights[i]);
+				r2.addMultiplied(vec4simd(m[2]), weights[i]);
+				r3.addMultiplied(vec4simd(m[3]), weights[i]);
+			}
+
+			if (hasPositions)
+			{
+				const vec3& p = sourcePositions[v];
+				destinationPositions[v] = (r0 * p.x + r1 * p.y + r2 * p.z + r3).xyz();
+			}
+
+			for (uint32_t d = 0; d < directionsCount; ++d)
+			{
+				vec4 n = directions[d].source(v);
+				directions[d].setDestination(v, normalize((r0 * n.x + r1 * n.y + r2 * n.z).xyz()), n.w);
+			}
+		}
+		else
+		{
+			/*
+			 * Blended dual quaternion, influences are flipped into the hemisphere of the first one
+			 */
+			vec4simd real(0.0f);
+			vec4simd dual(0.0f);
+			vec4simd pivot(0.0f);
+			bool pivotSet = false;
+			for (uint32_t i = 0; i < InfluencesPerVertex; ++i)
+			{
+				uint32_t bone = static_cast<uint32_t>(indices[i]);
+				if ((weights[i] == 0.0f) || (bone >= bonesCount))
+					continue;
+
+				vec4simd boneReal(dualQuaternions[bone].real);
+				vec4simd boneDual(dualQuaternions[bone].dual);
+				if (!pivotSet)
+				{
+					pivot = boneReal;
+					pivotSet = true;
+				}
+
+				vec4simd product = pivot * boneReal;
+				float w = (product.cX() + product.cY() + product.cZ() + product.cW() < 0.0f) ? -weights[i] : weights[i];
+				real.addMultiplied(boneReal, w);
+				dual.addMultiplied(boneDual, w);
+			}
+
+			quaternion q = toQuaternion(real.toVec4());
+			quaternion qd = toQuaternion(dual.toVec4());
+			float length = q.length();
+			if (length > std::numeric_limits<float>::epsilon())
+			{
+				q = q / length;
+				qd = qd / length;
+			}
+			else
+			{
+				q = quaternion();
+				qd = quaternion(0.0f, 0.0f, 0.0f, 0.0f);
+			}
+			vec3 translation = 2.0f * (qd * !q).vector;
+
+			if (hasPositions)
+				destinationPositions[v] = rotate(q, sourcePositions[v]) + translation;
+
+			for (uint32_t d = 0; d < directionsCount; ++d)
+			{
+				vec4 n = directions[d].source(v);
+				directions[d].setDestination(v, rotate(q, n.xyz()), n.w);
+			}
+		}
+	}
+}
+
+}
+
+bool skinning::canSkin(const VertexStorage::Pointer& vs)
+{
+	return vs.valid() && vs->hasAttributeWithType(VertexAttributeUsage::BlendIndices, DataType::IntVec4) &&
+		vs->hasAttributeWithType(VertexAttributeUsage::BlendWeights, DataType::Vec4);
+}
+
+void skinning::skinRange(const VertexStorage::Pointer& source, VertexStorage::Pointer destination,
+	const Vector<mat4>& transforms, Method method, uint32_t begin, uint32_t end)
+{
+	ET_ASSERT(canSkin(source));
+	ET_ASSERT(destination->capacity() >= end);
+
+	Vector<sk_local::BoneDualQuaternion> dualQuaternions;
+	if (method == Method::DualQuaternion)
+		sk_local::buildDualQuaternions(transforms, dualQuaternions);
+
+	sk_local::skinRange(source, destination, transforms, dualQuaternions, method, begin, end);
+}
+
+void skinning::skin(const VertexStorage::Pointer& source, VertexStorage::Pointer destination,
+	const Vector<mat4>& transforms, Method method)
+{
+	ET_ASSERT(canSkin(source));
+	ET_ASSERT(destination->capacity() >= source->capacity());
+
+	Vector<sk_local::BoneDualQuaternion> dualQuaternions;
+	if (method == Method::DualQuaternion)
+		sk_local::buildDualQuaternions(transforms, dualQuaternions);
+
+	threading::parallelFor(source->capacity(), ParallelThreshold, [&](uint32_t begin, uint32_t end)
+	{
+		sk_local::skinRange(source, destination, transforms, dualQuaternions, method, begin, end);
+	});
+}
+
+}
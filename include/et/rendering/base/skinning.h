@@ -0,0 +1,42 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/rendering/base/vertexstorage.h>
+
+namespace et
+{
+	namespace skinning
+	{
+		enum class Method : uint32_t
+		{
+			LinearBlend,
+			DualQuaternion
+		};
+
+		enum : uint32_t
+		{
+			ParallelThreshold = 4096
+		};
+
+		/*
+		 * Skins positions, normals, tangents and binormals of the source storage into the destination one
+		 * (which should have the same attributes, could be the source itself) using BlendIndices (IntVec4)
+		 * and BlendWeights (Vec4) attributes of the source. Attributes should not be encoded.
+		 * Dual quaternion skinning uses only rotation and translation of the transforms.
+		 * Large storages are processed in parallel, by vertex ranges
+		 */
+		void skin(const VertexStorage::Pointer& source, VertexStorage::Pointer destination,
+			const Vector<mat4>& transforms, Method = Method::LinearBlend);
+
+		void skinRange(const VertexStorage::Pointer& source, VertexStorage::Pointer destination,
+			const Vector<mat4>& transforms, Method, uint32_t begin, uint32_t end);
+
+		bool canSkin(const VertexStorage::Pointer&);
+	}
+}
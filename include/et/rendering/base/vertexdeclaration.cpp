@@ -14,12 +14,14 @@ namespace et
 static VertexElement _emptyVertexElement;
 
 VertexElement::VertexElement(VertexAttributeUsage aUsage, DataType aType, uint32_t aStride,
-	uint32_t aOffset) : _usage(aUsage), _type(aType), _stride(aStride), _offset(aOffset)
+	uint32_t aOffset, VertexAttributeEncoding aEncoding) : _usage(aUsage), _type(aType), _encoding(aEncoding),
+	_stride(aStride), _offset(aOffset)
 {
 	ET_ASSERT(_type < DataType::max);
+	ET_ASSERT(vertexAttributeEncodingSupported(_type, _encoding));
 
 	_components = dataTypeComponents(_type);
-	_dataFormat = dataTypeDataFormat(_type);
+	_dataFormat = vertexAttributeEncodingDataFormat(_type, _encoding);
 }
 
 VertexDeclaration::VertexDeclaration() = default;
@@ -36,6 +38,9 @@ bool VertexDeclaration::has(VertexAttributeUsage usage) const
 bool VertexDeclaration::push_back(VertexAttributeUsage usage, DataType type)
 	{ return push_back(VertexElement(usage, type, 0, _size)); }
 
+bool VertexDeclaration::push_back(VertexAttributeUsage usage, DataType type, VertexAttributeEncoding encoding)
+	{ return push_back(VertexElement(usage, type, 0, _size, encoding)); }
+
 bool VertexDeclaration::push_back(const VertexElement& el)
 {
 	if (has(el.usage()))
@@ -43,7 +48,7 @@ bool VertexDeclaration::push_back(const VertexElement& el)
 
 	_usageMask = _usageMask | vertexAttributeUsageMask(el.usage());
 	
-	_size += dataTypeSize(el.type());
+	_size += el.sizeInBytes();
 	_elements.insert(el);
 
 	if (_interleaved)
@@ -131,14 +136,25 @@ bool VertexDeclaration::hasSameElementsAs(const VertexDeclaration& r) const
 	return true;
 }
 
+bool VertexDeclaration::hasEncodedElements() const
+{
+	for (const auto& e : _elements)
+	{
+		if (e.encoded())
+			return true;
+	}
+	return false;
+}
+
 void VertexDeclaration::serialize(std::ostream& fOut)
 {
-	serializeUInt32(fOut, 0);
+	serializeUInt32(fOut, 1);
 	serializeUInt32(fOut, static_cast<uint32_t>(_elements.size()));
 	for (const VertexElement& e : _elements)
 	{
 		serializeUInt32(fOut, static_cast<uint32_t>(e.usage()));
 		serializeUInt32(fOut, static_cast<uint32_t>(e.type()));
+		serializeUInt32(fOut, static_cast<uint32_t>(e.encoding()));
 	}
 }
 
@@ -146,13 +162,15 @@ void VertexDeclaration::deserialize(std::istream& fIn)
 {
 	clear();
 
-	/* uint32_t version = */ deserializeUInt32(fIn);
+	uint32_t version = deserializeUInt32(fIn);
 	uint32_t elementCount = deserializeUInt32(fIn);
 	for (uint32_t i = 0; i < elementCount; ++i)
 	{
 		VertexAttributeUsage usage = static_cast<VertexAttributeUsage>(deserializeUInt32(fIn));
 		DataType type = static_cast<DataType>(deserializeUInt32(fIn));
-		push_back(usage, type);
+		VertexAttributeEncoding encoding = (version > 0) ? 
+			static_cast<VertexAttributeEncoding>(deserializeUInt32(fIn)) : VertexAttributeEncoding::None;
+		push_back(usage, type, encoding);
 	}
 }
 
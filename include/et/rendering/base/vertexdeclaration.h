@@ -18,13 +18,13 @@ public:
 		{ }
 		
 	VertexElement(VertexAttributeUsage aUsage, DataType aType, uint32_t aStride = 0,
-		uint32_t aOffset = 0);
+		uint32_t aOffset = 0, VertexAttributeEncoding aEncoding = VertexAttributeEncoding::None);
 
 	bool operator == (const VertexElement& r) const
-		{ return (_usage == r._usage) && (_type == r._type) && (_stride == r._stride) && (_offset == r._offset); }
+		{ return (_usage == r._usage) && (_type == r._type) && (_encoding == r._encoding) && (_stride == r._stride) && (_offset == r._offset); }
 
 	bool operator != (const VertexElement& r) const
-		{ return (_usage != r._usage) || (_type != r._type) || (_stride != r._stride) || (_offset != r._offset); }
+		{ return !(operator == (r)); }
 
 	bool operator == (const VertexAttributeUsage& aUsage) const
 		{ return (_usage == aUsage); }
@@ -35,6 +35,15 @@ public:
 	DataType type() const
 		{ return _type; } 
 
+	VertexAttributeEncoding encoding() const
+		{ return _encoding; }
+
+	bool encoded() const
+		{ return _encoding != VertexAttributeEncoding::None; }
+
+	uint32_t sizeInBytes() const
+		{ return vertexAttributeEncodingSize(_type, _encoding); }
+
 	uint32_t stride() const
 		{ return _stride; }
 
@@ -56,6 +65,7 @@ public:
 private:
 	VertexAttributeUsage _usage = VertexAttributeUsage::Position;
 	DataType _type = DataType::Float;
+	VertexAttributeEncoding _encoding = VertexAttributeEncoding::None;
 	DataFormat _dataFormat = DataFormat::Float;
 	uint32_t _stride = 0;
 	uint32_t _offset = 0;
@@ -75,6 +85,7 @@ public:
 	bool has(VertexAttributeUsage usage) const;
 
 	bool push_back(VertexAttributeUsage usage, DataType type);
+	bool push_back(VertexAttributeUsage usage, DataType type, VertexAttributeEncoding encoding);
 	bool push_back(const VertexElement& element);
 
 	bool remove(VertexAttributeUsage usage);
@@ -107,6 +118,7 @@ public:
 		{ return !(operator == (r)); }
 
 	bool hasSameElementsAs(const VertexDeclaration&) const;
+	bool hasEncodedElements() const;
 
 	void serialize(std::ostream&);
 	void deserialize(std::istream&);
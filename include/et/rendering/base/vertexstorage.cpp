@@ -6,6 +6,7 @@
  */
 
 #include <et/core/datastorage.h>
+#include <et/core/serialization.h>
 #include <et/rendering/base/vertexstorage.h>
 
 namespace et
@@ -19,6 +20,8 @@ public:
 public:
 	VertexDeclaration decl;
 	BinaryDataStorage data;
+	vec3 positionScale = vec3(1.0f);
+	vec3 positionOffset = vec3(0.0f);
 	uint32_t capacity = 0;
 };
 
@@ -75,8 +78,23 @@ uint32_t VertexStorage::offsetOfAttribute(VertexAttributeUsage usage) const
 uint32_t VertexStorage::sizeOfAttribute(VertexAttributeUsage usage) const
 {
 	ET_ASSERT(hasAttribute(usage));
-	const auto& element = declaration().elementForUsage(usage);
-	return sizeOfDataFormat(element.dataFormat()) * dataTypeComponents(element.type());
+	return declaration().elementForUsage(usage).sizeInBytes();
+}
+
+void VertexStorage::setPositionDequantization(const vec3& scale, const vec3& offset)
+{
+	_private->positionScale = scale;
+	_private->positionOffset = offset;
+}
+
+const vec3& VertexStorage::positionScale() const
+{
+	return _private->positionScale;
+}
+
+const vec3& VertexStorage::positionOffset() const
+{
+	return _private->positionOffset;
 }
 
 uint32_t VertexStorage::stride() const
@@ -107,8 +125,10 @@ void VertexStorage::resize(uint32_t sz)
 
 void VertexStorage::serialize(std::ostream& fOut)
 {
-	serializeUInt32(fOut, 0);
+	serializeUInt32(fOut, 1);
 	_private->decl.serialize(fOut);
+	serializeVector(fOut, _private->positionScale);
+	serializeVector(fOut, _private->positionOffset);
 	
 	serializeUInt64(fOut, _private->data.size());
 	if (_private->data.size() > 0)
@@ -117,11 +137,17 @@ void VertexStorage::serialize(std::ostream& fOut)
 
 void VertexStorage::deserialize(std::istream& fIn)
 {
-	/* uint32_t version = */ deserializeUInt32(fIn);
+	uint32_t version = deserializeUInt32(fIn);
 	_private->decl.deserialize(fIn);
+	if (version > 0)
+	{
+		_private->positionScale = deserializeVector<vec3>(fIn);
+		_private->positionOffset = deserializeVector<vec3>(fIn);
+	}
 	
-	uint32_t dataSize = deserializeUInt32(fIn);
+	uint64_t dataSize = deserializeUInt64(fIn);
 	_private->data.resize(dataSize);
+	_private->capacity = static_cast<uint32_t>(dataSize / _private->decl.sizeInBytes());
 	if (dataSize > 0)
 		fIn.read(_private->data.binary(), dataSize);
 }
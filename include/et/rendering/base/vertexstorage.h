@@ -31,6 +31,7 @@ public:
 	VertexDataAccessor<T> accessData(VertexAttributeUsage usage, uint32_t offset)
 	{
 		ET_ASSERT(hasAttributeWithType(usage, T));
+		ET_ASSERT(!declaration().elementForUsage(usage).encoded());
 
 		return VertexDataAccessor<T>(data().binary(), static_cast<uint32_t>(data().dataSize()),
 			stride(), offset * stride() + offsetOfAttribute(usage));
@@ -40,6 +41,7 @@ public:
 	VertexDataAccessor<T> accessData(VertexAttributeUsage usage, uint32_t offset) const
 	{
 		ET_ASSERT(hasAttributeWithType(usage, T));
+		ET_ASSERT(!declaration().elementForUsage(usage).encoded());
 
 		return VertexDataAccessor<T>(data().binary(), static_cast<uint32_t>(data().dataSize()),
 			stride(), offset * stride() + offsetOfAttribute(usage));
@@ -63,11 +65,19 @@ public:
 	uint32_t offsetOfAttribute(VertexAttributeUsage usage) const;
 	uint32_t sizeOfAttribute(VertexAttributeUsage usage) const;
 
+	/*
+	 * Positions encoded as Unorm16 are restored as (encoded * scale + offset),
+	 * this transform is applied together with object's world transform
+	 */
+	void setPositionDequantization(const vec3& scale, const vec3& offset);
+	const vec3& positionScale() const;
+	const vec3& positionOffset() const;
+
 	void serialize(std::ostream&);
 	void deserialize(std::istream&);
 
 private:
-	ET_DECLARE_PIMPL(VertexStorage, 128);
+	ET_DECLARE_PIMPL(VertexStorage, 160);
 };
 
 #define ET_DECLARE_ACCESSOR(vat, base) \
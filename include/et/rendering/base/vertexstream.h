@@ -25,6 +25,23 @@ public:
 	void setIndexBuffer(const Buffer::Pointer&, IndexArrayFormat);
 	void setPrimitiveType(PrimitiveType);
 
+	/*
+	 * Offsets of the stream data within (possibly shared) vertex and index buffers,
+	 * applied to every draw call made with this stream
+	 */
+	void setBaseVertex(uint32_t);
+	void setFirstIndex(uint32_t);
+	void setVertexCount(uint32_t);
+	void setAllocation(const Object::Pointer&);
+
+	/*
+	 * Restores quantized positions (see VertexStorage::setPositionDequantization),
+	 * should be applied on top of the object's world transform
+	 */
+	void setPositionDequantization(const vec3& scale, const vec3& offset);
+	mat4 positionDequantizationTransform() const;
+	bool hasPositionDequantization() const;
+
 	const VertexDeclaration& vertexDeclaration() const 
 		{ return _vbDeclaration; }
 
@@ -43,14 +60,28 @@ public:
 	const Buffer::Pointer& indexBuffer() const
 		{ return _ib; }
 
+	uint32_t baseVertex() const
+		{ return _baseVertex; }
+
+	uint32_t firstIndex() const
+		{ return _firstIndex; }
+
 	uint32_t vertexCount() const;
 
+	bool sharesBuffersWith(const VertexStream&) const;
+
 private:
 	Buffer::Pointer _vb;
 	Buffer::Pointer _ib;
+	Object::Pointer _allocation;
 	VertexDeclaration _vbDeclaration;
 	IndexArrayFormat _ibFormat = IndexArrayFormat::Count;
 	PrimitiveType _primitiveType = PrimitiveType::Points;
+	uint32_t _baseVertex = 0;
+	uint32_t _firstIndex = 0;
+	uint32_t _vertexCount = 0;
+	vec3 _positionScale = vec3(1.0f);
+	vec3 _positionOffset = vec3(0.0f);
 };
 
 inline void VertexStream::setVertexBuffer(const Buffer::Pointer& vb, const VertexDeclaration& decl)
@@ -70,9 +101,51 @@ inline void VertexStream::setPrimitiveType(PrimitiveType pt)
 	_primitiveType = pt;
 }
 
+inline void VertexStream::setBaseVertex(uint32_t value)
+{
+	_baseVertex = value;
+}
+
+inline void VertexStream::setFirstIndex(uint32_t value)
+{
+	_firstIndex = value;
+}
+
+inline void VertexStream::setVertexCount(uint32_t value)
+{
+	_vertexCount = value;
+}
+
+inline void VertexStream::setAllocation(const Object::Pointer& allocation)
+{
+	_allocation = allocation;
+}
+
+inline void VertexStream::setPositionDequantization(const vec3& scale, const vec3& offset)
+{
+	_positionScale = scale;
+	_positionOffset = offset;
+}
+
+inline mat4 VertexStream::positionDequantizationTransform() const
+{
+	return translationScaleMatrix(_positionOffset, _positionScale);
+}
+
+inline bool VertexStream::hasPositionDequantization() const
+{
+	return (_positionScale != vec3(1.0f)) || (_positionOffset != vec3(0.0f));
+}
+
 inline uint32_t VertexStream::vertexCount() const
 {
-	return static_cast<uint32_t>(_vb->size() / _vbDeclaration.sizeInBytes());
+	return (_vertexCount > 0) ? _vertexCount : static_cast<uint32_t>(_vb->size() / _vbDeclaration.sizeInBytes());
+}
+
+inline bool VertexStream::sharesBuffersWith(const VertexStream& r) const
+{
+	return (_vb == r._vb) && (_ib == r._ib) && (_ibFormat == r._ibFormat) &&
+		(_primitiveType == r._primitiveType) && (_vbDeclaration == r._vbDeclaration);
 }
 
 }
@@ -29,7 +29,8 @@ public:
 		Constant,
 		Vertex,
 		Index,
-		Staging
+		Staging,
+		Indirect
 	};
 
 	enum class Location : uint32_t
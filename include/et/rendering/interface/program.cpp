@@ -83,6 +83,8 @@ void Program::Reflection::serialize(std::ostream& file) const
 		serializeUInt32(file, materialVariables[i].enabled);
 	}
 
+	serializeUInt32(file, drawInstancesBufferEnabled ? 1 : 0);
+
 	serializeUInt32(file, static_cast<uint32_t>(textures.size()));
 	for (const auto& tex : textures)
 	{
@@ -140,6 +142,8 @@ bool Program::Reflection::deserialize(std::istream& file)
 		materialVariables[i].enabled = deserializeUInt32(file);
 	}
 
+	drawInstancesBufferEnabled = deserializeUInt32(file) != 0;
+
 	textures.clear();
 	uint32_t texturesSize = deserializeInt32(file);
 	for (uint32_t i = 0; i < texturesSize; ++i)
@@ -41,6 +41,8 @@ public:
 		uint32_t materialVariablesBufferSize = 0;
 		Variable materialVariables[MaterialVariable_max];
 
+		bool drawInstancesBufferEnabled = false;
+
 		TextureSet::Reflection textures;
 
 		void serialize(std::ostream&) const;
@@ -13,6 +13,7 @@
 #include <et/rendering/rendercontextparams.h>
 #include <et/rendering/renderoptions.h>
 #include <et/rendering/base/materiallibrary.h>
+#include <et/rendering/base/geometrybuffer.h>
 #include <et/rendering/interface/buffer.h>
 #include <et/rendering/interface/texture.h>
 #include <et/rendering/interface/renderpass.h>
@@ -37,6 +38,10 @@ public:
 		return _sharedConstantBuffer;
 	}
 
+	GeometryBuffer& sharedGeometryBuffer() {
+		return _sharedGeometryBuffer;
+	}
+
 	const FrameStatistics& statistics() const {
 		return _statistics;
 	}
@@ -148,6 +153,7 @@ protected:
 private:
 	MaterialLibrary _sharedMaterialLibrary;
 	ConstantBuffer _sharedConstantBuffer;
+	GeometryBuffer _sharedGeometryBuffer;
 	RenderBatchPool _renderBatchPool;
 	RenderOptions _options;
 	Texture::Pointer _checkersTexture;
@@ -276,6 +282,7 @@ inline const Sampler::Pointer& RenderInterface::builtInSampler(const std::string
 inline void RenderInterface::initInternalStructures() {
 	_options.load();
 	_sharedConstantBuffer.init(this, ConstantBufferStaticAllocation | ConstantBufferDynamicAllocation);
+	_sharedGeometryBuffer.init(this);
 	_sharedMaterialLibrary.init(this);
 
 	_options.optionChanged.connect([this](RenderOptions::ValueChangedEvent) {
@@ -359,6 +366,7 @@ inline void RenderInterface::shutdownInternalStructures() {
 	_renderBatchPool.clear();
 	_sharedMaterialLibrary.shutdown();
 	_sharedConstantBuffer.shutdown();
+	_sharedGeometryBuffer.shutdown();
 
 	_checkersTexture.reset(nullptr);
 	_whiteTexture.reset(nullptr);
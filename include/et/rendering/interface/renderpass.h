@@ -13,6 +13,7 @@
 #include <et/rendering/base/rendering.h>
 #include <et/rendering/base/constantbuffer.h>
 #include <et/rendering/base/renderbatch.h>
+#include <et/rendering/base/drawlist.h>
 
 namespace et {
 
@@ -105,6 +106,7 @@ public:
 
 	// virtual void begin(const RenderPassBeginInfo& info) = 0;
 	virtual void pushRenderBatch(const MaterialInstance::Pointer&, const VertexStream::Pointer&, uint32_t first, uint32_t count) = 0;
+	virtual void pushDrawList(const DrawList::Pointer&);
 	virtual void pushImageBarrier(const Texture::Pointer&, const ResourceBarrier&) = 0;
 	virtual void copyImage(const Texture::Pointer&, const Texture::Pointer&, const CopyDescriptor&) = 0;
 	virtual void copyImageToBuffer(const Texture::Pointer&, const Buffer::Pointer&, const CopyDescriptor&) = 0;
@@ -130,6 +132,7 @@ public:
 
 	void loadSharedVariablesFromCamera(const Camera::Pointer&);
 	void loadSharedVariablesFromLight(const Light::Pointer&);
+	void loadSharedVariablesFromDrawInstance(const DrawInstanceData&);
 
 	uint64_t identifier() const;
 
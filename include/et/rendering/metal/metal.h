@@ -73,6 +73,7 @@ namespace metal
 	MTLPrimitiveType primitiveTypeValue(PrimitiveType);
     MTLPrimitiveTopologyClass primitiveTypeToTopology(PrimitiveType);
     MTLVertexFormat dataTypeToVertexFormat(DataType);
+    MTLVertexFormat vertexFormatValue(DataType, VertexAttributeEncoding);
 	MTLCompareFunction compareFunctionValue(CompareFunction);
 	MTLIndexType indexArrayFormat(IndexArrayFormat);
 	MTLSamplerAddressMode wrapModeToAddressMode(TextureWrap);
@@ -140,6 +140,24 @@ MTLVertexFormat dataTypeToVertexFormat(DataType value)
     return _map.at(value);
 }
 
+MTLVertexFormat vertexFormatValue(DataType type, VertexAttributeEncoding encoding)
+{
+	ET_ASSERT(vertexAttributeEncodingSupported(type, encoding));
+	switch (encoding)
+	{
+		case VertexAttributeEncoding::OctahedralSnorm16:
+			return MTLVertexFormatShort2Normalized;
+		case VertexAttributeEncoding::Half:
+			return (type == DataType::Vec2) ? MTLVertexFormatHalf2 : MTLVertexFormatHalf4;
+		case VertexAttributeEncoding::Snorm10_10_10_2:
+			return MTLVertexFormatInt1010102Normalized;
+		case VertexAttributeEncoding::Unorm16:
+			return (type == DataType::Vec2) ? MTLVertexFormatUShort2Normalized : MTLVertexFormatUShort4Normalized;
+		default:
+			return dataTypeToVertexFormat(type);
+	}
+}
+
 DataType mtlDataTypeToDataType(MTLDataType value)
 {
 	static const std::map<MTLDataType, DataType> _map =
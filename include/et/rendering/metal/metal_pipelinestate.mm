@@ -78,7 +78,7 @@ void MetalPipelineState::build(const RenderPass::Pointer&)
 	for (const VertexElement& element : providedLayout.elements())
 	{
 		NSUInteger index = static_cast<NSUInteger>(element.usage());
-		desc.vertexDescriptor.attributes[index].format = metal::dataTypeToVertexFormat(element.type());
+		desc.vertexDescriptor.attributes[index].format = metal::vertexFormatValue(element.type(), element.encoding());
 		desc.vertexDescriptor.attributes[index].offset = element.offset();
 		desc.vertexDescriptor.attributes[index].bufferIndex = VertexStreamBufferIndex;
 	}
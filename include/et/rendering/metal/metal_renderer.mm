@@ -53,6 +53,7 @@ void MetalRenderer::init(const RenderContextParameters& /* params */)
 	application().context().objects[4] = (__bridge void*)_private->metal.layer;
 
 	sharedConstantBuffer().init(this, ConstantBufferStaticAllocation | ConstantBufferDynamicAllocation);
+	sharedGeometryBuffer().init(this);
 	sharedMaterialLibrary().init(this);
 }
 
@@ -60,6 +61,7 @@ void MetalRenderer::shutdown()
 {
 	sharedMaterialLibrary().shutdown();
 	sharedConstantBuffer().shutdown();
+	sharedGeometryBuffer().shutdown();
 
 	ET_OBJC_RELEASE(_private->metal.queue);
 	ET_OBJC_RELEASE(_private->metal.device);
@@ -476,6 +476,23 @@ VkFormat dataTypeValue(DataType fmt) {
 	};
 }
 
+VkFormat vertexFormatValue(DataType type, VertexAttributeEncoding encoding) {
+	ET_ASSERT(vertexAttributeEncodingSupported(type, encoding));
+	switch (encoding)
+	{
+	case VertexAttributeEncoding::OctahedralSnorm16:
+		return VK_FORMAT_R16G16_SNORM;
+	case VertexAttributeEncoding::Half:
+		return (type == DataType::Vec2) ? VK_FORMAT_R16G16_SFLOAT : VK_FORMAT_R16G16B16A16_SFLOAT;
+	case VertexAttributeEncoding::Snorm10_10_10_2:
+		return VK_FORMAT_A2B10G10R10_SNORM_PACK32;
+	case VertexAttributeEncoding::Unorm16:
+		return (type == DataType::Vec2) ? VK_FORMAT_R16G16_UNORM : VK_FORMAT_R16G16B16A16_UNORM;
+	default:
+		return dataTypeValue(type);
+	}
+}
+
 VkFormat textureFormatValue(TextureFormat fmt) {
 	switch (fmt)
 	{
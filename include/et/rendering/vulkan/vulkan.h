@@ -188,7 +188,7 @@ enum DescriptorSetClass : uint32_t
 	Images,
 
 	DescriptorSetClass_Count,
-	DynamicDescriptorsCount = 2
+	DynamicDescriptorsCount = 3
 };
 
 struct VulkanNativePipeline
@@ -251,6 +251,7 @@ namespace vulkan {
 
 VkCompareOp depthCompareOperation(CompareFunction);
 VkFormat dataTypeValue(DataType);
+VkFormat vertexFormatValue(DataType, VertexAttributeEncoding);
 VkPrimitiveTopology primitiveTopology(PrimitiveType);
 VkCullModeFlags cullModeFlags(CullMode);
 VkIndexType indexBufferFormat(IndexArrayFormat);
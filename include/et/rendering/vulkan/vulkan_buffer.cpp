@@ -29,12 +29,16 @@ VulkanBuffer::VulkanBuffer(VulkanState& vulkan, const Description& desc)
 {
 	ET_PIMPL_INIT(VulkanBuffer, vulkan);
 
+	/*
+	 * Constant buffers are also bound as read-only storage buffers (draw list instance data)
+	 */
 	static Map<Usage, uint32_t> usageFlags =
 	{
-		{ Usage::Constant, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT },
+		{ Usage::Constant, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT },
 		{ Usage::Vertex, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT },
 		{ Usage::Index, VK_BUFFER_USAGE_INDEX_BUFFER_BIT },
 		{ Usage::Staging, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT },
+		{ Usage::Indirect, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT },
 	};
 
 	_private->desc.location = desc.location;
@@ -107,7 +111,7 @@ void VulkanBuffer::updateData(uint64_t offset, const BinaryDataStorage& data)
 			stagingBuffer.unmap();
 
 			InstusivePointerScope<VulkanBuffer> scope(this);
-			stagingBuffer.transferData(VulkanBuffer::Pointer(this), 0, copyOffset, stagingBufferSize);
+			stagingBuffer.transferData(VulkanBuffer::Pointer(this), 0, offset + copyOffset, stagingBufferSize);
 			bytesRemaining -= stagingBufferSize;
 			copyOffset += stagingBufferSize;
 		}
@@ -142,7 +146,7 @@ uint8_t* VulkanBuffer::map(uint64_t offset, uint64_t size)
 	ET_ASSERT(offset + size <= _private->desc.alignedSize);
 
 	_private->mapped = true;
-	return _private->vulkan.allocator.map(_private->allocation);
+	return _private->vulkan.allocator.map(_private->allocation) + offset;
 }
 
 void VulkanBuffer::modifyRange(uint64_t begin, uint64_t length)
@@ -164,10 +168,14 @@ void VulkanBuffer::unmap()
 		}
 		ET_ASSERT(flushEnd > flushBegin);
 
+		VkDeviceSize atomSize = _private->vulkan.physicalDeviceProperties.limits.nonCoherentAtomSize;
+		flushBegin = alignDownTo(_private->allocation.offset + flushBegin, atomSize);
+		flushEnd = _private->allocation.offset + flushEnd;
+
 		VkMappedMemoryRange flushRange = { VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
 		flushRange.memory = _private->allocation.memory;
 		flushRange.offset = flushBegin;
-		flushRange.size = alignUpTo(flushEnd - flushBegin, _private->vulkan.physicalDeviceProperties.limits.nonCoherentAtomSize);
+		flushRange.size = alignUpTo(flushEnd - flushBegin, atomSize);
 		VULKAN_CALL(vkFlushMappedMemoryRanges(_private->vulkan.device, 1, &flushRange));
 	}
 	_private->vulkan.allocator.unmap(_private->allocation);
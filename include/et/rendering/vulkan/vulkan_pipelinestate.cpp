@@ -174,7 +174,7 @@ void VulkanPipelineStatePrivate::generateInputLayout(const VertexDeclaration& in
 			{
 				attribs.emplace_back();
 				attribs.back().offset = e.offset();
-				attribs.back().format = vulkan::dataTypeValue(e.type());
+				attribs.back().format = vulkan::vertexFormatValue(e.type(), e.encoding());
 				attribs.back().location = static_cast<uint32_t>(e.usage());
 			}
 		}
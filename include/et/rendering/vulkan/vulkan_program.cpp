@@ -18,7 +18,7 @@
 
 #define ET_VULKAN_PROGRAM_USE_CACHE 1
 
-const uint32_t programCacheVersion = 2;
+const uint32_t programCacheVersion = 3;
 const uint32_t programCacheHeader = 'PROG';
 const uint32_t programCacheVertex = 'VERT';
 const uint32_t programCacheFragment = 'FRAG';
@@ -105,8 +105,11 @@ bool VulkanProgramPrivate::loadCached(uint32_t stages, uint64_t hash, SPIRProgra
 	if (header != programCacheHeader)
 		RETURN_WITH_ERROR("Invalid header read from cache file");
 	
+	/*
+	 * Reflection layout changes between versions, outdated cache is rebuilt
+	 */
 	uint32_t version = deserializeUInt32(file);
-	if (version > programCacheVersion)
+	if (version != programCacheVersion)
 		RETURN_WITH_ERROR("Unsupported version read from cache file");
 
 	uint32_t storedStages = deserializeUInt32(file);
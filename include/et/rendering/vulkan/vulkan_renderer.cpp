@@ -209,6 +209,8 @@ void VulkanRenderer::init(const RenderContextParameters& params) {
 	VkPhysicalDeviceFeatures deviceFeatures = { };
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 	deviceFeatures.textureCompressionBC = VK_TRUE;
+	deviceFeatures.multiDrawIndirect = _private->physicalDeviceFeatures.multiDrawIndirect;
+	deviceFeatures.drawIndirectFirstInstance = _private->physicalDeviceFeatures.drawIndirectFirstInstance;
 
 	VkDeviceCreateInfo deviceCreateInfo = { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
 	deviceCreateInfo.queueCreateInfoCount = totalQueuesCount;
@@ -251,6 +253,7 @@ void VulkanRenderer::init(const RenderContextParameters& params) {
 
 	VkDescriptorPoolSize poolSizes[] = {
 		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, defaultPoolSize },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, defaultPoolSize },
 		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, defaultPoolSize },
 		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, defaultPoolSize },
 		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, defaultPoolSize },
@@ -339,8 +342,9 @@ PipelineState::Pointer VulkanRenderer::acquireGraphicsPipeline(const RenderPass:
 
 	const std::string& cls = pass->info().name;
 	const Material::Configuration& config = mat->configuration(cls);
+	const Program::Pointer& program = mat->program(cls, vs->vertexDeclaration());
 
-	VulkanPipelineState::Pointer ps = _private->pipelineCache.find(pass->identifier(), vs->vertexDeclaration(), config.program,
+	VulkanPipelineState::Pointer ps = _private->pipelineCache.find(pass->identifier(), vs->vertexDeclaration(), program,
 		config.depthState, config.blendState, config.cullMode, vs->primitiveType());
 
 	if (ps.invalid())
@@ -351,7 +355,7 @@ PipelineState::Pointer VulkanRenderer::acquireGraphicsPipeline(const RenderPass:
 		ps->setDepthState(config.depthState);
 		ps->setBlendState(config.blendState);
 		ps->setCullMode(config.cullMode);
-		ps->setProgram(config.program);
+		ps->setProgram(program);
 		ps->build(pass);
 
 		_private->pipelineCache.addToCache(pass, ps);
@@ -471,6 +475,7 @@ void VulkanRendererPrivate::presentFrame(VulkanRenderer* renderer, FrameInternal
 	});
 
 	renderer->sharedConstantBuffer().flush(frame->frame.continuousNumber);
+	renderer->sharedGeometryBuffer().flush(frame->frame.continuousNumber);
 
 	size_t maxQueueSize = 2 * (1 + std::min(32ull, sqr(passes.size())));
 	allSubmits.clear();
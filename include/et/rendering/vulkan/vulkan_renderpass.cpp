@@ -26,12 +26,23 @@ public:
 	struct PassInternal : public VulkanNativeRenderPass::Content
 	{
 		Vector<Object::Pointer> usedObjects;
+		Buffer::Pointer indirectBuffer;
+		uint64_t indirectBufferOffset = 0;
 		uint64_t beginTime = 0;
 		uint32_t beginQueryIndex = 0;
 		uint64_t endTime = 0;
 		uint32_t endQueryIndex = 0;
 	};
 
+	/*
+	 * Instance data is bound as a fixed range of the shared constant buffer,
+	 * larger draw lists are split into several bindings
+	 */
+	enum : uint32_t
+	{
+		DrawInstancesPerBinding = 512
+	};
+
 public:
 	VulkanRenderPassPrivate(VulkanState& v, VulkanRenderer* r)
 		: vulkan(v), renderer(r) {
@@ -54,6 +65,9 @@ public:
 
 	ConstantBufferEntry::Pointer buildObjectVariables(const VulkanProgram::Pointer& program);
 	void generateDynamicDescriptorSet(RenderPass* pass);
+	uint64_t uploadIndirectCommands(RenderPass* pass, const Vector<DrawIndexedIndirectCommand>& commands);
+	void uploadDrawInstances(const Vector<DrawInstanceData>& instances, Vector<ConstantBufferEntry::Pointer>& bindings);
+	void drawCommand(const DrawIndexedIndirectCommand& command, bool indexed);
 
 	PassInternal& currentContent() {
 		ET_ASSERT(buildingFrame.identifier != 0);
@@ -216,6 +230,7 @@ void VulkanRenderPass::begin(const RendererFrame& frame, const RenderPassBeginIn
 	VulkanRenderPassPrivate::PassInternal& internals = _private->currentContent();
 	internals.beginTime = queryCurrentTimeInMicroSeconds();
 	internals.usedObjects.clear();
+	internals.indirectBufferOffset = 0;
 
 	VulkanSwapchain::SwapchainFrame& swapchainFrame = _private->vulkan.swapchain.mutableFrame(_private->buildingFrame.index());
 
@@ -369,6 +384,113 @@ void VulkanRenderPass::nextSubpass() {
 void VulkanRenderPass::pushRenderBatch(const MaterialInstance::Pointer& inMaterial, const VertexStream::Pointer& vertexStream, uint32_t first, uint32_t count) {
 	ET_ASSERT(_private->recording);
 
+	if (!bindRenderState(inMaterial, vertexStream))
+		return;
+
+	uint32_t baseVertex = vertexStream.valid() ? vertexStream->baseVertex() : 0;
+	VkCommandBuffer commandBuffer = _private->currentContent().commandBuffer;
+	if (vertexStream.valid() && vertexStream->indexBuffer().valid())
+		vkCmdDrawIndexed(commandBuffer, count, 1, first + vertexStream->firstIndex(), static_cast<int32_t>(baseVertex), 0);
+	else
+		vkCmdDraw(commandBuffer, count, 1, first + baseVertex, 0);
+}
+
+void VulkanRenderPass::pushDrawList(const DrawList::Pointer& drawList) {
+	ET_ASSERT(_private->recording);
+
+	if (drawList->empty())
+		return;
+
+	const Vector<DrawIndexedIndirectCommand>& commands = drawList->commands();
+	const Vector<DrawInstanceData>& instances = drawList->instances();
+
+	Vector<ConstantBufferEntry::Pointer> instanceBindings;
+	_private->uploadDrawInstances(instances, instanceBindings);
+
+	/*
+	 * Indirect commands could start from non-zero instance only if supported by device,
+	 * otherwise commands are issued as direct draws
+	 */
+	bool indirectSupported = _private->vulkan.physicalDeviceFeatures.drawIndirectFirstInstance == VK_TRUE;
+	bool multiDrawSupported = _private->vulkan.physicalDeviceFeatures.multiDrawIndirect == VK_TRUE;
+	uint32_t maxDrawCount = multiDrawSupported ? std::max(1u, _private->vulkan.physicalDeviceProperties.limits.maxDrawIndirectCount) : 1;
+	uint64_t baseOffset = indirectSupported ? _private->uploadIndirectCommands(this, commands) : 0;
+
+	VulkanRenderPassPrivate::PassInternal& content = _private->currentContent();
+	VkCommandBuffer commandBuffer = content.commandBuffer;
+
+	const uint64_t commandStride = sizeof(DrawIndexedIndirectCommand);
+	const uint32_t instancesPerBinding = VulkanRenderPassPrivate::DrawInstancesPerBinding;
+	for (const DrawList::Group& group : drawList->groups())
+	{
+		bool indexed = group.vertexStream.valid() && group.vertexStream->indexBuffer().valid();
+		uint32_t groupEnd = group.firstCommand + group.commandCount;
+
+		/*
+		 * Commands of the group are ordered by instance, and split into runs
+		 * reading instance data from the same binding of the instances buffer
+		 */
+		uint32_t runBegin = group.firstCommand;
+		while (runBegin < groupEnd)
+		{
+			uint32_t binding = commands[runBegin].firstInstance / instancesPerBinding;
+			uint32_t runEnd = runBegin + 1;
+			while ((runEnd < groupEnd) && (commands[runEnd].firstInstance / instancesPerBinding == binding))
+				++runEnd;
+
+			bool drawInstancesEnabled = false;
+			loadSharedVariablesFromDrawInstance(instances.at(commands[runBegin].firstInstance));
+			if (!bindRenderState(group.material, group.vertexStream, instanceBindings.at(binding).pointer(), &drawInstancesEnabled))
+				break;
+
+			if (!drawInstancesEnabled)
+			{
+				/*
+				 * Program takes transforms from object variables only,
+				 * so they are updated (and state is rebound) whenever instance changes
+				 */
+				for (uint32_t i = runBegin; i < runEnd; ++i)
+				{
+					if ((i > runBegin) && (commands[i].firstInstance != commands[i - 1].firstInstance))
+					{
+						loadSharedVariablesFromDrawInstance(instances.at(commands[i].firstInstance));
+						bindRenderState(group.material, group.vertexStream);
+					}
+					DrawIndexedIndirectCommand command = commands[i];
+					command.firstInstance = 0;
+					_private->drawCommand(command, indexed);
+				}
+			}
+			else if (!indexed || !indirectSupported)
+			{
+				for (uint32_t i = runBegin; i < runEnd; ++i)
+				{
+					DrawIndexedIndirectCommand command = commands[i];
+					command.firstInstance %= instancesPerBinding;
+					_private->drawCommand(command, indexed);
+				}
+			}
+			else
+			{
+				VkBuffer indirectBuffer = VulkanBuffer::Pointer(content.indirectBuffer)->nativeBuffer().buffer;
+				uint32_t commandsRemaining = runEnd - runBegin;
+				uint64_t offset = baseOffset + runBegin * commandStride;
+				while (commandsRemaining > 0)
+				{
+					uint32_t drawCount = std::min(commandsRemaining, maxDrawCount);
+					vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, offset, drawCount, static_cast<uint32_t>(commandStride));
+					offset += drawCount * commandStride;
+					commandsRemaining -= drawCount;
+				}
+			}
+
+			runBegin = runEnd;
+		}
+	}
+}
+
+bool VulkanRenderPass::bindRenderState(const MaterialInstance::Pointer& inMaterial, const VertexStream::Pointer& vertexStream,
+	const ConstantBufferEntry* drawInstances, bool* drawInstancesEnabled) {
 	VulkanPipelineState::Pointer pipelineState;
 	{
 		InstusivePointerScope<VulkanRenderPass> scope(this);
@@ -377,7 +499,10 @@ void VulkanRenderPass::pushRenderBatch(const MaterialInstance::Pointer& inMateri
 	}
 
 	if (pipelineState->nativePipeline().pipeline == nullptr)
-		return;
+		return false;
+
+	if (drawInstancesEnabled != nullptr)
+		*drawInstancesEnabled = pipelineState->program()->reflection().drawInstancesBufferEnabled;
 
 	bool hasVertexBuffer = vertexStream.valid() && vertexStream->vertexBuffer().valid();
 	bool hasIndexBuffer = vertexStream.valid() && vertexStream->indexBuffer().valid();
@@ -411,7 +536,8 @@ void VulkanRenderPass::pushRenderBatch(const MaterialInstance::Pointer& inMateri
 
 	uint32_t dynamicOffsets[DescriptorSetClass::DynamicDescriptorsCount] = {
 		static_cast<uint32_t>(objectVariables != nullptr ? objectVariables->offset() : 0),
-		static_cast<uint32_t>(materialVariables != nullptr ? materialVariables->offset() : 0)
+		static_cast<uint32_t>(materialVariables != nullptr ? materialVariables->offset() : 0),
+		static_cast<uint32_t>(drawInstances != nullptr ? drawInstances->offset() : 0)
 	};
 
 	ET_ASSERT(_private->renderPassStarted);
@@ -438,12 +564,9 @@ void VulkanRenderPass::pushRenderBatch(const MaterialInstance::Pointer& inMateri
 
 		VkIndexType indexType = vulkan::indexBufferFormat(vertexStream->indexArrayFormat());
 		vkCmdBindIndexBuffer(commandBuffer, indexBuffer->nativeBuffer().buffer, 0, indexType);
-		vkCmdDrawIndexed(commandBuffer, count, 1, first, 0, 0);
-	}
-	else
-	{
-		vkCmdDraw(commandBuffer, count, 1, first, 0);
 	}
+
+	return true;
 }
 
 void VulkanRenderPass::dispatchCompute(const Compute::Pointer& compute, const vec3i& dim) {
@@ -475,7 +598,8 @@ void VulkanRenderPass::dispatchCompute(const Compute::Pointer& compute, const ve
 
 	uint32_t dynamicOffsets[DescriptorSetClass::DynamicDescriptorsCount] = {
 		static_cast<uint32_t>(objectVariables.valid() ? objectVariables->offset() : 0),
-		static_cast<uint32_t>(materialVariables.valid() ? materialVariables->offset() : 0)
+		static_cast<uint32_t>(materialVariables.valid() ? materialVariables->offset() : 0),
+		0
 	};
 
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, vulkanCompute->nativeCompute().pipeline);
@@ -635,12 +759,85 @@ bool VulkanRenderPass::fillStatistics(uint64_t frameIndex, uint64_t* buffer, Ren
 /*
  * Private implementation
  */
+uint64_t VulkanRenderPassPrivate::uploadIndirectCommands(RenderPass* pass, const Vector<DrawIndexedIndirectCommand>& commands) {
+	const uint64_t MinimalIndirectBufferSize = 64 * 1024;
+	uint64_t dataSize = commands.size() * sizeof(DrawIndexedIndirectCommand);
+
+	PassInternal& content = currentContent();
+	if (content.indirectBuffer.invalid() || (content.indirectBufferOffset + dataSize > content.indirectBuffer->size()))
+	{
+		/*
+		 * Buffer could be still referenced by the commands recorded in this frame,
+		 * so it's kept alive with the rest of used objects and replaced with a larger one
+		 */
+		uint64_t requiredSize = std::max(MinimalIndirectBufferSize, dataSize);
+		if (content.indirectBuffer.valid())
+		{
+			content.usedObjects.emplace_back(content.indirectBuffer);
+			requiredSize = std::max(requiredSize, 2 * content.indirectBuffer->size());
+		}
+
+		Buffer::Description desc;
+		desc.size = requiredSize;
+		desc.usage = Buffer::Usage::Indirect;
+		desc.location = Buffer::Location::Host;
+		content.indirectBuffer = renderer->createBuffer(pass->info().name + "-indirect", desc);
+		content.indirectBufferOffset = 0;
+	}
+
+	/*
+	 * Instance index is relative to the binding of the instances buffer, see uploadDrawInstances
+	 */
+	uint64_t offset = content.indirectBufferOffset;
+	DrawIndexedIndirectCommand* mapped = reinterpret_cast<DrawIndexedIndirectCommand*>(content.indirectBuffer->map(offset, dataSize));
+	memcpy(mapped, commands.data(), dataSize);
+	for (size_t i = 0, e = commands.size(); i < e; ++i)
+		mapped[i].firstInstance %= DrawInstancesPerBinding;
+	content.indirectBuffer->modifyRange(offset, dataSize);
+	content.indirectBuffer->unmap();
+
+	content.indirectBufferOffset = offset + dataSize;
+	return offset;
+}
+
+void VulkanRenderPassPrivate::uploadDrawInstances(const Vector<DrawInstanceData>& instances, Vector<ConstantBufferEntry::Pointer>& bindings) {
+	const uint64_t bindingSize = DrawInstancesPerBinding * sizeof(DrawInstanceData);
+
+	PassInternal& content = currentContent();
+	for (size_t first = 0, e = instances.size(); first < e; first += DrawInstancesPerBinding)
+	{
+		/*
+		 * Whole binding range is allocated, since descriptor reads fixed range from the dynamic offset
+		 */
+		size_t count = std::min(static_cast<size_t>(DrawInstancesPerBinding), e - first);
+		ConstantBufferEntry::Pointer entry = renderer->sharedConstantBuffer().allocate(bindingSize, ConstantBufferDynamicAllocation);
+		memcpy(entry->data(), instances.data() + first, count * sizeof(DrawInstanceData));
+		content.usedObjects.emplace_back(entry);
+		bindings.emplace_back(entry);
+	}
+}
+
+void VulkanRenderPassPrivate::drawCommand(const DrawIndexedIndirectCommand& command, bool indexed) {
+	VkCommandBuffer commandBuffer = currentContent().commandBuffer;
+	if (indexed)
+	{
+		vkCmdDrawIndexed(commandBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+	}
+	else
+	{
+		uint32_t firstVertex = command.firstIndex + static_cast<uint32_t>(command.vertexOffset);
+		vkCmdDraw(commandBuffer, command.indexCount, command.instanceCount, firstVertex, command.firstInstance);
+	}
+}
+
 void VulkanRenderPassPrivate::generateDynamicDescriptorSet(RenderPass* pass) {
-	VkDescriptorSetLayoutBinding bindings[] = { {},{} };
+	VkDescriptorSetLayoutBinding bindings[] = { {},{},{} };
 	bindings[0] = { ObjectVariablesBufferIndex, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 };
 	bindings[0].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
 	bindings[1] = { MaterialVariablesBufferIndex, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 };
 	bindings[1].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[2] = { DrawInstancesBufferIndex, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1 };
+	bindings[2].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
 
 	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
 	descriptorSetLayoutCreateInfo.bindingCount = sizeof(bindings) / sizeof(bindings[0]);
@@ -650,6 +847,7 @@ void VulkanRenderPassPrivate::generateDynamicDescriptorSet(RenderPass* pass) {
 	VulkanBuffer::Pointer cb = renderer->sharedConstantBuffer().buffer();
 	VkDescriptorBufferInfo objectBufferInfo = { cb->nativeBuffer().buffer, 0, sizeof(mat4) * ObjectVariable_max };
 	VkDescriptorBufferInfo materialBufferInfo = { cb->nativeBuffer().buffer, 0, sizeof(mat4) * MaterialVariable_max };
+	VkDescriptorBufferInfo drawInstancesBufferInfo = { cb->nativeBuffer().buffer, 0, DrawInstancesPerBinding * sizeof(DrawInstanceData) };
 
 	VkDescriptorSetAllocateInfo descriptorAllocInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
 	descriptorAllocInfo.pSetLayouts = &dynamicDescriptorSetLayout;
@@ -657,7 +855,7 @@ void VulkanRenderPassPrivate::generateDynamicDescriptorSet(RenderPass* pass) {
 	descriptorAllocInfo.descriptorSetCount = 1;
 	VULKAN_CALL(vkAllocateDescriptorSets(vulkan.device, &descriptorAllocInfo, &dynamicDescriptorSet));
 
-	VkWriteDescriptorSet writeSets[] = { { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET },{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET } };
+	VkWriteDescriptorSet writeSets[] = { { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET },{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET },{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET } };
 	{
 		writeSets[0].descriptorCount = bindings[0].descriptorCount;
 		writeSets[0].descriptorType = bindings[0].descriptorType;
@@ -669,6 +867,11 @@ void VulkanRenderPassPrivate::generateDynamicDescriptorSet(RenderPass* pass) {
 		writeSets[1].dstBinding = bindings[1].binding;
 		writeSets[1].pBufferInfo = &materialBufferInfo;
 		writeSets[1].dstSet = dynamicDescriptorSet;
+		writeSets[2].descriptorCount = bindings[2].descriptorCount;
+		writeSets[2].descriptorType = bindings[2].descriptorType;
+		writeSets[2].dstBinding = bindings[2].binding;
+		writeSets[2].pBufferInfo = &drawInstancesBufferInfo;
+		writeSets[2].dstSet = dynamicDescriptorSet;
 	}
 	uint32_t writeSetsCount = static_cast<uint32_t>(sizeof(writeSets) / sizeof(writeSets[0]));
 	vkUpdateDescriptorSets(vulkan.device, writeSetsCount, writeSets, 0, nullptr);
@@ -29,6 +29,7 @@ public:
 	const VulkanNativeRenderPass::Content& nativeRenderPassContent() const;
 
 	void pushRenderBatch(const MaterialInstance::Pointer&, const VertexStream::Pointer&, uint32_t, uint32_t) override;
+	void pushDrawList(const DrawList::Pointer&) override;
 	void pushImageBarrier(const Texture::Pointer&, const ResourceBarrier&) override;
 	void copyImage(const Texture::Pointer&, const Texture::Pointer&, const CopyDescriptor&) override;
 	void copyImageToBuffer(const Texture::Pointer&, const Buffer::Pointer&, const CopyDescriptor&) override;
@@ -44,6 +45,8 @@ public:
 	
 private:
 	ConstantBufferEntry::Pointer VulkanRenderPass::buildObjectVariables(const VulkanProgram::Pointer&);
+	bool bindRenderState(const MaterialInstance::Pointer&, const VertexStream::Pointer&,
+		const ConstantBufferEntry* drawInstances = nullptr, bool* drawInstancesEnabled = nullptr);
 
 private:
 	ET_DECLARE_PIMPL(VulkanRenderPass, 4096);
@@ -21,7 +21,22 @@ Animation::Animation(Dictionary)
 
 void Animation::addKeyFrame(float t, const vec3& tr, const quaternion& o, const vec3& s)
 {
-	_frames.emplace_back(t, tr, o, s);
+	/*
+	 * Frames are kept sorted by time, usually they are added in order
+	 */
+	auto pos = std::upper_bound(_times.begin(), _times.end(), t);
+	size_t index = static_cast<size_t>(pos - _times.begin());
+
+	_times.insert(pos, t);
+	_translations.insert(_translations.begin() + index, tr);
+	_orientations.insert(_orientations.begin() + index, o);
+	_scales.insert(_scales.begin() + index, s);
+}
+
+Animation::Frame Animation::frame(uint32_t index) const
+{
+	ET_ASSERT(index < frameCount());
+	return Frame(_times[index], _translations[index], _orientations[index], _scales[index]);
 }
 
 void Animation::setTimeRange(float start, float stop)
@@ -36,32 +51,23 @@ void Animation::setFrameRate(float r)
 	_frameRate = r;
 }
 
-void Animation::transformation(float time, vec3& t, quaternion& o, vec3& s) const
+float Animation::wrapTime(float time, float start, float stop, OutOfRangeMode mode)
 {
-	float d = duration();
+	float d = stop - start;
 	
-	if (d == 0.0f)
-	{
-		auto mainTransform = _frames.front();
-		t = mainTransform.translation;
-		o = mainTransform.orientation;
-		s = mainTransform.scale;
-		return;
-	}
-	
-	switch (_outOfRangeMode)
+	switch (mode)
 	{
 		case OutOfRangeMode_Loop:
 		{
 			float timeAspect = time / d;
-			time = _startTime + d * (timeAspect - std::floor(timeAspect));
+			time = start + d * (timeAspect - std::floor(timeAspect));
 			break;
 		}
 			
 		case OutOfRangeMode_PingPong:
 		{
 			float timeAspect = time / d;
-			time = _startTime + d * (1.0f - 2.0f * std::abs(0.5f * (timeAspect - 1.0f) - std::floor(0.5f * timeAspect)));
+			time = start + d * (1.0f - 2.0f * std::abs(0.5f * (timeAspect - 1.0f) - std::floor(0.5f * timeAspect)));
 			break;
 		}
 			
@@ -69,46 +75,112 @@ void Animation::transformation(float time, vec3& t, quaternion& o, vec3& s) cons
 			break;
 	}
 	
-	time = clamp(time, _startTime, _stopTime);
+	return clamp(time, start, stop);
+}
 	
-	int nearestLowerFrame = static_cast<int32_t>(_frames.size()) - 1;
-	for (auto i = _frames.rbegin(), e = _frames.rend(); (i != e) && (nearestLowerFrame >= 0); ++i)
+uint32_t Animation::findFrame(float time, Cursor* cursor) const
+{
+	/*
+	 * Returns last frame with time not greater than requested one (or the first frame).
+	 * With monotonic playback time cursor points to the same or to the next frame,
+	 * otherwise falls back to the binary search
+	 */
+	uint32_t lastFrame = frameCount() - 1;
+	if (cursor != nullptr)
 	{
-		if (i->time <= time) break;
-		--nearestLowerFrame;
+		uint32_t f = cursor->frame;
+		if ((f <= lastFrame) && (_times[f] <= time))
+		{
+			if ((f == lastFrame) || (time < _times[f + 1]))
+				return f;
+
+			if ((f + 1 == lastFrame) || (time < _times[f + 2]))
+				return (cursor->frame = f + 1);
+		}
 	}
 	
-	if (static_cast<size_t>(nearestLowerFrame + 1) >= _frames.size())
+	auto upper = std::upper_bound(_times.begin(), _times.end(), time);
+	uint32_t result = (upper == _times.begin()) ? 0 : static_cast<uint32_t>(upper - _times.begin()) - 1;
+
+	if (cursor != nullptr)
+		cursor->frame = result;
+
+	return result;
+}
+
+void Animation::sample(float time, Cursor* cursor, vec3& t, quaternion& o, vec3& s) const
+{
+	ET_ASSERT(!_times.empty());
+
+	if (duration() == 0.0f)
 	{
-		const auto& frame = _frames.at(nearestLowerFrame);
-		t = frame.translation;
-		o = frame.orientation;
-		s = frame.scale;
+		t = _translations.front();
+		o = _orientations.front();
+		s = _scales.front();
+		return;
+	}
+	
+	time = wrapTime(time, _startTime, _stopTime, _outOfRangeMode);
+	
+	uint32_t lower = findFrame(time, cursor);
+	uint32_t upper = lower + 1;
+	if (upper >= frameCount())
+	{
+		t = _translations[lower];
+		o = _orientations[lower];
+		s = _scales[lower];
 	}
 	else
 	{
-		const auto& lowerFrame = _frames.at(nearestLowerFrame);
-		const auto& upperFrame = _frames.at(nearestLowerFrame + 1);
-		float interolationFactor = (time - lowerFrame.time) / (upperFrame.time - lowerFrame.time);
-		t = mix(lowerFrame.translation, upperFrame.translation, interolationFactor);
-		o = slerp(lowerFrame.orientation, upperFrame.orientation, interolationFactor);
-		s = mix(lowerFrame.scale, upperFrame.scale, interolationFactor);
+		float dt = _times[upper] - _times[lower];
+		float interolationFactor = (dt > 0.0f) ? clamp((time - _times[lower]) / dt, 0.0f, 1.0f) : 0.0f;
+		t = mix(_translations[lower], _translations[upper], interolationFactor);
+		o = slerp(_orientations[lower], _orientations[upper], interolationFactor);
+		s = mix(_scales[lower], _scales[upper], interolationFactor);
 	}
 }
 
+void Animation::transformation(float time, vec3& t, quaternion& o, vec3& s) const
+{
+	sample(time, nullptr, t, o, s);
+}
+
+void Animation::transformation(float time, Cursor& cursor, vec3& t, quaternion& o, vec3& s) const
+{
+	sample(time, &cursor, t, o, s);
+}
+
 mat4 Animation::transformation(float time) const
+{
+	Cursor cursor;
+	return transformation(time, cursor);
+}
+
+mat4 Animation::transformation(float time, Cursor& cursor) const
 {
 	vec3 t(0.0f);
 	vec3 s(0.0f);
 	quaternion o;
 
-	transformation(time, t, o, s);
+	sample(time, &cursor, t, o, s);
 	
-	ComponentTransformable result;
-	result.setTranslation(t);
-	result.setOrientation(o);
-	result.setScale(s);
-	return result.transform();
+	mat4 result = o.toMatrix() * scaleMatrix(s);
+	result[3] = vec4(t, 1.0f);
+	return result;
+}
+
+void Animation::evaluate(float time, const Vector<const Animation*>& animations, Vector<Cursor>& cursors,
+	Vector<mat4>& transformations)
+{
+	size_t count = animations.size();
+	cursors.resize(count);
+	transformations.resize(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Animation* a = animations[i];
+		transformations[i] = ((a == nullptr) || a->_times.empty()) ? identityMatrix : a->transformation(time, cursors[i]);
+	}
 }
 
 void Animation::setOutOfRangeMode(OutOfRangeMode mode)
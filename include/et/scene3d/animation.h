@@ -31,6 +31,15 @@ public:
 			time(t), translation(tr), orientation(o), scale(s) { }
 	};
 	
+	/*
+	 * Keeps last sampled frame of the playback, so sampling with monotonic
+	 * time does not need to search for the frames
+	 */
+	struct Cursor
+	{
+		uint32_t frame = 0;
+	};
+
 	enum OutOfRangeMode
 	{
 		OutOfRangeMode_Loop,
@@ -44,9 +53,22 @@ public:
 	
 	void addKeyFrame(float, const vec3&, const quaternion&, const vec3&);
 	
+	uint32_t frameCount() const
+		{ return static_cast<uint32_t>(_times.size()); }
+
+	Frame frame(uint32_t) const;
+
 	mat4 transformation(float) const;
+	mat4 transformation(float, Cursor&) const;
 	
 	void transformation(float, vec3&, quaternion&, vec3&) const;
+	void transformation(float, Cursor&, vec3&, quaternion&, vec3&) const;
+
+	/*
+	 * Evaluates several animations (e.g. bones of the skeleton) at the same time,
+	 * cursors and transformations are resized to match animations
+	 */
+	static void evaluate(float, const Vector<const Animation*>&, Vector<Cursor>&, Vector<mat4>&);
 				
 	void setTimeRange(float, float);
 	
@@ -66,8 +88,23 @@ public:
 	float duration() const
 		{ return _stopTime - _startTime; }
 	
+	float frameRate() const
+		{ return _frameRate; }
+
+	/*
+	 * Maps playback time into [start, stop] range according to out of range mode
+	 */
+	static float wrapTime(float time, float start, float stop, OutOfRangeMode);
+
+private:
+	uint32_t findFrame(float, Cursor*) const;
+	void sample(float, Cursor*, vec3&, quaternion&, vec3&) const;
+
 private:
-	Vector<Frame> _frames;
+	Vector<float> _times;
+	Vector<vec3> _translations;
+	Vector<quaternion> _orientations;
+	Vector<vec3> _scales;
 	
 	float _startTime = 0.0f;
 	float _stopTime = 0.0f;
@@ -0,0 +1,449 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/core/threading.h>
+#include <et/app/application.h>
+#include <et/scene3d/animationsystem.h>
+
+namespace et
+{
+namespace s3d
+{
+
+namespace as_local
+{
+
+inline quaternion alignedTo(const quaternion& q, const quaternion& reference)
+{
+	return (dot(q.vector, reference.vector) + q.scalar * reference.scalar < 0.0f) ? -q : q;
+}
+
+inline quaternion nlerp(const quaternion& from, const quaternion& to, float t)
+{
+	return normalize(from * (1.0f - t) + alignedTo(to, from) * t);
+}
+
+}
+
+AnimationSystem& sharedAnimationSystem()
+{
+	static AnimationSystem system;
+	return system;
+}
+
+void AnimationSystem::Pose::resize(size_t count)
+{
+	translations.resize(count);
+	orientations.resize(count);
+	scales.resize(count);
+}
+
+AnimationSystem::AnimationSystem()
+{
+	_timer.expired.connect([this](NotifyTimer* timer)
+	{
+		float t = timer->actualTime();
+		update(t - _lastUpdateTime);
+		_lastUpdateTime = t;
+	});
+}
+
+AnimationSystem::Handle AnimationSystem::addSkeleton(BaseElement::Pointer root)
+{
+	Handle handle = InvalidHandle;
+	if (_freeHandles.empty())
+	{
+		handle = static_cast<Handle>(_skeletons.size());
+		_skeletons.emplace_back();
+	}
+	else
+	{
+		handle = _freeHandles.back();
+		_freeHandles.pop_back();
+	}
+
+	Skeleton& s = _skeletons[handle];
+	s = Skeleton();
+	s.active = true;
+
+	Vector<BaseElement::Pointer> stack(1, root);
+	while (!stack.empty())
+	{
+		BaseElement::Pointer bone = stack.back();
+		stack.pop_back();
+		s.bones.emplace_back(bone);
+		for (auto i = bone->children().rbegin(), e = bone->children().rend(); i != e; ++i)
+			stack.emplace_back(*i);
+	}
+
+	size_t bonesCount = s.bones.size();
+	size_t clipsCount = 0;
+	for (const BaseElement::Pointer& bone : s.bones)
+		clipsCount = std::max(clipsCount, bone->animations().size());
+
+	s.restPose.resize(bonesCount);
+	for (size_t b = 0; b < bonesCount; ++b)
+	{
+		s.restPose.translations[b] = s.bones[b]->translation();
+		s.restPose.orientations[b] = s.bones[b]->orientation();
+		s.restPose.scales[b] = s.bones[b]->scale();
+	}
+
+	s.animatedBones.resize(bonesCount);
+	for (size_t b = 0; b < bonesCount; ++b)
+		s.animatedBones[b] = !s.bones[b]->animations().empty();
+
+	s.clips.resize(clipsCount);
+	s.referencePoses.resize(clipsCount);
+	for (size_t c = 0; c < clipsCount; ++c)
+	{
+		s.clips[c].resize(bonesCount);
+		for (size_t b = 0; b < bonesCount; ++b)
+		{
+			const Vector<Animation>& animations = s.bones[b]->animations();
+			if ((c < animations.size()) && (animations[c].frameCount() > 0))
+				s.clips[c][b].animation = &animations[c];
+		}
+		buildReferencePose(s, c);
+	}
+
+	s.pose = s.restPose;
+	s.layers.emplace_back();
+	return handle;
+}
+
+void AnimationSystem::buildReferencePose(Skeleton& s, size_t clip)
+{
+	Pose& reference = s.referencePoses[clip];
+	reference = s.restPose;
+	for (size_t b = 0, e = s.bones.size(); b < e; ++b)
+	{
+		const ClipTrack& track = s.clips[clip][b];
+		if (track.empty())
+			continue;
+
+		Animation::Cursor cursor;
+		CompressedAnimation::Cursor compressedCursor;
+		track.sample(track.startTime(), cursor, compressedCursor,
+			reference.translations[b], reference.orientations[b], reference.scales[b]);
+	}
+}
+
+void AnimationSystem::ClipTrack::sample(float time, Animation::Cursor& cursor,
+	CompressedAnimation::Cursor& compressedCursor, vec3& t, quaternion& o, vec3& s) const
+{
+	if (compressed != nullptr)
+		compressed->transformation(time, compressedCursor, t, o, s);
+	else
+		animation->transformation(time, cursor, t, o, s);
+}
+
+void AnimationSystem::compressClips(Handle handle, const CompressedAnimation::Options& options)
+{
+	Skeleton& s = skeleton(handle);
+
+	/*
+	 * Storage is reserved up front, tracks keep pointers to the compressed animations
+	 */
+	size_t tracksCount = 0;
+	for (const Vector<ClipTrack>& clip : s.clips)
+	{
+		for (const ClipTrack& track : clip)
+			tracksCount += (track.animation != nullptr) ? 1 : 0;
+	}
+
+	s.compressedAnimations.clear();
+	s.compressedAnimations.reserve(tracksCount);
+	for (size_t c = 0, e = s.clips.size(); c < e; ++c)
+	{
+		for (ClipTrack& track : s.clips[c])
+		{
+			if (track.animation != nullptr)
+			{
+				s.compressedAnimations.emplace_back(*track.animation, options);
+				track.compressed = &s.compressedAnimations.back();
+			}
+		}
+		buildReferencePose(s, c);
+	}
+}
+
+uint32_t AnimationSystem::addClip(Handle handle, const Vector<const CompressedAnimation*>& animations)
+{
+	Skeleton& s = skeleton(handle);
+	ET_ASSERT(animations.size() == s.bones.size());
+
+	s.clips.emplace_back(s.bones.size());
+	s.referencePoses.emplace_back();
+	for (size_t b = 0, e = s.bones.size(); b < e; ++b)
+	{
+		if (animations[b] != nullptr)
+		{
+			s.clips.back()[b].compressed = animations[b];
+			s.animatedBones[b] = true;
+		}
+	}
+
+	uint32_t clip = static_cast<uint32_t>(s.clips.size() - 1);
+	buildReferencePose(s, clip);
+	return clip;
+}
+
+void AnimationSystem::removeSkeleton(Handle handle)
+{
+	skeleton(handle) = Skeleton();
+	_freeHandles.emplace_back(handle);
+}
+
+AnimationSystem::Skeleton& AnimationSystem::skeleton(Handle handle)
+{
+	ET_ASSERT((handle < _skeletons.size()) && _skeletons[handle].active);
+	return _skeletons[handle];
+}
+
+const AnimationSystem::Skeleton& AnimationSystem::skeleton(Handle handle) const
+{
+	ET_ASSERT((handle < _skeletons.size()) && _skeletons[handle].active);
+	return _skeletons[handle];
+}
+
+uint32_t AnimationSystem::clipCount(Handle handle) const
+{
+	return static_cast<uint32_t>(skeleton(handle).clips.size());
+}
+
+const AnimationSystem::Pose& AnimationSystem::pose(Handle handle) const
+{
+	return skeleton(handle).pose;
+}
+
+const Vector<BaseElement::Pointer>& AnimationSystem::bones(Handle handle) const
+{
+	return skeleton(handle).bones;
+}
+
+uint32_t AnimationSystem::addLayer(Handle handle, LayerMode mode, float weight)
+{
+	Skeleton& s = skeleton(handle);
+	s.layers.emplace_back();
+	s.layers.back().mode = mode;
+	s.layers.back().weight = weight;
+	return static_cast<uint32_t>(s.layers.size() - 1);
+}
+
+void AnimationSystem::setLayerWeight(Handle handle, uint32_t layer, float weight)
+{
+	skeleton(handle).layers.at(layer).weight = weight;
+}
+
+AnimationSystem::ClipState* AnimationSystem::findClip(Handle handle, uint32_t layer, uint32_t clip)
+{
+	for (ClipState& state : skeleton(handle).layers.at(layer).clips)
+	{
+		if (state.clip == clip)
+			return &state;
+	}
+	return nullptr;
+}
+
+void AnimationSystem::play(Handle handle, uint32_t layer, uint32_t clip, float weight, float speed)
+{
+	Skeleton& s = skeleton(handle);
+	ET_ASSERT(clip < s.clips.size());
+
+	ClipState* state = findClip(handle, layer, clip);
+	if (state == nullptr)
+	{
+		s.layers.at(layer).clips.emplace_back();
+		state = &s.layers.at(layer).clips.back();
+	}
+
+	/*
+	 * Clip starts at start time of its first animated bone
+	 */
+	state->clip = clip;
+	state->weight = weight;
+	state->speed = speed;
+	state->time = 0.0f;
+	for (const ClipTrack& track : s.clips[clip])
+	{
+		if (!track.empty())
+		{
+			state->time = track.startTime();
+			break;
+		}
+	}
+	state->cursors.assign(s.bones.size(), Animation::Cursor());
+	state->compressedCursors.assign(s.bones.size(), CompressedAnimation::Cursor());
+}
+
+void AnimationSystem::setClipWeight(Handle handle, uint32_t layer, uint32_t clip, float weight)
+{
+	ClipState* state = findClip(handle, layer, clip);
+	if (state != nullptr)
+		state->weight = weight;
+}
+
+void AnimationSystem::stop(Handle handle, uint32_t layer, uint32_t clip)
+{
+	Vector<ClipState>& clips = skeleton(handle).layers.at(layer).clips;
+	clips.erase(std::remove_if(clips.begin(), clips.end(), [clip](const ClipState& state)
+		{ return state.clip == clip; }), clips.end());
+}
+
+void AnimationSystem::stopAll(Handle handle)
+{
+	for (Layer& layer : skeleton(handle).layers)
+		layer.clips.clear();
+}
+
+void AnimationSystem::start()
+{
+	_lastUpdateTime = 0.0f;
+	_timer.start(currentTimerPool(), 0.0f, NotifyTimer::RepeatForever);
+}
+
+void AnimationSystem::stop()
+{
+	_timer.cancelUpdates();
+}
+
+void AnimationSystem::update(float dt)
+{
+	Vector<Skeleton*> skeletons;
+	skeletons.reserve(_skeletons.size());
+	for (Skeleton& s : _skeletons)
+	{
+		if (s.active)
+			skeletons.emplace_back(&s);
+	}
+
+	threading::parallelFor(static_cast<uint32_t>(skeletons.size()), ParallelUpdateThreshold, [this, &skeletons, dt](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			advance(*skeletons[i], dt);
+			evaluate(*skeletons[i]);
+		}
+	});
+
+	/*
+	 * Bones are updated sequentially, since they share transform hierarchy
+	 */
+	for (Skeleton* s : skeletons)
+		apply(*s);
+}
+
+void AnimationSystem::advance(Skeleton& s, float dt)
+{
+	for (Layer& layer : s.layers)
+	{
+		for (ClipState& state : layer.clips)
+			state.time += dt * state.speed;
+	}
+}
+
+void AnimationSystem::evaluate(Skeleton& s)
+{
+	s.pose = s.restPose;
+
+	for (Layer& layer : s.layers)
+	{
+		if ((layer.weight <= 0.0f) || layer.clips.empty())
+			continue;
+
+		evaluateLayer(s, layer);
+	}
+}
+
+void AnimationSystem::evaluateLayer(Skeleton& s, Layer& layer)
+{
+	float totalWeight = 0.0f;
+	for (const ClipState& state : layer.clips)
+		totalWeight += std::max(0.0f, state.weight);
+
+	if (totalWeight <= 0.0f)
+		return;
+
+	size_t bonesCount = s.bones.size();
+	bool additive = (layer.mode == LayerMode::Additive);
+
+	s.layerPose.resize(bonesCount);
+	std::fill(s.layerPose.translations.begin(), s.layerPose.translations.end(), vec3(0.0f));
+	std::fill(s.layerPose.orientations.begin(), s.layerPose.orientations.end(), quaternion(0.0f, 0.0f, 0.0f, 0.0f));
+	std::fill(s.layerPose.scales.begin(), s.layerPose.scales.end(), vec3(0.0f));
+
+	/*
+	 * Weighted sum of clips, orientations are accumulated in the hemisphere of the current pose
+	 * (or identity, for additive layers) and normalized. Additive clips are taken relative to their
+	 * reference pose: translation difference, scale ratio and rotation from reference
+	 */
+	for (ClipState& state : layer.clips)
+	{
+		if (state.weight <= 0.0f)
+			continue;
+
+		float w = state.weight / totalWeight;
+		const Vector<ClipTrack>& tracks = s.clips[state.clip];
+		const Pose& reference = s.referencePoses[state.clip];
+		for (size_t b = 0; b < bonesCount; ++b)
+		{
+			vec3 t = s.restPose.translations[b];
+			quaternion o = s.restPose.orientations[b];
+			vec3 sc = s.restPose.scales[b];
+			if (!tracks[b].empty())
+				tracks[b].sample(state.time, state.cursors[b], state.compressedCursors[b], t, o, sc);
+
+			if (additive)
+			{
+				t -= reference.translations[b];
+				o = !reference.orientations[b] * o;
+				sc = sc / maxv(reference.scales[b], vec3(std::numeric_limits<float>::epsilon()));
+			}
+
+			const quaternion& hemisphere = additive ? quaternion() : s.pose.orientations[b];
+			s.layerPose.translations[b] += w * t;
+			s.layerPose.orientations[b] = s.layerPose.orientations[b] + as_local::alignedTo(o, hemisphere) * w;
+			s.layerPose.scales[b] += w * sc;
+		}
+	}
+
+	float lw = std::min(1.0f, layer.weight);
+	for (size_t b = 0; b < bonesCount; ++b)
+	{
+		quaternion o = normalize(s.layerPose.orientations[b]);
+		if (additive)
+		{
+			s.pose.translations[b] += lw * s.layerPose.translations[b];
+			s.pose.orientations[b] = normalize(s.pose.orientations[b] * as_local::nlerp(quaternion(), o, lw));
+			s.pose.scales[b] *= mix(vec3(1.0f), s.layerPose.scales[b], lw);
+		}
+		else
+		{
+			s.pose.translations[b] = mix(s.pose.translations[b], s.layerPose.translations[b], lw);
+			s.pose.orientations[b] = as_local::nlerp(s.pose.orientations[b], o, lw);
+			s.pose.scales[b] = mix(s.pose.scales[b], s.layerPose.scales[b], lw);
+		}
+	}
+}
+
+void AnimationSystem::apply(Skeleton& s)
+{
+	for (size_t b = 0, e = s.bones.size(); b < e; ++b)
+	{
+		if (!s.animatedBones[b])
+			continue;
+
+		BaseElement::Pointer& bone = s.bones[b];
+		mat4 m = s.pose.orientations[b].toMatrix() * scaleMatrix(s.pose.scales[b]);
+		m[3] = vec4(s.pose.translations[b], 1.0f);
+		bone->setAnimationTransform(m);
+	}
+}
+
+}
+}
@@ -0,0 +1,168 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/scene3d/baseelement.h>
+#include <et/scene3d/compressedanimation.h>
+
+namespace et
+{
+namespace s3d
+{
+/*
+ * Skeleton level animation playback: each skeleton has a pose buffer and layers of blended clips.
+ * Clip N of the skeleton is formed by N-th animations of its bones. All skeletons are evaluated
+ * in one pass, driven by a single timer, resulting local transforms are written to the bones.
+ * Clips could be sampled from compressed animations instead of the source ones
+ */
+class AnimationSystem
+{
+public:
+	using Handle = uint32_t;
+
+	enum : uint32_t
+	{
+		InvalidHandle = static_cast<uint32_t>(-1),
+		ParallelUpdateThreshold = 64,
+	};
+
+	enum class LayerMode : uint32_t
+	{
+		Override,
+		Additive
+	};
+
+	struct Pose
+	{
+		Vector<vec3> translations;
+		Vector<quaternion> orientations;
+		Vector<vec3> scales;
+
+		void resize(size_t);
+	};
+
+public:
+	AnimationSystem();
+
+	/*
+	 * Bones are the root and all its descendants, animations of the bones
+	 * should not be added or removed while skeleton is registered
+	 */
+	Handle addSkeleton(BaseElement::Pointer root);
+	void removeSkeleton(Handle);
+
+	/*
+	 * Replaces animations of the skeleton's clips with compressed ones, owned by the system
+	 */
+	void compressClips(Handle, const CompressedAnimation::Options& = CompressedAnimation::Options());
+
+	/*
+	 * Adds clip sampled from compressed animations, given per bone in order of bones()
+	 * (nullptr for bones not animated by the clip). Animations are not copied
+	 * and should outlive the skeleton. Returns index of the clip
+	 */
+	uint32_t addClip(Handle, const Vector<const CompressedAnimation*>&);
+
+	uint32_t clipCount(Handle) const;
+	const Pose& pose(Handle) const;
+	const Vector<BaseElement::Pointer>& bones(Handle) const;
+
+	/*
+	 * Layer 0 (override, weight 1) is created with the skeleton, layers are applied in order.
+	 * Clips of the additive layers are applied relative to their pose at start time
+	 */
+	uint32_t addLayer(Handle, LayerMode, float weight = 1.0f);
+	void setLayerWeight(Handle, uint32_t layer, float weight);
+
+	/*
+	 * Clips within a layer are blended with normalized weights
+	 */
+	void play(Handle, uint32_t layer, uint32_t clip, float weight = 1.0f, float speed = 1.0f);
+	void setClipWeight(Handle, uint32_t layer, uint32_t clip, float weight);
+	void stop(Handle, uint32_t layer, uint32_t clip);
+	void stopAll(Handle);
+
+	/*
+	 * Advances playback and evaluates all skeletons, large numbers of skeletons
+	 * are evaluated in parallel. Resulting poses are written to bones
+	 */
+	void update(float dt);
+
+	/*
+	 * Drives update from the current timer pool
+	 */
+	void start();
+	void stop();
+
+private:
+	struct ClipTrack
+	{
+		const Animation* animation = nullptr;
+		const CompressedAnimation* compressed = nullptr;
+
+		bool empty() const
+			{ return (animation == nullptr) && (compressed == nullptr); }
+
+		float startTime() const
+			{ return (compressed == nullptr) ? animation->startTime() : compressed->startTime(); }
+
+		void sample(float time, Animation::Cursor&, CompressedAnimation::Cursor&, vec3&, quaternion&, vec3&) const;
+	};
+
+	struct ClipState
+	{
+		uint32_t clip = 0;
+		float time = 0.0f;
+		float speed = 1.0f;
+		float weight = 1.0f;
+		Vector<Animation::Cursor> cursors;
+		Vector<CompressedAnimation::Cursor> compressedCursors;
+	};
+
+	struct Layer
+	{
+		Vector<ClipState> clips;
+		LayerMode mode = LayerMode::Override;
+		float weight = 1.0f;
+	};
+
+	struct Skeleton
+	{
+		Vector<BaseElement::Pointer> bones;
+		Vector<Vector<ClipTrack>> clips;
+		Vector<CompressedAnimation> compressedAnimations;
+		Vector<Pose> referencePoses;
+		Vector<bool> animatedBones;
+		Vector<Layer> layers;
+		Pose restPose;
+		Pose layerPose;
+		Pose pose;
+		bool active = false;
+	};
+
+	Skeleton& skeleton(Handle);
+	const Skeleton& skeleton(Handle) const;
+	ClipState* findClip(Handle, uint32_t layer, uint32_t clip);
+	void buildReferencePose(Skeleton&, size_t clip);
+
+	void advance(Skeleton&, float dt);
+	void evaluate(Skeleton&);
+	void evaluateLayer(Skeleton&, Layer&);
+	void apply(Skeleton&);
+
+private:
+	Vector<Skeleton> _skeletons;
+	Vector<Handle> _freeHandles;
+	NotifyTimer _timer;
+	float _lastUpdateTime = 0.0f;
+};
+
+AnimationSystem& sharedAnimationSystem();
+
+}
+}
@@ -15,6 +15,9 @@ using namespace et::s3d;
 BaseElement::BaseElement(const std::string& name, BaseElement* parent) :
 	ElementHierarchy(parent)
 {
+	_transformHandle = sharedTransformHierarchy().allocate((parent == nullptr) ?
+		TransformHierarchy::InvalidHandle : parent->transformHandle());
+
 	setName(name);
 	
 	_animationTimer.expired.connect([this](NotifyTimer* timer)
@@ -32,55 +35,53 @@ BaseElement::BaseElement(const std::string& name, BaseElement* parent) :
 	});
 }
 
+BaseElement::~BaseElement()
+{
+	sharedTransformHierarchy().release(_transformHandle);
+}
+
 void BaseElement::setParent(BaseElement* p)
 {
-	invalidateTransform();
+	sharedTransformHierarchy().setParent(_transformHandle, (p == nullptr) ?
+		TransformHierarchy::InvalidHandle : p->transformHandle());
 	ElementHierarchy::setParent(p);
+	transformInvalidated();
 }
 
+/*
+ * Only local transform of the element is updated here, descendants are updated
+ * by the transform hierarchy on the next update or access to their final transforms
+ */
 void BaseElement::invalidateTransform()
 {
 	ComponentTransformable::invalidateTransform();
-	
-	for (auto i : children())
-		i->invalidateTransform();
-	
+	sharedTransformHierarchy().setLocalTransform(_transformHandle, _animations.empty() ? transform() : _animationTransform);
 	transformInvalidated();
 }
 
-void BaseElement::buildTransform()
+mat4 BaseElement::localTransform()
 {
-	_cachedFinalTransform = localTransform();
-	
-	if (parent() != nullptr)
-	{
-		_cachedFinalTransform *= parent()->finalTransform();
-	}
-	
-	_cachedFinalInverseTransform = _cachedFinalTransform.inverted();
+	return sharedTransformHierarchy().localTransform(_transformHandle);
 }
 
-const mat4& BaseElement::localTransform()
+mat4 BaseElement::finalTransform()
 {
-	_cachedLocalTransform = _animations.empty() ? transform() : _animationTransform;
-	return _cachedLocalTransform;
+	return sharedTransformHierarchy().worldTransform(_transformHandle);
 }
 
-const mat4& BaseElement::finalTransform()
+mat4 BaseElement::finalInverseTransform()
 {
-	if (!transformValid())
-	{
-		buildTransform();
-	}
-	return _cachedFinalTransform;
+	return sharedTransformHierarchy().worldInverseTransform(_transformHandle);
 }
 
-const mat4& BaseElement::finalInverseTransform()
+mat4 BaseElement::finalRotationTransform()
 {
-	if (!transformValid())
-		buildTransform();
-	
-	return _cachedFinalInverseTransform;
+	return sharedTransformHierarchy().worldRotationTransform(_transformHandle);
+}
+
+uint64_t BaseElement::finalTransformVersion()
+{
+	return sharedTransformHierarchy().worldTransformVersion(_transformHandle);
 }
 
 bool BaseElement::isKindOf(ElementType t) const
@@ -202,12 +203,15 @@ bool BaseElement::hasPropertyString(const std::string& s) const
 void BaseElement::addAnimation(const Animation& a)
 {
 	_animations.push_back(a);
-	_animationTransform = a.transformation(a.startTime());
+	_animationCursor = Animation::Cursor();
+	_animationTransform = _animations.front().transformation(_animations.front().startTime(), _animationCursor);
+	invalidateTransform();
 }
 
 void BaseElement::removeAnimations()
 {
 	_animations.clear();
+	_animationCursor = Animation::Cursor();
 	invalidateTransform();
 }
 
@@ -270,13 +274,48 @@ const Animation& BaseElement::defaultAnimation() const
 
 void BaseElement::setAnimationTime(float t)
 {
-	_animationTransform = _animations.empty() ? identityMatrix : _animations.front().transformation(t);
+	_animationTransform = _animations.empty() ? identityMatrix : _animations.front().transformation(t, _animationCursor);
+	invalidateTransform();
+}
+
+void BaseElement::setAnimationTransform(const mat4& m)
+{
+	_animationTransform = m;
 	invalidateTransform();
 }
 
 void BaseElement::setAnimationTimeRecursive(float a)
 {
-	setAnimationTime(a);
-	for (auto c : children())
-		c->setAnimationTimeRecursive(a);
+	/*
+	 * Gathers animated elements of the subtree and samples them in one batch
+	 */
+	Vector<BaseElement*> elements;
+	Vector<BaseElement*> stack(1, this);
+	while (!stack.empty())
+	{
+		BaseElement* element = stack.back();
+		stack.pop_back();
+		elements.emplace_back(element);
+		for (auto c : element->children())
+			stack.emplace_back(c.pointer());
+	}
+
+	Vector<const Animation*> animations(elements.size(), nullptr);
+	Vector<Animation::Cursor> cursors(elements.size());
+	for (size_t i = 0, e = elements.size(); i < e; ++i)
+	{
+		if (!elements[i]->_animations.empty())
+			animations[i] = &elements[i]->_animations.front();
+		cursors[i] = elements[i]->_animationCursor;
+	}
+
+	Vector<mat4> transformations;
+	Animation::evaluate(a, animations, cursors, transformations);
+
+	for (size_t i = 0, e = elements.size(); i < e; ++i)
+	{
+		elements[i]->_animationCursor = cursors[i];
+		elements[i]->_animationTransform = transformations[i];
+		elements[i]->invalidateTransform();
+	}
 }
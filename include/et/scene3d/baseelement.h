@@ -14,6 +14,7 @@
 #include <et/scene3d/base.h>
 #include <et/scene3d/serialization.h>
 #include <et/scene3d/animation.h>
+#include <et/scene3d/transformhierarchy.h>
 
 namespace et
 {
@@ -32,6 +33,7 @@ public:
 
 public:
 	BaseElement(const std::string& name, BaseElement* parent);
+	~BaseElement();
 	
 	void animate();
 	void stopAnimation();
@@ -48,12 +50,17 @@ public:
 
 	bool isKindOf(ElementType t) const;
 
-	const mat4& finalTransform();
-	const mat4& finalInverseTransform();
+	mat4 finalTransform();
+	mat4 finalInverseTransform();
+	mat4 finalRotationTransform();
+	uint64_t finalTransformVersion();
 	
-	const mat4& localTransform();
+	mat4 localTransform();
 	
-	void invalidateTransform();
+	void invalidateTransform() override;
+
+	TransformHierarchy::Handle transformHandle() const
+		{ return _transformHandle; }
 
 	void setParent(BaseElement* p);
 
@@ -81,6 +88,15 @@ public:
 	
 	void removeAnimations();
 
+	const Vector<Animation>& animations() const
+		{ return _animations; }
+
+	/*
+	 * Sets local transform produced by external animation evaluation,
+	 * used only by elements which have animations
+	 */
+	void setAnimationTransform(const mat4&);
+
 protected:
 	virtual void transformInvalidated() { }
 
@@ -92,8 +108,6 @@ private:
 	void childrenOfTypeCallback(ElementType t, BaseElement::List& list, const Pointer& root) const;
 	void childrenHavingFlagCallback(size_t flag, BaseElement::List& list, const Pointer& root) const;
 	
-	void buildTransform();
-
 private:
 	Animation _emptyAnimation;
 	NotifyTimer _animationTimer;
@@ -102,9 +116,8 @@ private:
 	Vector<Animation> _animations;
 	
 	mat4 _animationTransform = mat4(1.0f);
-	mat4 _cachedLocalTransform = mat4(1.0f);
-	mat4 _cachedFinalTransform = mat4(1.0f);
-	mat4 _cachedFinalInverseTransform = mat4(1.0f);
+	Animation::Cursor _animationCursor;
+	TransformHierarchy::Handle _transformHandle = TransformHierarchy::InvalidHandle;
 };
 }
 }
@@ -0,0 +1,440 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/core/serialization.h>
+#include <et/scene3d/compressedanimation.h>
+
+namespace et
+{
+namespace s3d
+{
+
+namespace ca_local
+{
+enum : uint32_t
+{
+	ClipSignature = ET_COMPOSE_UINT32('E', 'T', 'A', 'C'),
+	ClipVersion = 1,
+	ComponentsPerKey = 3,
+};
+
+const float TimeScale = 65535.0f;
+const float ValueScale = 65535.0f;
+const float SmallestThreeScale = 32767.0f;
+const float SmallestThreeRange = 0.70710678f;
+
+inline uint16_t quantize(float value, float scale)
+{
+	return static_cast<uint16_t>(clamp(value, 0.0f, 1.0f) * scale + 0.5f);
+}
+
+inline float dequantize(uint16_t value, float scale)
+{
+	return static_cast<float>(value) / scale;
+}
+
+/*
+ * Smallest three: largest component is dropped (and made positive), other three are in
+ * [-1/sqrt(2), 1/sqrt(2)] range and stored in 15 bits each, index of the dropped component
+ * is stored in the high bits of the first two values
+ */
+void encodeOrientation(const quaternion& source, uint16_t* output)
+{
+	quaternion q = source.normalized();
+
+	uint32_t largest = 0;
+	for (uint32_t i = 1; i < 4; ++i)
+	{
+		if (std::abs(q[i]) > std::abs(q[largest]))
+			largest = i;
+	}
+
+	if (q[largest] < 0.0f)
+		q = -q;
+
+	for (uint32_t i = 0, o = 0; i < 4; ++i)
+	{
+		if (i != largest)
+		{
+			float value = 0.5f + 0.5f * q[i] / SmallestThreeRange;
+			output[o++] = quantize(value, SmallestThreeScale);
+		}
+	}
+
+	output[0] |= (largest & 1) << 15;
+	output[1] |= (largest >> 1) << 15;
+}
+
+quaternion decodeOrientation(const uint16_t* input)
+{
+	uint32_t largest = ((input[0] >> 15) & 1) | (((input[1] >> 15) & 1) << 1);
+
+	quaternion result;
+	float lengthSquared = 0.0f;
+	for (uint32_t i = 0, o = 0; i < 4; ++i)
+	{
+		if (i != largest)
+		{
+			float value = dequantize(input[o++] & 0x7fff, SmallestThreeScale);
+			result[i] = SmallestThreeRange * (2.0f * value - 1.0f);
+			lengthSquared += sqr(result[i]);
+		}
+	}
+	result[largest] = std::sqrt(std::max(0.0f, 1.0f - lengthSquared));
+	return result;
+}
+
+/*
+ * Rotation angle between orientations, computed from the chord length
+ * since acos of the dot product is imprecise for small angles
+ */
+float orientationError(const quaternion& a, const quaternion& b)
+{
+	quaternion na = a.normalized();
+	quaternion nb = b.normalized();
+	if (dot(na.vector, nb.vector) + na.scalar * nb.scalar < 0.0f)
+		nb = -nb;
+
+	quaternion d = na + (-nb);
+	return 4.0f * std::asin(std::min(1.0f, 0.5f * d.length()));
+}
+
+float vectorError(CompressedAnimation::Track track, const vec3& value, const vec3& reference)
+{
+	float error = (value - reference).length();
+	return (track == CompressedAnimation::Track_Scale) ? error / std::max(reference.length(), 1.0e-5f) : error;
+}
+
+}
+
+CompressedAnimation::CompressedAnimation(const Animation& animation) :
+	CompressedAnimation(animation, Options())
+{
+}
+
+CompressedAnimation::CompressedAnimation(const Animation& animation, const Options& options) :
+	_startTime(animation.startTime()), _stopTime(animation.stopTime()), _frameRate(animation.frameRate()),
+	_outOfRangeMode(animation.outOfRangeMode())
+{
+	ET_ASSERT(animation.frameCount() > 0);
+
+	compressTrack(Track_Translation, animation, options.translationError);
+	compressTrack(Track_Orientation, animation, options.orientationError);
+	compressTrack(Track_Scale, animation, options.scaleError);
+}
+
+void CompressedAnimation::compressTrack(Track track, const Animation& animation, float maxError)
+{
+	TrackData& data = _tracks[track];
+	uint32_t frameCount = animation.frameCount();
+	float d = duration();
+
+	Vector<float> times(frameCount, 0.0f);
+	Vector<uint16_t> quantizedTimes(frameCount, 0);
+	for (uint32_t i = 0; i < frameCount; ++i)
+	{
+		float t = (d > 0.0f) ? (animation.frame(i).time - _startTime) / d : 0.0f;
+		quantizedTimes[i] = ca_local::quantize(t, ca_local::TimeScale);
+		times[i] = static_cast<float>(quantizedTimes[i]);
+	}
+
+	/*
+	 * Quantize all keys first, so the error of the key reduction includes quantization error
+	 */
+	Vector<uint16_t> values(ca_local::ComponentsPerKey * frameCount, 0);
+	Vector<vec3> sourceVectors;
+	Vector<quaternion> sourceOrientations;
+	if (track == Track_Orientation)
+	{
+		sourceOrientations.reserve(frameCount);
+		for (uint32_t i = 0; i < frameCount; ++i)
+		{
+			sourceOrientations.emplace_back(animation.frame(i).orientation);
+			ca_local::encodeOrientation(sourceOrientations.back(), values.data() + ca_local::ComponentsPerKey * i);
+		}
+	}
+	else
+	{
+		sourceVectors.reserve(frameCount);
+		for (uint32_t i = 0; i < frameCount; ++i)
+		{
+			Animation::Frame frame = animation.frame(i);
+			sourceVectors.emplace_back((track == Track_Translation) ? frame.translation : frame.scale);
+		}
+
+		vec3 minimum = sourceVectors.front();
+		vec3 maximum = sourceVectors.front();
+		for (const vec3& v : sourceVectors)
+		{
+			minimum = minv(minimum, v);
+			maximum = maxv(maximum, v);
+		}
+		data.minimum = minimum;
+		data.extent = maximum - minimum;
+
+		for (uint32_t i = 0; i < frameCount; ++i)
+		{
+			for (uint32_t c = 0; c < ca_local::ComponentsPerKey; ++c)
+			{
+				float value = (data.extent[c] > 0.0f) ? (sourceVectors[i][c] - minimum[c]) / data.extent[c] : 0.0f;
+				values[ca_local::ComponentsPerKey * i + c] = ca_local::quantize(value, ca_local::ValueScale);
+			}
+		}
+	}
+
+	data.values.swap(values);
+	data.times.swap(quantizedTimes);
+
+	auto errorAt = [&](uint32_t k, uint32_t from, uint32_t to) -> float
+	{
+		float dt = times[to] - times[from];
+		float f = (dt > 0.0f) ? clamp((times[k] - times[from]) / dt, 0.0f, 1.0f) : 0.0f;
+		if (track == Track_Orientation)
+		{
+			quaternion q = (to == from) ? decodeOrientation(from) : slerp(decodeOrientation(from), decodeOrientation(to), f);
+			return ca_local::orientationError(q, sourceOrientations[k]);
+		}
+		vec3 v = (to == from) ? decodeVector(track, from) : mix(decodeVector(track, from), decodeVector(track, to), f);
+		return ca_local::vectorError(track, v, sourceVectors[k]);
+	};
+
+	/*
+	 * Constant tracks are reduced to the first key, otherwise keys are greedily
+	 * removed while all removed keys could be interpolated from the kept ones
+	 */
+	bool constantTrack = true;
+	for (uint32_t k = 0; constantTrack && (k < frameCount); ++k)
+		constantTrack = errorAt(k, 0, 0) <= maxError;
+
+	Vector<uint32_t> keptKeys(1, 0);
+	if (!constantTrack)
+	{
+		uint32_t from = 0;
+		while (from + 1 < frameCount)
+		{
+			uint32_t to = from + 1;
+			while (to + 1 < frameCount)
+			{
+				bool acceptable = true;
+				for (uint32_t k = from + 1; acceptable && (k <= to); ++k)
+					acceptable = errorAt(k, from, to + 1) <= maxError;
+
+				if (!acceptable)
+					break;
+
+				++to;
+			}
+			keptKeys.emplace_back(to);
+			from = to;
+		}
+	}
+
+	Vector<uint16_t> keptTimes;
+	Vector<uint16_t> keptValues;
+	keptTimes.reserve(keptKeys.size());
+	keptValues.reserve(ca_local::ComponentsPerKey * keptKeys.size());
+	for (uint32_t k : keptKeys)
+	{
+		keptTimes.emplace_back(data.times[k]);
+		for (uint32_t c = 0; c < ca_local::ComponentsPerKey; ++c)
+			keptValues.emplace_back(data.values[ca_local::ComponentsPerKey * k + c]);
+	}
+	data.times.swap(keptTimes);
+	data.values.swap(keptValues);
+}
+
+vec3 CompressedAnimation::decodeVector(Track track, uint32_t key) const
+{
+	const TrackData& data = _tracks[track];
+	const uint16_t* values = data.values.data() + ca_local::ComponentsPerKey * key;
+	return data.minimum + data.extent * vec3(ca_local::dequantize(values[0], ca_local::ValueScale),
+		ca_local::dequantize(values[1], ca_local::ValueScale), ca_local::dequantize(values[2], ca_local::ValueScale));
+}
+
+quaternion CompressedAnimation::decodeOrientation(uint32_t key) const
+{
+	return ca_local::decodeOrientation(_tracks[Track_Orientation].values.data() + ca_local::ComponentsPerKey * key);
+}
+
+uint32_t CompressedAnimation::findKey(Track track, float normalizedTime, uint32_t& cursor) const
+{
+	const Vector<uint16_t>& times = _tracks[track].times;
+	uint32_t lastKey = static_cast<uint32_t>(times.size()) - 1;
+
+	uint32_t k = cursor;
+	if ((k <= lastKey) && (times[k] <= normalizedTime))
+	{
+		if ((k == lastKey) || (normalizedTime < times[k + 1]))
+			return k;
+
+		if ((k + 1 == lastKey) || (normalizedTime < times[k + 2]))
+			return (cursor = k + 1);
+	}
+
+	auto upper = std::upper_bound(times.begin(), times.end(), normalizedTime,
+		[](float t, uint16_t key) { return t < static_cast<float>(key); });
+
+	cursor = (upper == times.begin()) ? 0 : static_cast<uint32_t>(upper - times.begin()) - 1;
+	return cursor;
+}
+
+void CompressedAnimation::transformation(float time, Cursor& cursor, vec3& t, quaternion& o, vec3& s) const
+{
+	float d = duration();
+	float normalizedTime = 0.0f;
+	if (d > 0.0f)
+	{
+		time = Animation::wrapTime(time, _startTime, _stopTime, _outOfRangeMode);
+		normalizedTime = ca_local::TimeScale * (time - _startTime) / d;
+	}
+
+	for (uint32_t track = 0; track < Track_max; ++track)
+	{
+		const Vector<uint16_t>& times = _tracks[track].times;
+		ET_ASSERT(!times.empty());
+
+		uint32_t lower = findKey(static_cast<Track>(track), normalizedTime, cursor.keys[track]);
+		uint32_t upper = std::min(lower + 1, static_cast<uint32_t>(times.size()) - 1);
+
+		float dt = static_cast<float>(times[upper]) - static_cast<float>(times[lower]);
+		float f = (dt > 0.0f) ? clamp((normalizedTime - static_cast<float>(times[lower])) / dt, 0.0f, 1.0f) : 0.0f;
+
+		if (track == Track_Orientation)
+		{
+			o = (upper == lower) ? decodeOrientation(lower) : slerp(decodeOrientation(lower), decodeOrientation(upper), f);
+		}
+		else
+		{
+			vec3& v = (track == Track_Translation) ? t : s;
+			v = (upper == lower) ? decodeVector(static_cast<Track>(track), lower) :
+				mix(decodeVector(static_cast<Track>(track), lower), decodeVector(static_cast<Track>(track), upper), f);
+		}
+	}
+}
+
+mat4 CompressedAnimation::transformation(float time, Cursor& cursor) const
+{
+	vec3 t(0.0f);
+	vec3 s(0.0f);
+	quaternion o;
+
+	transformation(time, cursor, t, o, s);
+
+	mat4 result = o.toMatrix() * scaleMatrix(s);
+	result[3] = vec4(t, 1.0f);
+	return result;
+}
+
+mat4 CompressedAnimation::transformation(float time) const
+{
+	Cursor cursor;
+	return transformation(time, cursor);
+}
+
+Animation CompressedAnimation::decompress() const
+{
+	Animation result;
+	result.setTimeRange(_startTime, _stopTime);
+	result.setFrameRate(_frameRate);
+	result.setOutOfRangeMode(_outOfRangeMode);
+
+	Vector<uint16_t> times;
+	for (const TrackData& data : _tracks)
+		times.insert(times.end(), data.times.begin(), data.times.end());
+
+	std::sort(times.begin(), times.end());
+	times.erase(std::unique(times.begin(), times.end()), times.end());
+
+	/*
+	 * Sampling is done within time range, so frames are not affected by out of range mode
+	 */
+	Cursor cursor;
+	float d = duration();
+	for (uint16_t key : times)
+	{
+		float time = _startTime + d * ca_local::dequantize(key, ca_local::TimeScale);
+
+		vec3 t;
+		vec3 s;
+		quaternion o;
+		transformation(time, cursor, t, o, s);
+		result.addKeyFrame(time, t, o, s);
+	}
+
+	return result;
+}
+
+uint64_t CompressedAnimation::dataSize() const
+{
+	uint64_t result = sizeof(CompressedAnimation);
+	for (const TrackData& data : _tracks)
+		result += sizeof(uint16_t) * (data.times.size() + data.values.size());
+	return result;
+}
+
+void CompressedAnimation::serialize(std::ostream& stream) const
+{
+	serializeUInt32(stream, ca_local::ClipSignature);
+	serializeUInt32(stream, ca_local::ClipVersion);
+	serializeFloat(stream, _startTime);
+	serializeFloat(stream, _stopTime);
+	serializeFloat(stream, _frameRate);
+	serializeUInt32(stream, _outOfRangeMode);
+
+	for (const TrackData& data : _tracks)
+	{
+		serializeVector(stream, data.minimum);
+		serializeVector(stream, data.extent);
+		serializeUInt32(stream, static_cast<uint32_t>(data.times.size()));
+		stream.write(reinterpret_cast<const char*>(data.times.data()), sizeof(uint16_t) * data.times.size());
+		stream.write(reinterpret_cast<const char*>(data.values.data()), sizeof(uint16_t) * data.values.size());
+	}
+}
+
+bool CompressedAnimation::deserialize(std::istream& stream)
+{
+	if (deserializeUInt32(stream) != ca_local::ClipSignature)
+	{
+		log::error("Invalid compressed animation clip signature");
+		return false;
+	}
+
+	uint32_t version = deserializeUInt32(stream);
+	if (version != ca_local::ClipVersion)
+	{
+		log::error("Unsupported compressed animation clip version: %u", version);
+		return false;
+	}
+
+	_startTime = deserializeFloat(stream);
+	_stopTime = deserializeFloat(stream);
+	_frameRate = deserializeFloat(stream);
+	_outOfRangeMode = static_cast<Animation::OutOfRangeMode>(deserializeUInt32(stream));
+
+	for (TrackData& data : _tracks)
+	{
+		data.minimum = deserializeVector<vec3>(stream);
+		data.extent = deserializeVector<vec3>(stream);
+
+		uint32_t keys = deserializeUInt32(stream);
+		data.times.resize(keys);
+		data.values.resize(ca_local::ComponentsPerKey * keys);
+		stream.read(reinterpret_cast<char*>(data.times.data()), sizeof(uint16_t) * data.times.size());
+		stream.read(reinterpret_cast<char*>(data.values.data()), sizeof(uint16_t) * data.values.size());
+
+		if (stream.fail() || (keys == 0))
+		{
+			log::error("Compressed animation clip is corrupted");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+}
+}
@@ -0,0 +1,111 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/scene3d/animation.h>
+
+namespace et
+{
+namespace s3d
+{
+/*
+ * Compact representation of the animation clip, sampled directly at runtime.
+ * Rotations are stored as smallest three components (48 bits per key), translations and scales
+ * are quantized to 16 bits per component within track bounds, key times are quantized to 16 bits.
+ * Constant tracks are reduced to the single key, keys which could be interpolated
+ * from their neighbours within given error are removed
+ */
+class CompressedAnimation
+{
+public:
+	enum Track : uint32_t
+	{
+		Track_Translation,
+		Track_Orientation,
+		Track_Scale,
+
+		Track_max
+	};
+
+	struct Options
+	{
+		/*
+		 * translationError - in object space units
+		 * orientationError - in radians
+		 * scaleError - relative to scale
+		 */
+		float translationError = 0.0005f;
+		float orientationError = 0.0005f;
+		float scaleError = 0.0005f;
+	};
+
+	struct Cursor
+	{
+		uint32_t keys[Track_max] = { };
+	};
+
+public:
+	CompressedAnimation() = default;
+	CompressedAnimation(const Animation&);
+	CompressedAnimation(const Animation&, const Options&);
+
+	mat4 transformation(float) const;
+	mat4 transformation(float, Cursor&) const;
+
+	void transformation(float, Cursor&, vec3&, quaternion&, vec3&) const;
+
+	Animation decompress() const;
+
+	void serialize(std::ostream&) const;
+	bool deserialize(std::istream&);
+
+	uint32_t keyCount(Track track) const
+		{ return static_cast<uint32_t>(_tracks[track].times.size()); }
+
+	/*
+	 * Size of the compressed data in bytes
+	 */
+	uint64_t dataSize() const;
+
+	Animation::OutOfRangeMode outOfRangeMode() const
+		{ return _outOfRangeMode; }
+
+	float startTime() const
+		{ return _startTime; }
+
+	float stopTime() const
+		{ return _stopTime; }
+
+	float duration() const
+		{ return _stopTime - _startTime; }
+
+private:
+	struct TrackData
+	{
+		vec3 minimum;
+		vec3 extent;
+		Vector<uint16_t> times;
+		Vector<uint16_t> values;
+	};
+
+	void compressTrack(Track, const Animation&, float maxError);
+	uint32_t findKey(Track, float normalizedTime, uint32_t& cursor) const;
+	vec3 decodeVector(Track, uint32_t key) const;
+	quaternion decodeOrientation(uint32_t key) const;
+
+private:
+	TrackData _tracks[Track_max];
+
+	float _startTime = 0.0f;
+	float _stopTime = 0.0f;
+	float _frameRate = 0.0f;
+
+	Animation::OutOfRangeMode _outOfRangeMode = Animation::OutOfRangeMode_Loop;
+};
+}
+}
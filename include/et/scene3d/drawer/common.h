@@ -18,12 +18,14 @@ namespace s3d
 struct DrawerOptions
 {
 	float shadowmapScale = 1.0f;
+	float levelOfDetailPixelError = 1.0f;
 	bool drawCubemapsDebug = false;
 	bool drawShadowmap = false;
 	bool rebuildEnvironmentTextures = true;
 	bool enableScreenSpaceShadows = false;
 	bool enableScreenSpaceAO = true;
 	bool enableMultipleScattering = true;
+	bool enableLevelsOfDetail = true;
 };
 
 mat4 fullscreenBatchTransform(const vec2& viewport, const vec2& origin, const vec2& size);
@@ -102,6 +102,66 @@ void Drawer::updateVisibleMeshes() {
 			_visibleMeshes.emplace_back(mesh);
 		}
 	}
+
+	/*
+	 * Level of detail is selected by the screen space error: error of the level is projected
+	 * from the closest point of the bounding sphere and compared to the allowed error in pixels
+	 */
+	const Camera::Pointer& camera = _scene->renderCamera();
+	float pixelsPerUnit = 0.5f * camera->projectionMatrix()[1][1] * static_cast<float>(_main.color->size(0).y);
+	float allowedErrorScale = options.enableLevelsOfDetail ? options.levelOfDetailPixelError / pixelsPerUnit : 0.0f;
+
+	/*
+	 * Draw list contains only CPU-side data and does not touch renderer,
+	 * GPU upload is done by the render pass when list is pushed
+	 */
+	_drawList->clear();
+	_drawList->reserve(static_cast<uint32_t>(4 * _visibleMeshes.size()), static_cast<uint32_t>(_visibleMeshes.size()));
+	for (Mesh::Pointer& mesh : _visibleMeshes)
+	{
+		const Sphere& bounds = mesh->boundingSphere();
+		float distance = std::max((bounds.center() - camera->position()).length() - bounds.radius(), camera->zNear());
+		float allowedError = allowedErrorScale * distance / mesh->finalTransformScale();
+
+		std::pair<mat4, mat4>& previousTransform = _previousFrameTransforms[mesh];
+
+		DrawInstanceData instance;
+		instance.worldTransform = mesh->finalTransform();
+		instance.worldRotationTransform = mesh->finalRotationTransform();
+		instance.previousWorldTransform = previousTransform.first;
+		instance.previousWorldRotationTransform = previousTransform.second;
+		uint32_t instanceIndex = _drawList->addInstance(instance);
+
+		/*
+		 * Streams with quantized positions get their own instance
+		 * with dequantization folded into the transforms
+		 */
+		const VertexStream* dequantizedStream = nullptr;
+		uint32_t dequantizedInstanceIndex = instanceIndex;
+		for (const RenderBatch::Pointer& rb : mesh->renderBatchesForError(allowedError))
+		{
+			const VertexStream::Pointer& vs = rb->vertexStream();
+			if (vs.invalid() || !vs->hasPositionDequantization())
+			{
+				_drawList->push(rb, instanceIndex);
+				continue;
+			}
+
+			if (vs.pointer() != dequantizedStream)
+			{
+				mat4 dequantization = vs->positionDequantizationTransform();
+				DrawInstanceData dequantizedInstance = instance;
+				dequantizedInstance.worldTransform = dequantization * instance.worldTransform;
+				dequantizedInstance.previousWorldTransform = dequantization * instance.previousWorldTransform;
+				dequantizedInstanceIndex = _drawList->addInstance(dequantizedInstance);
+				dequantizedStream = vs.pointer();
+			}
+			_drawList->push(rb, dequantizedInstanceIndex);
+		}
+
+		previousTransform = std::make_pair(instance.worldTransform, instance.worldRotationTransform);
+	}
+	_drawList->build();
 }
 
 void Drawer::draw() {
@@ -110,6 +170,8 @@ void Drawer::draw() {
 	options.rebuldEnvironmentProbe = true;
 #endif
 
+	sharedTransformHierarchy().update();
+
 	_cubemapProcessor->process(_renderer, options, _lighting.directional);
 	_shadowmapProcessor->process(_renderer, options);
 
@@ -135,12 +197,7 @@ void Drawer::draw() {
 		_main.zPrepass->setSharedVariable(ObjectVariable::CameraJitter, _jitter);
 		_main.zPrepass->loadSharedVariablesFromCamera(_scene->renderCamera());
 		_main.zPrepass->nextSubpass();
-		for (Mesh::Pointer& mesh : _visibleMeshes)
-		{
-			_main.zPrepass->setSharedVariable(ObjectVariable::WorldTransform, mesh->transform());
-			for (const RenderBatch::Pointer& rb : mesh->renderBatches())
-				_main.zPrepass->pushRenderBatch(rb);
-		}
+		_main.zPrepass->pushDrawList(_drawList);
 		_main.zPrepass->endSubpass();
 		_main.zPrepass->pushImageBarrier(_main.zPrepass->info().depth.texture, ResourceBarrier(TextureState::ShaderResource));
 	}
@@ -179,19 +236,8 @@ void Drawer::draw() {
 		_main.forward->setSharedVariable(ObjectVariable::EnvironmentSphericalHarmonics, _cubemapProcessor->environmentSphericalHarmonics(), 9);
 		_main.forward->setSharedVariable(ObjectVariable::CameraJitter, _jitter);
 		_main.forward->nextSubpass();
-		for (Mesh::Pointer& mesh : _visibleMeshes)
-		{
-			_main.forward->setSharedVariable(ObjectVariable::WorldTransform, mesh->transform());
-			_main.forward->setSharedVariable(ObjectVariable::WorldRotationTransform, mesh->rotationTransform());
-			_main.forward->setSharedVariable(ObjectVariable::PreviousWorldTransform, _previousFrameTransforms[mesh].first);
-			_main.forward->setSharedVariable(ObjectVariable::PreviousWorldRotationTransform, _previousFrameTransforms[mesh].second);
-
-			for (const RenderBatch::Pointer& rb : mesh->renderBatches())
-				_main.forward->pushRenderBatch(rb);
-
-			_previousFrameTransforms[mesh] = std::make_pair(mesh->transform(), mesh->rotationTransform());
-		}
-		_main.forward->setSharedVariable(ObjectVariable::WorldTransform, identityMatrix);
+		_main.forward->pushDrawList(_drawList);
+		_main.forward->loadSharedVariablesFromDrawInstance(DrawInstanceData());
 		_main.forward->pushRenderBatch(_lighting.environmentBatch);
 		_main.forward->endSubpass();
 	}
@@ -54,6 +54,7 @@ private:
 	Vector<Mesh::Pointer> _allMeshes;
 	Vector<Mesh::Pointer> _visibleMeshes;
 	Map<Mesh::Pointer, std::pair<mat4, mat4>> _previousFrameTransforms;
+	DrawList::Pointer _drawList = DrawList::Pointer(PointerInit::CreateInplace);
 
 	RenderInterface::Pointer _renderer;
 	DebugDrawer::Pointer _debugDrawer;
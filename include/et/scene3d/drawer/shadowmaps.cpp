@@ -122,12 +122,18 @@ void ShadowmapProcessor::process(RenderInterface::Pointer& renderer, DrawerOptio
 	{
 		// if (_light->frustum().containsBoundingBox(mesh->tranformedBoundingBox()))
 		{
-			const mat4& transform = mesh->transform();
-			const mat4& rotationTransform = mesh->rotationTransform();
-			activePass->setSharedVariable(ObjectVariable::WorldTransform, transform);
-			activePass->setSharedVariable(ObjectVariable::WorldRotationTransform, rotationTransform);
+			mat4 transform = mesh->finalTransform();
+			activePass->setSharedVariable(ObjectVariable::WorldRotationTransform, mesh->finalRotationTransform());
 			for (const RenderBatch::Pointer& batch : mesh->renderBatches())
+			{
+				/*
+				 * Quantized positions are restored the same way as in main pass
+				 */
+				const VertexStream::Pointer& vs = batch->vertexStream();
+				bool dequantize = vs.valid() && vs->hasPositionDequantization();
+				activePass->setSharedVariable(ObjectVariable::WorldTransform, dequantize ? vs->positionDequantizationTransform() * transform : transform);
 				activePass->pushRenderBatch(batch);
+			}
 		}
 	}
 	activePass->endSubpass();
@@ -5,38 +5,1580 @@
  *
  */
 
-#include <et/scene3d/gltfloader.h>
 #include <et/core/json.h>
+#include <et/core/base64.h>
+#include <et/core/filesystem.h>
+#include <et/core/threading.h>
+#include <et/core/tools.h>
+#include <et/rendering/base/material.h>
+#include <et/scene3d/gltfloader.h>
 
 namespace et {
 
+namespace gltf_local {
+
+enum : uint32_t
+{
+	GLBMagic = 0x46546C67,
+	GLBVersion = 2,
+	GLBChunkJSON = 0x4E4F534A,
+	GLBChunkBIN = 0x004E4942,
+
+	ComponentByte = 5120,
+	ComponentUnsignedByte = 5121,
+	ComponentShort = 5122,
+	ComponentUnsignedShort = 5123,
+	ComponentUnsignedInt = 5125,
+	ComponentFloat = 5126,
+
+	ModeTriangles = 4,
+	ModeTriangleStrip = 5,
+	ModeTriangleFan = 6,
+
+	AttributesCount = 8,
+
+	CubicSplineSubdivisions = 4,
+};
+
+struct GLBHeader
+{
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint32_t length = 0;
+};
+
+struct GLBChunkHeader
+{
+	uint32_t length = 0;
+	uint32_t type = 0;
+};
+
+struct AttributeMapping
+{
+	const char* name;
+	VertexAttributeUsage usage;
+	DataType type;
+};
+
+/*
+ * Sorted by usage, so offsets in the declaration follow this order
+ */
+const AttributeMapping attributes[AttributesCount] =
+{
+	{ "POSITION", VertexAttributeUsage::Position, DataType::Vec3 },
+	{ "NORMAL", VertexAttributeUsage::Normal, DataType::Vec3 },
+	{ "COLOR_0", VertexAttributeUsage::Color, DataType::Vec4 },
+	{ "TANGENT", VertexAttributeUsage::Tangent, DataType::Vec4 },
+	{ "TEXCOORD_0", VertexAttributeUsage::TexCoord0, DataType::Vec2 },
+	{ "TEXCOORD_1", VertexAttributeUsage::TexCoord1, DataType::Vec2 },
+	{ "WEIGHTS_0", VertexAttributeUsage::BlendWeights, DataType::Vec4 },
+	{ "JOINTS_0", VertexAttributeUsage::BlendIndices, DataType::IntVec4 },
+};
+
+uint32_t componentSize(uint32_t type)
+{
+	switch (type)
+	{
+	case ComponentByte:
+	case ComponentUnsignedByte:
+		return 1;
+	case ComponentShort:
+	case ComponentUnsignedShort:
+		return 2;
+	case ComponentUnsignedInt:
+	case ComponentFloat:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+uint32_t componentsCount(const std::string& type)
+{
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	if (type == "MAT4") return 16;
+	return 0;
+}
+
+template <class T>
+inline T load(const char* ptr)
+{
+	T result;
+	memcpy(&result, ptr, sizeof(T));
+	return result;
+}
+
+/*
+ * Integer components are dequantized as described in KHR_mesh_quantization
+ */
+inline float componentValue(const char* ptr, uint32_t type, bool normalized)
+{
+	switch (type)
+	{
+	case ComponentByte:
+	{
+		float value = static_cast<float>(load<int8_t>(ptr));
+		return normalized ? std::max(value / 127.0f, -1.0f) : value;
+	}
+	case ComponentUnsignedByte:
+	{
+		float value = static_cast<float>(load<uint8_t>(ptr));
+		return normalized ? value / 255.0f : value;
+	}
+	case ComponentShort:
+	{
+		float value = static_cast<float>(load<int16_t>(ptr));
+		return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+	}
+	case ComponentUnsignedShort:
+	{
+		float value = static_cast<float>(load<uint16_t>(ptr));
+		return normalized ? value / 65535.0f : value;
+	}
+	case ComponentUnsignedInt:
+		return static_cast<float>(load<uint32_t>(ptr));
+	case ComponentFloat:
+		return load<float>(ptr);
+	default:
+		return 0.0f;
+	}
+}
+
+inline uint32_t indexValue(const char* ptr, uint32_t type)
+{
+	switch (type)
+	{
+	case ComponentUnsignedByte:
+		return load<uint8_t>(ptr);
+	case ComponentUnsignedShort:
+		return load<uint16_t>(ptr);
+	case ComponentUnsignedInt:
+		return load<uint32_t>(ptr);
+	default:
+		return static_cast<uint32_t>(componentValue(ptr, type, false));
+	}
+}
+
+/*
+ * Integral JSON numbers are deserialized as integers
+ */
+float number(const VariantBase::Pointer& value, float def)
+{
+	if (value.valid() && (value->variantClass() == VariantClass::Float))
+		return FloatValue(value)->content;
+
+	if (value.valid() && (value->variantClass() == VariantClass::Integer))
+		return static_cast<float>(IntegerValue(value)->content);
+
+	return def;
+}
+
+float numberForKey(const Dictionary& d, const std::string& key, float def)
+{
+	return number(d.objectForKey(key), def);
+}
+
+uint32_t indexForKey(const Dictionary& d, const std::string& key)
+{
+	VariantBase::Pointer value = d.objectForKey(key);
+	if (value.valid() && (value->variantClass() == VariantClass::Integer))
+		return static_cast<uint32_t>(IntegerValue(value)->content);
+
+	return InvalidIndex;
+}
+
+void numbersForKey(const Dictionary& d, const std::string& key, float* values, uint32_t count)
+{
+	ArrayValue array = d.arrayForKey(key);
+	count = std::min(count, static_cast<uint32_t>(array->content.size()));
+	for (uint32_t i = 0; i < count; ++i)
+		values[i] = number(array->content[i], values[i]);
+}
+
+Vector<uint32_t> indicesForKey(const Dictionary& d, const std::string& key)
+{
+	ArrayValue array = d.arrayForKey(key);
+	Vector<uint32_t> result;
+	result.reserve(array->content.size());
+	for (const VariantBase::Pointer& value : array->content)
+		result.emplace_back(static_cast<uint32_t>(number(value, -1.0f)));
+	return result;
+}
+
+/*
+ * Entries which are not objects are replaced with empty dictionaries to keep indices
+ */
+Vector<Dictionary> dictionariesForKey(const Dictionary& d, const std::string& key)
+{
+	ArrayValue array = d.arrayForKey(key);
+	Vector<Dictionary> result;
+	result.reserve(array->content.size());
+	for (const VariantBase::Pointer& value : array->content)
+	{
+		if (value.valid() && (value->variantClass() == VariantClass::Dictionary))
+			result.emplace_back(value);
+		else
+			result.emplace_back();
+	}
+	return result;
+}
+
+/*
+ * Engine quaternions are applied to row vectors, so glTF rotations are conjugated
+ */
+inline quaternion quaternionFromGLTF(const float* q)
+{
+	return quaternion(q[3], -q[0], -q[1], -q[2]);
+}
+
+}
+
 class GLTFLoaderPrivate
 {
+public:
+	struct Buffer
+	{
+		const char* data = nullptr;
+		uint64_t size = 0;
+	};
+
+	struct BufferView
+	{
+		uint32_t buffer = InvalidIndex;
+		uint64_t offset = 0;
+		uint64_t length = 0;
+		uint32_t stride = 0;
+	};
+
+	/*
+	 * Data pointer is resolved (and validated) after buffers are loaded,
+	 * accessors without data (e.g. sparse ones) are read as zeros
+	 */
+	struct Accessor
+	{
+		const char* data = nullptr;
+		const char* limit = nullptr;
+		uint32_t bufferView = InvalidIndex;
+		uint64_t offset = 0;
+		uint32_t count = 0;
+		uint32_t componentType = gltf_local::ComponentFloat;
+		uint32_t components = 0;
+		uint32_t stride = 0;
+		bool normalized = false;
+	};
+
+	struct Primitive
+	{
+		uint32_t attributes[gltf_local::AttributesCount] { };
+		uint32_t indices = InvalidIndex;
+		uint32_t material = InvalidIndex;
+		uint32_t mode = gltf_local::ModeTriangles;
+	};
+
+	struct Batch
+	{
+		uint32_t firstIndex = 0;
+		uint32_t count = 0;
+		uint32_t material = InvalidIndex;
+	};
+
+	struct MeshData
+	{
+		std::string name;
+		Vector<Primitive> primitives;
+		Vector<Batch> batches;
+		VertexStorage::Pointer vertices;
+		IndexArray::Pointer indices;
+		VertexStream::Pointer stream;
+	};
+
+	struct Node
+	{
+		std::string name;
+		vec3 translation = vec3(0.0f);
+		quaternion orientation;
+		vec3 scale = vec3(1.0f);
+		Vector<uint32_t> children;
+		Vector<s3d::Animation> animations;
+		uint32_t parent = InvalidIndex;
+		uint32_t mesh = InvalidIndex;
+		uint32_t skin = InvalidIndex;
+		bool joint = false;
+		s3d::BaseElement::Pointer element;
+		s3d::Mesh::Pointer meshElement;
+	};
+
+	struct Skin
+	{
+		Vector<uint32_t> joints;
+		uint32_t inverseBindMatrices = InvalidIndex;
+	};
+
+	struct MaterialDescription
+	{
+		std::string name;
+		vec4 baseColor = vec4(1.0f);
+		vec4 emissive = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		float metallic = 1.0f;
+		float roughness = 1.0f;
+		float normalScale = 1.0f;
+		uint32_t baseColorTexture = InvalidIndex;
+		uint32_t normalTexture = InvalidIndex;
+		uint32_t emissiveTexture = InvalidIndex;
+	};
+
+	struct Sampler
+	{
+		uint32_t input = InvalidIndex;
+		uint32_t output = InvalidIndex;
+		bool step = false;
+		bool cubic = false;
+	};
+
+	enum class AsyncStage : uint32_t
+	{
+		Materials,
+		Upload,
+		Scene
+	};
+
+public:
+	GLTFLoaderPrivate(const std::string& fileName) :
+		inputFileName(fileName), inputFilePath(getFilePath(fileName)) { }
+
+	bool prepare();
+
+	void loadMaterials(RenderInterface::Pointer&, s3d::Storage&, ObjectsCache&);
+	uint64_t uploadMesh(RenderInterface::Pointer&, s3d::Storage&, MeshData&);
+	s3d::ElementContainer::Pointer buildScene(RenderInterface::Pointer&);
+
+private:
+	bool readFile();
+	bool loadBuffers();
+	bool parseAccessors();
+	void parseMeshes();
+	void parseNodes();
+	void parseMaterials();
+	void parseAnimations();
+
+	void buildMeshes();
+	void buildMesh(MeshData&);
+	void copyVertices(const Primitive&, VertexStorage::Pointer&, uint32_t baseVertex);
+	bool canCopyVertices(const Primitive&, const VertexDeclaration&, uint32_t vertexCount, const char*& source);
+	void readComponents(const Accessor&, uint32_t, float*, uint32_t) const;
+	void sample(const Sampler&, float time, float* values, uint32_t components, bool rotation) const;
+
+	void createElement(RenderInterface::Pointer&, uint32_t, s3d::BaseElement*);
+	s3d::Mesh::Pointer createMesh(RenderInterface::Pointer&, const MeshData&, const std::string&, s3d::BaseElement*);
+	void createDeformer(s3d::Mesh::Pointer&, const MeshData&, const Skin&);
+
 public:
 	std::string inputFileName;
+	std::string inputFilePath;
 	Dictionary data;
+
+	Vector<BinaryDataStorage> storages;
+	Vector<Buffer> buffers;
+	Vector<BufferView> bufferViews;
+	Vector<Accessor> accessors;
+	Vector<MeshData> meshes;
+	Vector<Node> nodes;
+	Vector<Skin> skins;
+	Vector<MaterialDescription> materialDescriptions;
+	Vector<std::string> textureFiles;
+	Vector<uint32_t> rootNodes;
+
+	MaterialInstance::Collection materials;
+	MaterialInstance::Pointer defaultMaterial;
+	AsyncStage asyncStage = AsyncStage::Materials;
+	uint32_t uploadedMeshes = 0;
+	bool prepared = false;
 };
 
 GLTFLoader::GLTFLoader(const std::string& fileName) {
-	ET_PIMPL_INIT(GLTFLoader);
+	ET_PIMPL_INIT(GLTFLoader, fileName);
 }
 
 GLTFLoader::~GLTFLoader() {
 	ET_PIMPL_FINALIZE(GLTFLoader);
 }
 
-s3d::ElementContainer::Pointer GLTFLoader::load(RenderInterface::Pointer, s3d::Storage&, ObjectsCache&) {
-	s3d::ElementContainer::Pointer result(PointerInit::CreateInplace);
+s3d::ElementContainer::Pointer GLTFLoader::load(RenderInterface::Pointer renderer, s3d::Storage& storage, ObjectsCache& cache) {
+	if (!_private->prepared && !_private->prepare())
+		return s3d::ElementContainer::Pointer::create(_private->inputFileName, nullptr);
+
+	_private->loadMaterials(renderer, storage, cache);
+	for (GLTFLoaderPrivate::MeshData& mesh : _private->meshes)
+		_private->uploadMesh(renderer, storage, mesh);
+
+	return _private->buildScene(renderer);
+}
+
+void GLTFLoader::prepareAsync() {
+	_private->asyncStage = GLTFLoaderPrivate::AsyncStage::Materials;
+	_private->uploadedMeshes = 0;
+	_private->prepare();
+}
+
+bool GLTFLoader::finalizeAsync(RenderInterface::Pointer renderer, s3d::Storage& storage, ObjectsCache& cache,
+	uint64_t& budget, s3d::ElementContainer::Pointer& result) {
+	if (!_private->prepared)
+	{
+		result = s3d::ElementContainer::Pointer::create(_private->inputFileName, nullptr);
+		return true;
+	}
+
+	switch (_private->asyncStage)
+	{
+	case GLTFLoaderPrivate::AsyncStage::Materials:
+	{
+		_private->loadMaterials(renderer, storage, cache);
+		_private->asyncStage = GLTFLoaderPrivate::AsyncStage::Upload;
+		return false;
+	}
+
+	case GLTFLoaderPrivate::AsyncStage::Upload:
+	{
+		/*
+		 * At least one mesh is uploaded per slice, regardless of its size
+		 */
+		uint32_t meshesCount = static_cast<uint32_t>(_private->meshes.size());
+		do
+		{
+			if (_private->uploadedMeshes >= meshesCount)
+				break;
+
+			GLTFLoaderPrivate::MeshData& mesh = _private->meshes[_private->uploadedMeshes++];
+			budget -= std::min(budget, _private->uploadMesh(renderer, storage, mesh));
+		}
+		while (budget > 0);
+
+		if (_private->uploadedMeshes >= meshesCount)
+			_private->asyncStage = GLTFLoaderPrivate::AsyncStage::Scene;
+		return false;
+	}
+
+	default:
+	{
+		result = _private->buildScene(renderer);
+		return true;
+	}
+	}
+}
+
+/*
+ * Parsing
+ */
+bool GLTFLoaderPrivate::prepare() {
+	prepared = readFile() && loadBuffers() && parseAccessors();
+	if (prepared)
+	{
+		parseMeshes();
+		parseNodes();
+		parseMaterials();
+		parseAnimations();
+		buildMeshes();
+	}
+	data = Dictionary();
+	return prepared;
+}
+
+bool GLTFLoaderPrivate::readFile() {
+	using namespace gltf_local;
+
+	std::ifstream input(inputFileName, std::ios::in | std::ios::binary);
+	if (!input.is_open())
+	{
+		log::error("Unable to open glTF file: %s", inputFileName.c_str());
+		return false;
+	}
+
+	BinaryDataStorage content(static_cast<uint64_t>(streamSize(input)));
+	input.read(content.binary(), static_cast<std::streamsize>(content.size()));
+	if (input.fail())
+	{
+		log::error("Unable to read glTF file: %s", inputFileName.c_str());
+		return false;
+	}
+
+	const char* json = content.binary();
+	size_t jsonSize = static_cast<size_t>(content.size());
+
+	GLBHeader header;
+	if (content.size() >= sizeof(header))
+		memcpy(&header, content.data(), sizeof(header));
+
+	/*
+	 * Binary container: header, JSON chunk and optional binary chunk, used as buffer 0
+	 */
+	if (header.magic == GLBMagic)
+	{
+		if (header.version != GLBVersion)
+		{
+			log::error("Unsupported GLB version %u in %s", header.version, inputFileName.c_str());
+			return false;
+		}
+
+		uint64_t fileSize = std::min(content.size(), static_cast<uint64_t>(header.length));
+		uint64_t offset = sizeof(header);
+		json = nullptr;
+
+		while (offset + sizeof(GLBChunkHeader) <= fileSize)
+		{
+			GLBChunkHeader chunk;
+			memcpy(&chunk, content.data() + offset, sizeof(chunk));
+			offset += sizeof(chunk);
+
+			if (offset + chunk.length > fileSize)
+			{
+				log::error("Invalid GLB chunk size in %s", inputFileName.c_str());
+				return false;
+			}
+
+			if ((chunk.type == GLBChunkJSON) && (json == nullptr))
+			{
+				json = content.binary() + offset;
+				jsonSize = chunk.length;
+			}
+			else if ((chunk.type == GLBChunkBIN) && buffers.empty())
+			{
+				Buffer buffer;
+				buffer.data = content.binary() + offset;
+				buffer.size = chunk.length;
+				buffers.emplace_back(buffer);
+			}
+			offset += alignUpTo(static_cast<uint64_t>(chunk.length), uint64_t(4));
+		}
+
+		if (json == nullptr)
+		{
+			log::error("GLB file %s does not contain JSON chunk", inputFileName.c_str());
+			return false;
+		}
+	}
 
 	VariantClass cls = VariantClass::Invalid;
-	json::deserialize(loadTextFile(_private->inputFileName), cls);
+	VariantBase::Pointer root = json::deserialize(json, jsonSize, cls);
 	if (cls != VariantClass::Dictionary)
 	{
-		log::error("Failed to load GLTF from file: %s", _private->inputFileName.c_str());
-		return result;
+		log::error("Failed to load GLTF from file: %s", inputFileName.c_str());
+		return false;
+	}
+	data = root;
+
+	/*
+	 * Binary chunk (if any) references file content
+	 */
+	storages.emplace_back(std::move(content));
+
+	Dictionary asset = data.dictionaryForKey("asset");
+	std::string version = asset.stringForKey("version")->content;
+	if ((version.empty() == false) && (version.front() != '2'))
+		log::warning("glTF version %s is not supported, loading %s as 2.0", version.c_str(), inputFileName.c_str());
+
+	ArrayValue required = data.arrayForKey("extensionsRequired");
+	for (const VariantBase::Pointer& ext : required->content)
+	{
+		if (ext.valid() && (ext->variantClass() == VariantClass::String))
+		{
+			const std::string& name = StringValue(ext)->content;
+			if (name != "KHR_mesh_quantization")
+				log::warning("Required glTF extension %s is not supported (%s)", name.c_str(), inputFileName.c_str());
+		}
+	}
+
+	return true;
+}
+
+bool GLTFLoaderPrivate::loadBuffers() {
+	using namespace gltf_local;
+
+	Vector<Dictionary> bufferValues = dictionariesForKey(data, "buffers");
+	bool hasBinaryChunk = !buffers.empty();
+	buffers.resize(std::max(buffers.size(), bufferValues.size()));
+
+	for (size_t i = 0, e = bufferValues.size(); i < e; ++i)
+	{
+		uint64_t declaredSize = static_cast<uint64_t>(numberForKey(bufferValues[i], "byteLength", 0.0f));
+		std::string uri = bufferValues[i].stringForKey("uri")->content;
+		if (uri.empty())
+		{
+			if ((i > 0) || !hasBinaryChunk)
+			{
+				log::error("glTF buffer %llu does not have data (%s)", static_cast<uint64_t>(i), inputFileName.c_str());
+				return false;
+			}
+			continue;
+		}
+
+		BinaryDataStorage content;
+		if (uri.find("data:") == 0)
+		{
+			size_t dataStart = uri.find(";base64,");
+			if (dataStart == std::string::npos)
+			{
+				log::error("Unsupported glTF data URI in buffer %llu (%s)", static_cast<uint64_t>(i), inputFileName.c_str());
+				return false;
+			}
+			content = base64::decode(uri.substr(dataStart + 8));
+		}
+		else
+		{
+			std::string bufferFileName = inputFilePath + uri;
+			std::ifstream input(bufferFileName, std::ios::in | std::ios::binary);
+			if (!input.is_open())
+			{
+				log::error("Unable to open glTF buffer %s", bufferFileName.c_str());
+				return false;
+			}
+			content.resize(static_cast<uint64_t>(streamSize(input)));
+			input.read(content.binary(), static_cast<std::streamsize>(content.size()));
+		}
+
+		if (content.size() < declaredSize)
+			log::warning("glTF buffer %s is smaller than declared", uri.c_str());
+
+		buffers[i].data = content.binary();
+		buffers[i].size = content.size();
+		storages.emplace_back(std::move(content));
+	}
+
+	for (const Dictionary& value : dictionariesForKey(data, "bufferViews"))
+	{
+		BufferView view;
+		view.buffer = indexForKey(value, "buffer");
+		view.offset = static_cast<uint64_t>(numberForKey(value, "byteOffset", 0.0f));
+		view.length = static_cast<uint64_t>(numberForKey(value, "byteLength", 0.0f));
+		view.stride = static_cast<uint32_t>(numberForKey(value, "byteStride", 0.0f));
+
+		if ((view.buffer >= buffers.size()) || (view.offset + view.length > buffers[view.buffer].size))
+		{
+			log::error("Invalid glTF buffer view in %s", inputFileName.c_str());
+			return false;
+		}
+		bufferViews.emplace_back(view);
+	}
+
+	return true;
+}
+
+bool GLTFLoaderPrivate::parseAccessors() {
+	using namespace gltf_local;
+
+	for (const Dictionary& value : dictionariesForKey(data, "accessors"))
+	{
+		Accessor accessor;
+		accessor.bufferView = indexForKey(value, "bufferView");
+		accessor.offset = static_cast<uint64_t>(numberForKey(value, "byteOffset", 0.0f));
+		accessor.count = static_cast<uint32_t>(numberForKey(value, "count", 0.0f));
+		accessor.componentType = static_cast<uint32_t>(numberForKey(value, "componentType", 0.0f));
+		accessor.components = componentsCount(value.stringForKey("type")->content);
+		accessor.normalized = value.boolForKey("normalized")->content != 0;
+
+		uint32_t elementSize = componentSize(accessor.componentType) * accessor.components;
+		if (elementSize == 0)
+		{
+			log::error("Unsupported glTF accessor type in %s", inputFileName.c_str());
+			return false;
+		}
+		accessor.stride = elementSize;
+
+		if (value.hasKey("sparse"))
+			log::warning("Sparse glTF accessors are not supported (%s)", inputFileName.c_str());
+
+		if (accessor.bufferView < bufferViews.size())
+		{
+			const BufferView& view = bufferViews[accessor.bufferView];
+			const Buffer& buffer = buffers[view.buffer];
+			if (view.stride > 0)
+				accessor.stride = view.stride;
+
+			uint64_t required = accessor.offset + (accessor.count > 0 ? (accessor.count - 1) * accessor.stride + elementSize : 0);
+			if (required > view.length)
+			{
+				log::error("glTF accessor is out of buffer view bounds in %s", inputFileName.c_str());
+				return false;
+			}
+			accessor.data = buffer.data + view.offset + accessor.offset;
+			accessor.limit = buffer.data + view.offset + view.length;
+		}
+		accessors.emplace_back(accessor);
+	}
+
+	return true;
+}
+
+void GLTFLoaderPrivate::parseMeshes() {
+	using namespace gltf_local;
+
+	Vector<Dictionary> meshValues = dictionariesForKey(data, "meshes");
+	meshes.resize(meshValues.size());
+	for (size_t m = 0, me = meshValues.size(); m < me; ++m)
+	{
+		MeshData& mesh = meshes[m];
+		mesh.name = meshValues[m].stringForKey("name", "mesh_" + intToStr(m))->content;
+
+		for (const Dictionary& value : dictionariesForKey(meshValues[m], "primitives"))
+		{
+			Primitive primitive;
+			primitive.indices = indexForKey(value, "indices");
+			primitive.material = indexForKey(value, "material");
+			primitive.mode = static_cast<uint32_t>(numberForKey(value, "mode", static_cast<float>(ModeTriangles)));
+
+			Dictionary attributeValues = value.dictionaryForKey("attributes");
+			for (uint32_t a = 0; a < AttributesCount; ++a)
+			{
+				primitive.attributes[a] = indexForKey(attributeValues, attributes[a].name);
+				if ((primitive.attributes[a] != InvalidIndex) && (primitive.attributes[a] >= accessors.size()))
+					primitive.attributes[a] = InvalidIndex;
+			}
+
+			uint32_t positions = primitive.attributes[0];
+			bool supportedMode = (primitive.mode == ModeTriangles) || (primitive.mode == ModeTriangleStrip) || (primitive.mode == ModeTriangleFan);
+			if ((positions == InvalidIndex) || !supportedMode)
+			{
+				log::warning("Skipping primitive of mesh %s: %s", mesh.name.c_str(),
+					supportedMode ? "no positions" : "only triangles are supported");
+				continue;
+			}
+
+			bool consistent = (primitive.indices == InvalidIndex) || (primitive.indices < accessors.size());
+			for (uint32_t a = 1; consistent && (a < AttributesCount); ++a)
+			{
+				if (primitive.attributes[a] != InvalidIndex)
+					consistent = accessors[primitive.attributes[a]].count == accessors[positions].count;
+			}
+
+			if (consistent)
+				mesh.primitives.emplace_back(primitive);
+			else
+				log::warning("Skipping primitive of mesh %s: inconsistent accessors", mesh.name.c_str());
+		}
+	}
+}
+
+void GLTFLoaderPrivate::parseNodes() {
+	using namespace gltf_local;
+
+	Vector<Dictionary> nodeValues = dictionariesForKey(data, "nodes");
+	nodes.resize(nodeValues.size());
+	for (size_t i = 0, e = nodeValues.size(); i < e; ++i)
+	{
+		const Dictionary& value = nodeValues[i];
+		Node& node = nodes[i];
+		node.name = value.stringForKey("name", "node_" + intToStr(i))->content;
+		node.mesh = indexForKey(value, "mesh");
+		node.skin = indexForKey(value, "skin");
+
+		if (node.mesh >= meshes.size())
+			node.mesh = InvalidIndex;
+
+		if (value.hasKey("matrix"))
+		{
+			float m[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+			numbersForKey(value, "matrix", m, 16);
+
+			/*
+			 * Column major glTF matrix has the same memory layout as engine's one
+			 */
+			mat4 transform;
+			for (uint32_t r = 0; r < 4; ++r)
+			{
+				for (uint32_t c = 0; c < 4; ++c)
+					transform[r][c] = m[4 * r + c];
+			}
+			decomposeMatrix(transform, node.translation, node.orientation, node.scale);
+		}
+		else
+		{
+			float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			numbersForKey(value, "translation", node.translation.data(), 3);
+			numbersForKey(value, "rotation", rotation, 4);
+			numbersForKey(value, "scale", node.scale.data(), 3);
+			node.orientation = quaternionFromGLTF(rotation);
+		}
+
+		for (uint32_t child : indicesForKey(value, "children"))
+		{
+			if (child < nodeValues.size())
+				node.children.emplace_back(child);
+		}
+	}
+
+	for (uint32_t i = 0, e = static_cast<uint32_t>(nodes.size()); i < e; ++i)
+	{
+		for (uint32_t child : nodes[i].children)
+			nodes[child].parent = i;
+	}
+
+	for (const Dictionary& value : dictionariesForKey(data, "skins"))
+	{
+		Skin skin;
+		skin.inverseBindMatrices = indexForKey(value, "inverseBindMatrices");
+		/*
+		 * Invalid joints are kept, so positions in the list still match JOINTS_0 values
+		 */
+		for (uint32_t joint : indicesForKey(value, "joints"))
+		{
+			if (joint < nodes.size())
+				nodes[joint].joint = true;
+			skin.joints.emplace_back((joint < nodes.size()) ? joint : InvalidIndex);
+		}
+		skins.emplace_back(skin);
+	}
+
+	uint32_t sceneIndex = indexForKey(data, "scene");
+	Vector<Dictionary> scenes = dictionariesForKey(data, "scenes");
+	if (scenes.empty())
+	{
+		for (uint32_t i = 0, e = static_cast<uint32_t>(nodes.size()); i < e; ++i)
+		{
+			if (nodes[i].parent == InvalidIndex)
+				rootNodes.emplace_back(i);
+		}
+	}
+	else
+	{
+		for (uint32_t root : indicesForKey(scenes[sceneIndex < scenes.size() ? sceneIndex : 0], "nodes"))
+		{
+			if (root < nodes.size())
+				rootNodes.emplace_back(root);
+		}
+	}
+}
+
+void GLTFLoaderPrivate::parseMaterials() {
+	using namespace gltf_local;
+
+	Vector<Dictionary> images = dictionariesForKey(data, "images");
+	for (const Dictionary& value : dictionariesForKey(data, "textures"))
+	{
+		uint32_t source = indexForKey(value, "source");
+		std::string uri = (source < images.size()) ? images[source].stringForKey("uri")->content : std::string();
+		if (uri.empty() || (uri.find("data:") == 0))
+		{
+			log::warning("Embedded glTF images are not supported (%s)", inputFileName.c_str());
+			uri.clear();
+		}
+		textureFiles.emplace_back(uri.empty() ? uri : inputFilePath + uri);
+	}
+
+	Vector<Dictionary> materialValues = dictionariesForKey(data, "materials");
+	for (size_t i = 0, e = materialValues.size(); i < e; ++i)
+	{
+		const Dictionary& value = materialValues[i];
+		Dictionary pbr = value.dictionaryForKey("pbrMetallicRoughness");
+		Dictionary normal = value.dictionaryForKey("normalTexture");
+
+		MaterialDescription desc;
+		desc.name = value.stringForKey("name", "material_" + intToStr(i))->content;
+		desc.metallic = numberForKey(pbr, "metallicFactor", 1.0f);
+		desc.roughness = numberForKey(pbr, "roughnessFactor", 1.0f);
+		desc.normalScale = numberForKey(normal, "scale", 1.0f);
+		desc.baseColorTexture = indexForKey(pbr.dictionaryForKey("baseColorTexture"), "index");
+		desc.normalTexture = indexForKey(normal, "index");
+		desc.emissiveTexture = indexForKey(value.dictionaryForKey("emissiveTexture"), "index");
+		numbersForKey(pbr, "baseColorFactor", desc.baseColor.data(), 4);
+		numbersForKey(value, "emissiveFactor", desc.emissive.data(), 3);
+		materialDescriptions.emplace_back(desc);
+	}
+}
+
+/*
+ * Channels targeting the same node are merged into single animation,
+ * sampled at union of their key times. Animation interpolates keys linearly,
+ * so step keys are held by a duplicate just before the next key,
+ * and cubic splines are sampled at several times within each interval
+ */
+void GLTFLoaderPrivate::parseAnimations() {
+	using namespace gltf_local;
+
+	enum : uint32_t
+	{
+		Translation,
+		Rotation,
+		Scale,
+		PathsCount
+	};
+
+	Vector<Dictionary> animationValues = dictionariesForKey(data, "animations");
+	for (const Dictionary& animation : animationValues)
+	{
+		Vector<Sampler> samplers;
+		for (const Dictionary& value : dictionariesForKey(animation, "samplers"))
+		{
+			Sampler sampler;
+			sampler.input = indexForKey(value, "input");
+			sampler.output = indexForKey(value, "output");
+
+			std::string interpolation = value.stringForKey("interpolation", "LINEAR")->content;
+			sampler.step = (interpolation == "STEP");
+			sampler.cubic = (interpolation == "CUBICSPLINE");
+
+			bool valid = (sampler.input < accessors.size()) && (sampler.output < accessors.size());
+			if (valid)
+			{
+				const Accessor& input = accessors[sampler.input];
+				const Accessor& output = accessors[sampler.output];
+				valid = (input.data != nullptr) && (output.data != nullptr) && (input.count > 0) &&
+					(output.count >= input.count * (sampler.cubic ? 3 : 1));
+			}
+
+			if (!valid)
+				sampler.input = InvalidIndex;
+
+			samplers.emplace_back(sampler);
+		}
+
+		Map<uint32_t, std::array<uint32_t, PathsCount>> nodeChannels;
+		for (const Dictionary& value : dictionariesForKey(animation, "channels"))
+		{
+			Dictionary target = value.dictionaryForKey("target");
+			uint32_t node = indexForKey(target, "node");
+			uint32_t sampler = indexForKey(value, "sampler");
+			if ((node >= nodes.size()) || (sampler >= samplers.size()) || (samplers[sampler].input == InvalidIndex))
+				continue;
+
+			std::string path = target.stringForKey("path")->content;
+			uint32_t pathIndex = (path == "translation") ? Translation : (path == "rotation") ? Rotation : (path == "scale") ? Scale : PathsCount;
+			if (pathIndex == PathsCount)
+				continue;
+
+			if (nodeChannels.count(node) == 0)
+				nodeChannels[node].fill(InvalidIndex);
+			nodeChannels[node][pathIndex] = sampler;
+		}
+
+		float startTime = std::numeric_limits<float>::max();
+		float stopTime = -std::numeric_limits<float>::max();
+		for (const auto& channels : nodeChannels)
+		{
+			for (uint32_t sampler : channels.second)
+			{
+				if (sampler == InvalidIndex)
+					continue;
+
+				const Accessor& input = accessors[samplers[sampler].input];
+				startTime = std::min(startTime, componentValue(input.data, input.componentType, input.normalized));
+				stopTime = std::max(stopTime, componentValue(input.data + (input.count - 1) * input.stride, input.componentType, input.normalized));
+			}
+		}
+
+		if (startTime > stopTime)
+			startTime = stopTime = 0.0f;
+
+		/*
+		 * Every node gets an entry for each animation, so clip indices match across the nodes,
+		 * nodes without channels keep their rest pose during the clip
+		 */
+		for (uint32_t nodeIndex = 0, nodesCount = static_cast<uint32_t>(nodes.size()); nodeIndex < nodesCount; ++nodeIndex)
+		{
+			Node& node = nodes[nodeIndex];
+
+			s3d::Animation result;
+			result.setOutOfRangeMode(s3d::Animation::OutOfRangeMode_Loop);
+			result.setTimeRange(startTime, stopTime);
+
+			auto nodeChannel = nodeChannels.find(nodeIndex);
+			if (nodeChannel == nodeChannels.end())
+			{
+				result.addKeyFrame(startTime, node.translation, node.orientation, node.scale);
+				node.animations.emplace_back(result);
+				continue;
+			}
+			const auto& channels = *nodeChannel;
+
+			Vector<float> times;
+			for (uint32_t sampler : channels.second)
+			{
+				if (sampler == InvalidIndex)
+					continue;
+
+				const Sampler& channelSampler = samplers[sampler];
+				const Accessor& input = accessors[channelSampler.input];
+				float previousTime = 0.0f;
+				for (uint32_t i = 0; i < input.count; ++i)
+				{
+					float time = componentValue(input.data + i * input.stride, input.componentType, input.normalized);
+					if ((i > 0) && (time > previousTime))
+					{
+						if (channelSampler.step)
+						{
+							times.emplace_back(std::nextafter(time, previousTime));
+						}
+						else if (channelSampler.cubic)
+						{
+							float dt = (time - previousTime) / static_cast<float>(CubicSplineSubdivisions);
+							for (uint32_t k = 1; k < CubicSplineSubdivisions; ++k)
+								times.emplace_back(previousTime + dt * static_cast<float>(k));
+						}
+					}
+					times.emplace_back(time);
+					previousTime = time;
+				}
+			}
+			std::sort(times.begin(), times.end());
+			times.erase(std::unique(times.begin(), times.end()), times.end());
+
+			for (float time : times)
+			{
+				vec3 translation = node.translation;
+				quaternion orientation = node.orientation;
+				vec3 scale = node.scale;
+
+				if (channels.second[Translation] != InvalidIndex)
+					sample(samplers[channels.second[Translation]], time, translation.data(), 3, false);
+
+				if (channels.second[Scale] != InvalidIndex)
+					sample(samplers[channels.second[Scale]], time, scale.data(), 3, false);
+
+				if (channels.second[Rotation] != InvalidIndex)
+				{
+					float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+					sample(samplers[channels.second[Rotation]], time, rotation, 4, true);
+					orientation = quaternionFromGLTF(rotation);
+				}
+
+				result.addKeyFrame(time, translation, orientation, scale);
+			}
+			node.animations.emplace_back(result);
+		}
+	}
+}
+
+void GLTFLoaderPrivate::readComponents(const Accessor& accessor, uint32_t index, float* values, uint32_t count) const {
+	if (accessor.data == nullptr)
+		return;
+
+	const char* ptr = accessor.data + index * accessor.stride;
+	uint32_t size = gltf_local::componentSize(accessor.componentType);
+	count = std::min(count, accessor.components);
+	for (uint32_t c = 0; c < count; ++c)
+		values[c] = gltf_local::componentValue(ptr + c * size, accessor.componentType, accessor.normalized);
+}
+
+/*
+ * Cubic spline keys are stored as in-tangent, value, out-tangent
+ * and evaluated as Hermite curve between the values
+ */
+void GLTFLoaderPrivate::sample(const Sampler& sampler, float time, float* values, uint32_t components, bool rotation) const {
+	const Accessor& input = accessors[sampler.input];
+	const Accessor& output = accessors[sampler.output];
+
+	auto timeAt = [&input](uint32_t i)
+	{
+		return gltf_local::componentValue(input.data + i * input.stride, input.componentType, input.normalized);
+	};
+
+	uint32_t valueOffset = sampler.cubic ? 1 : 0;
+	uint32_t valueStride = sampler.cubic ? 3 : 1;
+
+	/*
+	 * Last key with time not greater than requested
+	 */
+	uint32_t lower = 0;
+	uint32_t upper = input.count;
+	while (upper - lower > 1)
+	{
+		uint32_t middle = lower + (upper - lower) / 2;
+		if (timeAt(middle) <= time)
+			lower = middle;
+		else
+			upper = middle;
+	}
+
+	readComponents(output, lower * valueStride + valueOffset, values, components);
+	if (sampler.step || (lower + 1 >= input.count) || (time <= timeAt(lower)))
+		return;
+
+	float next[4] = { values[0], values[1], values[2], components > 3 ? values[3] : 0.0f };
+	readComponents(output, (lower + 1) * valueStride + valueOffset, next, components);
+
+	float t0 = timeAt(lower);
+	float dt = std::max(timeAt(lower + 1) - t0, std::numeric_limits<float>::epsilon());
+	float t = clamp((time - t0) / dt, 0.0f, 1.0f);
+
+	if (sampler.cubic)
+	{
+		float outTangent[4] = { };
+		float inTangent[4] = { };
+		readComponents(output, lower * valueStride + 2, outTangent, components);
+		readComponents(output, (lower + 1) * valueStride, inTangent, components);
+
+		float t2 = t * t;
+		float t3 = t2 * t;
+		float h00 = 2.0f * t3 - 3.0f * t2 + 1.0f;
+		float h10 = (t3 - 2.0f * t2 + t) * dt;
+		float h01 = 3.0f * t2 - 2.0f * t3;
+		float h11 = (t3 - t2) * dt;
+		for (uint32_t c = 0; c < components; ++c)
+			values[c] = h00 * values[c] + h10 * outTangent[c] + h01 * next[c] + h11 * inTangent[c];
+
+		if (rotation)
+		{
+			quaternion q = normalize(quaternion(values[3], values[0], values[1], values[2]));
+			values[0] = q.vector.x;
+			values[1] = q.vector.y;
+			values[2] = q.vector.z;
+			values[3] = q.scalar;
+		}
+	}
+	else if (rotation)
+	{
+		quaternion q = slerp(quaternion(values[3], values[0], values[1], values[2]), quaternion(next[3], next[0], next[1], next[2]), t);
+		q = normalize(q);
+		values[0] = q.vector.x;
+		values[1] = q.vector.y;
+		values[2] = q.vector.z;
+		values[3] = q.scalar;
+	}
+	else
+	{
+		for (uint32_t c = 0; c < components; ++c)
+			values[c] += (next[c] - values[c]) * t;
+	}
+}
+
+/*
+ * Mesh building
+ */
+void GLTFLoaderPrivate::buildMeshes() {
+	/*
+	 * Meshes vary in size a lot, so they are distributed in small ranges
+	 */
+	threading::parallelFor(static_cast<uint32_t>(meshes.size()), 1, [this](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t m = begin; m < end; ++m)
+			buildMesh(meshes[m]);
+	});
+}
+
+void GLTFLoaderPrivate::buildMesh(MeshData& mesh) {
+	using namespace gltf_local;
+
+	if (mesh.primitives.empty())
+		return;
+
+	bool hasAttribute[AttributesCount] = { };
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	for (const Primitive& primitive : mesh.primitives)
+	{
+		uint32_t primitiveVertices = accessors[primitive.attributes[0]].count;
+		uint32_t primitiveIndices = (primitive.indices == InvalidIndex) ? primitiveVertices : accessors[primitive.indices].count;
+		if (primitive.mode != ModeTriangles)
+			primitiveIndices = 3 * (std::max(primitiveIndices, 2u) - 2);
+
+		vertexCount += primitiveVertices;
+		indexCount += primitiveIndices;
+		for (uint32_t a = 0; a < AttributesCount; ++a)
+			hasAttribute[a] |= (primitive.attributes[a] != InvalidIndex);
+	}
+
+	VertexDeclaration decl(true);
+	for (uint32_t a = 0; a < AttributesCount; ++a)
+	{
+		if (hasAttribute[a])
+			decl.push_back(attributes[a].usage, attributes[a].type);
+	}
+
+	/*
+	 * Skinned meshes need both joints and weights
+	 */
+	if (decl.has(VertexAttributeUsage::BlendIndices) != decl.has(VertexAttributeUsage::BlendWeights))
+	{
+		decl.remove(VertexAttributeUsage::BlendIndices);
+		decl.remove(VertexAttributeUsage::BlendWeights);
+	}
+
+	mesh.vertices = VertexStorage::Pointer::create(decl, vertexCount);
+	mesh.vertices->setName(mesh.name);
+	mesh.vertices->data().fill(0);
+
+	IndexArrayFormat format = (vertexCount <= IndexArray::MaxShortIndex) ? IndexArrayFormat::Format_16bit : IndexArrayFormat::Format_32bit;
+	mesh.indices = IndexArray::Pointer::create(format, indexCount, PrimitiveType::Triangles);
+	mesh.indices->setName(mesh.name);
+
+	uint32_t baseVertex = 0;
+	uint32_t baseIndex = 0;
+	for (const Primitive& primitive : mesh.primitives)
+	{
+		copyVertices(primitive, mesh.vertices, baseVertex);
+
+		uint32_t primitiveVertices = accessors[primitive.attributes[0]].count;
+		const Accessor* indices = (primitive.indices == InvalidIndex) ? nullptr : &accessors[primitive.indices];
+		uint32_t sourceCount = (indices == nullptr) ? primitiveVertices : indices->count;
+
+		auto sourceIndex = [indices](uint32_t i)
+		{
+			return ((indices == nullptr) || (indices->data == nullptr)) ? i :
+				indexValue(indices->data + i * indices->stride, indices->componentType);
+		};
+
+		/*
+		 * Indices referring outside of the primitive's vertices would address other primitives
+		 * or memory past the vertex storage, such primitives are not drawn
+		 */
+		bool validIndices = true;
+		for (uint32_t i = 0; validIndices && (i < sourceCount); ++i)
+			validIndices = sourceIndex(i) < primitiveVertices;
+
+		if (!validIndices)
+		{
+			log::warning("Skipping primitive of mesh %s: indices are out of vertex range", mesh.name.c_str());
+			sourceCount = 0;
+		}
+
+		Batch batch;
+		batch.firstIndex = baseIndex;
+		batch.material = primitive.material;
+
+		uint32_t indexSize = static_cast<uint32_t>(format);
+		bool directCopy = (primitive.mode == ModeTriangles) && (baseVertex == 0) && (indices != nullptr) &&
+			(indices->data != nullptr) && (componentSize(indices->componentType) == indexSize) && (indices->stride == indexSize);
+
+		if (directCopy)
+		{
+			memcpy(mesh.indices->binary() + baseIndex * indexSize, indices->data, sourceCount * indexSize);
+			baseIndex += sourceCount;
+		}
+		else if (primitive.mode == ModeTriangles)
+		{
+			for (uint32_t i = 0; i < sourceCount; ++i)
+				mesh.indices->setIndex(baseVertex + sourceIndex(i), baseIndex++);
+		}
+		else
+		{
+			for (uint32_t i = 2; i < sourceCount; ++i)
+			{
+				bool fan = (primitive.mode == ModeTriangleFan);
+				uint32_t i0 = fan ? 0 : ((i % 2 == 0) ? i - 2 : i - 1);
+				uint32_t i1 = fan ? i - 1 : ((i % 2 == 0) ? i - 1 : i - 2);
+				mesh.indices->setIndex(baseVertex + sourceIndex(i0), baseIndex++);
+				mesh.indices->setIndex(baseVertex + sourceIndex(i1), baseIndex++);
+				mesh.indices->setIndex(baseVertex + sourceIndex(i), baseIndex++);
+			}
+		}
+
+		batch.count = baseIndex - batch.firstIndex;
+		mesh.batches.emplace_back(batch);
+		baseVertex += primitiveVertices;
+	}
+	mesh.indices->setActualSize(baseIndex);
+}
+
+/*
+ * Interleaved float attributes laid out exactly as in declaration are copied as single block
+ */
+bool GLTFLoaderPrivate::canCopyVertices(const Primitive& primitive, const VertexDeclaration& decl,
+	uint32_t vertexCount, const char*& source) {
+	using namespace gltf_local;
+
+	source = nullptr;
+	uint32_t elements = 0;
+	for (uint32_t a = 0; a < AttributesCount; ++a)
+	{
+		if (primitive.attributes[a] == InvalidIndex)
+			continue;
+
+		const Accessor& accessor = accessors[primitive.attributes[a]];
+		if (!decl.has(attributes[a].usage) || (accessor.data == nullptr) || (accessor.componentType != ComponentFloat) ||
+			(accessor.components != dataTypeComponents(attributes[a].type)) || (accessor.stride != decl.sizeInBytes()))
+		{
+			return false;
+		}
+
+		const char* base = accessor.data - decl.elementForUsage(attributes[a].usage).offset();
+		if ((source != nullptr) && (base != source))
+			return false;
+
+		source = base;
+		++elements;
+	}
+
+	if ((source == nullptr) || (elements != decl.numElements()))
+		return false;
+
+	const Accessor& positions = accessors[primitive.attributes[0]];
+	return (source >= positions.data - positions.offset) && (source + vertexCount * decl.sizeInBytes() <= positions.limit);
+}
+
+void GLTFLoaderPrivate::copyVertices(const Primitive& primitive, VertexStorage::Pointer& vs, uint32_t baseVertex) {
+	using namespace gltf_local;
+
+	const VertexDeclaration& decl = vs->declaration();
+	uint32_t vertexCount = accessors[primitive.attributes[0]].count;
+	uint32_t stride = vs->stride();
+	ET_ASSERT(baseVertex + vertexCount <= vs->capacity());
+	char* target = vs->data().binary() + baseVertex * stride;
+
+	const char* source = nullptr;
+	if (canCopyVertices(primitive, decl, vertexCount, source))
+	{
+		memcpy(target, source, vertexCount * stride);
+		return;
+	}
+
+	for (uint32_t a = 0; a < AttributesCount; ++a)
+	{
+		VertexAttributeUsage usage = attributes[a].usage;
+		if (!decl.has(usage))
+			continue;
+
+		char* dst = target + vs->offsetOfAttribute(usage);
+		uint32_t components = dataTypeComponents(attributes[a].type);
+
+		/*
+		 * Vertex colors default to white, three component colors are opaque
+		 */
+		if ((usage == VertexAttributeUsage::Color) && ((primitive.attributes[a] == InvalidIndex) || (accessors[primitive.attributes[a]].components < 4)))
+		{
+			vec4 white(1.0f);
+			for (uint32_t v = 0; v < vertexCount; ++v)
+				memcpy(dst + v * stride, white.data(), sizeof(white));
+		}
+
+		if (primitive.attributes[a] == InvalidIndex)
+			continue;
+
+		const Accessor& accessor = accessors[primitive.attributes[a]];
+		if (accessor.data == nullptr)
+			continue;
+
+		if (accessor.count < vertexCount)
+		{
+			log::warning("glTF attribute %s has fewer elements than positions", attributes[a].name);
+			continue;
+		}
+
+		if (attributes[a].type == DataType::IntVec4)
+		{
+			uint32_t size = componentSize(accessor.componentType);
+			uint32_t count = std::min(components, accessor.components);
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				int32_t values[4] = { };
+				for (uint32_t c = 0; c < count; ++c)
+					values[c] = static_cast<int32_t>(indexValue(accessor.data + v * accessor.stride + c * size, accessor.componentType));
+				memcpy(dst + v * stride, values, sizeof(values));
+			}
+		}
+		else if ((accessor.componentType == ComponentFloat) && (accessor.components >= components))
+		{
+			uint32_t size = components * sizeof(float);
+			for (uint32_t v = 0; v < vertexCount; ++v)
+				memcpy(dst + v * stride, accessor.data + v * accessor.stride, size);
+		}
+		else
+		{
+			uint32_t size = std::min(components, accessor.components) * sizeof(float);
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				float values[4] = { };
+				readComponents(accessor, v, values, components);
+				memcpy(dst + v * stride, values, size);
+			}
+		}
+	}
+}
+
+/*
+ * GPU resources and scene
+ */
+void GLTFLoaderPrivate::loadMaterials(RenderInterface::Pointer& renderer, s3d::Storage& storage, ObjectsCache& cache) {
+	storage.flush();
+	materials.clear();
+
+	auto loadTexture = [this, &renderer, &cache](uint32_t index, const Texture::Pointer& fallback)
+	{
+		if ((index >= textureFiles.size()) || textureFiles[index].empty())
+			return fallback;
+
+		Texture::Pointer texture = renderer->loadTexture(textureFiles[index], cache);
+		return texture.valid() ? texture : fallback;
+	};
+
+	Material::Pointer microfacet = renderer->sharedMaterialLibrary().loadDefaultMaterial(DefaultMaterial::Microfacet);
+	for (const MaterialDescription& desc : materialDescriptions)
+	{
+		MaterialInstance::Pointer m = microfacet->instance();
+		m->setName(desc.name);
+		m->setVector(MaterialVariable::DiffuseReflectance, desc.baseColor);
+		m->setVector(MaterialVariable::EmissiveColor, desc.emissive);
+		m->setFloat(MaterialVariable::RoughnessScale, desc.roughness);
+		m->setFloat(MaterialVariable::MetallnessScale, desc.metallic);
+		m->setFloat(MaterialVariable::NormalScale, desc.normalScale);
+		m->setFloat(MaterialVariable::OpacityScale, desc.baseColor.w);
+		m->setTexture(MaterialTexture::BaseColor, loadTexture(desc.baseColorTexture, renderer->whiteTexture()));
+		m->setTexture(MaterialTexture::Normal, loadTexture(desc.normalTexture, renderer->flatNormalTexture()));
+		m->setTexture(MaterialTexture::Opacity, renderer->whiteTexture());
+		if (desc.emissiveTexture != InvalidIndex)
+			m->setTexture(MaterialTexture::EmissiveColor, loadTexture(desc.emissiveTexture, renderer->whiteTexture()));
+
+		storage.addMaterial(m);
+		materials.emplace_back(m);
+	}
+
+	defaultMaterial = microfacet->instance();
+	defaultMaterial->setName("default_material");
+	defaultMaterial->setTexture(MaterialTexture::BaseColor, renderer->whiteTexture());
+	defaultMaterial->setTexture(MaterialTexture::Normal, renderer->flatNormalTexture());
+	defaultMaterial->setTexture(MaterialTexture::Opacity, renderer->whiteTexture());
+}
+
+uint64_t GLTFLoaderPrivate::uploadMesh(RenderInterface::Pointer& renderer, s3d::Storage& storage, MeshData& mesh) {
+	if (mesh.vertices.invalid() || mesh.batches.empty())
+		return 0;
+
+	storage.addVertexStorage(mesh.vertices);
+	if (storage.indexArray().invalid())
+		storage.setIndexArray(mesh.indices);
+
+	mesh.stream = renderer->sharedGeometryBuffer().allocate(mesh.vertices, mesh.indices);
+	ET_ASSERT(mesh.stream.valid());
+
+	return mesh.vertices->data().size() + mesh.indices->dataSize();
+}
+
+s3d::ElementContainer::Pointer GLTFLoaderPrivate::buildScene(RenderInterface::Pointer& renderer) {
+	s3d::ElementContainer::Pointer result = s3d::ElementContainer::Pointer::create(inputFileName, nullptr);
+
+	for (uint32_t root : rootNodes)
+		createElement(renderer, root, result.pointer());
+
+	for (Node& node : nodes)
+	{
+		if (node.meshElement.valid() && (node.skin < skins.size()))
+			createDeformer(node.meshElement, meshes[node.mesh], skins[node.skin]);
 	}
 
 	return result;
 }
 
-}
\ No newline at end of file
+void GLTFLoaderPrivate::createElement(RenderInterface::Pointer& renderer, uint32_t index, s3d::BaseElement* parent) {
+	Node& node = nodes[index];
+	if (node.element.valid())
+	{
+		log::warning("glTF node %s is referenced more than once", node.name.c_str());
+		return;
+	}
+
+	/*
+	 * Joints are always skeleton elements, so mesh attached to the joint becomes its child
+	 */
+	if (node.joint)
+	{
+		node.element = s3d::SkeletonElement::Pointer::create(node.name, parent);
+		if (node.mesh != InvalidIndex)
+			node.meshElement = createMesh(renderer, meshes[node.mesh], node.name, node.element.pointer());
+	}
+	else if (node.mesh != InvalidIndex)
+	{
+		node.meshElement = createMesh(renderer, meshes[node.mesh], node.name, parent);
+		node.element = node.meshElement;
+	}
+	else
+	{
+		node.element = s3d::ElementContainer::Pointer::create(node.name, parent);
+	}
+
+	node.element->setTranslation(node.translation);
+	node.element->setOrientation(node.orientation);
+	node.element->setScale(node.scale);
+
+	for (const s3d::Animation& animation : node.animations)
+		node.element->addAnimation(animation);
+
+	for (uint32_t child : node.children)
+		createElement(renderer, child, node.element.pointer());
+}
+
+s3d::Mesh::Pointer GLTFLoaderPrivate::createMesh(RenderInterface::Pointer& renderer, const MeshData& mesh,
+	const std::string& name, s3d::BaseElement* parent) {
+	s3d::Mesh::Pointer result = s3d::Mesh::Pointer::create(name, parent);
+	if (mesh.stream.invalid())
+		return result;
+
+	for (const Batch& batch : mesh.batches)
+	{
+		const MaterialInstance::Pointer& material = (batch.material < materials.size()) ? materials[batch.material] : defaultMaterial;
+		RenderBatch::Pointer rb = renderer->allocateRenderBatch(material, mesh.stream, batch.firstIndex, batch.count);
+		rb->setVertexStorage(mesh.vertices);
+		rb->setIndexArray(mesh.indices);
+		result->addRenderBatch(rb);
+	}
+	result->calculateSupportData();
+	return result;
+}
+
+/*
+ * Cluster per joint, so cluster indices match JOINTS_0 values in the vertex data.
+ * Skinned vertices are in bind space, mesh node transform does not affect them
+ */
+void GLTFLoaderPrivate::createDeformer(s3d::Mesh::Pointer& mesh, const MeshData& data, const Skin& skin) {
+	VertexStorage::Pointer vs = data.vertices;
+	if (vs.invalid() || !vs->hasAttribute(VertexAttributeUsage::BlendIndices))
+		return;
+
+	/*
+	 * Joints outside of the scene (or invalid ones) have no element to follow,
+	 * such mesh is kept in bind pose
+	 */
+	for (uint32_t joint : skin.joints)
+	{
+		if ((joint == InvalidIndex) || nodes[joint].element.invalid())
+		{
+			log::warning("Mesh %s is not skinned: skin refers to joint which is not in the scene", mesh->name().c_str());
+			return;
+		}
+	}
+
+	const Accessor* inverseBindMatrices = (skin.inverseBindMatrices < accessors.size()) ?
+		&accessors[skin.inverseBindMatrices] : nullptr;
+
+	s3d::MeshDeformer::Pointer deformer = s3d::MeshDeformer::Pointer::create();
+	for (uint32_t j = 0, je = static_cast<uint32_t>(skin.joints.size()); j < je; ++j)
+	{
+		mat4 inverseBindMatrix = identityMatrix;
+		if ((inverseBindMatrices != nullptr) && (j < inverseBindMatrices->count))
+		{
+			float m[16] = { };
+			readComponents(*inverseBindMatrices, j, m, 16);
+			for (uint32_t r = 0; r < 4; ++r)
+			{
+				for (uint32_t c = 0; c < 4; ++c)
+					inverseBindMatrix[r][c] = m[4 * r + c];
+			}
+		}
+
+		s3d::MeshDeformerCluster::Pointer cluster = s3d::MeshDeformerCluster::Pointer::create();
+		cluster->setMeshInitialTransform(identityMatrix);
+		cluster->setLinkInitialTransform(inverseBindMatrix.inverted());
+		cluster->setLinkTag(skin.joints[j]);
+		cluster->setLink(nodes[skin.joints[j]].element);
+		deformer->addCluster(cluster);
+	}
+
+	auto& clusters = deformer->clusters();
+	auto bli = vs->accessData<DataType::IntVec4>(VertexAttributeUsage::BlendIndices, 0);
+	auto blw = vs->accessData<DataType::Vec4>(VertexAttributeUsage::BlendWeights, 0);
+	for (uint32_t v = 0, ve = vs->capacity(); v < ve; ++v)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			uint32_t joint = static_cast<uint32_t>(bli[v][c]);
+			if ((blw[v][c] > 0.0f) && (joint < clusters.size()))
+				clusters[joint]->weights().emplace_back(v, blw[v][c]);
+		}
+	}
+
+	for (const s3d::MeshDeformerCluster::Pointer& cluster : clusters)
+		cluster->sortWeights();
+
+	mesh->setDeformer(deformer);
+}
+
+}
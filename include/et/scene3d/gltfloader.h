@@ -11,6 +11,12 @@
 
 namespace et {
 
+/*
+ * Loads glTF 2.0 scenes from .gltf (with external or embedded buffers) and binary .glb files:
+ * node hierarchy, meshes (including KHR_mesh_quantization attributes), materials, skins and animations.
+ * Primitives of the mesh share single vertex storage and index array,
+ * meshes are built in parallel
+ */
 class GLTFLoaderPrivate;
 class GLTFLoader : public ModelLoader
 {
@@ -20,8 +26,13 @@ public:
 
 	s3d::ElementContainer::Pointer load(RenderInterface::Pointer, s3d::Storage&, ObjectsCache&) override;
 
+protected:
+	void prepareAsync() override;
+	bool finalizeAsync(RenderInterface::Pointer, s3d::Storage&, ObjectsCache&, uint64_t& budget,
+		s3d::ElementContainer::Pointer& result) override;
+
 private:
-	ET_DECLARE_PIMPL(GLTFLoader, 256);
+	ET_DECLARE_PIMPL(GLTFLoader, 768);
 };
 
 }
@@ -50,6 +50,8 @@ void Mesh::calculateSupportData()
 		_supportData.boundingBox = BoundingBox(0.5f * (minVertex + maxVertex), 0.5f * dimensions);
 		_supportData.boundingSphereRadius =  0.5f * std::max(std::max(dimensions.x, dimensions.y), dimensions.z);
 	}
+
+	transformInvalidated();
 }
 
 Mesh* Mesh::duplicate()
@@ -83,9 +85,24 @@ void Mesh::transformInvalidated()
 	_supportData.shouldUpdateBoundingSphereUntransformed = true;
 }
 
+/*
+ * Transformed bounds depend on the transforms of all ancestors,
+ * which are tracked by the version of the final transform
+ */
+void Mesh::validateTransformedSupportData()
+{
+	uint64_t version = finalTransformVersion();
+	if (_supportData.transformVersion != version)
+	{
+		_supportData.shouldUpdateBoundingBox = true;
+		_supportData.shouldUpdateBoundingSphere = true;
+		_supportData.transformVersion = version;
+	}
+}
+
 float Mesh::finalTransformScale()
 {
-	return 1.0f / std::pow(std::abs(finalInverseTransform().mat3().determinant()), 1.0f / 3.0f);
+	return std::pow(std::abs(finalTransform().mat3().determinant()), 1.0f / 3.0f);
 }
 
 const Sphere& Mesh::boundingSphereUntransformed()
@@ -100,6 +117,7 @@ const Sphere& Mesh::boundingSphereUntransformed()
 
 const Sphere& Mesh::boundingSphere()
 {
+	validateTransformedSupportData();
 	if (_supportData.shouldUpdateBoundingSphere)
 	{
 		const auto& ft = finalTransform();
@@ -117,6 +135,7 @@ const BoundingBox& Mesh::boundingBox()
 
 const BoundingBox& Mesh::tranformedBoundingBox()
 {
+	validateTransformedSupportData();
 	if (_supportData.shouldUpdateBoundingBox)
 	{
 		_supportData.transformedBoundingBox = _supportData.boundingBox.transform(finalTransform());
@@ -126,6 +145,22 @@ const BoundingBox& Mesh::tranformedBoundingBox()
 	return _supportData.transformedBoundingBox;
 }
 
+void Mesh::addLevelOfDetail(const LevelOfDetail& lod)
+{
+	ET_ASSERT(_levelsOfDetail.empty() || (_levelsOfDetail.back().error <= lod.error));
+	_levelsOfDetail.emplace_back(lod);
+}
+
+const Vector<RenderBatch::Pointer>& Mesh::renderBatchesForError(float maxError) const
+{
+	for (auto i = _levelsOfDetail.rbegin(), e = _levelsOfDetail.rend(); i != e; ++i)
+	{
+		if (i->error <= maxError)
+			return i->renderBatches;
+	}
+	return renderBatches();
+}
+
 const Vector<mat4>& Mesh::deformationMatrices()
 {
 	if (_deformer.valid())
@@ -141,163 +176,125 @@ const Vector<mat4>& Mesh::deformationMatrices()
  * Bake deformations + stuff for it
  */
 
-template <DataType attribType>
-void copyAttributeWithType(VertexStorage::Pointer from, VertexStorage::Pointer to, VertexAttributeUsage attrib)
-{
-	auto c0 = from->accessData<attribType>(attrib, 0);
-	auto c1 = to->accessData<attribType>(attrib, 0);
-	for (uint32_t i = 0; i < from->capacity(); ++i)
-		c1[i] = c0[i];
-}
-
-void copyAttribute(VertexStorage::Pointer from, VertexStorage::Pointer to, VertexAttributeUsage attrib)
-{
-	if (!from->hasAttribute(attrib)) return;
-	
-	switch (from->attributeType(attrib))
-	{
-		case DataType::Float:
-			copyAttributeWithType<DataType::Float>(from, to, attrib);
-			break;
-		case DataType::Int:
-			copyAttributeWithType<DataType::Int>(from, to, attrib);
-			break;
-		case DataType::Vec2:
-			copyAttributeWithType<DataType::Vec2>(from, to, attrib);
-			break;
-		case DataType::Vec3:
-			copyAttributeWithType<DataType::Vec3>(from, to, attrib);
-			break;
-		case DataType::Vec4:
-			copyAttributeWithType<DataType::Vec4>(from, to, attrib);
-			break;
-		case DataType::IntVec2:
-			copyAttributeWithType<DataType::IntVec2>(from, to, attrib);
-			break;
-		case DataType::IntVec3:
-			copyAttributeWithType<DataType::IntVec3>(from, to, attrib);
-			break;
-		case DataType::IntVec4:
-			copyAttributeWithType<DataType::IntVec4>(from, to, attrib);
-			break;
-		default:
-			ET_FAIL("Unhandled attribute type");
-	}
-}
-
 void copyVector3Rotated(VertexStorage::Pointer from, VertexStorage::Pointer to, VertexAttributeUsage attrib,
 	const mat4& transform)
 {
-	if (!from->hasAttribute(attrib)) return;
+	/*
+	 * Four component directions (tangents with handedness) keep their w component
+	 */
+	if (from->hasAttributeWithType(attrib, DataType::Vec4))
+	{
+		const auto c0 = from->accessData<DataType::Vec4>(attrib, 0);
+		auto c1 = to->accessData<DataType::Vec4>(attrib, 0);
+		for (uint32_t i = 0; i < from->capacity(); ++i)
+			c1[i] = vec4(normalize(transform.rotationMultiply(c0[i].xyz())), c0[i].w);
+		return;
+	}
 	
-	auto c0 = from->accessData<DataType::Vec3>(attrib, 0);
+	if (!from->hasAttributeWithType(attrib, DataType::Vec3)) return;
+	
+	const auto c0 = from->accessData<DataType::Vec3>(attrib, 0);
 	auto c1 = to->accessData<DataType::Vec3>(attrib, 0);
 	for (uint32_t i = 0; i < from->capacity(); ++i)
-		c1[i] = transform.rotationMultiply(c0[i]);
+		c1[i] = normalize(transform.rotationMultiply(c0[i]));
 }
 
 void copyVector3Transformed(VertexStorage::Pointer from, VertexStorage::Pointer to, VertexAttributeUsage attrib,
 	const mat4& transform)
 {
-	if (!from->hasAttribute(attrib)) return;
+	if (!from->hasAttributeWithType(attrib, DataType::Vec3)) return;
 	
-	auto c0 = from->accessData<DataType::Vec3>(attrib, 0);
+	const auto c0 = from->accessData<DataType::Vec3>(attrib, 0);
 	auto c1 = to->accessData<DataType::Vec3>(attrib, 0);
 	for (uint32_t i = 0; i < from->capacity(); ++i)
 		c1[i] = transform * c0[i];
 }
 
-void skinVector3Rotated(VertexStorage::Pointer from, VertexStorage::Pointer to, VertexAttributeUsage attrib,
-	const Vector<mat4>& transforms)
+bool Mesh::skinned() const
 {
-	if (!from->hasAttribute(attrib)) return;
+	if (_deformer.invalid() || _deformer->clusters().empty() || renderBatches().empty())
+		return false;
 	
-	auto c0 = from->accessData<DataType::Vec3>(attrib, 0);
-	auto c1 = to->accessData<DataType::Vec3>(attrib, 0);
-	auto bi = to->accessData<DataType::IntVec4>(VertexAttributeUsage::BlendIndices, 0);
-	auto bw = to->accessData<DataType::Vec4>(VertexAttributeUsage::BlendWeights, 0);
-	for (uint32_t i = 0; i < from->capacity(); ++i)
+	for (const RenderBatch::Pointer& rb : renderBatches())
 	{
-		c1[i] =
-			transforms[bi[i][0]].rotationMultiply(c0[i]) * bw[i][0] +
-			transforms[bi[i][1]].rotationMultiply(c0[i]) * bw[i][1] +
-			transforms[bi[i][2]].rotationMultiply(c0[i]) * bw[i][2] +
-			transforms[bi[i][3]].rotationMultiply(c0[i]) * bw[i][3];
+		if (!skinning::canSkin(rb->vertexStorage()))
+			return false;
 	}
+	return true;
 }
 
-void skinVector3Transformed(VertexStorage::Pointer from, VertexStorage::Pointer to, VertexAttributeUsage attrib,
-	const Vector<mat4>& transforms)
+VertexStorage::Pointer Mesh::bakeDeformations(skinning::Method method)
 {
-	if (!from->hasAttribute(attrib)) return;
+	if (renderBatches().empty())
+		return VertexStorage::Pointer();
 	
-	auto c0 = from->accessData<DataType::Vec3>(attrib, 0);
-	auto c1 = to->accessData<DataType::Vec3>(attrib, 0);
-	auto bi = to->accessData<DataType::IntVec4>(VertexAttributeUsage::BlendIndices, 0);
-	auto bw = to->accessData<DataType::Vec4>(VertexAttributeUsage::BlendWeights, 0);
-	for (uint32_t i = 0; i < from->capacity(); ++i)
-	{
-		c1[i] = (transforms[bi[i][0]] * c0[i]) * bw[i][0] + (transforms[bi[i][1]] * c0[i]) * bw[i][1] +
-			(transforms[bi[i][2]] * c0[i]) * bw[i][2] +  (transforms[bi[i][3]] * c0[i]) * bw[i][3];
-	}
-}
+	const VertexStorage::Pointer& source = renderBatches().front()->vertexStorage();
+	ET_ASSERT(std::all_of(renderBatches().begin(), renderBatches().end(), [&source](const RenderBatch::Pointer& rb)
+		{ return rb->vertexStorage() == source; }));
 
-bool Mesh::skinned() const
-{
-	ET_FAIL("TODO");
-	/*
-	 * TODO
-	 *
-	return _vertexStorage->hasAttribute(VertexAttributeUsage::BlendIndices) &&
-		_vertexStorage->hasAttribute(VertexAttributeUsage::BlendWeights);
-	// */
-	return false;
+	return bakeDeformations(source, method);
 }
 
-VertexStorage::Pointer Mesh::bakeDeformations()
+VertexStorage::Pointer Mesh::bakeDeformations(const VertexStorage::Pointer& source, skinning::Method method)
 {
-	ET_FAIL("TODO");
-	
-	/*
-	 * TODO
-	 *
-	const auto& transforms = deformationMatrices();
-	
-	VertexStorage::Pointer result =
-		VertexStorage::Pointer::create(_vertexStorage->declaration(), _vertexStorage->capacity());
-	
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::Color);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::TexCoord0);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::TexCoord1);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::TexCoord2);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::TexCoord3);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::Smoothing);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::BlendIndices);
-	copyAttribute(_vertexStorage, result, VertexAttributeUsage::BlendWeights);
+	VertexStorage::Pointer result = VertexStorage::Pointer::create(source->declaration(), source->capacity());
+	memcpy(result->data().binary(), source->data().binary(), source->data().dataSize());
 	
 	if (skinned())
 	{
-		skinVector3Transformed(_vertexStorage, result, VertexAttributeUsage::Position, transforms);
-		skinVector3Rotated(_vertexStorage, result, VertexAttributeUsage::Normal, transforms);
-		skinVector3Rotated(_vertexStorage, result, VertexAttributeUsage::Tangent, transforms);
-		skinVector3Rotated(_vertexStorage, result, VertexAttributeUsage::Binormal, transforms);
+		skinning::skin(source, result, deformationMatrices(), method);
 	}
 	else
 	{
 		const mat4& ft = finalTransform();
-		copyVector3Transformed(_vertexStorage, result, VertexAttributeUsage::Position, ft);
-		copyVector3Rotated(_vertexStorage, result, VertexAttributeUsage::Normal, ft);
-		copyVector3Rotated(_vertexStorage, result, VertexAttributeUsage::Tangent, ft);
-		copyVector3Rotated(_vertexStorage, result, VertexAttributeUsage::Binormal, ft);
+		copyVector3Transformed(source, result, VertexAttributeUsage::Position, ft);
+		copyVector3Rotated(source, result, VertexAttributeUsage::Normal, ft);
+		copyVector3Rotated(source, result, VertexAttributeUsage::Tangent, ft);
+		copyVector3Rotated(source, result, VertexAttributeUsage::Binormal, ft);
 	}
 	return result;
-	// */
-	return VertexStorage::Pointer();
+}
+
+const VertexStorage::Pointer& Mesh::deformedStorage()
+{
+	const VertexStorage::Pointer& source = renderBatches().front()->vertexStorage();
+	const Vector<mat4>& matrices = deformationMatrices();
+
+	if (_deformedStorage.baked.invalid() || (_deformedStorage.source != source) || (_deformedStorage.matrices != matrices))
+	{
+		_deformedStorage.baked = bakeDeformations();
+		_deformedStorage.source = source;
+		_deformedStorage.matrices = matrices;
+	}
+	return _deformedStorage.baked;
 }
 
 RayIntersection Mesh::intersectsWorldSpaceRay(const ray3d& ray)
 {
 	RayIntersection result;
+
+	/*
+	 * Deformed vertices are baked in world space, intersection time there is squared distance
+	 */
+	if (skinned())
+	{
+		const VertexStorage::Pointer& deformed = deformedStorage();
+		for (const RenderBatch::Pointer& rb : renderBatches())
+		{
+			RayIntersection batchIntersection = rb->intersectsLocalSpaceRay(ray, deformed);
+			if (batchIntersection.occurred && (batchIntersection.time < result.time))
+			{
+				result.occurred = true;
+				result.time = batchIntersection.time;
+			}
+		}
+
+		if (result.occurred)
+			result.time = std::sqrt(result.time);
+
+		return result;
+	}
+
 	mat4 invTransform = transform().inverted();
 	ray3d localRay(invTransform * ray.origin, invTransform.rotationMultiply(ray.direction));
 	for (const RenderBatch::Pointer& rb : renderBatches())
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <et/rendering/base/skinning.h>
 #include <et/scene3d/renderableelement.h>
 #include <et/scene3d/meshdeformer.h>
 
@@ -21,6 +22,12 @@ public:
 	
 	static const std::string defaultMeshName;
 
+	struct LevelOfDetail
+	{
+		Vector<RenderBatch::Pointer> renderBatches;
+		float error = 0.0f;
+	};
+
 public:
 	Mesh(const std::string& = defaultMeshName, BaseElement* = nullptr);
 	
@@ -48,7 +55,24 @@ public:
 	const Vector<mat4>& deformationMatrices();
 
 	bool skinned() const;
-	VertexStorage::Pointer bakeDeformations();
+
+	/*
+	 * Returns copy of the vertex storage with deformations (or final transform) applied, in world space.
+	 * Parameterless version bakes vertex storage shared by render batches
+	 */
+	VertexStorage::Pointer bakeDeformations(skinning::Method = skinning::Method::LinearBlend);
+	VertexStorage::Pointer bakeDeformations(const VertexStorage::Pointer&, skinning::Method = skinning::Method::LinearBlend);
+
+	/*
+	 * Levels of detail should be added in order of increasing error (object space units),
+	 * render batches of the mesh itself are the level with zero error
+	 */
+	void addLevelOfDetail(const LevelOfDetail&);
+
+	const Vector<LevelOfDetail>& levelsOfDetail() const
+		{ return _levelsOfDetail; }
+
+	const Vector<RenderBatch::Pointer>& renderBatchesForError(float maxError) const;
 
 	RayIntersection intersectsWorldSpaceRay(const ray3d& ray) override;
 	
@@ -62,15 +86,33 @@ protected:
 		BoundingBox boundingBox;
 		BoundingBox transformedBoundingBox;
 		float boundingSphereRadius = 0.0f;
+		uint64_t transformVersion = 0;
 		bool shouldUpdateBoundingBox = true;
 		bool shouldUpdateBoundingSphere = true;
 		bool shouldUpdateBoundingSphereUntransformed = true;
 	};
 
+	/*
+	 * Deformed vertices used for intersection tests,
+	 * valid while source storage and deformation matrices stay the same
+	 */
+	struct DeformedStorage
+	{
+		VertexStorage::Pointer source;
+		VertexStorage::Pointer baked;
+		Vector<mat4> matrices;
+	};
+
+private:
+	void validateTransformedSupportData();
+	const VertexStorage::Pointer& deformedStorage();
+
 private:
 	MeshDeformer::Pointer _deformer;
 	SupportData _supportData;
+	DeformedStorage _deformedStorage;
 	Vector<mat4> _undeformedTransformationMatrices;
+	Vector<LevelOfDetail> _levelsOfDetail;
 };
 }
 }
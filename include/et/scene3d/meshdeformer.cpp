@@ -20,19 +20,26 @@ void MeshDeformerCluster::sortWeights()
 
 const Vector<mat4>& MeshDeformer::calculateTransforms()
 {
-	_transformMatrices.clear();
-	_transformMatrices.reserve(std::min(size_t(4), _clusters.size()));
+	/*
+	 * At least four matrices are kept, padding is identity
+	 */
+	size_t clustersCount = _clusters.size();
+	if (_transformMatrices.size() != std::max(size_t(4), clustersCount))
+		_transformMatrices.assign(std::max(size_t(4), clustersCount), identityMatrix);
 	
-	for (auto& cluster : _clusters)
-		_transformMatrices.push_back(cluster->transformMatrix());
-	
-	while (_transformMatrices.size() < 4)
-		_transformMatrices.push_back(identityMatrix);
+	for (size_t i = 0; i < clustersCount; ++i)
+		_transformMatrices[i] = _clusters[i]->transformMatrix();
 	
 	return _transformMatrices;
 }
 
-mat4 MeshDeformerCluster::transformMatrix()
+const mat4& MeshDeformerCluster::transformMatrix()
 {
-	return _meshInitialTransform * _linkInitialTransformInverse * _link->finalTransform();
+	uint64_t linkVersion = _link->finalTransformVersion();
+	if (linkVersion != _linkTransformVersion)
+	{
+		_transformMatrix = _bindTransform * _link->finalTransform();
+		_linkTransformVersion = linkVersion;
+	}
+	return _transformMatrix;
 }
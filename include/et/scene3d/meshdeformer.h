@@ -68,18 +68,30 @@ public:
 	void setLink(s3d::SkeletonElement::Pointer l)
 	{
 		_link = l;
+		_linkTransformVersion = 0;
 	}
 
-	mat4 transformMatrix();
+	/*
+	 * Cached until final transform of the link changes
+	 */
+	const mat4& transformMatrix();
 
 	void setLinkInitialTransform(const mat4& m)
 	{
 		_linkInitialTransformInverse = m.inverted();
+		updateBindTransform();
+	}
+
+	void setLinkInitialTransformInverse(const mat4& m)
+	{
+		_linkInitialTransformInverse = m;
+		updateBindTransform();
 	}
 
 	void setMeshInitialTransform(const mat4& m)
 	{
 		_meshInitialTransform = m;
+		updateBindTransform();
 	}
 
 	const mat4& linkInitialTransformInverse() const
@@ -92,11 +104,21 @@ public:
 		return _meshInitialTransform;
 	}
 
+private:
+	void updateBindTransform()
+	{
+		_bindTransform = _meshInitialTransform * _linkInitialTransformInverse;
+		_linkTransformVersion = 0;
+	}
+
 private:
 	s3d::SkeletonElement::Pointer _link;
 	VertexWeightVector _weights;
 	mat4 _linkInitialTransformInverse;
 	mat4 _meshInitialTransform;
+	mat4 _bindTransform;
+	mat4 _transformMatrix;
+	uint64_t _linkTransformVersion = 0;
 	size_t _linkTag = 0;
 };
 
@@ -0,0 +1,57 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/app/invocation.h>
+#include <et/scene3d/modelloader.h>
+
+namespace et
+{
+
+void ModelLoader::loadAsync(RenderInterface::Pointer renderer, s3d::Storage& storage, ObjectsCache& cache, uint64_t uploadBudget)
+{
+	ET_ASSERT(!_loading);
+
+	_loading = true;
+	_asyncRenderer = renderer;
+	_asyncStorage = &storage;
+	_asyncCache = &cache;
+	_uploadBudget = uploadBudget;
+
+	Invocation([this]()
+	{
+		prepareAsync();
+		Invocation([this]() { finalizeAsyncSlice(); }).invokeInMainRunLoop();
+	}).invokeInBackground();
+}
+
+bool ModelLoader::finalizeAsync(RenderInterface::Pointer renderer, s3d::Storage& storage, ObjectsCache& cache,
+	uint64_t& budget, s3d::ElementContainer::Pointer& result)
+{
+	result = load(renderer, storage, cache);
+	budget = 0;
+	return true;
+}
+
+void ModelLoader::finalizeAsyncSlice()
+{
+	uint64_t budget = _uploadBudget;
+	s3d::ElementContainer::Pointer result;
+	if (finalizeAsync(_asyncRenderer, *_asyncStorage, *_asyncCache, budget, result))
+	{
+		_loading = false;
+		_asyncRenderer.reset(nullptr);
+		_asyncStorage = nullptr;
+		_asyncCache = nullptr;
+		loaded.invoke(result);
+	}
+	else
+	{
+		Invocation([this]() { finalizeAsyncSlice(); }).invokeInMainRunLoop();
+	}
+}
+
+}
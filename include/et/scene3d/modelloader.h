@@ -14,10 +14,51 @@ namespace et
 {
 class ModelLoader
 {
+public:
+	enum : uint64_t
+	{
+		DefaultUploadBudget = 16 * 1024 * 1024
+	};
+
 public:
 	virtual s3d::ElementContainer::Pointer load(RenderInterface::Pointer, s3d::Storage&, ObjectsCache&) = 0;
 
+	/*
+	 * Prepares CPU side data in background, then creates GPU resources in main run loop,
+	 * uploading about uploadBudget bytes per run loop iteration. `loaded` is invoked in main run loop,
+	 * loader, storage and cache should not be destroyed until then
+	 */
+	void loadAsync(RenderInterface::Pointer, s3d::Storage&, ObjectsCache&, uint64_t uploadBudget = DefaultUploadBudget);
+
+	bool loading() const
+		{ return _loading; }
+
+	ET_DECLARE_EVENT1(loaded, s3d::ElementContainer::Pointer);
+
 public:
 	virtual ~ModelLoader() {}
+
+protected:
+	/*
+	 * Called on background thread, should not access renderer or objects cache
+	 */
+	virtual void prepareAsync() { }
+
+	/*
+	 * Called in main run loop until it returns true, budget should be decreased by size of uploaded data.
+	 * Default implementation performs synchronous load at once
+	 */
+	virtual bool finalizeAsync(RenderInterface::Pointer, s3d::Storage&, ObjectsCache&, uint64_t& budget,
+		s3d::ElementContainer::Pointer& result);
+
+private:
+	void finalizeAsyncSlice();
+
+private:
+	RenderInterface::Pointer _asyncRenderer;
+	s3d::Storage* _asyncStorage = nullptr;
+	ObjectsCache* _asyncCache = nullptr;
+	uint64_t _uploadBudget = DefaultUploadBudget;
+	bool _loading = false;
 };
 }
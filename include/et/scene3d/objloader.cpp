@@ -10,670 +10,616 @@
 #include <et/core/filesystem.h>
 #include <et/rendering/base/primitives.h>
 #include <et/rendering/base/material.h>
+#include <et/rendering/base/meshoptimizer.h>
+#include <et/scene3d/scenecache.h>
 #include <et/scene3d/objloader.h>
 
 namespace et {
 
-template <typename F>
-inline void splitAndWrite(const std::string& s, F func)
+void getLine(std::ifstream& stream, std::string& line);
+
+/*
+ * OBJLoader
+ */
+
+OBJLoader::OBJLoader(const std::string& inFile, uint32_t options) :
+	inputFileName(inFile.c_str()),
+	inputFile(inputFileName.c_str()), _loadOptions(options)
 {
-	if (s.empty()) return;
+	inputFilePath = getFilePath(inputFileName);
 	
-	const char t_space = ' ';
-	const char t_tab = '\t';
+	/*
+	 * Options affect generated geometry, so they are part of the cache name
+	 */
+	uint64_t uid = getFileUniqueIdentifier(inputFileName);
+	cacheFileName = application().environment().applicationDocumentsFolder() + "modelscache/" + 
+		replaceFileExt(getFileName(inputFileName), "." + intToStr(uid) + "." + intToStr(_loadOptions) + ".cached_obj");
+
+	if (inputFile.fail())
+		log::info("Unable to open file %s", inputFileName.c_str());
+}
+
+OBJLoader::~OBJLoader()
+{
+	if (inputFile.is_open())
+		inputFile.close();
+	
+	if (materialFile.is_open())
+		materialFile.close();
+}
+
+namespace obj_local
+{
+enum : uint32_t
+{
+	ParallelChunkSize = 4 * 1024 * 1024,
+	InvalidIndex = static_cast<uint32_t>(-1),
+	ComponentsPerLink = 3,
+};
+
+const double powersOf10[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+const int32_t maxExactPower = static_cast<int32_t>(sizeof(powersOf10) / sizeof(powersOf10[0])) - 1;
 
-	const char* begin = s.data();
-	const char* pos = begin;
-	const char* end = begin + s.size();
-	while (begin < end)
+inline bool isSpace(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+inline bool isDigit(char c)
+{
+	return (c >= '0') && (c <= '9');
+}
+
+inline const char* skipSpaces(const char* p, const char* end)
+{
+	while ((p < end) && isSpace(*p))
+		++p;
+	return p;
+}
+
+inline const char* skipToken(const char* p, const char* end)
+{
+	while ((p < end) && !isSpace(*p))
+		++p;
+	return p;
+}
+		
+inline const char* trimEnd(const char* begin, const char* end)
+{
+	while ((end > begin) && isSpace(*(end - 1)))
+		--end;
+	return end;
+}
+
+/*
+ * Locale independent: up to 19 significant digits are accumulated as integer,
+ * then scaled by power of 10 once (exactly, for the most of the real world values)
+ */
+inline float parseFloat(const char*& p, const char* end)
+{
+	bool negative = false;
+	if ((p < end) && ((*p == '-') || (*p == '+')))
+		negative = (*p++ == '-');
+
+	uint64_t mantissa = 0;
+	int32_t exponent = 0;
+	uint32_t digits = 0;
+	for (; (p < end) && isDigit(*p); ++p)
 	{
-		if ((*begin == t_space) || (*begin == t_tab))
+		if (digits < 19)
 		{
-			func(std::string(pos, begin - pos));
-			while ((*begin == t_space) || (*begin == t_tab))
-				++begin;
-			pos = begin;
+			mantissa = 10 * mantissa + static_cast<uint64_t>(*p - '0');
+			digits += (mantissa > 0) ? 1 : 0;
 		}
 		else
 		{
-			++begin;
+			++exponent;
 		}
 	}
-	if (begin - pos > 0)
-		func(std::string(pos, begin - pos));
-}
 
-template <typename F>
-inline void splitAndWrite(const std::string& s, char token, F func)
-{
-	if (s.empty()) return;
-	
-	const char* begin = s.data();
-	const char* pos = begin;
-	const char* end = begin + s.size();
-	while (begin < end)
+	if ((p < end) && (*p == '.'))
 	{
-		if (*begin == token)
+		for (++p; (p < end) && isDigit(*p); ++p)
 		{
-			func(std::string(pos, begin - pos));
-			while (*(begin + 1) == token)
+			if (digits < 19)
 			{
-				func(intToStr(std::numeric_limits<int32_t>::max()));
-				++begin;
+				mantissa = 10 * mantissa + static_cast<uint64_t>(*p - '0');
+				digits += (mantissa > 0) ? 1 : 0;
+				--exponent;
 			}
-			pos = begin + 1;
 		}
-		++begin;
 	}
-	if (begin - pos > 0)
-		func(std::string(pos, begin - pos));
-}
 
-inline std::istream& operator >> (std::istream& stream, vec2& value)
-{
-	static std::string ln;
-	ln.reserve(128);
-	ln.clear();
+	if ((p < end) && ((*p == 'e') || (*p == 'E')))
+	{
+		++p;
+		bool negativeExponent = false;
+		if ((p < end) && ((*p == '-') || (*p == '+')))
+			negativeExponent = (*p++ == '-');
 
-	std::getline(stream, ln);
-	trim(ln);
+		int32_t value = 0;
+		for (; (p < end) && isDigit(*p); ++p)
+		{
+			if (value < 10000)
+				value = 10 * value + (*p - '0');
+		}
+		exponent += negativeExponent ? -value : value;
+	}
 
-	int comp = 0;
-	splitAndWrite(ln, [&value, &comp](const std::string& s)
-	{
-		if (comp < 2)
-			value[comp++] = strToFloat(s);
-	});
-	return stream;
+	double result = static_cast<double>(mantissa);
+	if ((exponent < 0) && (exponent >= -maxExactPower))
+		result /= powersOf10[-exponent];
+	else if ((exponent > 0) && (exponent <= maxExactPower))
+		result *= powersOf10[exponent];
+	else if (exponent != 0)
+		result *= std::pow(10.0, static_cast<double>(exponent));
+
+	return static_cast<float>(negative ? -result : result);
 }
 
-inline std::istream& operator >> (std::istream& stream, vec3& value)
+inline int32_t parseInt(const char*& p, const char* end)
 {
-	static std::string ln;
-	ln.reserve(128);
-	ln.clear();
+	bool negative = false;
+	if ((p < end) && ((*p == '-') || (*p == '+')))
+		negative = (*p++ == '-');
 
-	std::getline(stream, ln);
-	trim(ln);
+	int32_t result = 0;
+	for (; (p < end) && isDigit(*p); ++p)
+		result = 10 * result + (*p - '0');
 
-	uint32_t comp = 0;
-	splitAndWrite(ln, [&value, &comp](const std::string& s)
-	{
-		if (comp < 3)
-		{
-			value[comp++] = strToFloat(s);
-		}
-	});
-	return stream;
+	return negative ? -result : result;
 }
 
-inline std::istream& operator >> (std::istream& stream, vec4& value)
+inline void parseFloats(const char* p, const char* end, float* values, uint32_t count)
 {
-	static std::string ln;
-	ln.reserve(128);
-	ln.clear();
-
-	std::getline(stream, ln);
-	trim(ln);
-
-	uint32_t comp = 0;
-	splitAndWrite(ln, [&value, &comp](const std::string& s)
+	for (uint32_t i = 0; i < count; ++i)
 	{
-		if (comp < 4)
-			value[comp++] = strToFloat(s);
-	});
-	return stream;
+		p = skipSpaces(p, end);
+		values[i] = (p < end) ? parseFloat(p, end) : 0.0f;
+	}
 }
 
-void getLine(std::ifstream& stream, std::string& line);
-
 /*
- * OBJLoader
+ * Material libraries are stored in the cache as "<identifier> <path>",
+ * so cache is not used after any of them is modified
  */
+inline std::string cacheDependency(const std::string& path)
+{
+	return intToStr(getFileUniqueIdentifier(path)) + " " + path;
+}
 
-OBJLoader::OBJLoader(const std::string& inFile, uint32_t options) :
-	inputFileName(inFile.c_str()),
-	inputFile(inputFileName.c_str()), _loadOptions(options)
+inline bool parseCacheDependency(const std::string& dependency, uint64_t& identifier, std::string& path)
 {
-	inputFilePath = getFilePath(inputFileName);
-	
-	uint64_t uid = getFileUniqueIdentifier(inputFileName);
-	cacheFileName = application().environment().applicationDocumentsFolder() + "modelscache/" + 
-		replaceFileExt(getFileName(inputFileName), "." + intToStr(uid) + ".cached_obj");
+	size_t separator = dependency.find(' ');
+	if ((separator == std::string::npos) || (separator == 0))
+		return false;
 
-	if (inputFile.fail())
-		log::info("Unable to open file %s", inputFileName.c_str());
+	identifier = std::strtoull(dependency.c_str(), nullptr, 10);
+	path = dependency.substr(separator + 1);
+	return true;
 }
 
-OBJLoader::~OBJLoader()
+/*
+ * Reads the rest of the line, missing components are kept
+ */
+inline void readVector(std::istream& stream, vec4& value)
 {
-	if (inputFile.is_open())
-		inputFile.close();
-	
-	if (materialFile.is_open())
-		materialFile.close();
+	std::string line;
+	std::getline(stream, line);
+
+	const char* p = line.data();
+	const char* end = p + line.size();
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		p = skipSpaces(p, end);
+		if (p >= end)
+			break;
+
+		value[i] = parseFloat(p, end);
+		p = skipToken(p, end);
+	}
 }
 
-float naive_atof(const char *p) 
+/*
+ * Open addressing table of (position, texcoord, normal) triplets
+ */
+class LinkTable
 {
-	float r = 0.0;
-	bool neg = false;
-	if (*p == '-') {
-		neg = true;
-		++p;
-	}
-	while (*p >= '0' && *p <= '9') 
+public:
+	void reset(uint32_t expectedCount)
 	{
-		r = (r * 10.0f) + (*p - '0');
-		++p;
+		uint32_t size = 16;
+		while (size < 2 * expectedCount)
+			size *= 2;
+
+		_mask = size - 1;
+		_keys.resize(ComponentsPerLink * size);
+		_values.assign(size, InvalidIndex);
 	}
-	if (*p == '.') 
+
+	uint32_t findOrInsert(const uint32_t* key, uint32_t value)
 	{
-		float f = 0.0f;
-		int32_t n = 0;
-		++p;
-		while (*p >= '0' && *p <= '9') 
+		uint32_t h = key[0] * 0x9E3779B1u ^ key[1] * 0x85EBCA77u ^ key[2] * 0xC2B2AE3Du;
+		h ^= h >> 15;
+
+		for (uint32_t slot = h & _mask; ; slot = (slot + 1) & _mask)
 		{
-			f = (f * 10.0f) + (*p - '0');
-			++p;
-			++n;
+			uint32_t* slotKey = _keys.data() + ComponentsPerLink * slot;
+			if (_values[slot] == InvalidIndex)
+			{
+				std::copy(key, key + ComponentsPerLink, slotKey);
+				_values[slot] = value;
+				return value;
+			}
+
+			if ((slotKey[0] == key[0]) && (slotKey[1] == key[1]) && (slotKey[2] == key[2]))
+				return _values[slot];
 		}
-		r += f / std::pow(10.0f, n);
 	}
-	return neg ? -r : r;
+
+private:
+	Vector<uint32_t> _keys;
+	Vector<uint32_t> _values;
+	uint32_t _mask = 0;
+};
+
 }
 
-int64_t naive_atoll(char* ptr)
+/*
+ * Statements other than geometry are collected with number of chunk's faces preceding them
+ * and replayed in order, when chunks are merged
+ */
+struct OBJLoader::OBJChunk
 {
-	int64_t result = 0;
-	while (*ptr)
+	struct Statement
 	{
-		result = (result * 10) + (*ptr - 48);
-		++ptr;
-	}
-	return result;
-}
+		enum class Type : uint32_t
+		{
+			MaterialLibrary,
+			Group,
+			UseMaterial,
+			Unsupported
+		};
+
+		Type type = Type::Unsupported;
+		uint32_t faceIndex = 0;
+		uint32_t line = 0;
+		std::string value;
+
+		Statement(Type t, uint32_t f, uint32_t l, const char* begin, const char* end) :
+			type(t), faceIndex(f), line(l), value(begin, end) { }
+	};
 
-void OBJLoader::load(ObjectsCache& cache)
-{
-	uint32_t lineNumber = 0;
+	/*
+	 * Negative (relative) indices are resolved to chunk's own arrays, bits of the mask
+	 * mark links components which should be offset by the sizes of the preceding chunks
+	 */
+	struct RelativeFace
+	{
+		uint32_t faceIndex = 0;
+		uint32_t mask = 0;
 
-	auto trimWhitespace = [](char* begin, char* end) -> char* {
-		
-		while (isWhitespaceChar(*begin))
-			++begin;
+		RelativeFace(uint32_t f, uint32_t m) :
+			faceIndex(f), mask(m) { }
+	};
 
-		while ((end > begin) && (isWhitespaceChar(*(end - 1)))) {
-			*(end - 1) = 0;
-			--end;
-		}
+	const char* begin = nullptr;
+	const char* end = nullptr;
+	uint32_t lineCount = 0;
 
-		return begin;
-	};
+	Vector<vec3> vertices;
+	Vector<vec3> normals;
+	Vector<vec2> texCoords;
+	Vector<OBJFace> faces;
+	Vector<RelativeFace> relativeFaces;
+	Vector<Statement> statements;
+};
 
-	auto readFloats = [](char* line, char* end, uint32_t count, float* dst) {
-		uint32_t floatsRead = 0;
-		char* begin = line;
-		while ((floatsRead < count) && (begin < end))
-		{
-			char* token = begin;
-			while (!isWhitespaceChar(*token))
-				++token;
-			
-			char tokenValue = *token;
+void OBJLoader::parseChunk(OBJChunk& chunk, uint32_t options)
+{
+	using namespace obj_local;
+	using Statement = OBJChunk::Statement;
 
-			*token = 0;
-			dst[floatsRead] = naive_atof(begin);
-			*token = tokenValue;
+	static_assert(ComponentsPerLink * OBJFace::MaxVertexLinks <= 32, "Relative face mask does not fit");
 
-			begin = token + 1;
-			++floatsRead;
-		}
-	};
+	bool swapYZ = (options & Option_SwapYwithZ) == Option_SwapYwithZ;
 
-	const uint32_t BufferSize = 256 * 1024;
-	char localBuffer[BufferSize + 3] = { };
+	size_t sizeEstimate = static_cast<size_t>(chunk.end - chunk.begin) / 32;
+	chunk.vertices.reserve(sizeEstimate / 2);
+	chunk.faces.reserve(sizeEstimate / 2);
 
-	intptr_t readOffset = 0;
-	intptr_t charactersRead = 0;
-	do 
+	const char* p = chunk.begin;
+	while (p < chunk.end)
 	{
-		inputFile.read(localBuffer + readOffset, BufferSize - readOffset);
-		charactersRead = inputFile.gcount();
+		const char* lineEnd = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(chunk.end - p)));
+		if (lineEnd == nullptr)
+			lineEnd = chunk.end;
 
-		intptr_t currentBufferLength = readOffset + charactersRead;
-		if (currentBufferLength > 0)
-		{
-			localBuffer[readOffset + charactersRead] = 0;
-			readOffset = 0;
+		const char* key = skipSpaces(p, lineEnd);
+		p = (lineEnd < chunk.end) ? lineEnd + 1 : chunk.end;
+		++chunk.lineCount;
 
-			char* begin = localBuffer;
-			char* end = begin;
-			while ((end - localBuffer) < currentBufferLength)
-			{
-				end = begin;
-				while ((*end != 0) && (*end != '\n'))
-					++end;
+		if ((key == lineEnd) || (*key == '#'))
+			continue;
 
-				if ((*end == '\n') || ((*end == 0) && inputFile.eof()))
-				{
-					*end = 0;
-					{
-						++lineNumber;
+		const char* keyEnd = skipToken(key, lineEnd);
+		const char* value = skipSpaces(keyEnd, lineEnd);
+		const char* valueEnd = trimEnd(value, lineEnd);
+		size_t keyLength = static_cast<size_t>(keyEnd - key);
 
-						char* line_begin = begin;
-						char* local_end = end;
-						char* local_begin = trimWhitespace(line_begin, local_end);
-						if ((*local_begin == '#') || ((local_end - local_begin) == 0))
-						{
-							begin = end + 1;
-							continue;
-						}
-						
-						char* keyEnd = local_begin;
-						while (!isWhitespaceChar(*keyEnd))
-							++keyEnd;
+		if ((keyLength == 1) && (*key == 'v'))
+		{
+			chunk.vertices.emplace_back();
+			parseFloats(value, valueEnd, chunk.vertices.back().data(), 3);
+			if (swapYZ)
+				std::swap(chunk.vertices.back().y, chunk.vertices.back().z);
+		}
+		else if ((keyLength == 2) && (key[0] == 'v') && (key[1] == 'n'))
+		{
+			chunk.normals.emplace_back();
+			parseFloats(value, valueEnd, chunk.normals.back().data(), 3);
+			if (swapYZ)
+				std::swap(chunk.normals.back().y, chunk.normals.back().z);
+		}
+		else if ((keyLength == 2) && (key[0] == 'v') && (key[1] == 't'))
+		{
+			chunk.texCoords.emplace_back();
+			parseFloats(value, valueEnd, chunk.texCoords.back().data(), 2);
+		}
+		else if ((keyLength == 1) && (*key == 'f'))
+		{
+			uint32_t counts[ComponentsPerLink] = { static_cast<uint32_t>(chunk.vertices.size()),
+				static_cast<uint32_t>(chunk.texCoords.size()), static_cast<uint32_t>(chunk.normals.size()) };
 
-						char* key = local_begin;
-						*keyEnd = 0;
+			chunk.faces.emplace_back();
+			OBJFace& face = chunk.faces.back();
+			uint32_t relativeMask = 0;
 
-						char* local_value = trimWhitespace(keyEnd + 1, local_end);
+			const char* q = value;
+			while ((q < valueEnd) && (face.vertexLinksCount < OBJFace::MaxVertexLinks))
+			{
+				OBJFace::VertexLink& link = face.vertexLinks[face.vertexLinksCount];
+				link.fill(0);
 
-						bool recognized = true;
-						switch (*key)
-						{
-						case 'm':
-						{
-							if (strcmp(key, "mtllib") == 0)
-							{
-								loadMaterials(std::string(local_value, local_end - local_value), cache);
-							}
-							else
-							{
-								recognized = false;
-							}
-							break;
-						}
-						case 'g':
-						{
-							_groups.emplace_back(local_value, _lastUsedMaterial, _sizeEstimate);
-							break;
-						}
-						case 'u':
-						{
-							if (strcmp(key, "usemtl") == 0)
-							{
-								bool addGroup = _groups.empty() ||
-									((strlen(_groups.back().material) > 0) && (strcmp(_groups.back().material, local_value) != 0));
-
-								if (addGroup)
-								{
-									char buffer[OBJGroup::MaxGroupName] = {};
-									sprintf(buffer, "group-%u-%s", static_cast<uint32_t>(_groups.size()), local_value);
-									_groups.emplace_back(buffer, local_value, _sizeEstimate);
-								}
-								else
-								{
-									size_t stringSize = std::min(static_cast<size_t>(OBJGroup::MaxMaterialName), strlen(local_value) + 1);
-									strncpy(_groups.back().material, local_value, stringSize);
-								}
-
-								memset(_lastUsedMaterial, 0, sizeof(_lastUsedMaterial));
-								strcpy(_lastUsedMaterial, local_value);
-							}
-							else
-							{
-								recognized = false;
-							}
-							break;
-						}
-						case 'v':
-						{
-							switch (*(key + 1))
-							{
-							case 0:
-							{
-								_vertices.emplace_back();
-								readFloats(local_value, local_end, 3, _vertices.back().data());
-								break;
-							}
-							case 'n':
-							{
-								_normals.emplace_back();
-								readFloats(local_value, local_end, 3, _normals.back().data());
-								break;
-							}
-							case 't':
-							{
-								_texCoords.emplace_back();
-								readFloats(local_value, local_end, 2, _texCoords.back().data());
-								break;
-							}
-							default:
-								recognized = false;
-							}
-							break;
-						}
-						case 'f':
+				for (uint32_t c = 0; c < ComponentsPerLink; ++c)
+				{
+					if ((q < valueEnd) && (*q != '/') && !isSpace(*q))
+					{
+						int32_t index = parseInt(q, valueEnd);
+						if (index < 0)
 						{
-							if (_groups.empty())
-							{
-								char buffer[OBJGroup::MaxGroupName] = {};
-								sprintf(buffer, "group-%u", static_cast<uint32_t>(_groups.size()));
-								_groups.emplace_back(buffer, _sizeEstimate);
-							}
-
-							_groups.back().faces.emplace_back();
-							OBJFace& face = _groups.back().faces.back();
-
-							while (local_value < local_end)
-							{
-								char* valueEnd = local_value;
-								while ((valueEnd < local_end) && !isWhitespaceChar(*valueEnd))
-									++valueEnd;
-
-								char valueKey = *valueEnd;
-								*valueEnd = 0;
-
-								char* link = local_value;
-								char* linkEnd = link;
-
-								uint32_t linkIndex = 0;
-								while (link < valueEnd)
-								{
-									char endValue = *linkEnd;
-									if ((endValue == '/') || (endValue == 0))
-									{
-										*linkEnd = 0;
-
-										if (linkEnd > link)
-										{
-											int64_t linkValue = naive_atoll(link);
-											ET_ASSERT(linkValue > 0);
-											ET_ASSERT(face.vertexLinksCount < OBJFace::MaxVertexLinks);
-
-											face.vertexLinks[face.vertexLinksCount][linkIndex] = static_cast<uint32_t>(linkValue - 1);
-											*linkEnd = endValue;
-										}
-										++linkIndex;
-
-										link = linkEnd + 1;
-									}
-									++linkEnd;
-								}
-
-								++face.vertexLinksCount;
-
-								*valueEnd = valueKey;
-								local_value = valueEnd + 1;
-							}
-							break;
-						}
-						case 's':
-						case 'o':
-							break;
-
-						default:
-							recognized = false;
-							break;
+							link[c] = counts[c] - static_cast<uint32_t>(-index);
+							relativeMask |= 1u << (ComponentsPerLink * face.vertexLinksCount + c);
 						}
-
-						if (!recognized)
+						else if (index > 0)
 						{
-							log::warning("Unsupported entry `%s` in OBJ file at line %u", key, lineNumber);
+							link[c] = static_cast<uint32_t>(index - 1);
 						}
 					}
-					begin = end + 1;
-				}
-				else
-				{
-					readOffset = end - begin;
-					memmove(localBuffer, begin, readOffset);
+
+					if ((q < valueEnd) && (*q == '/'))
+						++q;
+					else
+						break;
 				}
+
+				++face.vertexLinksCount;
+				q = skipSpaces(skipToken(q, valueEnd), valueEnd);
 			}
-		}
-	} while (charactersRead > 0);
-}
+			ET_ASSERT(q == valueEnd);
 
-void OBJLoader::loadData(ObjectsCache& cache)
-{
-	std::string line;
-	uint32_t lineNumber = 0;
-	char key = 0;
-	while (inputFile.is_open() && !inputFile.eof())
-	{
-		++lineNumber;
-		inputFile >> key;
-		
-		if (inputFile.eof()) 
-			break;
-		
-		key = static_cast<char>(tolower(key));
-		
-		if (key == '#')
-		{
-			getLine(inputFile, line);
-		}
-		else if (key == 'm') // mtllib
-		{
-			std::string mtllib;
-			inputFile >> mtllib;
-			lowercase(mtllib);
-			
-			if (mtllib.compare("tllib") == 0)
+			if (face.vertexLinksCount < 3)
 			{
-				std::string matName;
-				inputFile >> matName;
-				loadMaterials(matName, cache);
+				chunk.faces.pop_back();
 			}
-			else
+			else if (relativeMask != 0)
 			{
-				std::cout << "Unresolved symbol: " << key << mtllib << std::endl;
+				chunk.relativeFaces.emplace_back(static_cast<uint32_t>(chunk.faces.size() - 1), relativeMask);
 			}
 		}
-		else if (key == 'o') // object, ignored for now
+		else if ((keyLength == 1) && (*key == 'g'))
 		{
-			getLine(inputFile, line);
+			chunk.statements.emplace_back(Statement::Type::Group, static_cast<uint32_t>(chunk.faces.size()),
+				chunk.lineCount, value, valueEnd);
 		}
-		else if (key == 'g') // group
+		else if ((keyLength == 6) && (strncmp(key, "usemtl", keyLength) == 0))
 		{
-			getLine(inputFile, line);
-			trim(line);
-			
-			if (!_groups.empty())
-			{
-				_groups.back().faces.shrink_to_fit();
-			}
-
-            _groups.emplace_back(line, _sizeEstimate);
+			chunk.statements.emplace_back(Statement::Type::UseMaterial, static_cast<uint32_t>(chunk.faces.size()),
+				chunk.lineCount, value, valueEnd);
 		}
-		else if (key == 'u') // group's material
+		else if ((keyLength == 6) && (strncmp(key, "mtllib", keyLength) == 0))
 		{
-			std::string usemtl;
-			inputFile >> usemtl;
-			lowercase(usemtl);
-			
-			if (usemtl.compare("semtl") == 0) 
-			{
-				std::string materialId;
-				inputFile >> materialId;
-				
-                if (_groups.empty())
-                {
-                    auto groupName = "group-" + intToStr(_lastGroupId++) + "-" + materialId;
-					_groups.emplace_back(groupName, materialId, static_cast<uint32_t>(_sizeEstimate));
-                }
-                else if ((strlen(_groups.back().material) == 0) || _groups.back().material == materialId)
-                {
-					size_t stringSize = std::min(static_cast<size_t>(OBJGroup::MaxMaterialName), materialId.size());
-					strncpy(_groups.back().material, materialId.c_str(), stringSize);
-                }
-				getLine(inputFile, line);
-			}
-			else
-			{
-				std::cout << "Unresolved symbol " << key << usemtl << ". Current group: " << _groups.back().name << std::endl;
-			}
+			chunk.statements.emplace_back(Statement::Type::MaterialLibrary, static_cast<uint32_t>(chunk.faces.size()),
+				chunk.lineCount, value, valueEnd);
 		}
-		else if (key == 's') // smoothing group
+		else if ((keyLength > 1) || ((*key != 's') && (*key != 'o')))
 		{
-            if (_groups.empty())
-            {
-                _groups.emplace_back("group-" + intToStr(_lastGroupId++), _sizeEstimate);
-            }
-			getLine(inputFile, line);
-			_lastSmoothGroup = (line.compare("off") == 0) ? 0 : strToInt(line);
+			chunk.statements.emplace_back(Statement::Type::Unsupported, static_cast<uint32_t>(chunk.faces.size()),
+				chunk.lineCount, key, keyEnd);
 		}
-		else if (key == 'f') // faces
+	}
+}
+
+void OBJLoader::parse()
+{
+	using Statement = OBJChunk::Statement;
+
+	uint64_t fileSize = streamSize(inputFile);
+	_sizeEstimate = std::max(1024llu, fileSize / 128);
+	log::info("Loading OBJ, estimated array sizes: %llu", _sizeEstimate);
+
+	_groups.reserve(128);
+	_vertices.reserve(_sizeEstimate);
+	_normals.reserve(_sizeEstimate);
+	_texCoords.reserve(_sizeEstimate);
+
+	_sizeEstimate = std::max(128llu, _sizeEstimate / 2048);
+	log::info("Loading OBJ, estimated face array sizes: %llu", _sizeEstimate);
+
+	/*
+	 * Whole file is read at once and split into chunks at line boundaries,
+	 * chunks are parsed in parallel and merged in order
+	 */
+	inputFile.clear();
+	inputFile.seekg(0, std::ios::end);
+	size_t dataCapacity = static_cast<size_t>(std::max(std::streamoff(0), std::streamoff(inputFile.tellg())));
+	inputFile.seekg(0, std::ios::beg);
+
+	Vector<char> data(dataCapacity);
+	inputFile.read(data.data(), static_cast<std::streamsize>(dataCapacity));
+	const char* dataBegin = data.data();
+	const char* dataEnd = dataBegin + inputFile.gcount();
+
+	size_t dataSize = static_cast<size_t>(dataEnd - dataBegin);
+	uint32_t chunksCount = static_cast<uint32_t>(std::min(threading::maxConcurrentThreads(), dataSize / obj_local::ParallelChunkSize));
+	chunksCount = std::max(1u, chunksCount);
+
+	Vector<OBJChunk> chunks(chunksCount);
+	const char* chunkBegin = dataBegin;
+	for (uint32_t i = 0; i < chunksCount; ++i)
+	{
+		const char* chunkEnd = dataEnd;
+		if (i + 1 < chunksCount)
 		{
-			OBJFace face;
-			std::getline(inputFile, line);
-			trim(line);
-			
-			static StringList faces;
-			faces.reserve(5);
-			faces.clear();
+			chunkEnd = chunkBegin + (dataEnd - chunkBegin) / (chunksCount - i);
+			chunkEnd = static_cast<const char*>(memchr(chunkEnd, '\n', static_cast<size_t>(dataEnd - chunkEnd)));
+			chunkEnd = (chunkEnd == nullptr) ? dataEnd : chunkEnd + 1;
+		}
+		chunks[i].begin = chunkBegin;
+		chunks[i].end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
 
-			splitAndWrite(line, ' ', [](const std::string& s) {
-				faces.emplace_back(s);
-			});
-			ET_ASSERT((faces.size() > 2) && (faces.size() < OBJFace::MaxVertexLinks));
+	uint32_t options = _loadOptions;
+	threading::parallelFor(chunksCount, 1, [&chunks, options](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+			parseChunk(chunks[i], options);
+	});
 
-			for (auto inFace : faces)
-			{
-				static Vector<int32_t> indexes;
-				indexes.reserve(3);
-				indexes.clear();
+	uint32_t lineBase = 0;
+	for (OBJChunk& chunk : chunks)
+	{
+		uint32_t bases[obj_local::ComponentsPerLink] = { static_cast<uint32_t>(_vertices.size()),
+			static_cast<uint32_t>(_texCoords.size()), static_cast<uint32_t>(_normals.size()) };
 
-				splitAndWrite(inFace, '/', [](const std::string& s)
-					{ indexes.push_back(strToInt(s)); });
+		_vertices.insert(_vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+		_texCoords.insert(_texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+		_normals.insert(_normals.end(), chunk.normals.begin(), chunk.normals.end());
 
-				uint32_t i = 0;
-				face.vertexLinks[face.vertexLinksCount].fill(0);
-				for (auto iValue : indexes)
+		for (const OBJChunk::RelativeFace& relative : chunk.relativeFaces)
+		{
+			OBJFace& face = chunk.faces[relative.faceIndex];
+			for (uint32_t l = 0; l < face.vertexLinksCount; ++l)
+			{
+				for (uint32_t c = 0; c < obj_local::ComponentsPerLink; ++c)
 				{
-					if (iValue == std::numeric_limits<int32_t>::max())
-					{
-					}
-					else if (iValue < 0)
-					{
-						uint32_t szValue = static_cast<uint32_t>(-iValue);
-						if (i == 0)
-						{
-							ET_ASSERT(szValue <= _vertices.size());
-							face.vertexLinks[face.vertexLinksCount][i] = static_cast<uint32_t>(_vertices.size() - szValue);
-						}
-						else if (i == 1)
-						{
-							ET_ASSERT(szValue <= _texCoords.size());
-							face.vertexLinks[face.vertexLinksCount][i] = static_cast<uint32_t>(_texCoords.size() - szValue);
-						}
-						else if (i == 2)
-						{
-							ET_ASSERT(szValue <= _normals.size());
-							face.vertexLinks[face.vertexLinksCount][i] = static_cast<uint32_t>(_normals.size() - szValue);
-						}
-					}
-					else
-					{
-						face.vertexLinks[face.vertexLinksCount][i] = iValue - 1;
-					}
-					++i;
+					if (relative.mask & (1u << (obj_local::ComponentsPerLink * l + c)))
+						face.vertexLinks[l][c] += bases[c];
 				}
-				
-				++face.vertexLinksCount;
 			}
-			
+		}
+
+		uint32_t faceIndex = 0;
+		auto appendFaces = [this, &chunk, &faceIndex](uint32_t upTo)
+		{
+			if (upTo <= faceIndex)
+				return;
+
 			if (_groups.empty())
 			{
-                _groups.emplace_back("group-" + intToStr(_lastGroupId++), _sizeEstimate);
+				char buffer[OBJGroup::MaxGroupName] = {};
+				sprintf(buffer, "group-%u", static_cast<uint32_t>(_groups.size()));
+				_groups.emplace_back(buffer, _sizeEstimate);
 			}
-			
-			_groups.back().faces.push_back(face);
-		}
-		else if (key == 'v')
+
+			auto& faces = _groups.back().faces;
+			faces.insert(faces.end(), chunk.faces.begin() + faceIndex, chunk.faces.begin() + upTo);
+			faceIndex = upTo;
+		};
+
+		for (const Statement& statement : chunk.statements)
 		{
-			char subKey = static_cast<char>(inputFile.peek());
+			appendFaces(statement.faceIndex);
 			
-			if (subKey == 't')
+			const char* value = statement.value.c_str();
+			switch (statement.type)
 			{
-				vec2 vertex(0.0f);
-				inputFile >> subKey >> vertex;
-				_texCoords.push_back(vertex);
-			}
-			else if (subKey == 'n')
+			case Statement::Type::MaterialLibrary:
 			{
-				vec3 vertex(0.0f);
-				inputFile >> subKey >> vertex;
-
-				if ((_loadOptions & Option_SwapYwithZ) == Option_SwapYwithZ)
-					std::swap(vertex.y, vertex.z);
+				_materialLibraries.emplace_back(statement.value);
+				break;
+			}
 
-				_normals.push_back(vertex);
+			case Statement::Type::Group:
+			{
+				_groups.emplace_back(value, _lastUsedMaterial, _sizeEstimate);
+				break;
 			}
-			else if (isWhitespaceChar(subKey))
+
+			case Statement::Type::UseMaterial:
 			{
-				vec3 vertex(0.0f);
-				inputFile >> vertex;
+				bool addGroup = _groups.empty() ||
+					((strlen(_groups.back().material) > 0) && (strcmp(_groups.back().material, value) != 0));
 
-				if ((_loadOptions & Option_SwapYwithZ) == Option_SwapYwithZ)
-					std::swap(vertex.y, vertex.z);
+				if (addGroup)
+				{
+					char buffer[OBJGroup::MaxGroupName] = {};
+					snprintf(buffer, sizeof(buffer), "group-%u-%s", static_cast<uint32_t>(_groups.size()), value);
+					_groups.emplace_back(buffer, value, _sizeEstimate);
+				}
+				else
+				{
+					size_t stringSize = std::min(static_cast<size_t>(OBJGroup::MaxMaterialName), statement.value.size() + 1);
+					strncpy(_groups.back().material, value, stringSize);
+				}
 
-				_vertices.push_back(vertex);
+				memset(_lastUsedMaterial, 0, sizeof(_lastUsedMaterial));
+				strncpy(_lastUsedMaterial, value, sizeof(_lastUsedMaterial) - 1);
+				break;
 			}
-			else
-			{
-				getLine(inputFile, line);
-				log::warning("Unknown line [%u] `%s`", lineNumber, line.c_str());
+
+			default:
+				log::warning("Unsupported entry `%s` in OBJ file at line %u", value, lineBase + statement.line);
 			}
 		}
-		else
-		{
-			getLine(inputFile, line);
-			log::warning("Unknown line [%u] `%c%s`", lineNumber, key, line.c_str());
-		}
+		appendFaces(static_cast<uint32_t>(chunk.faces.size()));
+
+		lineBase += chunk.lineCount;
+		chunk = OBJChunk();
 	}
 }
 
 s3d::ElementContainer::Pointer OBJLoader::load(et::RenderInterface::Pointer ren, s3d::Storage& storage, ObjectsCache& cache)
 {
-	storage.flush();
+	_renderer = ren;
 
-	bool cacheLoaded = false;
-	if (fileExists(cacheFileName))
-	{
-		cacheLoaded = loadCached(cacheFileName);
-	}
+	s3d::ElementContainer::Pointer result;
+	if (openCache())
+		result = instantiateCached(storage, cache);
 
-	if (cacheLoaded == false)
+	if (result.invalid())
 	{
-		uint64_t fileSize = streamSize(inputFile);
-		_sizeEstimate = std::max(1024llu, fileSize / 128);
-		log::info("Loading OBJ, estimated array sizes: %llu", _sizeEstimate);
-
-		_renderer = ren;
-		_groups.reserve(128);
-		_vertices.reserve(_sizeEstimate);
-		_normals.reserve(_sizeEstimate);
-		_texCoords.reserve(_sizeEstimate);
-
-		_sizeEstimate = std::max(128llu, _sizeEstimate / 2048);
-		log::info("Loading OBJ, estimated face array sizes: %llu", _sizeEstimate);
-
 		uint64_t t1 = queryCurrentTimeInMicroSeconds();
 
-		load(cache);
+		parse();
+		loadMaterialLibraries(cache);
 		uint64_t t2 = queryCurrentTimeInMicroSeconds();
 
 		processLoadedData();
-		// saveCache(cacheFileName);
-		// uint64_t t3 = queryCurrentTimeInMicroSeconds();
+		assignMaterials();
 
 		uint64_t loadingTime = t2 - t1;
 		log::info("OBJ loading time: %llu.%3llums", loadingTime / 1000, loadingTime % 1000);
+
+		result = generateVertexBuffers(storage);
+		saveCache(cacheFileName, result);
 	}
 
-	s3d::ElementContainer::Pointer result = generateVertexBuffers(storage);
 	loaded.invoke(result);
 
 	sharedBlockAllocator().flushUnusedBlocks();
@@ -681,6 +627,81 @@ s3d::ElementContainer::Pointer OBJLoader::load(et::RenderInterface::Pointer ren,
 	return result;
 }
 
+void OBJLoader::prepareAsync()
+{
+	if (openCache())
+		return;
+
+	parse();
+	processLoadedData();
+}
+
+bool OBJLoader::finalizeAsync(RenderInterface::Pointer ren, s3d::Storage& storage, ObjectsCache& cache,
+	uint64_t& budget, s3d::ElementContainer::Pointer& result)
+{
+	_renderer = ren;
+
+	if (_sceneCache.valid())
+	{
+		result = instantiateCached(storage, cache);
+		if (result.valid())
+			return true;
+
+		/*
+		 * Cache could not be used, model is loaded in place
+		 */
+		parse();
+		processLoadedData();
+	}
+
+	for (;;)
+	{
+		switch (_asyncStage)
+		{
+		case AsyncStage::Materials:
+		{
+			/*
+			 * Material libraries load textures, so they take the whole iteration
+			 */
+			loadMaterialLibraries(cache);
+			assignMaterials();
+			addToStorage(storage);
+			_vertexStream.reset(nullptr);
+			_asyncStage = AsyncStage::Upload;
+			return false;
+		}
+
+		case AsyncStage::Upload:
+		{
+			/*
+			 * Data is uploaded in budget-sized parts across run loop iterations
+			 */
+			if (uploadVertexData(budget))
+				_asyncStage = AsyncStage::Meshes;
+
+			if (budget == 0)
+				return false;
+			break;
+		}
+
+		default:
+		{
+			result = generateMeshes();
+			saveCache(cacheFileName, result);
+			sharedBlockAllocator().flushUnusedBlocks();
+			_asyncStage = AsyncStage::Materials;
+			return true;
+		}
+		}
+	}
+}
+
+void OBJLoader::loadMaterialLibraries(ObjectsCache& cache)
+{
+	for (const std::string& library : _materialLibraries)
+		loadMaterials(library, cache);
+}
+
 void OBJLoader::loadMaterials(const std::string& fileName, ObjectsCache& cache)
 {
 	application().pushSearchPath(inputFilePath);
@@ -785,19 +806,19 @@ void OBJLoader::loadMaterials(const std::string& fileName, ObjectsCache& cache)
 				else if (next == 'd')
 				{
 					vec4 value(0.0f);
-					materialFile >> value;
+					obj_local::readVector(materialFile, value);
 					_lastMaterial->setVector(MaterialVariable::DiffuseReflectance, value);
 				} 
 				else if (next == 's')
 				{
 					vec4 value(0.0f);
-					materialFile >> value;
+					obj_local::readVector(materialFile, value);
 					_lastMaterial->setVector(MaterialVariable::SpecularReflectance, value);
 				} 
 				else if (next == 'e')
 				{
 					vec4 value(0.0f);
-					materialFile >> value;
+					obj_local::readVector(materialFile, value);
 					_lastMaterial->setVector(MaterialVariable::EmissiveColor, value);
 				} 
 				else
@@ -1062,20 +1083,74 @@ void OBJLoader::processLoadedData() {
 		}
 	}
 
-	for (MaterialInstance::Pointer& mat : _materials)
-	{
-		if (mat->texture(MaterialTexture::BaseColor).invalid())
-			mat->setTexture(MaterialTexture::BaseColor, _renderer->whiteTexture());
-		if (mat->texture(MaterialTexture::Normal).invalid())
-			mat->setTexture(MaterialTexture::Normal, _renderer->flatNormalTexture());
-		if (mat->texture(MaterialTexture::Opacity).invalid())
-			mat->setTexture(MaterialTexture::Opacity, _renderer->whiteTexture());
-	}
-	uint32_t totalVertices = 3 * totalTriangles;
+	uint32_t totalIndices = 3 * totalTriangles;
 
 	bool hasNormals = _normals.size() > 0;
 	bool hasTexCoords = _texCoords.size() > 0;
 
+	/*
+	 * Vertices are shared between faces of the group, when their (position, texcoord, normal)
+	 * triplets match. Files without normals keep vertices unique, so calculated normals are faceted
+	 */
+	Vector<uint32_t> indices;
+	indices.reserve(totalIndices);
+
+	Vector<OBJFace::VertexLink> vertexLinks;
+	Vector<uint32_t> vertexGroups;
+	vertexLinks.reserve(totalIndices);
+	vertexGroups.reserve(totalIndices);
+
+	Vector<vec3> centers(_groups.size(), vec3(0.0f));
+	obj_local::LinkTable linkTable;
+	for (uint32_t g = 0, ge = static_cast<uint32_t>(_groups.size()); g < ge; ++g)
+	{
+		const OBJGroup& group = _groups[g];
+
+		uint32_t groupCorners = 0;
+		for (const OBJFace& face : group.faces)
+			groupCorners += 3 * (face.vertexLinksCount - 2);
+
+		if (hasNormals)
+			linkTable.reset(groupCorners);
+
+		auto addCorner = [&](const OBJFace::VertexLink& link)
+		{
+			uint32_t index = static_cast<uint32_t>(vertexLinks.size());
+			if (hasNormals)
+				index = linkTable.findOrInsert(link.data, index);
+
+			if (index == vertexLinks.size())
+			{
+				vertexLinks.emplace_back(link);
+				vertexGroups.emplace_back(g);
+			}
+			indices.emplace_back(index);
+		};
+
+		uint32_t vertexCount = 0;
+		for (const OBJFace& face : group.faces)
+		{
+			uint32_t numTriangles = face.vertexLinksCount - 2;
+			for (uint32_t i = 1; i <= numTriangles; ++i)
+			{
+				addCorner(face.vertexLinks[0]);
+				addCorner(face.vertexLinks[i]);
+				addCorner(face.vertexLinks[i + 1]);
+
+				if (_loadOptions & Option_CalculateTransforms)
+				{
+					centers[g] += _vertices[face.vertexLinks[0][0]];
+					centers[g] += _vertices[face.vertexLinks[i][0]];
+					centers[g] += _vertices[face.vertexLinks[i + 1][0]];
+					vertexCount += 3;
+				}
+			}
+		}
+
+		if (vertexCount > 0)
+			centers[g] /= static_cast<float>(vertexCount);
+	}
+
 	VertexDeclaration decl(true, VertexAttributeUsage::Position, DataType::Vec3);
 	decl.push_back(VertexAttributeUsage::Normal, DataType::Vec3);
 
@@ -1087,11 +1162,13 @@ void OBJLoader::processLoadedData() {
 			decl.push_back(VertexAttributeUsage::Tangent, DataType::Vec3);
 	}
 
+	uint32_t totalVertices = static_cast<uint32_t>(vertexLinks.size());
 	IndexArrayFormat fmt = (totalVertices > 65535) ? IndexArrayFormat::Format_32bit : IndexArrayFormat::Format_16bit;
 
-	log::info("Index array + vertex storage: %u vertices", totalVertices);
-	_indices = IndexArray::Pointer::create(fmt, totalVertices, PrimitiveType::Triangles);
-	_indices->linearize(totalVertices);
+	log::info("Index array + vertex storage: %u indices, %u vertices", totalIndices, totalVertices);
+	_indices = IndexArray::Pointer::create(fmt, totalIndices, PrimitiveType::Triangles);
+	for (uint32_t i = 0; i < totalIndices; ++i)
+		_indices->setIndex(indices[i], i);
 
 	_vertexData = VertexStorage::Pointer::create(decl, totalVertices);
 
@@ -1105,57 +1182,87 @@ void OBJLoader::processLoadedData() {
 	if (_vertexData->hasAttributeWithType(VertexAttributeUsage::TexCoord0, DataType::Vec2))
 		tex = _vertexData->accessData<DataType::Vec2>(VertexAttributeUsage::TexCoord0, 0);
 
-	uint32_t index = 0;
+	for (uint32_t v = 0; v < totalVertices; ++v)
+	{
+		const OBJFace::VertexLink& link = vertexLinks[v];
+		pos[v] = _vertices[link[0]] - centers[vertexGroups[v]];
+		if (hasTexCoords)
+			tex[v] = _texCoords[link[1]];
+		if (hasNormals)
+			nrm[v] = _normals[link[2]];
+	}
 
-	for (const OBJGroup& group : _groups)
+	uint32_t index = 0;
+	for (uint32_t g = 0, ge = static_cast<uint32_t>(_groups.size()); g < ge; ++g)
 	{
+		const OBJGroup& group = _groups[g];
+
 		uint32_t startIndex = index;
+		for (const OBJFace& face : group.faces)
+			index += 3 * (face.vertexLinksCount - 2);
 
-		vec3 center(0.0f);
+		_meshes.emplace_back(group.name, startIndex, index - startIndex, MaterialInstance::Pointer(), centers[g]);
+	}
 
-		if (_loadOptions & Option_CalculateTransforms)
-		{
-			uint32_t vertexCount = 0;
+	bool calculateTangents = (_loadOptions & Option_CalculateTangents) == Option_CalculateTangents;
+	primitives::TriangleAdjacency adjacency;
+	if ((hasNormals == false) || calculateTangents)
+		adjacency = primitives::buildTriangleAdjacency(_indices, 0, _indices->primitivesCount(), _vertexData->capacity());
 
-			for (const OBJFace& face : group.faces)
-			{
-				uint32_t numTriangles = face.vertexLinksCount - 2;
-				for (uint32_t i = 1; i <= numTriangles; ++i)
-				{
-					center += _vertices[face.vertexLinks[0][0]];
-					center += _vertices[face.vertexLinks[i][0]];
-					center += _vertices[face.vertexLinks[i + 1][0]];
-					vertexCount += 3;
-				}
-			}
+	if (hasNormals == false)
+	{
+		log::info("Calculating normals...");
+		primitives::calculateNormals(_vertexData, adjacency);
+	}
 
-			if (vertexCount > 0.0f)
-				center /= static_cast<float>(vertexCount);
-		}
+	if (calculateTangents)
+	{
+		log::info("Calculating tangents...");
+		primitives::calculateTangents(_vertexData, adjacency);
+	}
 
-		for (const OBJFace& face : group.faces)
-		{
-			uint32_t numTriangles = face.vertexLinksCount - 2;
-			for (uint32_t i = 1; i <= numTriangles; ++i)
-			{
-				pos[index + 0] = _vertices[face.vertexLinks[0][0]] - center;
-				pos[index + 1] = _vertices[face.vertexLinks[i][0]] - center;
-				pos[index + 2] = _vertices[face.vertexLinks[i + 1][0]] - center;
-				if (hasTexCoords)
-				{
-					tex[index + 0] = _texCoords[face.vertexLinks[0][1]];
-					tex[index + 1] = _texCoords[face.vertexLinks[i][1]];
-					tex[index + 2] = _texCoords[face.vertexLinks[i + 1][1]];
-				}
-				if (hasNormals)
-				{
-					nrm[index + 0] = _normals[face.vertexLinks[0][2]];
-					nrm[index + 1] = _normals[face.vertexLinks[i][2]];
-					nrm[index + 2] = _normals[face.vertexLinks[i + 1][2]];
-				}
-				index += 3;
-			}
-		}
+	meshoptimizer::IndexRangeList ranges;
+	ranges.reserve(_meshes.size());
+	for (const OBJMeshIndexBounds& mesh : _meshes)
+		ranges.emplace_back(mesh.start, mesh.count);
+
+	if ((_loadOptions & Option_OptimizeMeshes) == Option_OptimizeMeshes)
+	{
+		log::info("Optimizing meshes...");
+		meshoptimizer::optimize(_vertexData, _indices, ranges);
+	}
+
+	if ((_loadOptions & Option_GenerateLevelsOfDetail) == Option_GenerateLevelsOfDetail)
+	{
+		/*
+		 * Simplification requires indexed vertices, loaded ones are not shared without normals
+		 */
+		log::info("Generating levels of detail...");
+		if ((_loadOptions & Option_OptimizeMeshes) == 0)
+			meshoptimizer::removeDuplicateVertices(_vertexData, _indices, ranges);
+		_levelsOfDetail = meshsimplifier::generateLevelsOfDetail(_vertexData, _indices, ranges);
+	}
+}
+
+void OBJLoader::assignMaterials()
+{
+	for (MaterialInstance::Pointer& mat : _materials)
+	{
+		if (mat->texture(MaterialTexture::BaseColor).invalid())
+			mat->setTexture(MaterialTexture::BaseColor, _renderer->whiteTexture());
+		if (mat->texture(MaterialTexture::Normal).invalid())
+			mat->setTexture(MaterialTexture::Normal, _renderer->flatNormalTexture());
+		if (mat->texture(MaterialTexture::Opacity).invalid())
+			mat->setTexture(MaterialTexture::Opacity, _renderer->whiteTexture());
+	}
+
+	/*
+	 * Meshes are generated one per group
+	 */
+	ET_ASSERT(_meshes.size() == _groups.size());
+	for (size_t g = 0, ge = _groups.size(); g < ge; ++g)
+	{
+		const OBJGroup& group = _groups[g];
 
 		MaterialInstance::Pointer m;
 		for (const MaterialInstance::Pointer& mat : _materials)
@@ -1174,108 +1281,191 @@ void OBJLoader::processLoadedData() {
 			m = microfacet->instance();
 			m->setName("missing_material");
 		}
+		_meshes[g].material = m;
+	}
+}
+
+void OBJLoader::addToStorage(s3d::Storage& storage)
+{
+	storage.flush();
+	storage.addVertexStorage(_vertexData);
+	storage.setIndexArray(_indices);
+	
+	for (auto m : _materials)
+		storage.addMaterial(m);
+}
+	
+/*
+ * Uploads vertices, then indices, decreasing budget by the uploaded size. At least one element
+ * is uploaded per call, returns true when all data is uploaded
+ */
+bool OBJLoader::uploadVertexData(uint64_t& budget)
+{
+	GeometryBuffer& geometryBuffer = _renderer->sharedGeometryBuffer();
+	if (_vertexStream.invalid())
+	{
+		/*
+		 * Compressed data is used only on GPU, render batches keep original storage
+		 */
+		_gpuVertexData = _vertexData;
+		if ((_loadOptions & Option_CompressVertexData) == Option_CompressVertexData)
+			_gpuVertexData = primitives::encodeVertexStorage(_vertexData, primitives::compressedVertexDeclaration(_vertexData->declaration()));
+	
+		const VertexDeclaration& decl = _gpuVertexData->declaration();
+		_vertexStream = geometryBuffer.allocate(decl, static_cast<uint32_t>(_gpuVertexData->data().size() / decl.sizeInBytes()),
+			_indices->format(), _indices->capacity(), _indices->primitiveType());
+		ET_ASSERT(_vertexStream.valid());
 
-		uint32_t startIndex_u32 = static_cast<uint32_t>(startIndex);
-		uint32_t numIndexes_u32 = static_cast<uint32_t>(index - startIndex);
-		_meshes.emplace_back(group.name, startIndex_u32, numIndexes_u32, m, center);
+		if (_vertexStream.invalid())
+			return true;
+
+		_vertexStream->setPositionDequantization(_gpuVertexData->positionScale(), _gpuVertexData->positionOffset());
+		_uploadedVertices = 0;
+		_uploadedIndices = 0;
 	}
 
-	if (hasNormals == false)
+	uint32_t vertexCount = _vertexStream->vertexCount();
+	if (_uploadedVertices < vertexCount)
 	{
-		log::info("Calculating normals...");
-		primitives::calculateNormals(_vertexData, _indices, 0, _indices->primitivesCount());
+		uint64_t stride = _gpuVertexData->declaration().sizeInBytes();
+		uint32_t count = static_cast<uint32_t>(std::min(static_cast<uint64_t>(vertexCount - _uploadedVertices), std::max(uint64_t(1), budget / stride)));
+		geometryBuffer.uploadVertices(_vertexStream, _gpuVertexData, _uploadedVertices, count);
+		_uploadedVertices += count;
+		budget -= std::min(budget, count * stride);
 	}
 
-	if ((_loadOptions & Option_CalculateTangents) == Option_CalculateTangents)
+	uint32_t indexCount = _indices->capacity();
+	if ((_uploadedVertices == vertexCount) && (_uploadedIndices < indexCount) && (budget > 0))
 	{
-		log::info("Calculating tangents...");
-		primitives::calculateTangents(_vertexData, _indices, 0, _indices->primitivesCount());
+		uint64_t indexSize = static_cast<uint64_t>(_vertexStream->indexArrayFormat());
+		uint32_t count = static_cast<uint32_t>(std::min(static_cast<uint64_t>(indexCount - _uploadedIndices), std::max(uint64_t(1), budget / indexSize)));
+		geometryBuffer.uploadIndices(_vertexStream, _indices, _uploadedIndices, count);
+		_uploadedIndices += count;
+		budget -= std::min(budget, count * indexSize);
 	}
+
+	bool finished = (_uploadedVertices == vertexCount) && (_uploadedIndices == indexCount);
+	if (finished)
+		_gpuVertexData.reset(nullptr);
+
+	return finished;
 }
 
-s3d::ElementContainer::Pointer OBJLoader::generateVertexBuffers(s3d::Storage& storage)
+s3d::ElementContainer::Pointer OBJLoader::generateMeshes()
 {
 	s3d::ElementContainer::Pointer result = s3d::ElementContainer::Pointer::create(inputFileName, nullptr);
 
-	storage.flush();
-	storage.addVertexStorage(_vertexData);
-	storage.setIndexArray(_indices);
-	
-	for (auto m : _materials)
-		storage.addMaterial(m);
-	
-	Buffer::Pointer vb = _renderer->createVertexBuffer("model-vb", _vertexData, Buffer::Location::Device);
-	Buffer::Pointer ib = _renderer->createIndexBuffer("model-ib", _indices, Buffer::Location::Device);
-	
-	VertexStream::Pointer vao = VertexStream::Pointer::create();
-	vao->setVertexBuffer(vb, _vertexData->declaration());
-	vao->setIndexBuffer(ib, _indices->format());
-	vao->setPrimitiveType(_indices->primitiveType());
-
-	vec3 minExtent(+std::numeric_limits<float>::max());
-	vec3 maxExtent(-std::numeric_limits<float>::max());
-	for (auto& i : _meshes)
+	for (size_t m = 0, me = _meshes.size(); m < me; ++m)
 	{
+		const OBJMeshIndexBounds& i = _meshes[m];
 		s3d::Mesh::Pointer mesh = Mesh::Pointer::create(i.name, result.pointer());
 		mesh->setTranslation(i.center);
 
-		RenderBatch::Pointer rb = _renderer->allocateRenderBatch(i.material, vao, i.start, i.count);
+		RenderBatch::Pointer rb = _renderer->allocateRenderBatch(i.material, _vertexStream, i.start, i.count);
 		rb->setVertexStorage(_vertexData);
 		rb->setIndexArray(_indices);
 		mesh->addRenderBatch(rb);
+
+		if (m < _levelsOfDetail.size())
+		{
+			for (const meshsimplifier::LevelOfDetail& level : _levelsOfDetail[m])
+			{
+				s3d::Mesh::LevelOfDetail lod;
+				lod.error = level.error;
+				lod.renderBatches.emplace_back(_renderer->allocateRenderBatch(i.material, _vertexStream, level.range.first, level.range.count));
+				lod.renderBatches.back()->setVertexStorage(_vertexData);
+				lod.renderBatches.back()->setIndexArray(_indices);
+				mesh->addLevelOfDetail(lod);
+			}
+		}
 		mesh->calculateSupportData();
-		maxExtent = maxv(maxExtent, mesh->tranformedBoundingBox().maxVertex());
-		minExtent = minv(minExtent, mesh->tranformedBoundingBox().minVertex());
 	}
 	return result;
 }
 
-void OBJLoader::threadFinished()
+s3d::ElementContainer::Pointer OBJLoader::generateVertexBuffers(s3d::Storage& storage)
 {
-	ET_FAIL("TODO");
-	/*
-	 * TODO
-	 *
-	loaded.invoke(generateVertexBuffers(storage));
-	// */
+	addToStorage(storage);
+	_vertexStream.reset(nullptr);
+
+	uint64_t budget = std::numeric_limits<uint64_t>::max();
+	uploadVertexData(budget);
+
+	return generateMeshes();
 }
 
-bool OBJLoader::loadCached(const std::string& fileName)
+bool OBJLoader::openCache()
 {
-	return false;
+	if (!fileExists(cacheFileName) || !_sceneCache.open(cacheFileName))
+		return false;
+
+	for (const std::string& dependency : _sceneCache.dependencies())
+	{
+		uint64_t identifier = 0;
+		std::string materialFile;
+		if (!obj_local::parseCacheDependency(dependency, identifier, materialFile) || (getFileUniqueIdentifier(materialFile) != identifier))
+		{
+			log::info("Material library %s was modified, cached model is not used", materialFile.c_str());
+			_sceneCache = s3d::SceneCache();
+			return false;
+		}
+	}
+
+	return true;
 }
 
-void OBJLoader::saveCache(const std::string& fileName)
+s3d::ElementContainer::Pointer OBJLoader::instantiateCached(s3d::Storage& storage, ObjectsCache& cache)
 {
-	/*
-	std::string cachePath = getFilePath(fileName);
+	storage.flush();
 
-	if (folderExists(cachePath) || createDirectory(cachePath, true))
+	/*
+	 * Dependencies are material libraries, materials are resolved by name
+	 */
+	for (const std::string& dependency : _sceneCache.dependencies())
 	{
-		std::ofstream fOut(fileName, std::ios::binary);
-		
-		_vertexData->serialize(fOut);
-		_indices->serialize(fOut);
+		uint64_t identifier = 0;
+		std::string materialFile;
+		if (obj_local::parseCacheDependency(dependency, identifier, materialFile))
+			loadMaterials(materialFile, cache);
+	}
 
-		uint32_t materialsCount = static_cast<uint32_t>(_materials.size());
-		serializeUInt32(fOut, materialsCount);
+	auto materialProvider = [this](const std::string& name) -> MaterialInstance::Pointer
+	{
 		for (const MaterialInstance::Pointer& material : _materials)
-			material->serialize(fOut);
-
-		uint32_t meshesCount = static_cast<uint32_t>(_meshes.size());
-		serializeUInt32(fOut, meshesCount);
-		for (const OBJMeshIndexBounds& mesh : _meshes)
 		{
-			serializeString(fOut, mesh.name);
-			serializeString(fOut, mesh.material->name());
-			serializeUInt32(fOut, mesh.start);
-			serializeUInt32(fOut, mesh.count);
-			serializeVector(fOut, mesh.center);
+			if (material->name() == name)
+				return material;
 		}
+		return MaterialInstance::Pointer();
+	};
+
+	uint32_t options = ((_loadOptions & Option_CompressVertexData) == Option_CompressVertexData) ?
+		s3d::SceneCache::Option_CompressVertexData : s3d::SceneCache::Option_None;
+
+	s3d::BaseElement::Pointer root = _sceneCache.instantiate(_renderer, storage, materialProvider, options);
+	_sceneCache = s3d::SceneCache();
+
+	if (root.invalid() || (root->type() != s3d::ElementType::Container))
+	{
+		log::warning("Unable to instantiate cached model %s", cacheFileName.c_str());
+		storage.flush();
+		return s3d::ElementContainer::Pointer();
+	}
 
-		fOut.close();
+	return s3d::ElementContainer::Pointer(static_cast<s3d::ElementContainer*>(root.pointer()));
+}
+
+void OBJLoader::saveCache(const std::string& fileName, s3d::ElementContainer::Pointer root)
+{
+	std::string cachePath = getFilePath(fileName);
+	if (folderExists(cachePath) || createDirectory(cachePath, true))
+	{
+		Vector<std::string> dependencies;
+		for (const std::string& materialFile : _loadedMaterials)
+			dependencies.emplace_back(obj_local::cacheDependency(materialFile));
+		
+		s3d::SceneCache::save(fileName, root, dependencies);
 	}
-	*/
 }
 
 /*
@@ -9,9 +9,11 @@
 
 #include <et/scene3d/mesh.h>
 #include <et/scene3d/storage.h>
+#include <et/scene3d/scenecache.h>
 #include <et/scene3d/modelloader.h>
 #include <et/rendering/interface/renderer.h>
 #include <et/rendering/base/vertexstorage.h>
+#include <et/rendering/base/meshsimplifier.h>
 
 namespace et
 {
@@ -25,6 +27,9 @@ public:
 		Option_SwapYwithZ = 1 << 0,
 		Option_CalculateTransforms = 1 << 1,
 		Option_CalculateTangents = 1 << 2,
+		Option_CompressVertexData = 1 << 3,
+		Option_OptimizeMeshes = 1 << 4,
+		Option_GenerateLevelsOfDetail = 1 << 5,
 	};
 
 public:
@@ -33,9 +38,19 @@ public:
 
 	s3d::ElementContainer::Pointer load(RenderInterface::Pointer, s3d::Storage&, ObjectsCache&) override;
 
-	ET_DECLARE_EVENT1(loaded, s3d::ElementContainer::Pointer);
+protected:
+	void prepareAsync() override;
+	bool finalizeAsync(RenderInterface::Pointer, s3d::Storage&, ObjectsCache&, uint64_t& budget,
+		s3d::ElementContainer::Pointer& result) override;
 
 private:
+	enum class AsyncStage : uint32_t
+	{
+		Materials,
+		Upload,
+		Meshes
+	};
+
 	struct OBJMeshIndexBounds
 	{
 		std::string name;
@@ -108,19 +123,29 @@ private:
 		}
 	};
 
+	/*
+	 * Contiguous range of lines, parsed independently; defined in objloader.cpp
+	 */
+	struct OBJChunk;
+
 private:
-	void loadData(ObjectsCache& cache);
-	void load(ObjectsCache& cache);
+	static void parseChunk(OBJChunk&, uint32_t options);
+	void parse();
 	
-	bool loadCached(const std::string& fileName);
-	void saveCache(const std::string& fileName);
+	bool openCache();
+	s3d::ElementContainer::Pointer instantiateCached(s3d::Storage&, ObjectsCache&);
+	void saveCache(const std::string& fileName, s3d::ElementContainer::Pointer);
 	
 	void processLoadedData();
+	void assignMaterials();
 
+	void addToStorage(s3d::Storage&);
+	bool uploadVertexData(uint64_t& budget);
+	s3d::ElementContainer::Pointer generateMeshes();
 	s3d::ElementContainer::Pointer generateVertexBuffers(s3d::Storage&);
 
 	void loadMaterials(const std::string& fileName, ObjectsCache& cache);
-	void threadFinished();
+	void loadMaterialLibraries(ObjectsCache& cache);
 
 private:
 	RenderInterface::Pointer _renderer;
@@ -134,9 +159,17 @@ private:
 	MaterialInstance::Pointer _lastMaterial;
 	MaterialInstance::Collection _materials;
 	Vector<OBJMeshIndexBounds> _meshes;
+	Vector<meshsimplifier::LevelOfDetailList> _levelsOfDetail;
 
 	IndexArray::Pointer _indices;
 	VertexStorage::Pointer _vertexData;
+	VertexStream::Pointer _vertexStream;
+	VertexStorage::Pointer _gpuVertexData;
+	uint32_t _uploadedVertices = 0;
+	uint32_t _uploadedIndices = 0;
+	s3d::SceneCache _sceneCache;
+	Vector<std::string> _materialLibraries;
+	AsyncStage _asyncStage = AsyncStage::Materials;
 
 	std::vector<et::vec3> _vertices;
 	std::vector<et::vec3> _normals;
@@ -147,7 +180,5 @@ private:
 
 	uint32_t _loadOptions = Option_JustLoad;
 	uint64_t _sizeEstimate = 1024;
-	int _lastSmoothGroup = 0;
-	int _lastGroupId = 0;
 };
 }
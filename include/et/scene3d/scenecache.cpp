@@ -0,0 +1,1076 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/core/tools.h>
+#include <et/rendering/base/primitives.h>
+#include <et/scene3d/skeletonelement.h>
+#include <et/scene3d/elementcontainer.h>
+#include <et/scene3d/scenecache.h>
+
+namespace et
+{
+namespace s3d
+{
+
+namespace sc_local
+{
+enum : uint32_t
+{
+	Signature = ET_COMPOSE_UINT32('E', 'T', 'S', 'C'),
+	Version = 2,
+	Alignment = 16,
+	InvalidIndex = static_cast<uint32_t>(-1),
+};
+
+enum ChunkType : uint32_t
+{
+	Chunk_Strings,
+	Chunk_VertexStorages,
+	Chunk_VertexElements,
+	Chunk_IndexArrays,
+	Chunk_Elements,
+	Chunk_LevelsOfDetail,
+	Chunk_RenderBatches,
+	Chunk_Animations,
+	Chunk_Properties,
+	Chunk_Dependencies,
+	Chunk_DeformerClusters,
+	Chunk_Blob,
+
+	Chunk_max
+};
+
+struct FileHeader
+{
+	uint32_t signature = Signature;
+	uint32_t version = Version;
+	uint32_t chunkCount = 0;
+	uint32_t reserved = 0;
+};
+
+struct ChunkHeader
+{
+	uint32_t type = 0;
+	uint32_t count = 0;
+	uint64_t offset = 0;
+	uint64_t size = 0;
+	uint64_t reserved = 0;
+};
+
+struct VertexStorageRecord
+{
+	uint32_t name = 0;
+	uint32_t firstElement = 0;
+	uint32_t elementCount = 0;
+	uint32_t capacity = 0;
+	uint32_t interleaved = 0;
+	uint32_t reserved[3] { };
+	uint64_t dataOffset = 0;
+	uint64_t dataSize = 0;
+};
+
+struct VertexElementRecord
+{
+	uint32_t usage = 0;
+	uint32_t type = 0;
+	uint32_t encoding = 0;
+	uint32_t reserved = 0;
+};
+
+struct IndexArrayRecord
+{
+	uint32_t format = 0;
+	uint32_t primitiveType = 0;
+	uint32_t actualSize = 0;
+	uint32_t capacity = 0;
+	uint64_t dataOffset = 0;
+	uint64_t dataSize = 0;
+};
+
+struct ElementRecord
+{
+	uint32_t type = 0;
+	uint32_t parent = InvalidIndex;
+	uint32_t name = 0;
+	uint32_t reserved0 = 0;
+	uint64_t flags = 0;
+	vec4 orientation;
+	vec3 translation;
+	vec3 scale;
+	uint32_t firstBatch = 0;
+	uint32_t batchCount = 0;
+	uint32_t firstLevel = 0;
+	uint32_t levelCount = 0;
+	uint32_t firstAnimation = 0;
+	uint32_t animationCount = 0;
+	uint32_t firstProperty = 0;
+	uint32_t propertyCount = 0;
+	uint32_t firstCluster = 0;
+	uint32_t clusterCount = 0;
+	uint32_t reserved1[2] { };
+};
+
+struct LevelOfDetailRecord
+{
+	float error = 0.0f;
+	uint32_t firstBatch = 0;
+	uint32_t batchCount = 0;
+	uint32_t reserved = 0;
+};
+
+struct RenderBatchRecord
+{
+	uint32_t material = 0;
+	uint32_t vertexStorage = InvalidIndex;
+	uint32_t indexArray = InvalidIndex;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	uint32_t reserved[3] { };
+};
+
+/*
+ * Frames are stored in blob as separate 16 bytes aligned arrays:
+ * times, translations, orientations (scalar, x, y, z), scales
+ */
+struct AnimationRecord
+{
+	float startTime = 0.0f;
+	float stopTime = 0.0f;
+	float frameRate = 0.0f;
+	uint32_t outOfRangeMode = 0;
+	uint32_t frameCount = 0;
+	uint32_t reserved = 0;
+	uint64_t timesOffset = 0;
+	uint64_t translationsOffset = 0;
+	uint64_t orientationsOffset = 0;
+	uint64_t scalesOffset = 0;
+	uint64_t reserved1 = 0;
+};
+
+/*
+ * Link is the index of skeleton element, weights are stored in blob
+ */
+struct DeformerClusterRecord
+{
+	uint32_t link = InvalidIndex;
+	uint32_t weightCount = 0;
+	uint64_t weightsOffset = 0;
+	uint64_t linkTag = 0;
+	uint64_t reserved = 0;
+	mat4 linkInitialTransformInverse;
+	mat4 meshInitialTransform;
+};
+
+static_assert(sizeof(FileHeader) % Alignment == 0, "Invalid header size");
+static_assert(sizeof(ChunkHeader) % Alignment == 0, "Invalid chunk header size");
+static_assert(sizeof(VertexStorageRecord) % Alignment == 0, "Invalid record size");
+static_assert(sizeof(IndexArrayRecord) % Alignment == 0, "Invalid record size");
+static_assert(sizeof(ElementRecord) % Alignment == 0, "Invalid record size");
+static_assert(sizeof(RenderBatchRecord) % Alignment == 0, "Invalid record size");
+static_assert(sizeof(AnimationRecord) % Alignment == 0, "Invalid record size");
+static_assert(sizeof(DeformerClusterRecord) % Alignment == 0, "Invalid record size");
+static_assert(sizeof(MeshDeformerCluster::VertexWeight) == 2 * sizeof(uint32_t), "Invalid vertex weight size");
+
+class Writer
+{
+public:
+	uint32_t addString(const std::string& s)
+	{
+		auto i = _stringOffsets.find(s);
+		if (i != _stringOffsets.end())
+			return i->second;
+
+		uint32_t offset = static_cast<uint32_t>(_strings.size());
+		_strings.insert(_strings.end(), s.begin(), s.end());
+		_strings.emplace_back(0);
+		_stringOffsets.emplace(s, offset);
+		return offset;
+	}
+
+	uint64_t addBlob(const void* data, uint64_t size)
+	{
+		uint64_t offset = alignUpTo(static_cast<uint64_t>(_blob.size()), uint64_t(Alignment));
+		_blob.resize(offset + size);
+		if (size > 0)
+			memcpy(_blob.data() + offset, data, size);
+		return offset;
+	}
+
+	template <class T>
+	void setChunk(ChunkType type, const Vector<T>& records)
+	{
+		_chunks[type].count = static_cast<uint32_t>(records.size());
+		_chunks[type].data.resize(sizeof(T) * records.size());
+		if (!records.empty())
+			memcpy(_chunks[type].data.data(), records.data(), _chunks[type].data.size());
+	}
+
+	bool write(const std::string& fileName)
+	{
+		_chunks[Chunk_Strings].count = static_cast<uint32_t>(_stringOffsets.size());
+		_chunks[Chunk_Strings].data = _strings;
+		_chunks[Chunk_Blob].count = 1;
+		_chunks[Chunk_Blob].data.swap(_blob);
+
+		FileHeader header;
+		header.chunkCount = Chunk_max;
+
+		Vector<ChunkHeader> headers(Chunk_max);
+		uint64_t offset = sizeof(FileHeader) + sizeof(ChunkHeader) * headers.size();
+		for (uint32_t i = 0; i < Chunk_max; ++i)
+		{
+			offset = alignUpTo(offset, uint64_t(Alignment));
+			headers[i].type = i;
+			headers[i].count = _chunks[i].count;
+			headers[i].offset = offset;
+			headers[i].size = _chunks[i].data.size();
+			offset += headers[i].size;
+		}
+
+		std::ofstream output(fileName, std::ios::out | std::ios::binary);
+		if (!output.is_open())
+			return false;
+
+		output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		output.write(reinterpret_cast<const char*>(headers.data()), sizeof(ChunkHeader) * headers.size());
+
+		const char padding[Alignment] = { };
+		uint64_t written = sizeof(FileHeader) + sizeof(ChunkHeader) * headers.size();
+		for (uint32_t i = 0; i < Chunk_max; ++i)
+		{
+			output.write(padding, static_cast<std::streamsize>(headers[i].offset - written));
+			output.write(_chunks[i].data.data(), static_cast<std::streamsize>(headers[i].size));
+			written = headers[i].offset + headers[i].size;
+		}
+
+		return !output.fail();
+	}
+
+private:
+	struct Chunk
+	{
+		uint32_t count = 0;
+		Vector<char> data;
+	};
+
+private:
+	Chunk _chunks[Chunk_max];
+	UnorderedMap<std::string, uint32_t> _stringOffsets;
+	Vector<char> _strings;
+	Vector<char> _blob;
+};
+
+template <class T>
+uint32_t indexOf(Map<const T*, uint32_t>& indices, const T* object)
+{
+	auto i = indices.find(object);
+	if (i != indices.end())
+		return i->second;
+
+	uint32_t index = static_cast<uint32_t>(indices.size());
+	indices.emplace(object, index);
+	return index;
+}
+
+}
+
+bool SceneCache::save(const std::string& fileName, BaseElement::Pointer root, const Vector<std::string>& dependencies)
+{
+	using namespace sc_local;
+
+	Writer writer;
+
+	Vector<ElementRecord> elements;
+	Vector<LevelOfDetailRecord> levels;
+	Vector<RenderBatchRecord> batches;
+	Vector<AnimationRecord> animations;
+	Vector<uint32_t> properties;
+	Vector<uint32_t> dependencyStrings;
+	Vector<DeformerClusterRecord> clusters;
+	Vector<const BaseElement*> clusterLinks;
+	Map<const BaseElement*, uint32_t> elementIndices;
+
+	Map<const VertexStorage*, uint32_t> storageIndices;
+	Vector<VertexStorage::Pointer> storages;
+	Map<const IndexArray*, uint32_t> indexArrayIndices;
+	Vector<IndexArray::Pointer> indexArrays;
+
+	auto addBatches = [&](const Vector<RenderBatch::Pointer>& source, uint32_t& first, uint32_t& count)
+	{
+		first = static_cast<uint32_t>(batches.size());
+		count = static_cast<uint32_t>(source.size());
+		for (const RenderBatch::Pointer& rb : source)
+		{
+			RenderBatchRecord record;
+			record.material = writer.addString(rb->material().valid() ? rb->material()->name() : emptyString);
+			record.firstIndex = rb->firstIndex();
+			record.indexCount = rb->numIndexes();
+			if (rb->vertexStorage().valid())
+			{
+				record.vertexStorage = indexOf(storageIndices, rb->vertexStorage().pointer());
+				if (record.vertexStorage == storages.size())
+					storages.emplace_back(rb->vertexStorage());
+			}
+			if (rb->indexArray().valid())
+			{
+				record.indexArray = indexOf(indexArrayIndices, rb->indexArray().pointer());
+				if (record.indexArray == indexArrays.size())
+					indexArrays.emplace_back(rb->indexArray());
+			}
+			batches.emplace_back(record);
+		}
+	};
+
+	/*
+	 * Depth first preorder, so parents are always created before children
+	 */
+	Vector<std::pair<BaseElement::Pointer, uint32_t>> stack(1, std::make_pair(root, uint32_t(InvalidIndex)));
+	while (!stack.empty())
+	{
+		BaseElement::Pointer element = stack.back().first;
+		uint32_t parent = stack.back().second;
+		stack.pop_back();
+
+		ElementRecord record;
+		record.type = static_cast<uint32_t>(element->type());
+		record.parent = parent;
+		record.name = writer.addString(element->name());
+		record.flags = element->flags();
+		const quaternion& q = element->orientation();
+		record.orientation = vec4(q.scalar, q.vector.x, q.vector.y, q.vector.z);
+		record.translation = element->translation();
+		record.scale = element->scale();
+
+		record.firstProperty = static_cast<uint32_t>(properties.size());
+		for (const std::string& p : element->properties())
+			properties.emplace_back(writer.addString(p));
+		record.propertyCount = static_cast<uint32_t>(properties.size()) - record.firstProperty;
+
+		record.firstAnimation = static_cast<uint32_t>(animations.size());
+		for (const Animation& a : element->animations())
+		{
+			AnimationRecord ar;
+			ar.startTime = a.startTime();
+			ar.stopTime = a.stopTime();
+			ar.frameRate = a.frameRate();
+			ar.outOfRangeMode = static_cast<uint32_t>(a.outOfRangeMode());
+			ar.frameCount = a.frameCount();
+
+			Vector<float> times(ar.frameCount);
+			Vector<vec3> translations(ar.frameCount);
+			Vector<vec4> orientations(ar.frameCount);
+			Vector<vec3> scales(ar.frameCount);
+			for (uint32_t f = 0; f < ar.frameCount; ++f)
+			{
+				Animation::Frame frame = a.frame(f);
+				times[f] = frame.time;
+				translations[f] = frame.translation;
+				orientations[f] = vec4(frame.orientation.scalar, frame.orientation.vector.x,
+					frame.orientation.vector.y, frame.orientation.vector.z);
+				scales[f] = frame.scale;
+			}
+			ar.timesOffset = writer.addBlob(times.data(), sizeof(float) * times.size());
+			ar.translationsOffset = writer.addBlob(translations.data(), sizeof(vec3) * translations.size());
+			ar.orientationsOffset = writer.addBlob(orientations.data(), sizeof(vec4) * orientations.size());
+			ar.scalesOffset = writer.addBlob(scales.data(), sizeof(vec3) * scales.size());
+			animations.emplace_back(ar);
+		}
+		record.animationCount = static_cast<uint32_t>(animations.size()) - record.firstAnimation;
+
+		if (element->type() == ElementType::Mesh)
+		{
+			Mesh* mesh = static_cast<Mesh*>(element.pointer());
+			addBatches(mesh->renderBatches(), record.firstBatch, record.batchCount);
+
+			record.firstLevel = static_cast<uint32_t>(levels.size());
+			for (const Mesh::LevelOfDetail& lod : mesh->levelsOfDetail())
+			{
+				LevelOfDetailRecord lr;
+				lr.error = lod.error;
+				addBatches(lod.renderBatches, lr.firstBatch, lr.batchCount);
+				levels.emplace_back(lr);
+			}
+			record.levelCount = static_cast<uint32_t>(levels.size()) - record.firstLevel;
+
+			record.firstCluster = static_cast<uint32_t>(clusters.size());
+			if (mesh->deformer().valid())
+			{
+				for (const MeshDeformerCluster::Pointer& cluster : mesh->deformer()->clusters())
+				{
+					const MeshDeformerCluster::VertexWeightVector& weights = cluster->weights();
+
+					DeformerClusterRecord cr;
+					cr.weightCount = static_cast<uint32_t>(weights.size());
+					cr.weightsOffset = writer.addBlob(weights.data(), sizeof(MeshDeformerCluster::VertexWeight) * weights.size());
+					cr.linkTag = static_cast<uint64_t>(cluster->linkTag());
+					cr.linkInitialTransformInverse = cluster->linkInitialTransformInverse();
+					cr.meshInitialTransform = cluster->meshInitialTransform();
+					clusters.emplace_back(cr);
+					clusterLinks.emplace_back(cluster->link().pointer());
+				}
+			}
+			record.clusterCount = static_cast<uint32_t>(clusters.size()) - record.firstCluster;
+		}
+
+		uint32_t index = static_cast<uint32_t>(elements.size());
+		elementIndices.emplace(element.pointer(), index);
+		elements.emplace_back(record);
+
+		const auto& children = element->children();
+		for (auto i = children.rbegin(), e = children.rend(); i != e; ++i)
+			stack.emplace_back(*i, index);
+	}
+
+	Vector<VertexStorageRecord> storageRecords;
+	Vector<VertexElementRecord> elementRecords;
+	for (const VertexStorage::Pointer& vs : storages)
+	{
+		const VertexDeclaration& decl = vs->declaration();
+
+		VertexStorageRecord record;
+		record.name = writer.addString(vs->name());
+		record.capacity = vs->capacity();
+		record.interleaved = decl.interleaved() ? 1 : 0;
+		record.firstElement = static_cast<uint32_t>(elementRecords.size());
+		for (const VertexElement& e : decl.elements())
+		{
+			VertexElementRecord er;
+			er.usage = static_cast<uint32_t>(e.usage());
+			er.type = static_cast<uint32_t>(e.type());
+			er.encoding = static_cast<uint32_t>(e.encoding());
+			elementRecords.emplace_back(er);
+		}
+		record.elementCount = static_cast<uint32_t>(elementRecords.size()) - record.firstElement;
+		record.dataSize = vs->data().dataSize();
+		record.dataOffset = writer.addBlob(vs->data().data(), record.dataSize);
+		storageRecords.emplace_back(record);
+	}
+
+	Vector<IndexArrayRecord> indexArrayRecords;
+	for (const IndexArray::Pointer& ia : indexArrays)
+	{
+		IndexArrayRecord record;
+		record.format = static_cast<uint32_t>(ia->format());
+		record.primitiveType = static_cast<uint32_t>(ia->primitiveType());
+		record.actualSize = ia->actualSize();
+		record.capacity = ia->capacity();
+		record.dataSize = ia->dataSize();
+		record.dataOffset = writer.addBlob(ia->data(), record.dataSize);
+		indexArrayRecords.emplace_back(record);
+	}
+
+	/*
+	 * Links of the deformers are resolved when the whole hierarchy is written
+	 */
+	for (size_t i = 0, e = clusters.size(); i < e; ++i)
+	{
+		auto link = elementIndices.find(clusterLinks[i]);
+		if (link == elementIndices.end())
+		{
+			log::error("[s3d::SceneCache] Mesh deformer is linked to the element outside of the scene, %s is not written", fileName.c_str());
+			return false;
+		}
+		clusters[i].link = link->second;
+	}
+
+	for (const std::string& d : dependencies)
+		dependencyStrings.emplace_back(writer.addString(d));
+
+	writer.setChunk(Chunk_VertexStorages, storageRecords);
+	writer.setChunk(Chunk_VertexElements, elementRecords);
+	writer.setChunk(Chunk_IndexArrays, indexArrayRecords);
+	writer.setChunk(Chunk_Elements, elements);
+	writer.setChunk(Chunk_LevelsOfDetail, levels);
+	writer.setChunk(Chunk_RenderBatches, batches);
+	writer.setChunk(Chunk_Animations, animations);
+	writer.setChunk(Chunk_Properties, properties);
+	writer.setChunk(Chunk_Dependencies, dependencyStrings);
+	writer.setChunk(Chunk_DeformerClusters, clusters);
+
+	if (!writer.write(fileName))
+	{
+		log::error("[s3d::SceneCache] Unable to write %s", fileName.c_str());
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Blob is the last chunk: only records before it are loaded, vertex and index data
+ * is read from the file directly into the storages on instantiation
+ */
+bool SceneCache::open(const std::string& fileName)
+{
+	using namespace sc_local;
+
+	std::ifstream input(fileName, std::ios::in | std::ios::binary);
+	if (!input.is_open())
+		return false;
+
+	uint64_t fileSize = static_cast<uint64_t>(streamSize(input));
+
+	FileHeader header;
+	ChunkHeader chunks[Chunk_max];
+	input.read(reinterpret_cast<char*>(&header), sizeof(header));
+	input.read(reinterpret_cast<char*>(chunks), sizeof(chunks));
+	if (input.fail() || (header.chunkCount != Chunk_max))
+	{
+		log::warning("[s3d::SceneCache] Invalid or outdated scene cache");
+		return false;
+	}
+
+	BinaryDataStorage data(std::min(chunks[Chunk_Blob].offset, fileSize));
+	input.seekg(0, std::ios::beg);
+	input.read(data.binary(), static_cast<std::streamsize>(data.size()));
+	if (input.fail())
+	{
+		log::error("[s3d::SceneCache] Unable to read %s", fileName.c_str());
+		return false;
+	}
+
+	_fileName = fileName;
+	return load(std::move(data), fileSize);
+}
+
+bool SceneCache::open(BinaryDataStorage&& data)
+{
+	_fileName.clear();
+	uint64_t dataSize = data.size();
+	return load(std::move(data), dataSize);
+}
+
+bool SceneCache::load(BinaryDataStorage&& data, uint64_t fileSize)
+{
+	using namespace sc_local;
+
+	_data = std::move(data);
+	_fileSize = fileSize;
+	_valid = false;
+
+	ET_ASSERT(reinterpret_cast<uintptr_t>(_data.data()) % Alignment == 0);
+
+	if (_data.size() < sizeof(FileHeader))
+		return false;
+
+	const FileHeader* header = reinterpret_cast<const FileHeader*>(_data.data());
+	if ((header->signature != Signature) || (header->version != Version) || (header->chunkCount != Chunk_max))
+	{
+		log::warning("[s3d::SceneCache] Invalid or outdated scene cache");
+		return false;
+	}
+
+	if (_data.size() < sizeof(FileHeader) + sizeof(ChunkHeader) * header->chunkCount)
+		return false;
+
+	/*
+	 * Blob may be not loaded, other chunks are always in memory
+	 */
+	const ChunkHeader* chunks = reinterpret_cast<const ChunkHeader*>(_data.data() + sizeof(FileHeader));
+	for (uint32_t i = 0; i < header->chunkCount; ++i)
+	{
+		uint64_t available = (i == Chunk_Blob) ? _fileSize : _data.size();
+		if ((chunks[i].type != i) || (chunks[i].offset % Alignment != 0) ||
+			(chunks[i].offset > available) || (chunks[i].size > available - chunks[i].offset))
+		{
+			log::warning("[s3d::SceneCache] Scene cache is corrupted");
+			return false;
+		}
+	}
+
+	if (!validate())
+	{
+		log::warning("[s3d::SceneCache] Scene cache is corrupted");
+		return false;
+	}
+
+	_valid = true;
+	return true;
+}
+
+/*
+ * Every reference in the records is checked against the sizes of chunks and blob,
+ * so instantiation never reads outside of the loaded data
+ */
+bool SceneCache::validate() const
+{
+	using namespace sc_local;
+
+	const ChunkHeader* chunks = reinterpret_cast<const ChunkHeader*>(_data.data() + sizeof(FileHeader));
+	auto recordsFit = [chunks](uint32_t type, uint64_t recordSize)
+		{ return chunks[type].size >= recordSize * chunks[type].count; };
+
+	if (!recordsFit(Chunk_VertexStorages, sizeof(VertexStorageRecord)) || !recordsFit(Chunk_VertexElements, sizeof(VertexElementRecord)) ||
+		!recordsFit(Chunk_IndexArrays, sizeof(IndexArrayRecord)) || !recordsFit(Chunk_Elements, sizeof(ElementRecord)) ||
+		!recordsFit(Chunk_LevelsOfDetail, sizeof(LevelOfDetailRecord)) || !recordsFit(Chunk_RenderBatches, sizeof(RenderBatchRecord)) ||
+		!recordsFit(Chunk_Animations, sizeof(AnimationRecord)) || !recordsFit(Chunk_Properties, sizeof(uint32_t)) ||
+		!recordsFit(Chunk_Dependencies, sizeof(uint32_t)) || !recordsFit(Chunk_DeformerClusters, sizeof(DeformerClusterRecord)))
+	{
+		return false;
+	}
+
+	/*
+	 * Strings are null terminated, so any offset within the chunk points to the valid string
+	 */
+	uint32_t stringsCount = 0;
+	const char* strings = reinterpret_cast<const char*>(chunkData(Chunk_Strings, stringsCount));
+	uint64_t stringsSize = chunks[Chunk_Strings].size;
+	if ((stringsSize > 0) && (strings[stringsSize - 1] != 0))
+		return false;
+
+	auto validString = [stringsSize](uint32_t offset)
+		{ return offset < stringsSize; };
+
+	uint64_t blobSize = chunks[Chunk_Blob].size;
+	auto validBlobRange = [blobSize](uint64_t offset, uint64_t size)
+		{ return (offset % Alignment == 0) && (offset <= blobSize) && (size <= blobSize - offset); };
+
+	auto validRange = [](uint32_t first, uint32_t count, uint32_t total)
+		{ return static_cast<uint64_t>(first) + count <= total; };
+
+	uint32_t vertexElementsCount = 0;
+	const VertexElementRecord* vertexElements = records<VertexElementRecord>(Chunk_VertexElements, vertexElementsCount);
+	for (uint32_t i = 0; i < vertexElementsCount; ++i)
+	{
+		if ((vertexElements[i].usage >= static_cast<uint32_t>(VertexAttributeUsage::max)) ||
+			(vertexElements[i].type >= static_cast<uint32_t>(DataType::max)) ||
+			(vertexElements[i].encoding >= static_cast<uint32_t>(VertexAttributeEncoding::max)))
+		{
+			return false;
+		}
+	}
+
+	uint32_t storagesCount = 0;
+	const VertexStorageRecord* storageRecords = records<VertexStorageRecord>(Chunk_VertexStorages, storagesCount);
+	for (uint32_t i = 0; i < storagesCount; ++i)
+	{
+		const VertexStorageRecord& record = storageRecords[i];
+		if (!validString(record.name) || !validRange(record.firstElement, record.elementCount, vertexElementsCount) ||
+			!validBlobRange(record.dataOffset, record.dataSize))
+		{
+			return false;
+		}
+
+		VertexDeclaration decl(record.interleaved != 0);
+		for (uint32_t e = record.firstElement, ee = record.firstElement + record.elementCount; e < ee; ++e)
+		{
+			if (!decl.push_back(static_cast<VertexAttributeUsage>(vertexElements[e].usage),
+				static_cast<DataType>(vertexElements[e].type), static_cast<VertexAttributeEncoding>(vertexElements[e].encoding)))
+			{
+				return false;
+			}
+		}
+
+		if (static_cast<uint64_t>(decl.sizeInBytes()) * record.capacity != record.dataSize)
+			return false;
+	}
+
+	uint32_t indexArraysCount = 0;
+	const IndexArrayRecord* indexArrayRecords = records<IndexArrayRecord>(Chunk_IndexArrays, indexArraysCount);
+	for (uint32_t i = 0; i < indexArraysCount; ++i)
+	{
+		const IndexArrayRecord& record = indexArrayRecords[i];
+		bool validFormat = (record.format == static_cast<uint32_t>(IndexArrayFormat::Format_8bit)) ||
+			(record.format == static_cast<uint32_t>(IndexArrayFormat::Format_16bit)) ||
+			(record.format == static_cast<uint32_t>(IndexArrayFormat::Format_32bit));
+
+		if (!validFormat || (record.primitiveType >= static_cast<uint32_t>(PrimitiveType::max)) ||
+			(record.actualSize > record.capacity) || (static_cast<uint64_t>(record.format) * record.capacity != record.dataSize) ||
+			!validBlobRange(record.dataOffset, record.dataSize))
+		{
+			return false;
+		}
+	}
+
+	uint32_t batchesCount = 0;
+	const RenderBatchRecord* batchRecords = records<RenderBatchRecord>(Chunk_RenderBatches, batchesCount);
+	for (uint32_t i = 0; i < batchesCount; ++i)
+	{
+		const RenderBatchRecord& record = batchRecords[i];
+		if (!validString(record.material) ||
+			((record.vertexStorage != InvalidIndex) && (record.vertexStorage >= storagesCount)) ||
+			((record.indexArray != InvalidIndex) && (record.indexArray >= indexArraysCount)))
+		{
+			return false;
+		}
+
+		if ((record.indexArray != InvalidIndex) && !validRange(record.firstIndex, record.indexCount, indexArrayRecords[record.indexArray].capacity))
+			return false;
+	}
+
+	uint32_t levelsCount = 0;
+	const LevelOfDetailRecord* levelRecords = records<LevelOfDetailRecord>(Chunk_LevelsOfDetail, levelsCount);
+	for (uint32_t i = 0; i < levelsCount; ++i)
+	{
+		if (!validRange(levelRecords[i].firstBatch, levelRecords[i].batchCount, batchesCount))
+			return false;
+	}
+
+	uint32_t animationsCount = 0;
+	const AnimationRecord* animationRecords = records<AnimationRecord>(Chunk_Animations, animationsCount);
+	for (uint32_t i = 0; i < animationsCount; ++i)
+	{
+		const AnimationRecord& record = animationRecords[i];
+		uint64_t frames = record.frameCount;
+		if ((record.outOfRangeMode > static_cast<uint32_t>(Animation::OutOfRangeMode_PingPong)) || !(record.stopTime - record.startTime >= 0.0f) || (frames == 0) ||
+			!validBlobRange(record.timesOffset, sizeof(float) * frames) || !validBlobRange(record.translationsOffset, sizeof(vec3) * frames) ||
+			!validBlobRange(record.orientationsOffset, sizeof(vec4) * frames) || !validBlobRange(record.scalesOffset, sizeof(vec3) * frames))
+		{
+			return false;
+		}
+	}
+
+	uint32_t propertiesCount = 0;
+	const uint32_t* propertyRecords = records<uint32_t>(Chunk_Properties, propertiesCount);
+	for (uint32_t i = 0; i < propertiesCount; ++i)
+	{
+		if (!validString(propertyRecords[i]))
+			return false;
+	}
+
+	uint32_t dependenciesCount = 0;
+	const uint32_t* dependencyRecords = records<uint32_t>(Chunk_Dependencies, dependenciesCount);
+	for (uint32_t i = 0; i < dependenciesCount; ++i)
+	{
+		if (!validString(dependencyRecords[i]))
+			return false;
+	}
+
+	uint32_t elementsCount = 0;
+	const ElementRecord* elementRecords = records<ElementRecord>(Chunk_Elements, elementsCount);
+
+	uint32_t clustersCount = 0;
+	const DeformerClusterRecord* clusterRecords = records<DeformerClusterRecord>(Chunk_DeformerClusters, clustersCount);
+	for (uint32_t i = 0; i < clustersCount; ++i)
+	{
+		const DeformerClusterRecord& record = clusterRecords[i];
+		if ((record.link >= elementsCount) || (elementRecords[record.link].type != static_cast<uint32_t>(ElementType::Skeleton)) ||
+			!validBlobRange(record.weightsOffset, sizeof(MeshDeformerCluster::VertexWeight) * static_cast<uint64_t>(record.weightCount)))
+		{
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < elementsCount; ++i)
+	{
+		const ElementRecord& record = elementRecords[i];
+		bool validParent = (i == 0) ? (record.parent == InvalidIndex) : (record.parent < i);
+		if (!validParent || !validString(record.name) ||
+			!validRange(record.firstBatch, record.batchCount, batchesCount) || !validRange(record.firstLevel, record.levelCount, levelsCount) ||
+			!validRange(record.firstAnimation, record.animationCount, animationsCount) ||
+			!validRange(record.firstProperty, record.propertyCount, propertiesCount) ||
+			!validRange(record.firstCluster, record.clusterCount, clustersCount))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const void* SceneCache::chunkData(uint32_t type, uint32_t& count) const
+{
+	const sc_local::ChunkHeader* chunks = reinterpret_cast<const sc_local::ChunkHeader*>(_data.data() + sizeof(sc_local::FileHeader));
+	count = chunks[type].count;
+	return _data.data() + chunks[type].offset;
+}
+
+const char* SceneCache::string(uint32_t offset) const
+{
+	uint32_t count = 0;
+	return reinterpret_cast<const char*>(chunkData(sc_local::Chunk_Strings, count)) + offset;
+}
+
+Vector<std::string> SceneCache::dependencies() const
+{
+	Vector<std::string> result;
+	if (!_valid)
+		return result;
+
+	uint32_t count = 0;
+	const uint32_t* strings = records<uint32_t>(sc_local::Chunk_Dependencies, count);
+	for (uint32_t i = 0; i < count; ++i)
+		result.emplace_back(string(strings[i]));
+
+	return result;
+}
+
+BaseElement::Pointer SceneCache::instantiate(RenderInterface::Pointer& renderer, Storage& storage,
+	const MaterialProvider& materialProvider, uint32_t options)
+{
+	using namespace sc_local;
+
+	if (!_valid)
+		return BaseElement::Pointer();
+
+	std::ifstream blobInput;
+	if (!_fileName.empty())
+	{
+		blobInput.open(_fileName, std::ios::in | std::ios::binary);
+		if (!blobInput.is_open() || (static_cast<uint64_t>(streamSize(blobInput)) != _fileSize))
+		{
+			log::error("[s3d::SceneCache] %s was modified after it was opened", _fileName.c_str());
+			return BaseElement::Pointer();
+		}
+	}
+
+	const ChunkHeader* chunks = reinterpret_cast<const ChunkHeader*>(_data.data() + sizeof(FileHeader));
+	uint64_t blobOffset = chunks[Chunk_Blob].offset;
+
+	bool blobRead = true;
+	auto readBlob = [&](uint64_t offset, void* destination, uint64_t size)
+	{
+		if (size == 0)
+			return;
+
+		if (_fileName.empty())
+		{
+			memcpy(destination, _data.data() + blobOffset + offset, size);
+			return;
+		}
+
+		blobInput.seekg(static_cast<std::streamoff>(blobOffset + offset), std::ios::beg);
+		blobInput.read(static_cast<char*>(destination), static_cast<std::streamsize>(size));
+		blobRead = blobRead && !blobInput.fail();
+	};
+
+	uint32_t vertexElementsCount = 0;
+	const VertexElementRecord* vertexElements = records<VertexElementRecord>(Chunk_VertexElements, vertexElementsCount);
+
+	uint32_t storagesCount = 0;
+	const VertexStorageRecord* storageRecords = records<VertexStorageRecord>(Chunk_VertexStorages, storagesCount);
+
+	Vector<VertexStorage::Pointer> storages;
+	Vector<VertexStorage::Pointer> gpuStorages;
+	storages.reserve(storagesCount);
+	for (uint32_t i = 0; i < storagesCount; ++i)
+	{
+		const VertexStorageRecord& record = storageRecords[i];
+
+		VertexDeclaration decl(record.interleaved != 0);
+		for (uint32_t e = record.firstElement, ee = record.firstElement + record.elementCount; e < ee; ++e)
+		{
+			decl.push_back(static_cast<VertexAttributeUsage>(vertexElements[e].usage),
+				static_cast<DataType>(vertexElements[e].type), static_cast<VertexAttributeEncoding>(vertexElements[e].encoding));
+		}
+
+		VertexStorage::Pointer vs = VertexStorage::Pointer::create(decl, record.capacity);
+		readBlob(record.dataOffset, vs->data().binary(), record.dataSize);
+		vs->setName(string(record.name));
+		storages.emplace_back(vs);
+	}
+
+	uint32_t indexArraysCount = 0;
+	const IndexArrayRecord* indexArrayRecords = records<IndexArrayRecord>(Chunk_IndexArrays, indexArraysCount);
+
+	Vector<IndexArray::Pointer> indexArrays;
+	indexArrays.reserve(indexArraysCount);
+	for (uint32_t i = 0; i < indexArraysCount; ++i)
+	{
+		const IndexArrayRecord& record = indexArrayRecords[i];
+
+		IndexArray::Pointer ia = IndexArray::Pointer::create(static_cast<IndexArrayFormat>(record.format),
+			record.capacity, static_cast<PrimitiveType>(record.primitiveType));
+		readBlob(record.dataOffset, ia->binary(), record.dataSize);
+		ia->setActualSize(record.actualSize);
+		indexArrays.emplace_back(ia);
+	}
+
+	if (!blobRead)
+	{
+		log::error("[s3d::SceneCache] Unable to read geometry from %s", _fileName.c_str());
+		return BaseElement::Pointer();
+	}
+
+	bool shouldCompress = (options & Option_CompressVertexData) == Option_CompressVertexData;
+	for (const VertexStorage::Pointer& vs : storages)
+	{
+		storage.addVertexStorage(vs);
+		gpuStorages.emplace_back(shouldCompress ?
+			primitives::encodeVertexStorage(vs, primitives::compressedVertexDeclaration(vs->declaration())) : vs);
+	}
+
+	if (!indexArrays.empty())
+		storage.setIndexArray(indexArrays.front());
+
+	uint32_t batchesCount = 0;
+	const RenderBatchRecord* batchRecords = records<RenderBatchRecord>(Chunk_RenderBatches, batchesCount);
+
+	Map<std::pair<uint32_t, uint32_t>, VertexStream::Pointer> streams;
+	UnorderedMap<std::string, MaterialInstance::Pointer> materials;
+	auto createBatches = [&](uint32_t first, uint32_t count) -> Vector<RenderBatch::Pointer>
+	{
+		Vector<RenderBatch::Pointer> result;
+		result.reserve(count);
+		for (uint32_t b = first; b < first + count; ++b)
+		{
+			const RenderBatchRecord& record = batchRecords[b];
+
+			std::string materialName(string(record.material));
+			auto mi = materials.find(materialName);
+			if (mi == materials.end())
+			{
+				MaterialInstance::Pointer material = materialProvider ? materialProvider(materialName) : MaterialInstance::Pointer();
+				if (material.invalid())
+					log::warning("[s3d::SceneCache] Material %s not provided", materialName.c_str());
+				else
+					storage.addMaterial(material);
+				mi = materials.emplace(materialName, material).first;
+			}
+
+			VertexStream::Pointer& stream = streams[std::make_pair(record.vertexStorage, record.indexArray)];
+			if (stream.invalid() && (record.vertexStorage != InvalidIndex) && (record.indexArray != InvalidIndex))
+				stream = renderer->sharedGeometryBuffer().allocate(gpuStorages[record.vertexStorage], indexArrays[record.indexArray]);
+
+			RenderBatch::Pointer rb = renderer->allocateRenderBatch(mi->second, stream, record.firstIndex, record.indexCount);
+			if (record.vertexStorage != InvalidIndex)
+				rb->setVertexStorage(storages[record.vertexStorage]);
+			if (record.indexArray != InvalidIndex)
+				rb->setIndexArray(indexArrays[record.indexArray]);
+			result.emplace_back(rb);
+		}
+		return result;
+	};
+
+	uint32_t elementsCount = 0;
+	const ElementRecord* elementRecords = records<ElementRecord>(Chunk_Elements, elementsCount);
+
+	uint32_t levelsCount = 0;
+	const LevelOfDetailRecord* levelRecords = records<LevelOfDetailRecord>(Chunk_LevelsOfDetail, levelsCount);
+
+	uint32_t animationsCount = 0;
+	const AnimationRecord* animationRecords = records<AnimationRecord>(Chunk_Animations, animationsCount);
+
+	uint32_t propertiesCount = 0;
+	const uint32_t* propertyRecords = records<uint32_t>(Chunk_Properties, propertiesCount);
+
+	uint32_t clustersCount = 0;
+	const DeformerClusterRecord* clusterRecords = records<DeformerClusterRecord>(Chunk_DeformerClusters, clustersCount);
+
+	Vector<BaseElement::Pointer> elements;
+	Vector<SkeletonElement::Pointer> skeletons(elementsCount);
+	Vector<std::pair<Mesh::Pointer, uint32_t>> deformedMeshes;
+	elements.reserve(elementsCount);
+	for (uint32_t i = 0; i < elementsCount; ++i)
+	{
+		const ElementRecord& record = elementRecords[i];
+		BaseElement* parent = (record.parent == InvalidIndex) ? nullptr : elements[record.parent].pointer();
+		std::string name(string(record.name));
+
+		BaseElement::Pointer element;
+		switch (static_cast<ElementType>(record.type))
+		{
+			case ElementType::Mesh:
+			{
+				Mesh::Pointer mesh = Mesh::Pointer::create(name, parent);
+				for (RenderBatch::Pointer& rb : createBatches(record.firstBatch, record.batchCount))
+					mesh->addRenderBatch(rb);
+
+				for (uint32_t l = record.firstLevel; l < record.firstLevel + record.levelCount; ++l)
+				{
+					Mesh::LevelOfDetail lod;
+					lod.error = levelRecords[l].error;
+					lod.renderBatches = createBatches(levelRecords[l].firstBatch, levelRecords[l].batchCount);
+					mesh->addLevelOfDetail(lod);
+				}
+
+				if (record.clusterCount > 0)
+					deformedMeshes.emplace_back(mesh, i);
+
+				element = mesh;
+				break;
+			}
+
+			case ElementType::Skeleton:
+			{
+				skeletons[i] = SkeletonElement::Pointer::create(name, parent);
+				element = skeletons[i];
+				break;
+			}
+
+			default:
+			{
+				if (static_cast<ElementType>(record.type) != ElementType::Container)
+					log::warning("[s3d::SceneCache] Element %s of type %u loaded as container", name.c_str(), record.type);
+
+				element = ElementContainer::Pointer::create(name, parent);
+			}
+		}
+
+		element->setFlags(record.flags);
+		element->setTranslation(record.translation);
+		element->setScale(record.scale);
+		element->setOrientation(quaternion(record.orientation.x, record.orientation.y, record.orientation.z, record.orientation.w));
+
+		for (uint32_t p = record.firstProperty; p < record.firstProperty + record.propertyCount; ++p)
+			element->addPropertyString(string(propertyRecords[p]));
+
+		for (uint32_t a = record.firstAnimation; a < record.firstAnimation + record.animationCount; ++a)
+		{
+			const AnimationRecord& ar = animationRecords[a];
+
+			Vector<float> times(ar.frameCount);
+			Vector<vec3> translations(ar.frameCount);
+			Vector<vec4> orientations(ar.frameCount);
+			Vector<vec3> scales(ar.frameCount);
+			readBlob(ar.timesOffset, times.data(), sizeof(float) * times.size());
+			readBlob(ar.translationsOffset, translations.data(), sizeof(vec3) * translations.size());
+			readBlob(ar.orientationsOffset, orientations.data(), sizeof(vec4) * orientations.size());
+			readBlob(ar.scalesOffset, scales.data(), sizeof(vec3) * scales.size());
+
+			Animation animation;
+			animation.setTimeRange(ar.startTime, ar.stopTime);
+			animation.setFrameRate(ar.frameRate);
+			animation.setOutOfRangeMode(static_cast<Animation::OutOfRangeMode>(ar.outOfRangeMode));
+			for (uint32_t f = 0; f < ar.frameCount; ++f)
+			{
+				const vec4& o = orientations[f];
+				animation.addKeyFrame(times[f], translations[f], quaternion(o.x, o.y, o.z, o.w), scales[f]);
+			}
+			element->addAnimation(animation);
+		}
+
+		if (element->type() == ElementType::Mesh)
+			static_cast<Mesh*>(element.pointer())->calculateSupportData();
+
+		elements.emplace_back(element);
+	}
+
+	/*
+	 * Deformers are created when all skeleton elements exist
+	 */
+	for (auto& deformed : deformedMeshes)
+	{
+		const ElementRecord& record = elementRecords[deformed.second];
+
+		MeshDeformer::Pointer deformer = MeshDeformer::Pointer::create();
+		for (uint32_t c = record.firstCluster; c < record.firstCluster + record.clusterCount; ++c)
+		{
+			const DeformerClusterRecord& cr = clusterRecords[c];
+
+			MeshDeformerCluster::Pointer cluster = MeshDeformerCluster::Pointer::create();
+			cluster->weights().resize(cr.weightCount);
+			readBlob(cr.weightsOffset, cluster->weights().data(), sizeof(MeshDeformerCluster::VertexWeight) * cr.weightCount);
+			cluster->setMeshInitialTransform(cr.meshInitialTransform);
+			cluster->setLinkInitialTransformInverse(cr.linkInitialTransformInverse);
+			cluster->setLinkTag(static_cast<size_t>(cr.linkTag));
+			cluster->setLink(skeletons[cr.link]);
+			deformer->addCluster(cluster);
+		}
+		deformed.first->setDeformer(deformer);
+	}
+
+	if (!blobRead)
+	{
+		log::error("[s3d::SceneCache] Unable to read animations from %s", _fileName.c_str());
+		return BaseElement::Pointer();
+	}
+
+	return elements.empty() ? BaseElement::Pointer() : elements.front();
+}
+
+}
+}
@@ -0,0 +1,75 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/scene3d/storage.h>
+#include <et/scene3d/mesh.h>
+
+namespace et
+{
+namespace s3d
+{
+/*
+ * Versioned chunked binary container for the element hierarchy: transforms, properties,
+ * mesh render batches with levels of detail, animations, vertex storages, index arrays and
+ * mesh deformers. Sections are 16 bytes aligned, records are plain structures referenced by offsets
+ * and are used directly from the loaded data, all offsets and sizes are validated when file is opened.
+ * Vertex and index data is not kept in memory, it is read from the file directly into new storages
+ * on instantiation. Materials are referenced by name and resolved by the provider
+ */
+class SceneCache
+{
+public:
+	using MaterialProvider = std::function<MaterialInstance::Pointer(const std::string&)>;
+
+	enum : uint32_t
+	{
+		Option_None = 0,
+		Option_CompressVertexData = 1 << 0,
+	};
+
+public:
+	/*
+	 * Dependencies are arbitrary strings (e.g. source files), stored along with the scene
+	 */
+	static bool save(const std::string& fileName, BaseElement::Pointer root,
+		const Vector<std::string>& dependencies = Vector<std::string>());
+
+	bool open(const std::string& fileName);
+	bool open(BinaryDataStorage&&);
+
+	bool valid() const
+		{ return _valid; }
+
+	Vector<std::string> dependencies() const;
+
+	/*
+	 * Creates vertex storages, index arrays (added to storage) and vertex streams
+	 * (allocated in the shared geometry buffer of the renderer) and element hierarchy
+	 */
+	BaseElement::Pointer instantiate(RenderInterface::Pointer&, Storage&, const MaterialProvider&,
+		uint32_t options = Option_None);
+
+private:
+	bool load(BinaryDataStorage&&, uint64_t fileSize);
+	bool validate() const;
+	const void* chunkData(uint32_t type, uint32_t& count) const;
+	const char* string(uint32_t offset) const;
+
+	template <class T>
+	const T* records(uint32_t type, uint32_t& count) const
+		{ return reinterpret_cast<const T*>(chunkData(type, count)); }
+
+private:
+	BinaryDataStorage _data;
+	std::string _fileName;
+	uint64_t _fileSize = 0;
+	bool _valid = false;
+};
+}
+}
@@ -0,0 +1,429 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#include <et/core/threading.h>
+#include <et/scene3d/transformhierarchy.h>
+
+namespace et
+{
+namespace s3d
+{
+
+TransformHierarchy& sharedTransformHierarchy()
+{
+	static TransformHierarchy hierarchy;
+	return hierarchy;
+}
+
+TransformHierarchy::Handle TransformHierarchy::allocate(Handle parent)
+{
+	CriticalSectionScope lock(_lock);
+
+	Handle handle = InvalidHandle;
+	if (_freeHandles.empty())
+	{
+		handle = static_cast<Handle>(_slots.size());
+		_slots.emplace_back(InvalidHandle);
+	}
+	else
+	{
+		handle = _freeHandles.back();
+		_freeHandles.pop_back();
+	}
+
+	/*
+	 * New node is appended, so it always follows its parent
+	 */
+	uint32_t slot = size();
+	uint32_t parentSlot = (parent == InvalidHandle) ? InvalidHandle : _slots[parent];
+	_slots[handle] = slot;
+	_handles.emplace_back(handle);
+	_parents.emplace_back(parentSlot);
+	_localTransforms.emplace_back(identityMatrix);
+	_worldTransforms.emplace_back(identityMatrix);
+	_worldInverseTransforms.emplace_back(identityMatrix);
+	_versions.emplace_back(++_version);
+	_flags.emplace_back(Flag_Dirty);
+	appendToSubtreeRanges(slot, parentSlot);
+	return handle;
+}
+
+void TransformHierarchy::release(Handle handle)
+{
+	CriticalSectionScope lock(_lock);
+
+	uint32_t slot = _slots[handle];
+	ET_ASSERT((_flags[slot] & Flag_Released) == 0);
+
+	_flags[slot] |= Flag_Released;
+	_handles[slot] = InvalidHandle;
+	_slots[handle] = InvalidHandle;
+	_freeHandles.emplace_back(handle);
+	++_releasedNodes;
+}
+
+void TransformHierarchy::setParent(Handle handle, Handle parent)
+{
+	CriticalSectionScope lock(_lock);
+
+	uint32_t slot = _slots[handle];
+	uint32_t parentSlot = (parent == InvalidHandle) ? InvalidHandle : _slots[parent];
+	ET_ASSERT(parentSlot != slot);
+
+	_parents[slot] = parentSlot;
+	_flags[slot] |= Flag_Dirty;
+	_sorted = _sorted && keepsSubtreeRanges(slot, parentSlot);
+}
+
+void TransformHierarchy::setLocalTransform(Handle handle, const mat4& m)
+{
+	CriticalSectionScope lock(_lock);
+
+	uint32_t slot = _slots[handle];
+	_localTransforms[slot] = m;
+	_flags[slot] |= Flag_Dirty;
+}
+
+mat4 TransformHierarchy::localTransform(Handle handle)
+{
+	CriticalSectionScope lock(_lock);
+	return _localTransforms[_slots[handle]];
+}
+
+mat4 TransformHierarchy::worldTransform(Handle handle)
+{
+	CriticalSectionScope lock(_lock);
+
+	uint32_t slot = _slots[handle];
+	if (worldDirty(slot))
+		buildWorldTransform(slot);
+
+	return _worldTransforms[slot];
+}
+
+mat4 TransformHierarchy::worldInverseTransform(Handle handle)
+{
+	CriticalSectionScope lock(_lock);
+
+	uint32_t slot = _slots[handle];
+	if (worldDirty(slot))
+		buildWorldTransform(slot);
+
+	if ((_flags[slot] & Flag_InverseValid) == 0)
+	{
+		_worldInverseTransforms[slot] = _worldTransforms[slot].inverted();
+		_flags[slot] |= Flag_InverseValid;
+	}
+	return _worldInverseTransforms[slot];
+}
+
+mat4 TransformHierarchy::worldRotationTransform(Handle handle)
+{
+	mat4 result = worldInverseTransform(handle).transposed();
+	result[3] = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	return result;
+}
+
+uint64_t TransformHierarchy::worldTransformVersion(Handle handle)
+{
+	CriticalSectionScope lock(_lock);
+
+	uint32_t slot = _slots[handle];
+	if (worldDirty(slot))
+		buildWorldTransform(slot);
+
+	return _versions[slot];
+}
+
+uint32_t TransformHierarchy::parentSlot(uint32_t slot) const
+{
+	uint32_t parent = _parents[slot];
+	return ((parent == InvalidHandle) || (_flags[parent] & Flag_Released)) ? InvalidHandle : parent;
+}
+
+bool TransformHierarchy::worldDirty(uint32_t slot) const
+{
+	for (uint32_t s = slot; s != InvalidHandle; s = _parents[s])
+	{
+		if ((_flags[s] & Flag_Dirty) || (parentSlot(s) != _parents[s]))
+			return true;
+	}
+	return false;
+}
+
+void TransformHierarchy::buildWorldTransform(uint32_t slot)
+{
+	/*
+	 * Lazy access between updates: recompute path from the topmost changed ancestor,
+	 * flags are kept, so the other descendants of that ancestor are updated later
+	 */
+	_path.clear();
+	size_t firstDirty = 0;
+	for (uint32_t s = slot; s != InvalidHandle; s = parentSlot(s))
+	{
+		_path.emplace_back(s);
+		if ((_flags[s] & Flag_Dirty) || (parentSlot(s) != _parents[s]))
+			firstDirty = _path.size();
+	}
+
+	for (size_t i = firstDirty; i > 0; --i)
+	{
+		uint32_t s = _path[i - 1];
+		uint32_t parent = parentSlot(s);
+		_worldTransforms[s] = (parent == InvalidHandle) ? _localTransforms[s] : _localTransforms[s] * _worldTransforms[parent];
+		_flags[s] &= ~Flag_InverseValid;
+		_versions[s] = ++_version;
+	}
+}
+
+void TransformHierarchy::updateRange(uint32_t begin, uint32_t end, uint64_t version)
+{
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		uint32_t flags = _flags[i];
+		if (flags & Flag_Released)
+			continue;
+
+		uint32_t parent = _parents[i];
+		if ((parent != InvalidHandle) && (_flags[parent] & Flag_Released))
+		{
+			_parents[i] = parent = InvalidHandle;
+			flags |= Flag_Dirty;
+		}
+
+		if ((flags & Flag_Dirty) || ((parent != InvalidHandle) && (_flags[parent] & Flag_Changed)))
+		{
+			_worldTransforms[i] = (parent == InvalidHandle) ? _localTransforms[i] : _localTransforms[i] * _worldTransforms[parent];
+			_versions[i] = version;
+			_flags[i] = (flags & ~(Flag_Dirty | Flag_InverseValid)) | Flag_Changed;
+		}
+		else
+		{
+			_flags[i] = flags & ~Flag_Changed;
+		}
+	}
+}
+
+void TransformHierarchy::update()
+{
+	CriticalSectionScope lock(_lock);
+
+	if (!_sorted || (4 * _releasedNodes > size()))
+		sortNodes();
+
+	uint64_t version = ++_version;
+	for (uint32_t slot : _splitNodes)
+		updateRange(slot, slot + 1, version);
+
+	/*
+	 * Ranges depend only on split nodes and on themselves
+	 */
+	auto updateSubtreeRanges = [this, version](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+			updateRange(_subtreeRanges[i].begin, _subtreeRanges[i].end, version);
+	};
+
+	uint32_t rangesCount = static_cast<uint32_t>(_subtreeRanges.size());
+	if (size() < ParallelUpdateThreshold)
+		updateSubtreeRanges(0, rangesCount);
+	else
+		threading::parallelFor(rangesCount, 1, updateSubtreeRanges);
+}
+
+void TransformHierarchy::sortNodes()
+{
+	uint32_t count = size();
+
+	Vector<uint32_t> childOffsets(count + 1, 0);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t parent = parentSlot(i);
+		if (((_flags[i] & Flag_Released) == 0) && (parent != InvalidHandle))
+			++childOffsets[parent + 1];
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+		childOffsets[i + 1] += childOffsets[i];
+
+	Vector<uint32_t> children(childOffsets.back());
+	Vector<uint32_t> fill(childOffsets.begin(), childOffsets.end() - 1);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t parent = parentSlot(i);
+		if (((_flags[i] & Flag_Released) == 0) && (parent != InvalidHandle))
+			children[fill[parent]++] = i;
+	}
+
+	/*
+	 * Depth first preorder, roots and children keep their relative order
+	 */
+	Vector<uint32_t> order;
+	order.reserve(count - _releasedNodes);
+	Vector<uint32_t> stack;
+	for (uint32_t root = 0; root < count; ++root)
+	{
+		if ((_flags[root] & Flag_Released) || (parentSlot(root) != InvalidHandle))
+			continue;
+
+		stack.emplace_back(root);
+		while (!stack.empty())
+		{
+			uint32_t node = stack.back();
+			stack.pop_back();
+			order.emplace_back(node);
+			for (uint32_t c = childOffsets[node + 1]; c > childOffsets[node]; --c)
+				stack.emplace_back(children[c - 1]);
+		}
+	}
+	ET_ASSERT(order.size() + _releasedNodes == count);
+
+	Vector<uint32_t> newSlots(count, InvalidHandle);
+	for (uint32_t i = 0, e = static_cast<uint32_t>(order.size()); i < e; ++i)
+		newSlots[order[i]] = i;
+
+	Vector<uint32_t> parents(order.size());
+	Vector<mat4> localTransforms(order.size());
+	Vector<mat4> worldTransforms(order.size());
+	Vector<mat4> worldInverseTransforms(order.size());
+	Vector<uint64_t> versions(order.size());
+	Vector<uint32_t> flags(order.size());
+	Vector<Handle> handles(order.size());
+	for (uint32_t i = 0, e = static_cast<uint32_t>(order.size()); i < e; ++i)
+	{
+		uint32_t oldSlot = order[i];
+		uint32_t parent = parentSlot(oldSlot);
+		parents[i] = (parent == InvalidHandle) ? InvalidHandle : newSlots[parent];
+		localTransforms[i] = _localTransforms[oldSlot];
+		worldTransforms[i] = _worldTransforms[oldSlot];
+		worldInverseTransforms[i] = _worldInverseTransforms[oldSlot];
+		versions[i] = _versions[oldSlot];
+		flags[i] = (_flags[oldSlot] & ~Flag_Split) | ((parent != _parents[oldSlot]) ? Flag_Dirty : 0);
+		handles[i] = _handles[oldSlot];
+		_slots[handles[i]] = i;
+	}
+
+	_parents.swap(parents);
+	_localTransforms.swap(localTransforms);
+	_worldTransforms.swap(worldTransforms);
+	_worldInverseTransforms.swap(worldInverseTransforms);
+	_versions.swap(versions);
+	_flags.swap(flags);
+	_handles.swap(handles);
+	_releasedNodes = 0;
+	_sorted = true;
+
+	buildSubtreeRanges();
+}
+
+void TransformHierarchy::buildSubtreeRanges()
+{
+	uint32_t count = size();
+
+	Vector<uint32_t> subtreeSizes(count, 1);
+	for (uint32_t i = count; i-- > 0;)
+	{
+		if (_parents[i] != InvalidHandle)
+			subtreeSizes[_parents[i]] += subtreeSizes[i];
+	}
+
+	/*
+	 * Subtrees are contiguous in preorder. Roots of large subtrees are split off
+	 * and updated first, so their children subtrees form separate ranges,
+	 * small neighbouring subtrees are merged into one range
+	 */
+	_splitNodes.clear();
+	_subtreeRanges.clear();
+	for (uint32_t i = 0; i < count;)
+	{
+		if (subtreeSizes[i] > SubtreeRangeSize)
+		{
+			_flags[i] |= Flag_Split;
+			_splitNodes.emplace_back(i);
+			++i;
+			continue;
+		}
+
+		uint32_t end = i + subtreeSizes[i];
+		if (!_subtreeRanges.empty() && (_subtreeRanges.back().end == i) && (end - _subtreeRanges.back().begin <= SubtreeRangeSize))
+		{
+			_subtreeRanges.back().end = end;
+		}
+		else
+		{
+			_subtreeRanges.emplace_back();
+			_subtreeRanges.back().begin = i;
+			_subtreeRanges.back().end = end;
+		}
+		i = end;
+	}
+}
+
+/*
+ * New node is the last one, it starts new range (or joins the last one) if its parent is not in any range,
+ * and extends the last range if its parent is there. Otherwise ranges are rebuilt on the next update
+ */
+void TransformHierarchy::appendToSubtreeRanges(uint32_t slot, uint32_t parent)
+{
+	if (!_sorted)
+		return;
+
+	bool continuesLastRange = !_subtreeRanges.empty() && (_subtreeRanges.back().end == slot);
+	if ((parent == InvalidHandle) || (_flags[parent] & Flag_Split))
+	{
+		if (continuesLastRange && (slot - _subtreeRanges.back().begin < SubtreeRangeSize))
+		{
+			_subtreeRanges.back().end = slot + 1;
+		}
+		else
+		{
+			_subtreeRanges.emplace_back();
+			_subtreeRanges.back().begin = slot;
+			_subtreeRanges.back().end = slot + 1;
+		}
+	}
+	else if (continuesLastRange && (parent >= _subtreeRanges.back().begin))
+	{
+		_subtreeRanges.back().end = slot + 1;
+	}
+	else
+	{
+		_sorted = false;
+	}
+}
+
+/*
+ * Split nodes are updated in order before ranges, so they could be attached only to preceding split nodes,
+ * other nodes could be attached to any split node, or to the preceding node of the same range
+ */
+bool TransformHierarchy::keepsSubtreeRanges(uint32_t slot, uint32_t parent) const
+{
+	bool independentParent = (parent == InvalidHandle) || (_flags[parent] & Flag_Split);
+
+	if (_flags[slot] & Flag_Split)
+		return independentParent && ((parent == InvalidHandle) || (parent < slot));
+
+	if (independentParent)
+		return true;
+
+	return (parent < slot) && (subtreeRangeIndex(parent) == subtreeRangeIndex(slot));
+}
+
+uint32_t TransformHierarchy::subtreeRangeIndex(uint32_t slot) const
+{
+	auto i = std::upper_bound(_subtreeRanges.begin(), _subtreeRanges.end(), slot,
+		[](uint32_t s, const SubtreeRange& range) { return s < range.begin; });
+
+	if (i == _subtreeRanges.begin())
+		return InvalidHandle;
+
+	--i;
+	return (slot < i->end) ? static_cast<uint32_t>(i - _subtreeRanges.begin()) : InvalidHandle;
+}
+
+}
+}
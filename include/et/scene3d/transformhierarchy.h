@@ -0,0 +1,120 @@
+/*
+ * This file is part of `et engine`
+ * Copyright 2009-2016 by Sergey Reznik
+ * Please, modify content only if you know what are you doing.
+ *
+ */
+
+#pragma once
+
+#include <et/core/criticalsection.h>
+#include <et/geometry/geometry.h>
+
+namespace et
+{
+namespace s3d
+{
+/*
+ * Flat storage of local and world transforms, nodes are kept sorted so that parents precede children.
+ * Changing a node marks only the node itself, world transforms of the whole hierarchy
+ * are updated in one pass over independent subtree ranges. Inverse world transforms are computed on demand
+ */
+class TransformHierarchy
+{
+public:
+	using Handle = uint32_t;
+
+	enum : uint32_t
+	{
+		InvalidHandle = static_cast<uint32_t>(-1),
+		SubtreeRangeSize = 1024,
+		ParallelUpdateThreshold = 8192,
+	};
+
+public:
+	Handle allocate(Handle parent);
+	void release(Handle);
+
+	void setParent(Handle, Handle parent);
+	void setLocalTransform(Handle, const mat4&);
+
+	/*
+	 * Transforms are returned by value: storage is reordered and reallocated
+	 * by the other threads while nodes are added, released or sorted
+	 */
+	mat4 localTransform(Handle);
+	mat4 worldTransform(Handle);
+	mat4 worldInverseTransform(Handle);
+
+	/*
+	 * Inverse transposed world transform without translation, used to transform normals
+	 */
+	mat4 worldRotationTransform(Handle);
+
+	/*
+	 * Changes each time world transform of the node is recomputed
+	 */
+	uint64_t worldTransformVersion(Handle);
+
+	/*
+	 * Recomputes world transforms of changed nodes and their descendants,
+	 * subtree ranges are updated in parallel for large hierarchies
+	 */
+	void update();
+
+	uint32_t size() const
+		{ return static_cast<uint32_t>(_handles.size()); }
+
+private:
+	enum Flags : uint32_t
+	{
+		Flag_Dirty = 1 << 0,
+		Flag_Changed = 1 << 1,
+		Flag_InverseValid = 1 << 2,
+		Flag_Released = 1 << 3,
+		Flag_Split = 1 << 4,
+	};
+
+	/*
+	 * Contiguous slots of one or more whole subtrees, parents of the subtrees roots
+	 * are either missing or split nodes, which are updated before all ranges
+	 */
+	struct SubtreeRange
+	{
+		uint32_t begin = 0;
+		uint32_t end = 0;
+	};
+
+	uint32_t parentSlot(uint32_t slot) const;
+	bool worldDirty(uint32_t slot) const;
+	void buildWorldTransform(uint32_t slot);
+	void updateRange(uint32_t begin, uint32_t end, uint64_t version);
+	void sortNodes();
+	void buildSubtreeRanges();
+	void appendToSubtreeRanges(uint32_t slot, uint32_t parent);
+	bool keepsSubtreeRanges(uint32_t slot, uint32_t parent) const;
+	uint32_t subtreeRangeIndex(uint32_t slot) const;
+
+private:
+	CriticalSection _lock;
+	Vector<uint32_t> _parents;
+	Vector<mat4> _localTransforms;
+	Vector<mat4> _worldTransforms;
+	Vector<mat4> _worldInverseTransforms;
+	Vector<uint64_t> _versions;
+	Vector<uint32_t> _flags;
+	Vector<Handle> _handles;
+	Vector<uint32_t> _slots;
+	Vector<Handle> _freeHandles;
+	Vector<uint32_t> _path;
+	Vector<uint32_t> _splitNodes;
+	Vector<SubtreeRange> _subtreeRanges;
+	uint64_t _version = 0;
+	uint32_t _releasedNodes = 0;
+	bool _sorted = true;
+};
+
+TransformHierarchy& sharedTransformHierarchy();
+
+}
+}
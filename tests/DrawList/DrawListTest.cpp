@@ -0,0 +1,198 @@
+#include <et/app/application.h>
+#include <et/rendering/base/drawlist.h>
+#include <random>
+#include <set>
+#include <tuple>
+
+const uint32_t instancesCount = 700;
+const uint32_t drawsPerInstance = 4;
+const uint32_t meshIndexCount = 3000;
+
+/*
+ * Buffers are used only as identities of the vertex streams
+ */
+class MockBuffer : public et::Buffer
+{
+public:
+	uint8_t* map(uint64_t, uint64_t) override { return nullptr; }
+	void modifyRange(uint64_t, uint64_t) override { }
+	void unmap() override { }
+	bool mapped() const override { return false; }
+	void updateData(uint64_t, const et::BinaryDataStorage&) override { }
+	void transferData(et::Buffer::Pointer, uint64_t, uint64_t, uint64_t) override { }
+	uint64_t size() const override { return 0; }
+};
+
+/*
+ * Index of the drawn triangle corner with all the state required to draw it
+ */
+using DrawnIndex = std::tuple<uint32_t, const et::MaterialInstance*, const et::Buffer*, int32_t, uint32_t>;
+
+et::VertexStream::Pointer createStream(const et::Buffer::Pointer& vb, const et::Buffer::Pointer& ib, uint32_t baseVertex, uint32_t firstIndex)
+{
+	et::VertexDeclaration decl(true);
+	decl.push_back(et::VertexAttributeUsage::Position, et::DataType::Vec3);
+
+	et::VertexStream::Pointer result = et::VertexStream::Pointer::create();
+	result->setVertexBuffer(vb, decl);
+	result->setIndexBuffer(ib, et::IndexArrayFormat::Format_32bit);
+	result->setPrimitiveType(et::PrimitiveType::Triangles);
+	result->setBaseVertex(baseVertex);
+	result->setFirstIndex(firstIndex);
+	return result;
+}
+
+et::DrawInstanceData fakeInstance(uint32_t index)
+{
+	et::DrawInstanceData result;
+	result.worldTransform[3] = et::vec4(static_cast<float>(index), 1.0f, 2.0f, 1.0f);
+	result.previousWorldTransform[3] = et::vec4(static_cast<float>(index) - 0.5f, 1.0f, 2.0f, 1.0f);
+	return result;
+}
+
+bool runTest()
+{
+	std::mt19937 generator(3);
+
+	et::Material::Pointer materials[] =
+	{
+		et::Material::Pointer::create(nullptr),
+		et::Material::Pointer::create(nullptr)
+	};
+	et::MaterialInstance::Pointer materialInstances[] = { materials[0]->instance(), materials[1]->instance() };
+
+	/*
+	 * First two streams are suballocated from the same buffers (see GeometryBuffer)
+	 */
+	et::Buffer::Pointer vb0(new MockBuffer());
+	et::Buffer::Pointer ib0(new MockBuffer());
+	et::Buffer::Pointer vb1(new MockBuffer());
+	et::Buffer::Pointer ib1(new MockBuffer());
+	et::VertexStream::Pointer streams[] =
+	{
+		createStream(vb0, ib0, 0, 0),
+		createStream(vb0, ib0, 5000, 2 * meshIndexCount),
+		createStream(vb1, ib1, 100, 300)
+	};
+
+	et::DrawList::Pointer drawList = et::DrawList::Pointer::create();
+	drawList->reserve(instancesCount * (drawsPerInstance + 2), instancesCount);
+
+	std::set<DrawnIndex> expected;
+	std::set<std::pair<const et::MaterialInstance*, const et::Buffer*>> expectedStates;
+	for (uint32_t i = 0; i < instancesCount; ++i)
+	{
+		uint32_t instanceIndex = drawList->addInstance(fakeInstance(i));
+
+		/*
+		 * Mesh split into parts of contiguous index ranges, as meshes with several
+		 * render batches using the same material, and one empty batch
+		 */
+		const et::MaterialInstance::Pointer& material = materialInstances[generator() % 2];
+		const et::VertexStream::Pointer& stream = streams[generator() % 3];
+		uint32_t first = 3 * (generator() % 100);
+		for (uint32_t p = 0; p < drawsPerInstance; ++p)
+		{
+			uint32_t count = 3 * (1 + generator() % 200);
+			drawList->push(material, stream, first, count, 0, instanceIndex);
+			for (uint32_t index = first; index < first + count; ++index)
+			{
+				expected.emplace(instanceIndex, material.pointer(), stream->indexBuffer().pointer(),
+					static_cast<int32_t>(stream->baseVertex()), stream->firstIndex() + index);
+			}
+			first += count;
+		}
+		drawList->push(material, stream, first, 0, 0, instanceIndex);
+		expectedStates.emplace(material.pointer(), stream->indexBuffer().pointer());
+	}
+	drawList->build();
+
+	const et::Vector<et::DrawIndexedIndirectCommand>& commands = drawList->commands();
+	const et::Vector<et::DrawList::Group>& groups = drawList->groups();
+	uint32_t failures = 0;
+
+	/*
+	 * Groups are formed by pipeline state only: material and buffers
+	 */
+	if (groups.size() != expectedStates.size())
+	{
+		et::log::error("%u groups built for %u different states", static_cast<uint32_t>(groups.size()),
+			static_cast<uint32_t>(expectedStates.size()));
+		++failures;
+	}
+
+	std::set<DrawnIndex> drawn;
+	uint32_t commandsInGroups = 0;
+	for (const et::DrawList::Group& group : groups)
+	{
+		commandsInGroups += group.commandCount;
+		for (uint32_t c = group.firstCommand, e = group.firstCommand + group.commandCount; c < e; ++c)
+		{
+			const et::DrawIndexedIndirectCommand& command = commands[c];
+			if ((command.indexCount == 0) || (command.instanceCount != 1) || (command.firstInstance >= drawList->instances().size()))
+			{
+				et::log::error("Command %u is invalid", c);
+				++failures;
+				continue;
+			}
+
+			if ((c > group.firstCommand) && (commands[c - 1].firstInstance > command.firstInstance))
+			{
+				et::log::error("Commands of the group are not ordered by instance (command %u)", c);
+				++failures;
+			}
+
+			/*
+			 * Instance data referenced by firstInstance should be the one draw was pushed with
+			 */
+			const et::DrawInstanceData& instance = drawList->instances()[command.firstInstance];
+			if (instance.worldTransform[3].x != static_cast<float>(command.firstInstance))
+			{
+				et::log::error("Command %u references wrong instance data", c);
+				++failures;
+			}
+
+			for (uint32_t index = command.firstIndex; index < command.firstIndex + command.indexCount; ++index)
+			{
+				drawn.emplace(command.firstInstance, group.material.pointer(), group.vertexStream->indexBuffer().pointer(),
+					command.vertexOffset, index);
+			}
+		}
+	}
+
+	if ((commandsInGroups != commands.size()) || (drawn != expected))
+	{
+		et::log::error("Drawn indices do not match pushed draws (%u of %u)", static_cast<uint32_t>(drawn.size()),
+			static_cast<uint32_t>(expected.size()));
+		++failures;
+	}
+
+	/*
+	 * Contiguous parts of every mesh should be merged into a single command
+	 */
+	if (commands.size() != instancesCount)
+	{
+		et::log::error("%u commands built for %u instances", static_cast<uint32_t>(commands.size()), instancesCount);
+		++failures;
+	}
+
+	et::log::info("%u instances, %u commands, %u groups", instancesCount, static_cast<uint32_t>(commands.size()),
+		static_cast<uint32_t>(groups.size()));
+
+	drawList->clear();
+	return failures == 0;
+}
+
+int main()
+{
+	et::log::addOutput(et::log::ConsoleOutput::Pointer::create());
+	et::log::info("Starting test...");
+
+	bool passed = runTest();
+	et::log::info("%s", passed ? "passed" : "FAILED");
+
+	system("pause");
+	return passed ? 0 : 1;
+}
+
+et::IApplicationDelegate* et::Application::initApplicationDelegate() { return nullptr; };
@@ -0,0 +1,163 @@
+#include <et/app/application.h>
+#include <et/rendering/interface/renderer.h>
+
+const uint32_t vertexCount = 200;
+const uint32_t indexCount = 250;
+const uint32_t verticesPerUpload = 37;
+const uint32_t indicesPerUpload = 13;
+
+/*
+ * Buffers are kept in memory, so uploaded contents could be compared
+ */
+class MockBuffer : public et::Buffer
+{
+public:
+	MockBuffer(uint64_t size) :
+		_data(size, 0xcd) { }
+
+	uint8_t* map(uint64_t, uint64_t) override { return nullptr; }
+	void modifyRange(uint64_t, uint64_t) override { }
+	void unmap() override { }
+	bool mapped() const override { return false; }
+	void transferData(et::Buffer::Pointer, uint64_t, uint64_t, uint64_t) override { }
+
+	void updateData(uint64_t offset, const et::BinaryDataStorage& data) override
+	{
+		ET_ASSERT(offset + data.size() <= _data.size());
+		memcpy(_data.data() + offset, data.data(), data.size());
+	}
+
+	uint64_t size() const override
+		{ return _data.size(); }
+
+	const uint8_t* data() const
+		{ return _data.data(); }
+
+private:
+	std::vector<uint8_t> _data;
+};
+
+class MockRenderer : public et::RenderInterface
+{
+public:
+	et::RenderingAPI api() const override { return et::RenderingAPI::Vulkan; }
+	void init(const et::RenderContextParameters&) override { }
+	void shutdown() override { }
+	void destroy() override { }
+	void resize(const et::vec2i&) override { }
+	et::vec2i contextSize() const override { return et::vec2i(0); }
+	et::RendererFrame allocateFrame() override { return et::RendererFrame(); }
+	void submitFrame(const et::RendererFrame&) override { }
+	void present() override { }
+
+	et::RenderPass::Pointer allocateRenderPass(const et::RenderPass::ConstructionInfo&) override { return et::RenderPass::Pointer(); }
+	void beginRenderPass(const et::RenderPass::Pointer&, const et::RenderPassBeginInfo&) override { }
+	void submitRenderPass(const et::RenderPass::Pointer&) override { }
+
+	et::Buffer::Pointer createBuffer(const std::string&, const et::Buffer::Description& desc) override
+		{ return et::Buffer::Pointer(new MockBuffer(desc.size)); }
+
+	et::Texture::Pointer createTexture(const et::TextureDescription::Pointer&) override { return et::Texture::Pointer(); }
+	et::TextureSet::Pointer createTextureSet(const et::TextureSet::Description&) override { return et::TextureSet::Pointer(); }
+	et::Program::Pointer createProgram(uint32_t, const std::string&) override { return et::Program::Pointer(); }
+	et::Sampler::Pointer createSampler(const et::Sampler::Description&) override { return et::Sampler::Pointer(); }
+	et::Compute::Pointer createCompute(const et::Material::Pointer&) override { return et::Compute::Pointer(); }
+
+	et::PipelineState::Pointer acquireGraphicsPipeline(const et::RenderPass::Pointer&, const et::Material::Pointer&,
+		const et::VertexStream::Pointer&) override { return et::PipelineState::Pointer(); }
+};
+
+uint32_t expectedIndex(uint32_t i)
+{
+	return (i * 7) % vertexCount;
+}
+
+bool validateStream(const et::VertexStream::Pointer& stream, const char* name)
+{
+	const MockBuffer* vertexBuffer = static_cast<const MockBuffer*>(stream->vertexBuffer().pointer());
+	const MockBuffer* indexBuffer = static_cast<const MockBuffer*>(stream->indexBuffer().pointer());
+
+	const float* positions = reinterpret_cast<const float*>(vertexBuffer->data()) + 3 * stream->baseVertex();
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		if ((positions[3 * i] != static_cast<float>(i)) || (positions[3 * i + 1] != static_cast<float>(2 * i)))
+		{
+			et::log::error("%s: vertex %u does not match", name, i);
+			return false;
+		}
+	}
+
+	uint32_t indexSize = static_cast<uint32_t>(stream->indexArrayFormat());
+	if ((indexSize != 2) && (indexSize != 4))
+	{
+		et::log::error("%s: unexpected index size %u, 8-bit indices should be converted", name, indexSize);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < indexCount; ++i)
+	{
+		const uint8_t* ptr = indexBuffer->data() + indexSize * (stream->firstIndex() + i);
+		uint32_t index = (indexSize == 2) ? *reinterpret_cast<const uint16_t*>(ptr) : *reinterpret_cast<const uint32_t*>(ptr);
+		if (index != expectedIndex(i))
+		{
+			et::log::error("%s: index %u is %u, expected %u", name, i, index, expectedIndex(i));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Geometry uploaded in parts should match geometry uploaded at once
+ */
+bool runTest(et::GeometryBuffer& geometryBuffer, et::IndexArrayFormat format)
+{
+	et::VertexDeclaration decl(true);
+	decl.push_back(et::VertexAttributeUsage::Position, et::DataType::Vec3);
+
+	et::VertexStorage::Pointer vertices = et::VertexStorage::Pointer::create(decl, vertexCount);
+	auto positions = vertices->accessData<et::DataType::Vec3>(et::VertexAttributeUsage::Position, 0);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+		positions[i] = et::vec3(static_cast<float>(i), static_cast<float>(2 * i), static_cast<float>(format));
+
+	et::IndexArray::Pointer indices = et::IndexArray::Pointer::create(format, indexCount, et::PrimitiveType::Triangles);
+	for (uint32_t i = 0; i < indexCount; ++i)
+		indices->setIndex(expectedIndex(i), i);
+
+	et::VertexStream::Pointer whole = geometryBuffer.allocate(vertices, indices);
+	et::VertexStream::Pointer parts = geometryBuffer.allocate(decl, vertexCount, format, indexCount, et::PrimitiveType::Triangles);
+
+	for (uint32_t i = 0; i < vertexCount; i += verticesPerUpload)
+		geometryBuffer.uploadVertices(parts, vertices, i, std::min(verticesPerUpload, vertexCount - i));
+
+	for (uint32_t i = 0; i < indexCount; i += indicesPerUpload)
+		geometryBuffer.uploadIndices(parts, indices, i, std::min(indicesPerUpload, indexCount - i));
+
+	bool passed = validateStream(whole, "whole") && validateStream(parts, "parts");
+	passed = passed && (whole->indexArrayFormat() == parts->indexArrayFormat());
+
+	et::log::info("%2u-bit indices : %s", 8 * static_cast<uint32_t>(format), passed ? "passed" : "FAILED");
+	return passed;
+}
+
+int main()
+{
+	et::log::addOutput(et::log::ConsoleOutput::Pointer::create());
+	et::log::info("Starting test...");
+
+	MockRenderer renderer;
+	et::GeometryBuffer geometryBuffer;
+	geometryBuffer.init(&renderer);
+
+	bool passed = runTest(geometryBuffer, et::IndexArrayFormat::Format_8bit);
+	passed = runTest(geometryBuffer, et::IndexArrayFormat::Format_16bit) && passed;
+	passed = runTest(geometryBuffer, et::IndexArrayFormat::Format_32bit) && passed;
+
+	geometryBuffer.shutdown();
+
+	system("pause");
+	return passed ? 0 : 1;
+}
+
+et::IApplicationDelegate* et::Application::initApplicationDelegate() { return nullptr; };
@@ -0,0 +1,163 @@
+#include <et/app/application.h>
+#include <et/rendering/base/meshoptimizer.h>
+#include <algorithm>
+#include <random>
+
+const uint32_t gridSize = 48;
+
+/*
+ * Triangle as contents of its vertices, rotated to start from the smallest one
+ * so the winding is preserved
+ */
+using TriangleKey = std::array<std::string, 3>;
+
+/*
+ * Grid where each quad has its own vertices, so most of them are duplicated,
+ * triangles are shuffled to make post-transform cache usage poor
+ */
+void buildGrid(et::VertexStorage::Pointer& vs, et::IndexArray::Pointer& ia, std::mt19937& generator)
+{
+	et::VertexDeclaration decl(true, et::VertexAttributeUsage::Position, et::DataType::Vec3);
+	decl.push_back(et::VertexAttributeUsage::Normal, et::DataType::Vec3);
+
+	vs = et::VertexStorage::Pointer::create(decl, 4 * gridSize * gridSize);
+	auto pos = vs->accessData<et::DataType::Vec3>(et::VertexAttributeUsage::Position, 0);
+	auto nrm = vs->accessData<et::DataType::Vec3>(et::VertexAttributeUsage::Normal, 0);
+
+	std::vector<std::array<uint32_t, 3>> triangles;
+	uint32_t vertex = 0;
+	for (uint32_t y = 0; y < gridSize; ++y)
+	{
+		for (uint32_t x = 0; x < gridSize; ++x)
+		{
+			for (uint32_t k = 0; k < 4; ++k)
+			{
+				float px = static_cast<float>(x + k % 2);
+				float py = static_cast<float>(y + k / 2);
+				pos[vertex + k] = et::vec3(px, py, 0.1f * std::sin(px * py));
+				nrm[vertex + k] = et::vec3(0.0f, 0.0f, 1.0f);
+			}
+			triangles.push_back({ vertex, vertex + 1, vertex + 3 });
+			triangles.push_back({ vertex, vertex + 3, vertex + 2 });
+			vertex += 4;
+		}
+	}
+	std::shuffle(triangles.begin(), triangles.end(), generator);
+
+	ia = et::IndexArray::Pointer::create(et::IndexArrayFormat::Format_32bit, 3 * static_cast<uint32_t>(triangles.size()),
+		et::PrimitiveType::Triangles);
+
+	uint32_t index = 0;
+	for (const auto& triangle : triangles)
+	{
+		for (uint32_t v : triangle)
+			ia->setIndex(v, index++);
+	}
+}
+
+std::vector<TriangleKey> rangeTriangles(const et::VertexStorage::Pointer& vs, const et::IndexArray::Pointer& ia,
+	const et::meshoptimizer::IndexRange& range)
+{
+	const char* data = vs->data().binary();
+	uint32_t stride = vs->stride();
+
+	std::vector<TriangleKey> result;
+	for (uint32_t i = range.first, e = range.first + range.count; i < e; i += 3)
+	{
+		TriangleKey key;
+		for (uint32_t k = 0; k < 3; ++k)
+			key[k] = std::string(data + ia->getIndex(i + k) * stride, stride);
+
+		std::rotate(key.begin(), std::min_element(key.begin(), key.end()), key.end());
+		result.emplace_back(key);
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+bool runTest(uint32_t options, const char* name)
+{
+	std::mt19937 generator(5);
+
+	et::VertexStorage::Pointer vs;
+	et::IndexArray::Pointer ia;
+	buildGrid(vs, ia, generator);
+
+	uint32_t indexCount = ia->capacity();
+	uint32_t split = 3 * (indexCount / 9);
+	et::meshoptimizer::IndexRangeList ranges =
+	{
+		et::meshoptimizer::IndexRange(0, split),
+		et::meshoptimizer::IndexRange(split, indexCount - split)
+	};
+
+	std::vector<std::vector<TriangleKey>> expected;
+	for (const et::meshoptimizer::IndexRange& range : ranges)
+		expected.emplace_back(rangeTriangles(vs, ia, range));
+
+	et::BinaryDataStorage sourceVertices(vs->data());
+	uint32_t sourceVertexCount = vs->capacity();
+
+	et::meshoptimizer::CacheStatistics before = et::meshoptimizer::analyzeVertexCache(ia, ranges);
+	et::meshoptimizer::optimize(vs, ia, ranges, options);
+	et::meshoptimizer::CacheStatistics after = et::meshoptimizer::analyzeVertexCache(ia, ranges);
+
+	bool passed = true;
+	for (size_t r = 0; r < ranges.size(); ++r)
+	{
+		if (rangeTriangles(vs, ia, ranges[r]) != expected[r])
+		{
+			et::log::error("%s: triangles of range %u changed", name, static_cast<uint32_t>(r));
+			passed = false;
+		}
+	}
+
+	for (uint32_t i = 0; i < ia->capacity(); ++i)
+	{
+		if (ia->getIndex(i) >= vs->capacity())
+		{
+			et::log::error("%s: index %u is out of vertex storage", name, i);
+			passed = false;
+			break;
+		}
+	}
+
+	if (options & et::meshoptimizer::Option_RemoveDuplicateVertices)
+	{
+		uint32_t uniqueCount = (gridSize + 1) * (gridSize + 1);
+		if (vs->capacity() != uniqueCount)
+		{
+			et::log::error("%s: %u vertices left of %u, %u unique", name, vs->capacity(), sourceVertexCount, uniqueCount);
+			passed = false;
+		}
+	}
+	else if ((vs->capacity() != sourceVertexCount) || (memcmp(vs->data().binary(), sourceVertices.binary(), sourceVertices.size()) != 0))
+	{
+		et::log::error("%s: vertex storage was modified", name);
+		passed = false;
+	}
+
+	if (!(after.acmr < before.acmr))
+	{
+		et::log::error("%s: ACMR was not improved", name);
+		passed = false;
+	}
+
+	et::log::info("%12s : ACMR %.3f -> %.3f, %u -> %u vertices, %s", name, before.acmr, after.acmr,
+		sourceVertexCount, vs->capacity(), passed ? "passed" : "FAILED");
+	return passed;
+}
+
+int main()
+{
+	et::log::addOutput(et::log::ConsoleOutput::Pointer::create());
+	et::log::info("Starting test...");
+
+	bool passed = runTest(et::meshoptimizer::Option_IndicesOnly, "indices only");
+	passed = runTest(et::meshoptimizer::Option_All, "all") && passed;
+
+	system("pause");
+	return passed ? 0 : 1;
+}
+
+et::IApplicationDelegate* et::Application::initApplicationDelegate() { return nullptr; };
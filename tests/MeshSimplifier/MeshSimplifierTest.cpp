@@ -0,0 +1,186 @@
+#include <et/app/application.h>
+#include <et/rendering/base/meshsimplifier.h>
+#include <set>
+
+const uint32_t segments = 96;
+const uint32_t rings = 64;
+const float radius = 10.0f;
+
+/*
+ * UV sphere with texture coordinates seam at u = 0 / 1
+ */
+void buildSphere(et::VertexStorage::Pointer& vs, et::IndexArray::Pointer& ia)
+{
+	et::VertexDeclaration decl(true, et::VertexAttributeUsage::Position, et::DataType::Vec3);
+	decl.push_back(et::VertexAttributeUsage::Normal, et::DataType::Vec3);
+	decl.push_back(et::VertexAttributeUsage::TexCoord0, et::DataType::Vec2);
+
+	vs = et::VertexStorage::Pointer::create(decl, (segments + 1) * (rings + 1));
+	auto pos = vs->accessData<et::DataType::Vec3>(et::VertexAttributeUsage::Position, 0);
+	auto nrm = vs->accessData<et::DataType::Vec3>(et::VertexAttributeUsage::Normal, 0);
+	auto uv = vs->accessData<et::DataType::Vec2>(et::VertexAttributeUsage::TexCoord0, 0);
+	for (uint32_t r = 0; r <= rings; ++r)
+	{
+		for (uint32_t s = 0; s <= segments; ++s)
+		{
+			float theta = PI * static_cast<float>(r) / static_cast<float>(rings);
+			float phi = DOUBLE_PI * static_cast<float>(s % segments) / static_cast<float>(segments);
+			et::vec3 n(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			if ((r == 0) || (r == rings))
+				n = et::vec3(0.0f, (r == 0) ? 1.0f : -1.0f, 0.0f);
+
+			uint32_t v = r * (segments + 1) + s;
+			pos[v] = radius * n;
+			nrm[v] = n;
+			uv[v] = et::vec2(static_cast<float>(s) / static_cast<float>(segments), static_cast<float>(r) / static_cast<float>(rings));
+		}
+	}
+
+	std::vector<uint32_t> indices;
+	for (uint32_t r = 0; r < rings; ++r)
+	{
+		for (uint32_t s = 0; s < segments; ++s)
+		{
+			uint32_t a = r * (segments + 1) + s;
+			uint32_t c = a + segments + 1;
+			if (r > 0)
+				indices.insert(indices.end(), { a, a + 1, c });
+			if (r + 1 < rings)
+				indices.insert(indices.end(), { a + 1, c + 1, c });
+		}
+	}
+
+	ia = et::IndexArray::Pointer::create(et::IndexArrayFormat::Format_32bit, static_cast<uint32_t>(indices.size()),
+		et::PrimitiveType::Triangles);
+	for (uint32_t i = 0, e = static_cast<uint32_t>(indices.size()); i < e; ++i)
+		ia->setIndex(indices[i], i);
+}
+
+/*
+ * Max distance from sphere surface to triangle centroids and edge midpoints
+ */
+float maxDeviation(const et::VertexStorage::Pointer& vs, const et::IndexArray::Pointer& ia, const et::meshoptimizer::IndexRange& range)
+{
+	const auto pos = vs->accessData<et::DataType::Vec3>(et::VertexAttributeUsage::Position, 0);
+
+	float result = 0.0f;
+	for (uint32_t i = range.first, e = range.first + range.count; i < e; i += 3)
+	{
+		const et::vec3& a = pos[ia->getIndex(i)];
+		const et::vec3& b = pos[ia->getIndex(i + 1)];
+		const et::vec3& c = pos[ia->getIndex(i + 2)];
+		et::vec3 points[] = { (a + b + c) / 3.0f, 0.5f * (a + b), 0.5f * (b + c), 0.5f * (c + a) };
+		for (const et::vec3& p : points)
+			result = std::max(result, radius - p.length());
+	}
+	return result;
+}
+
+bool runTest()
+{
+	et::VertexStorage::Pointer vs;
+	et::IndexArray::Pointer ia;
+	buildSphere(vs, ia);
+
+	/*
+	 * Upper and lower hemispheres, so both ranges have open borders
+	 */
+	uint32_t sourceIndexCount = ia->capacity();
+	uint32_t split = 3 * (sourceIndexCount / 6);
+	et::meshoptimizer::IndexRangeList ranges =
+	{
+		et::meshoptimizer::IndexRange(0, split),
+		et::meshoptimizer::IndexRange(split, sourceIndexCount - split)
+	};
+
+	et::meshsimplifier::Options options;
+	options.maxLevels = 6;
+	options.minTriangles = 16;
+	options.maxError = 0.02f;
+
+	et::Vector<et::meshsimplifier::LevelOfDetailList> levels = et::meshsimplifier::generateLevelsOfDetail(vs, ia, ranges, options);
+	if (levels.size() != ranges.size())
+	{
+		et::log::error("%u level lists generated for %u ranges", static_cast<uint32_t>(levels.size()),
+			static_cast<uint32_t>(ranges.size()));
+		return false;
+	}
+
+	/*
+	 * Hemisphere extent is its diameter
+	 */
+	float maxError = options.maxError * 2.0f * radius;
+
+	bool passed = true;
+	for (size_t r = 0; r < ranges.size(); ++r)
+	{
+		std::set<uint32_t> sourceVertices;
+		for (uint32_t i = ranges[r].first, e = ranges[r].first + ranges[r].count; i < e; ++i)
+			sourceVertices.insert(ia->getIndex(i));
+
+		float sourceDeviation = maxDeviation(vs, ia, ranges[r]);
+		uint32_t previousCount = ranges[r].count;
+		float previousError = 0.0f;
+
+		if (levels[r].empty())
+		{
+			et::log::error("Range %u: no levels of detail generated", static_cast<uint32_t>(r));
+			passed = false;
+		}
+
+		for (const et::meshsimplifier::LevelOfDetail& level : levels[r])
+		{
+			const et::meshoptimizer::IndexRange& range = level.range;
+			if ((range.count == 0) || (range.count % 3 != 0) || (range.count >= previousCount) ||
+				(range.first < sourceIndexCount) || (range.first + range.count > ia->capacity()))
+			{
+				et::log::error("Range %u: invalid level range %u, %u", static_cast<uint32_t>(r), range.first, range.count);
+				passed = false;
+				continue;
+			}
+
+			bool validIndices = true;
+			for (uint32_t i = range.first, e = range.first + range.count; i < e; ++i)
+				validIndices = validIndices && (sourceVertices.count(ia->getIndex(i)) > 0);
+
+			if (!validIndices)
+			{
+				et::log::error("Range %u: level references vertices outside of the source range", static_cast<uint32_t>(r));
+				passed = false;
+			}
+
+			/*
+			 * Reported error grows with the level and stays within requested bounds,
+			 * actual deviation from the surface is not above reported error
+			 */
+			float deviation = maxDeviation(vs, ia, range);
+			if ((level.error < previousError) || (level.error > maxError) || (deviation > level.error + sourceDeviation))
+			{
+				et::log::error("Range %u: error %.4f (previous %.4f, max %.4f), actual deviation %.4f", static_cast<uint32_t>(r),
+					level.error, previousError, maxError, deviation);
+				passed = false;
+			}
+
+			et::log::info("Range %u: %5u triangles, error %.4f, deviation %.4f", static_cast<uint32_t>(r),
+				range.count / 3, level.error, deviation);
+
+			previousCount = range.count;
+			previousError = level.error;
+		}
+	}
+	return passed;
+}
+
+int main()
+{
+	et::log::addOutput(et::log::ConsoleOutput::Pointer::create());
+	et::log::info("Starting test...");
+
+	bool passed = runTest();
+	et::log::info("%s", passed ? "passed" : "FAILED");
+
+	system("pause");
+	return passed ? 0 : 1;
+}
+
+et::IApplicationDelegate* et::Application::initApplicationDelegate() { return nullptr; };
@@ -0,0 +1,121 @@
+#include <et/app/application.h>
+
+const uint32_t iterationsCount = 2000;
+const uint32_t maxElementsCount = 50000;
+
+bool testCoverage()
+{
+	for (uint32_t iteration = 0; iteration < iterationsCount; ++iteration)
+	{
+		uint32_t count = 1 + (iteration * 7919) % maxElementsCount;
+		uint32_t minRangeSize = 1 + iteration % 300;
+
+		std::vector<std::atomic<uint32_t>> hits(count);
+		et::threading::parallelFor(count, minRangeSize, [&hits](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+				hits[i]++;
+		});
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (hits[i] != 1)
+			{
+				et::log::error("Coverage: element %u of %u processed %u times (min range size %u)",
+					i, count, hits[i].load(), minRangeSize);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool testNesting()
+{
+	const uint32_t outerCount = 4096;
+	const uint32_t innerCount = 1000;
+
+	std::vector<std::atomic<uint32_t>> hits(outerCount);
+	std::atomic<uint32_t> innerHits(0);
+
+	/*
+	 * Every outer range starts nested loop on the same pool,
+	 * caller should process unclaimed ranges itself instead of waiting for the workers
+	 */
+	et::threading::parallelFor(outerCount, 16, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+			hits[i]++;
+
+		et::threading::parallelFor(innerCount, 16, [&innerHits](uint32_t innerBegin, uint32_t innerEnd)
+		{
+			innerHits += innerEnd - innerBegin;
+		});
+	});
+
+	uint32_t rangesCount = innerHits / innerCount;
+	if ((innerHits % innerCount != 0) || (rangesCount == 0))
+	{
+		et::log::error("Nesting: inner loops processed %u elements, not a multiple of %u", innerHits.load(), innerCount);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < outerCount; ++i)
+	{
+		if (hits[i] != 1)
+		{
+			et::log::error("Nesting: element %u processed %u times", i, hits[i].load());
+			return false;
+		}
+	}
+	return true;
+}
+
+bool testSmallRanges()
+{
+	bool calledForEmpty = false;
+	et::threading::parallelFor(0, 1, [&calledForEmpty](uint32_t, uint32_t)
+		{ calledForEmpty = true; });
+
+	if (calledForEmpty)
+	{
+		et::log::error("Small ranges: function called for empty range");
+		return false;
+	}
+
+	uint32_t callsCount = 0;
+	std::thread::id caller = std::this_thread::get_id();
+	std::thread::id executor;
+	et::threading::parallelFor(100, 100, [&](uint32_t begin, uint32_t end)
+	{
+		executor = std::this_thread::get_id();
+		callsCount += (begin == 0) && (end == 100) ? 1 : 2;
+	});
+
+	if ((callsCount != 1) || (executor != caller))
+	{
+		et::log::error("Small ranges: range not smaller than minimal size should be processed inline");
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	et::log::addOutput(et::log::ConsoleOutput::Pointer::create());
+	et::log::info("Starting test, %u threads...", static_cast<uint32_t>(et::threading::maxConcurrentThreads()));
+
+	uint64_t startTime = et::queryCurrentTimeInMicroSeconds();
+
+	bool passed = testCoverage();
+	passed = testNesting() && passed;
+	passed = testSmallRanges() && passed;
+
+	uint64_t totalTime = et::queryCurrentTimeInMicroSeconds() - startTime;
+	et::log::info("%s : % 4llu.%04llu", passed ? "passed" : "FAILED", totalTime / 1000, totalTime % 1000);
+
+	system("pause");
+	return passed ? 0 : 1;
+}
+
+et::IApplicationDelegate* et::Application::initApplicationDelegate() { return nullptr; };
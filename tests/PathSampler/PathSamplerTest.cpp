@@ -0,0 +1,164 @@
+#include <et/app/application.h>
+#include <et-ext/rt/sampler.h>
+
+const uint32_t pixelsCount = 2000;
+const uint32_t dimensionsCount = 3;
+const uint32_t samplesPerPixel[] = { 16, 64, 256 };
+const double quarterDiscArea = 3.14159265358979 / 4.0;
+
+const char* samplerName(et::rt::PathSamplerType type)
+{
+	static const char* names[] = { "random", "sobol", "lattice" };
+	return names[static_cast<uint32_t>(type)];
+}
+
+/*
+ * Estimates area of the quarter disc within unit square in each 2D dimension of the path,
+ * returns RMSE over all pixels and dimensions, or negative value if sample is out of [0, 1)
+ */
+double quarterDiscError(et::rt::PathSamplerType type, uint32_t samples)
+{
+	double squaredError = 0.0;
+	for (uint32_t pixel = 0; pixel < pixelsCount; ++pixel)
+	{
+		et::rt::PathSampler sampler(type, 1);
+
+		uint32_t inside[dimensionsCount] = { };
+		for (uint32_t i = 0; i < samples; ++i)
+		{
+			sampler.startSample(pixel, i);
+			for (uint32_t d = 0; d < dimensionsCount; ++d)
+			{
+				et::rt::float4 value = sampler.next2D();
+				float x = value.component<0>();
+				float y = value.component<1>();
+				if ((x < 0.0f) || (x >= 1.0f) || (y < 0.0f) || (y >= 1.0f))
+					return -1.0;
+
+				inside[d] += (x * x + y * y < 1.0f) ? 1 : 0;
+			}
+		}
+
+		for (uint32_t d = 0; d < dimensionsCount; ++d)
+		{
+			double e = static_cast<double>(inside[d]) / static_cast<double>(samples) - quarterDiscArea;
+			squaredError += e * e;
+		}
+	}
+	return std::sqrt(squaredError / static_cast<double>(pixelsCount * dimensionsCount));
+}
+
+/*
+ * First 16 Sobol samples of the pixel should fall into separate cells of 4x4 grid in every dimension
+ */
+bool testSobolStratification()
+{
+	for (uint32_t pixel = 0; pixel < pixelsCount; ++pixel)
+	{
+		et::rt::PathSampler sampler(et::rt::PathSamplerType::Sobol, 1);
+
+		uint32_t cells[dimensionsCount][16] = { };
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			sampler.startSample(pixel, i);
+			for (uint32_t d = 0; d < dimensionsCount; ++d)
+			{
+				et::rt::float4 value = sampler.next2D();
+				uint32_t cx = static_cast<uint32_t>(4.0f * value.component<0>());
+				uint32_t cy = static_cast<uint32_t>(4.0f * value.component<1>());
+				cells[d][cx + 4 * cy]++;
+			}
+		}
+
+		for (uint32_t d = 0; d < dimensionsCount; ++d)
+		{
+			for (uint32_t c = 0; c < 16; ++c)
+			{
+				if (cells[d][c] != 1)
+				{
+					et::log::error("Sobol samples of pixel %u are not stratified in dimension %u", pixel, d);
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/*
+ * Sequence should depend only on pixel, sample and seed
+ */
+bool testDeterminism(et::rt::PathSamplerType type)
+{
+	et::rt::PathSampler a(type, 7);
+	et::rt::PathSampler b(type, 7);
+	for (uint32_t i = 0; i < 64; ++i)
+	{
+		a.startSample(13, i);
+		b.startSample(13, 63 - i);
+		b.startSample(13, i);
+		for (uint32_t d = 0; d < dimensionsCount; ++d)
+		{
+			float x = a.next1D();
+			float y = b.next1D();
+			if (x != y)
+			{
+				et::log::error("%s: sample %u differs in dimension %u", samplerName(type), i, d);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	et::log::addOutput(et::log::ConsoleOutput::Pointer::create());
+	et::log::info("Starting test...");
+
+	et::rt::PathSamplerType types[] =
+	{
+		et::rt::PathSamplerType::Random,
+		et::rt::PathSamplerType::Sobol,
+		et::rt::PathSamplerType::Lattice
+	};
+
+	bool passed = true;
+	double errors[3][3] = { };
+	for (uint32_t t = 0; t < 3; ++t)
+	{
+		for (uint32_t s = 0; s < 3; ++s)
+		{
+			errors[t][s] = quarterDiscError(types[t], samplesPerPixel[s]);
+			if (errors[t][s] < 0.0)
+			{
+				et::log::error("%s: sample is out of [0, 1) range", samplerName(types[t]));
+				passed = false;
+			}
+		}
+		et::log::info("%8s : RMSE %.5f / %.5f / %.5f at %u / %u / %u spp", samplerName(types[t]),
+			errors[t][0], errors[t][1], errors[t][2], samplesPerPixel[0], samplesPerPixel[1], samplesPerPixel[2]);
+
+		passed = testDeterminism(types[t]) && passed;
+	}
+
+	/*
+	 * Stratified sequences should converge noticeably faster than random ones
+	 */
+	for (uint32_t t = 1; t < 3; ++t)
+	{
+		if (!(errors[t][2] < 0.5 * errors[0][2]))
+		{
+			et::log::error("%s: RMSE at %u spp is not below half of random", samplerName(types[t]), samplesPerPixel[2]);
+			passed = false;
+		}
+	}
+
+	passed = testSobolStratification() && passed;
+	et::log::info("%s", passed ? "passed" : "FAILED");
+
+	system("pause");
+	return passed ? 0 : 1;
+}
+
+et::IApplicationDelegate* et::Application::initApplicationDelegate() { return nullptr; };
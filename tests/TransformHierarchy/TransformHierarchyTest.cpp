@@ -0,0 +1,189 @@
+#include <et/app/application.h>
+#include <et/scene3d/transformhierarchy.h>
+#include <random>
+
+const uint32_t initialNodesCount = 40000;
+const uint32_t iterationsCount = 30;
+const uint32_t editsPerIteration = 300;
+const uint32_t noParent = static_cast<uint32_t>(-1);
+
+/*
+ * Reference model: local transforms and parents of the nodes, world transforms
+ * are evaluated naively by walking up to the root
+ */
+struct Model
+{
+	std::vector<et::s3d::TransformHierarchy::Handle> handles;
+	std::vector<uint32_t> parents;
+	std::vector<et::mat4> locals;
+	std::vector<bool> alive;
+
+	et::mat4 world(uint32_t node) const
+	{
+		et::mat4 result = locals[node];
+		for (uint32_t p = parents[node]; p != noParent; p = parents[p])
+			result = result * locals[p];
+		return result;
+	}
+
+	bool isAncestor(uint32_t node, uint32_t of) const
+	{
+		for (uint32_t p = of; p != noParent; p = parents[p])
+		{
+			if (p == node)
+				return true;
+		}
+		return false;
+	}
+};
+
+et::mat4 randomTransform(std::mt19937& generator)
+{
+	et::mat4 result = et::identityMatrix;
+	result[0][0] = 1.0f + 0.01f * static_cast<float>(generator() % 3);
+	result[1][0] = 0.02f * static_cast<float>(generator() % 3);
+	result[3] = et::vec4(static_cast<float>(generator() % 7) - 3.0f, static_cast<float>(generator() % 5),
+		static_cast<float>(generator() % 3), 1.0f);
+	return result;
+}
+
+void addNode(et::s3d::TransformHierarchy& hierarchy, Model& model, uint32_t parent, std::mt19937& generator)
+{
+	et::s3d::TransformHierarchy::Handle parentHandle = (parent == noParent) ?
+		et::s3d::TransformHierarchy::InvalidHandle : model.handles[parent];
+
+	et::mat4 local = randomTransform(generator);
+	et::s3d::TransformHierarchy::Handle handle = hierarchy.allocate(parentHandle);
+	hierarchy.setLocalTransform(handle, local);
+
+	model.handles.emplace_back(handle);
+	model.parents.emplace_back(parent);
+	model.locals.emplace_back(local);
+	model.alive.emplace_back(true);
+}
+
+float maxDifference(const et::mat4& a, const et::mat4& b)
+{
+	float result = 0.0f;
+	for (int r = 0; r < 4; ++r)
+	{
+		for (int c = 0; c < 4; ++c)
+			result = std::max(result, std::abs(a[r][c] - b[r][c]));
+	}
+	return result;
+}
+
+/*
+ * Random edits between updates: local transforms, new nodes, reparenting and releasing.
+ * Hierarchy is large enough to be updated in parallel by subtree ranges
+ */
+bool runTest()
+{
+	std::mt19937 generator(7);
+	et::s3d::TransformHierarchy hierarchy;
+	Model model;
+
+	/*
+	 * One large root with deep and wide subtrees, and a number of small roots
+	 */
+	addNode(hierarchy, model, noParent, generator);
+	for (uint32_t i = 1; i < initialNodesCount; ++i)
+	{
+		uint32_t r = generator() % 10;
+		uint32_t parent = (r == 0) ? noParent : ((r < 4) ? 0 : generator() % i);
+		addNode(hierarchy, model, parent, generator);
+	}
+
+	uint32_t failures = 0;
+	for (uint32_t iteration = 0; iteration < iterationsCount; ++iteration)
+	{
+		for (uint32_t k = 0; k < editsPerIteration; ++k)
+		{
+			uint32_t operation = generator() % 4;
+			uint32_t node = generator() % model.handles.size();
+			if (!model.alive[node])
+				continue;
+
+			if (operation == 0)
+			{
+				model.locals[node] = randomTransform(generator);
+				hierarchy.setLocalTransform(model.handles[node], model.locals[node]);
+			}
+			else if (operation == 1)
+			{
+				addNode(hierarchy, model, (generator() % 3 == 0) ? noParent : node, generator);
+			}
+			else if ((operation == 2) && (iteration % 3 == 0))
+			{
+				uint32_t parent = generator() % model.handles.size();
+				if (model.alive[parent] && !model.isAncestor(node, parent))
+				{
+					model.parents[node] = parent;
+					hierarchy.setParent(model.handles[node], model.handles[parent]);
+				}
+			}
+			else if ((operation == 3) && (node != 0) && (k % 10 == 0))
+			{
+				/*
+				 * Children of the released node become roots
+				 */
+				model.alive[node] = false;
+				hierarchy.release(model.handles[node]);
+				for (uint32_t& parent : model.parents)
+				{
+					if (parent == node)
+						parent = noParent;
+				}
+			}
+		}
+
+		hierarchy.update();
+
+		for (uint32_t i = 0, e = static_cast<uint32_t>(model.handles.size()); i < e; ++i)
+		{
+			if (!model.alive[i])
+				continue;
+
+			et::mat4 expected = model.world(i);
+			float difference = maxDifference(hierarchy.worldTransform(model.handles[i]), expected);
+			if (difference > 0.01f * (1.0f + std::abs(expected[3][0])))
+			{
+				if (failures++ < 5)
+					et::log::error("Iteration %u, node %u: world transform differs by %f", iteration, i, difference);
+			}
+		}
+	}
+
+	for (uint32_t i = 0, e = static_cast<uint32_t>(model.handles.size()); i < e; i += 97)
+	{
+		if (!model.alive[i])
+			continue;
+
+		et::mat4 expected = hierarchy.worldTransform(model.handles[i]).inverted().transposed();
+		expected[3] = et::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		if (maxDifference(hierarchy.worldRotationTransform(model.handles[i]), expected) > 0.001f)
+		{
+			if (failures++ < 5)
+				et::log::error("Node %u: rotation transform is not inverse-transpose of world transform", i);
+		}
+	}
+
+	et::log::info("%u nodes, %u failures", static_cast<uint32_t>(model.handles.size()), failures);
+	return failures == 0;
+}
+
+int main()
+{
+	et::log::addOutput(et::log::ConsoleOutput::Pointer::create());
+	et::log::info("Starting test...");
+
+	uint64_t startTime = et::queryCurrentTimeInMicroSeconds();
+	bool passed = runTest();
+	uint64_t totalTime = et::queryCurrentTimeInMicroSeconds() - startTime;
+	et::log::info("%s : % 4llu.%04llu", passed ? "passed" : "FAILED", totalTime / 1000, totalTime % 1000);
+
+	system("pause");
+	return passed ? 0 : 1;
+}
+
+et::IApplicationDelegate* et::Application::initApplicationDelegate() { return nullptr; };
@@ -0,0 +1,178 @@
+#include <et/app/application.h>
+#include <et-ext/rt/kdtree.h>
+#include <random>
+
+const int gridSize = 64;
+const uint32_t randomRaysCount = 20000;
+const float distanceTolerance = 0.0001f;
+
+et::vec3 gridVertex(int x, int y)
+{
+	return et::vec3(0.37f * static_cast<float>(x) - 7.1f, 0.29f * static_cast<float>(y) - 5.3f,
+		0.013f * static_cast<float>(x * y % 7));
+}
+
+et::rt::TriangleList buildGrid()
+{
+	et::rt::TriangleList result;
+	result.reserve(2 * gridSize * gridSize);
+	for (int y = 0; y < gridSize; ++y)
+	{
+		for (int x = 0; x < gridSize; ++x)
+		{
+			et::rt::Triangle a;
+			a.v[0] = et::rt::float4(gridVertex(x, y), 0.0f);
+			a.v[1] = et::rt::float4(gridVertex(x + 1, y), 0.0f);
+			a.v[2] = et::rt::float4(gridVertex(x + 1, y + 1), 0.0f);
+			a.computeSupportData();
+			result.emplace_back(a);
+
+			et::rt::Triangle b;
+			b.v[0] = et::rt::float4(gridVertex(x, y), 0.0f);
+			b.v[1] = et::rt::float4(gridVertex(x + 1, y + 1), 0.0f);
+			b.v[2] = et::rt::float4(gridVertex(x, y + 1), 0.0f);
+			b.computeSupportData();
+			result.emplace_back(b);
+		}
+	}
+	return result;
+}
+
+/*
+ * Closest hit distance by testing every triangle, negative if nothing was hit
+ */
+float bruteForceDistance(const et::rt::TriangleList& triangles, const et::rt::Ray& ray)
+{
+	et::rt::WatertightRay watertightRay(ray);
+
+	float closest = std::numeric_limits<float>::max();
+	for (size_t i = 0, e = triangles.size(); i < e; ++i)
+	{
+		et::rt::TriangleBlock block;
+		block.set(0, triangles[i], static_cast<uint32_t>(i));
+
+		float t = 0.0f;
+		et::rt::float4 barycentric;
+		if (et::rt::intersectTriangleBlock(block, watertightRay, 0.0f, closest, t, barycentric) != et::rt::InvalidIndex)
+			closest = t;
+	}
+	return (closest == std::numeric_limits<float>::max()) ? -1.0f : closest;
+}
+
+/*
+ * Rays aimed exactly at shared vertices and edges of the grid should never pass between triangles
+ */
+bool testWatertightness(const et::rt::KDTree& tree, std::mt19937& generator)
+{
+	std::uniform_real_distribution<float> offset(-3.0f, 3.0f);
+
+	uint32_t missed = 0;
+	uint32_t total = 0;
+	for (int y = 1; y < gridSize; ++y)
+	{
+		for (int x = 1; x < gridSize; ++x)
+		{
+			et::vec3 targets[] =
+			{
+				gridVertex(x, y),
+				0.5f * (gridVertex(x, y) + gridVertex(x + 1, y + 1)),
+				0.5f * (gridVertex(x, y) + gridVertex(x + 1, y)),
+				0.5f * (gridVertex(x, y) + gridVertex(x, y + 1)),
+			};
+
+			for (const et::vec3& target : targets)
+			{
+				et::vec3 origin = target + et::vec3(offset(generator), offset(generator), 5.0f);
+				et::rt::Ray ray(et::rt::float4(origin, 1.0f), et::rt::float4(normalize(target - origin), 0.0f));
+				missed += (tree.traverse(ray).triangleIndex == et::rt::InvalidIndex) ? 1 : 0;
+				++total;
+			}
+		}
+	}
+
+	if (missed > 0)
+		et::log::error("%u of %u rays through vertices and edges missed", missed, total);
+
+	return missed == 0;
+}
+
+/*
+ * Closest hits and occlusion queries of random rays should match brute force
+ */
+bool testRandomRays(const et::rt::KDTree& tree, const et::rt::TriangleList& triangles, std::mt19937& generator)
+{
+	std::uniform_real_distribution<float> position(-12.0f, 12.0f);
+	std::uniform_real_distribution<float> maxDistanceScale(0.5f, 1.5f);
+
+	uint32_t mismatches = 0;
+	for (uint32_t i = 0; i < randomRaysCount; ++i)
+	{
+		et::vec3 origin(position(generator), position(generator), 6.0f);
+		et::vec3 target(position(generator), position(generator), 0.0f);
+		et::rt::Ray ray(et::rt::float4(origin, 1.0f), et::rt::float4(normalize(target - origin), 0.0f));
+
+		float expected = bruteForceDistance(triangles, ray);
+
+		et::rt::KDTree::TraverseResult hit = tree.traverse(ray);
+		bool hasHit = (hit.triangleIndex != et::rt::InvalidIndex);
+		if (hasHit != (expected >= 0.0f))
+		{
+			++mismatches;
+			continue;
+		}
+
+		if (hasHit)
+		{
+			float distance = (hit.intersectionPoint - ray.origin).length();
+			if (std::abs(distance - expected) > distanceTolerance * std::max(1.0f, expected))
+				++mismatches;
+		}
+
+		float maxDistance = hasHit ? expected * maxDistanceScale(generator) : std::numeric_limits<float>::max();
+		bool expectedOcclusion = hasHit && (expected < maxDistance);
+		if (tree.occluded(ray, maxDistance) != expectedOcclusion)
+			++mismatches;
+	}
+
+	if (mismatches > 0)
+		et::log::error("%u of %u random rays do not match brute force", mismatches, randomRaysCount);
+
+	return mismatches == 0;
+}
+
+int main()
+{
+	et::log::addOutput(et::log::ConsoleOutput::Pointer::create());
+	et::log::info("Starting test...");
+
+	et::rt::TriangleList triangles = buildGrid();
+
+	const char* names[] = { "kd-tree", "BVH4", "BVH8" };
+	et::rt::AccelerationStructure structures[] =
+	{
+		et::rt::AccelerationStructure::KDTree,
+		et::rt::AccelerationStructure::BVH4,
+		et::rt::AccelerationStructure::BVH8
+	};
+
+	bool passed = true;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		std::mt19937 generator(1);
+
+		et::rt::KDTree tree;
+		tree.build(triangles, 32, structures[i]);
+
+		bool structurePassed = testWatertightness(tree, generator);
+		structurePassed = testRandomRays(tree, triangles, generator) && structurePassed;
+		et::log::info("%8s : %s", names[i], structurePassed ? "passed" : "FAILED");
+
+		tree.cleanUp();
+		passed = passed && structurePassed;
+	}
+
+	system("pause");
+	return passed ? 0 : 1;
+}
+
+et::IApplicationDelegate* et::Application::initApplicationDelegate() { return nullptr; };
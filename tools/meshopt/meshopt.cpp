@@ -0,0 +1,121 @@
+#include <et/core/tools.h>
+#include <et/core/serialization.h>
+#include <et/rendering/base/meshoptimizer.h>
+
+using namespace et;
+
+void printHelp()
+{
+	log::info("Using:\n"
+		"meshopt -in <INPUT FILE> -out <OUTPUT FILE>\n"
+		"\tinput and output files contain serialized vertex storage followed by serialized index array\n"
+		"\tOPTIONAL: -indicesonly, default off - don't modify vertex storage, only reorder triangles\n"
+		"\tOPTIONAL: -threshold <VALUE>, default: 1.05 - max ACMR ratio of overdraw clusters\n"
+		"\tOPTIONAL: -analyze, default off - only print cache statistics, don't write output.");
+}
+
+void printStatistics(const char* tag, const meshoptimizer::CacheStatistics& stats)
+{
+	log::info("%s: %u triangles, %u unique vertices, %u transformed vertices, ACMR: %.3f, ATVR: %.3f", tag,
+		stats.triangles, stats.uniqueVertices, stats.transformedVertices, stats.acmr, stats.atvr);
+}
+
+int main(int argc, char* argv[])
+{
+	log::addOutput(log::ConsoleOutput::Pointer::create());
+
+	bool hasInput = false;
+	bool hasOutput = false;
+	bool analyzeOnly = false;
+	bool indicesOnly = false;
+
+	std::string inFile;
+	std::string outFile;
+	float threshold = 1.05f;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if ((strcmp(argv[i], "-in") == 0) && (i + 1 < argc))
+		{
+			inFile = std::string(argv[i+1]);
+			if (fileExists(inFile))
+			{
+				hasInput = true;
+				++i;
+			}
+			else
+			{
+				log::error("Input file not found: %s", inFile.c_str());
+				return 0;
+			}
+		}
+		else if ((strcmp(argv[i], "-out") == 0) && (i + 1 < argc))
+		{
+			outFile = std::string(argv[i+1]);
+			hasOutput = true;
+			++i;
+		}
+		else if ((strcmp(argv[i], "-threshold") == 0) && (i + 1 < argc))
+		{
+			threshold = strToFloat(std::string(argv[i+1]));
+			++i;
+		}
+		else if (strcmp(argv[i], "-indicesonly") == 0)
+		{
+			indicesOnly = true;
+		}
+		else if (strcmp(argv[i], "-analyze") == 0)
+		{
+			analyzeOnly = true;
+		}
+	}
+
+	if (!hasInput || (!hasOutput && !analyzeOnly))
+	{
+		printHelp();
+		return 0;
+	}
+
+	VertexStorage::Pointer vertexStorage = VertexStorage::Pointer::create(VertexDeclaration(true), 0);
+	IndexArray::Pointer indexArray = IndexArray::Pointer::create(IndexArrayFormat::Format_32bit, 0, PrimitiveType::Triangles);
+	{
+		std::ifstream fIn(inFile, std::ios::binary);
+		vertexStorage->deserialize(fIn);
+		indexArray->deserialize(fIn);
+		if (fIn.fail())
+		{
+			log::error("Unable to read mesh from file: %s", inFile.c_str());
+			return 0;
+		}
+	}
+
+	if ((indexArray->primitiveType() != PrimitiveType::Triangles) || !vertexStorage->hasAttribute(VertexAttributeUsage::Position))
+	{
+		log::error("Only triangle lists with positions could be optimized");
+		return 0;
+	}
+
+	uint32_t indexCount = indexArray->actualSize() > 0 ? indexArray->actualSize() : indexArray->capacity();
+	meshoptimizer::IndexRangeList ranges = { meshoptimizer::IndexRange(0, indexCount - indexCount % 3) };
+	printStatistics("Input", meshoptimizer::analyzeVertexCache(indexArray, ranges));
+
+	if (analyzeOnly)
+		return 0;
+
+	if (!indicesOnly)
+		meshoptimizer::removeDuplicateVertices(vertexStorage, indexArray, ranges);
+
+	meshoptimizer::optimizeVertexCache(indexArray, ranges.front());
+	meshoptimizer::optimizeOverdraw(indexArray, vertexStorage, ranges.front(), threshold);
+
+	if (!indicesOnly)
+		meshoptimizer::optimizeVertexFetch(vertexStorage, indexArray, ranges);
+
+	printStatistics("Output", meshoptimizer::analyzeVertexCache(indexArray, ranges));
+
+	std::ofstream fOut(outFile, std::ios::binary);
+	vertexStorage->serialize(fOut);
+	indexArray->serialize(fOut);
+
+	return 0;
+}